@@ -7,10 +7,22 @@
 #  - Engine performance (scheduler, executor, queue)
 #  - Workflow throughput and latency
 #  - Plugin/connector benchmarks
+#  - Native plugin load tests (plugins/cpp and plugins/c over pipes)
 #  - CPU/memory profiling
 #
 # All results are saved into: benchmarks/results/<timestamp>/
 #
+# Usage:
+#   benchmarks/run_benchmarks.sh                 # everything (needs Docker)
+#   benchmarks/run_benchmarks.sh --plugins-only  # native plugin load tests only (no Docker)
+#
+# Native plugin load tests build the sample plugins and omni_plugin_loadgen
+# (plugins/cpp/tests/benchmark/plugin_loadgen.cpp) and write one JSON report
+# per run, plus plugins_summary.json. Tune them with:
+#   BENCH_REQUESTS (20000), BENCH_SIZE (128 bytes per request line),
+#   BENCH_MIX (echo=1,reverse=1,compute=1), BENCH_CONCURRENCY ("1 32"),
+#   BENCH_BUILD_DIR (benchmarks/.build)
+#
 
 set -e
 set -o pipefail
@@ -32,6 +44,21 @@ RESULTS_DIR="${ROOT_DIR}/benchmarks/results"
 TIMESTAMP=$(date +"%Y-%m-%d_%H-%M-%S")
 OUTPUT_DIR="${RESULTS_DIR}/${TIMESTAMP}"
 
+PLUGINS_ONLY=0
+for arg in "$@"; do
+  case "$arg" in
+    --plugins-only) PLUGINS_ONLY=1 ;;
+    -h|--help) sed -n '2,30p' "$0"; exit 0 ;;
+    *) echo "unknown option: $arg" >&2; exit 2 ;;
+  esac
+done
+
+BENCH_REQUESTS="${BENCH_REQUESTS:-20000}"
+BENCH_SIZE="${BENCH_SIZE:-128}"
+BENCH_MIX="${BENCH_MIX:-echo=1,reverse=1,compute=1}"
+BENCH_CONCURRENCY="${BENCH_CONCURRENCY:-1 32}"
+BENCH_BUILD_DIR="${BENCH_BUILD_DIR:-${ROOT_DIR}/benchmarks/.build}"
+
 mkdir -p "$OUTPUT_DIR"
 
 # ------------------------------
@@ -39,12 +66,14 @@ mkdir -p "$OUTPUT_DIR"
 # ------------------------------
 echo -e "${BLUE}→ Checking environment...${NC}"
 
-if ! command -v docker >/dev/null 2>&1; then
+if [ "$PLUGINS_ONLY" -eq 1 ]; then
+  echo -e "${YELLOW}--plugins-only: Docker suites skipped${NC}"
+elif ! command -v docker >/dev/null 2>&1; then
   echo -e "${RED}Docker is required but not installed.${NC}"
   exit 1
 fi
 
-if ! docker info >/dev/null 2>&1; then
+if [ "$PLUGINS_ONLY" -eq 0 ] && ! docker info >/dev/null 2>&1; then
   echo -e "${RED}Docker daemon is not running.${NC}"
   exit 1
 fi
@@ -76,6 +105,92 @@ run_docker_benchmark() {
     | tee "${OUTPUT_DIR}/${name}.log"
 }
 
+# Build the native sample plugins and the load generator into BENCH_BUILD_DIR.
+# A plugin that fails to build is skipped (reported, not fatal).
+build_native_plugins() {
+  local cpp_out="${BENCH_BUILD_DIR}/cpp"
+  local c_out="${BENCH_BUILD_DIR}/c"
+  mkdir -p "$cpp_out" "$c_out"
+
+  if make -C "${ROOT_DIR}/plugins/cpp" BUILD_DIR="$cpp_out" OUT_DIR="$cpp_out" \
+       direct-build "${cpp_out}/omni_plugin_loadgen" >"${OUTPUT_DIR}/build_plugin_cpp.log" 2>&1; then
+    LOADGEN="${cpp_out}/omni_plugin_loadgen"
+    CPP_PLUGIN="${cpp_out}/omni_plugin_cpp"
+  else
+    echo -e "${RED}C++ plugin / load generator build failed (see build_plugin_cpp.log)${NC}"
+  fi
+
+  if make -C "${ROOT_DIR}/plugins/c" OUTDIR="$c_out" build >"${OUTPUT_DIR}/build_plugin_c.log" 2>&1; then
+    C_PLUGIN="${c_out}/sample_plugin"
+  else
+    echo -e "${RED}C plugin build failed (see build_plugin_c.log)${NC}"
+  fi
+}
+
+# run_loadgen <label> <plugin binary> <concurrency> [KEY=VALUE env...]
+run_loadgen() {
+  local label="$1" binary="$2" conc="$3"
+  shift 3
+  local report="${OUTPUT_DIR}/plugin_${label}_c${conc}.json"
+  local env_args=()
+  for kv in "$@"; do env_args+=(--env "$kv"); done
+
+  echo -e "${BLUE}→ ${label}: concurrency=${conc} size=${BENCH_SIZE} mix=${BENCH_MIX}${NC}"
+  if "$LOADGEN" --plugin "$binary" --name "$label" --requests "$BENCH_REQUESTS" \
+       --concurrency "$conc" --size "$BENCH_SIZE" --mix "$BENCH_MIX" \
+       "${env_args[@]}" --out "$report"; then
+    echo -e "${GREEN}✓ $(cat "$report")${NC}"
+  else
+    echo -e "${RED}✗ ${label} (c${conc}) had failures: ${report}${NC}"
+  fi
+}
+
+run_native_plugin_benchmarks() {
+  log_section "Native Plugin Benchmarks (load generator over pipes)"
+
+  LOADGEN="" CPP_PLUGIN="" C_PLUGIN=""
+  build_native_plugins
+  if [ -z "$LOADGEN" ]; then
+    echo -e "${RED}No load generator; native plugin benchmarks skipped${NC}"
+    return 0
+  fi
+
+  for conc in $BENCH_CONCURRENCY; do
+    if [ -n "$CPP_PLUGIN" ]; then
+      run_loadgen cpp "$CPP_PLUGIN" "$conc"
+      # the worker pool only pays off with requests in flight
+      if [ "$conc" -gt 1 ]; then
+        run_loadgen cpp_workers "$CPP_PLUGIN" "$conc" OMNIFLOW_PLUGIN_WORKERS=auto
+      fi
+    fi
+    if [ -n "$C_PLUGIN" ]; then
+      run_loadgen c "$C_PLUGIN" "$conc"
+    fi
+  done
+
+  # one JSON array with every run, for dashboards and regression checks
+  local summary="${OUTPUT_DIR}/plugins_summary.json"
+  local first=1
+  {
+    echo "["
+    for f in "${OUTPUT_DIR}"/plugin_*.json; do
+      [ -e "$f" ] || continue
+      [ "$first" -eq 1 ] || echo ","
+      first=0
+      tr -d '\n' <"$f"
+    done
+    echo "]"
+  } >"$summary"
+  echo -e "${GREEN}✓ Summary: ${summary}${NC}"
+}
+
+if [ "$PLUGINS_ONLY" -eq 1 ]; then
+  run_native_plugin_benchmarks
+  log_section "Benchmark Suite Completed"
+  echo -e "${GREEN}Results saved to:${NC} ${OUTPUT_DIR}"
+  exit 0
+fi
+
 # ------------------------------
 # CPU & Memory Profiling Baseline
 # ------------------------------
@@ -134,6 +249,12 @@ else
   echo -e "${YELLOW}No plugin benchmarking directory found.${NC}"
 fi
 
+# ------------------------------
+# Native Plugin Benchmarks
+# ------------------------------
+
+run_native_plugin_benchmarks
+
 # ------------------------------
 # Final Summary
 # ------------------------------
@@ -20,10 +20,13 @@
  * Host -> Plugin messages (newline terminated JSON):
  * {
  *   "id": "<uuid>",
- *   "type": "exec" | "health" | "shutdown",
+ *   "type": "exec" | "batch" | "health" | "shutdown",
  *   "payload": { ... }
  * }
  *
+ * A "batch" carries payload.requests[] (exec/health envelopes) and is answered
+ * by a single response whose body.responses[] holds one response per item.
+ *
  * Plugin -> Host responses (newline terminated JSON):
  * {
  *   "id": "<uuid>",
@@ -60,6 +63,15 @@
  * - OMNIFLOW_PLUGIN_MAX_LINE=131072    # max bytes per incoming message (default 131072)
  * - OMNIFLOW_PLUGIN_HEARTBEAT=5        # heartbeat interval seconds
  * - OMNIFLOW_LOG_JSON=true             # if set, emit structured JSON logs to stderr
+ * - OMNIFLOW_PLUGIN_FLUSH_US=0         # >0: coalesce responses into fewer write(2) calls;
+ *                                      #     flushed when stdin is idle, at 64 KiB, or this
+ *                                      #     many microseconds after the first buffered one
+ * - OMNIFLOW_PLUGIN_TIMINGS=1          # 0/false/off: no per-stage timings in response "meta"
+ * - OMNIFLOW_PLUGIN_QUEUE_MAX=0         # >0: answer exec/batch "busy" while this many
+ *                                      #     requests are already read ahead and waiting
+ * - OMNIFLOW_PLUGIN_QUEUE_BYTES=0       # >0: same, once this many bytes are read ahead;
+ *                                      #     a read-ahead bound, clamped to READ_CHUNK
+ * - OMNIFLOW_PLUGIN_ARENA_BYTES=65536  # cJSON arena per message (0: plain malloc/free)
  *
  * Tests & CI
  * ----------
@@ -80,6 +92,8 @@
 #include <time.h>
 #include <errno.h>
 #include <unistd.h>
+#include <poll.h>
+#include <sys/uio.h>
 
 /* cJSON include - vendor/cjson/cJSON.h
  * Ensure cJSON.c is compiled and linked into the plugin binary.
@@ -91,6 +105,13 @@
 #define DEFAULT_HEARTBEAT 5            /* seconds */
 #define PLUGIN_NAME "OmniFlowCRelease"
 #define PLUGIN_VERSION "1.0.0"
+#define MAX_BATCH 1024                 /* sub-requests per "batch" message */
+#define FLUSH_BYTES (64 * 1024)        /* coalesced output is flushed at this size */
+#define MAX_FLUSH_US 1000000L
+#define READ_CHUNK (64 * 1024)         /* stdin is read(2) in chunks of this size */
+#define DEFAULT_RETRY_AFTER_MS 100     /* "busy" hint before any exec time is known */
+#define DEFAULT_ARENA_BYTES (64 * 1024) /* request + response trees of a typical message */
+#define MAX_ARENA_BYTES (64L * 1024 * 1024)
 
 /* ---------------- Global state ---------------- */
 static atomic_bool running = ATOMIC_VAR_INIT(true);
@@ -101,6 +122,27 @@ static pthread_t bg_thread;
 static size_t MAX_LINE = DEFAULT_MAX_LINE;
 static int HEARTBEAT_SEC = DEFAULT_HEARTBEAT;
 static bool LOG_JSON = false;
+static long FLUSH_US = 0; /* 0 = write every response immediately */
+/* Admission control over the read-ahead input (0 = off) */
+static size_t QUEUE_MAX = 0;
+static size_t QUEUE_BYTES = 0;
+static unsigned long long mean_exec_us = 0; /* moving average of exec/batch handling time */
+static bool TIMINGS = true; /* per-stage timings in response "meta" */
+static unsigned long long write_ns_total = 0; /* respond(): serialize + write/buffer */
+static unsigned long long write_count = 0;
+
+/* Every cJSON tree of a message (request, response, printed text) lives in
+ * this arena, which is reset before the next message; what does not fit
+ * falls back to malloc. Only the main thread uses cJSON. */
+static size_t ARENA_BYTES = DEFAULT_ARENA_BYTES;
+static cJSON_Arena arena;
+
+/* Response output buffer (coalescing) and its counters, reported by "meta" */
+static char outbuf[FLUSH_BYTES];
+static size_t outlen = 0;
+static struct timespec out_first_pending;
+static unsigned long long stat_responses = 0;
+static unsigned long long stat_writes = 0;
 
 /* ---------------- Utilities ---------------- */
 static void current_time_iso8601(char *buf, size_t len) {
@@ -110,12 +152,28 @@ static void current_time_iso8601(char *buf, size_t len) {
     strftime(buf, len, "%Y-%m-%dT%H:%M:%SZ", &tm);
 }
 
+/* msg as a quoted JSON string. Logging runs on the background thread and in
+ * the signal handler too, so it does not go through cJSON (whose allocator is
+ * the main thread's arena). */
+static void fput_json_string(const char *msg, FILE *f) {
+    fputc('"', f);
+    for (const unsigned char *p = (const unsigned char *)msg; *p; ++p) {
+        if (*p == '"' || *p == '\\') { fputc('\\', f); fputc(*p, f); }
+        else if (*p == '\n') fputs("\\n", f);
+        else if (*p < 0x20) fprintf(f, "\\u%04x", *p);
+        else fputc(*p, f);
+    }
+    fputc('"', f);
+}
+
 static void log_raw(const char *level, const char *msg) {
     char tbuf[32]; current_time_iso8601(tbuf, sizeof(tbuf));
     if (LOG_JSON) {
         /* Structured JSON log */
-        fprintf(stderr, "{\"time\":\"%s\",\"level\":\"%s\",\"plugin\":\"%s\",\"message\":%s}\n",
-                tbuf, level, PLUGIN_NAME, cJSON_PrintUnformatted(cJSON_CreateString(msg)));
+        fprintf(stderr, "{\"time\":\"%s\",\"level\":\"%s\",\"plugin\":\"%s\",\"message\":",
+                tbuf, level, PLUGIN_NAME);
+        fput_json_string(msg, stderr);
+        fputs("}\n", stderr);
     } else {
         fprintf(stderr, "%s [%s] %s: %s\n", tbuf, level, PLUGIN_NAME, msg);
     }
@@ -126,37 +184,270 @@ static void log_info(const char *msg) { log_raw("INFO", msg); }
 static void log_warn(const char *msg) { log_raw("WARN", msg); }
 static void log_err(const char *msg)  { log_raw("ERROR", msg); }
 
-/* Respond helpers */
-static void respond_json(cJSON *obj) {
+/* ---------------- Output ---------------- */
+static long elapsed_us(const struct timespec *since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long)(now.tv_sec - since->tv_sec) * 1000000L + (now.tv_nsec - since->tv_nsec) / 1000;
+}
+
+static long long elapsed_ns(const struct timespec *from, const struct timespec *to) {
+    return (long long)(to->tv_sec - from->tv_sec) * 1000000000LL + (to->tv_nsec - from->tv_nsec);
+}
+
+/* writev(2) every byte, retrying on EINTR and short writes. On a broken pipe
+ * the host is gone and the data is dropped. */
+static void write_all(struct iovec *iov, int iovcnt) {
+    while (iovcnt > 0) {
+        ssize_t n = writev(STDOUT_FILENO, iov, iovcnt);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        stat_writes++;
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len) { n -= (ssize_t)iov->iov_len; iov++; iovcnt--; }
+        if (iovcnt > 0) { iov->iov_base = (char *)iov->iov_base + n; iov->iov_len -= (size_t)n; }
+    }
+}
+
+static void out_flush(void) {
+    if (outlen == 0) return;
+    struct iovec iov = { outbuf, outlen };
+    write_all(&iov, 1);
+    outlen = 0;
+}
+
+/* ---------------- Input framing ----------------
+ * stdin is read with read(2) in READ_CHUNK pieces into one buffer that holds a
+ * maximal line plus a chunk; lines are found with memchr and returned in place
+ * (the '\n' is replaced by NUL). A line longer than MAX_LINE is reported once
+ * as soon as that is known and the rest of it is skipped chunk by chunk, so it
+ * is never buffered in full.
+ */
+typedef enum { FRAME_LINE, FRAME_OVERSIZED, FRAME_EOF } frame_status;
+
+typedef struct {
+    char *buf;
+    size_t cap;       /* usable bytes; buf has one more for the terminator */
+    size_t start;     /* first byte of the current (partial) line */
+    size_t scan;      /* bytes before this offset contain no '\n' */
+    size_t end;       /* end of buffered data */
+    bool discarding;  /* skipping the tail of an oversized line */
+    bool eof;
+    size_t lines;     /* complete lines buffered after the current one */
+} line_framer;
+
+/* The stdin framer; its read-ahead is the request queue reported by "health" */
+static line_framer framer;
+
+static int framer_init(line_framer *f) {
+    memset(f, 0, sizeof(*f));
+    f->cap = MAX_LINE + 1 + READ_CHUNK;
+    f->buf = malloc(f->cap + 1);
+    return f->buf ? 0 : -1;
+}
+
+static void framer_fill(line_framer *f) {
+    if (f->cap - f->end < READ_CHUNK && f->start > 0) {
+        memmove(f->buf, f->buf + f->start, f->end - f->start);
+        f->end -= f->start;
+        f->scan -= f->start;
+        f->start = 0;
+    }
+    for (;;) {
+        ssize_t n = read(STDIN_FILENO, f->buf + f->end, f->cap - f->end);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) { f->eof = true; return; } /* EOF or unrecoverable read error */
+        for (const char *p = f->buf + f->end, *e = p + n; (p = memchr(p, '\n', (size_t)(e - p))) != NULL; ++p)
+            f->lines++;
+        f->end += (size_t)n;
+        return;
+    }
+}
+
+/* Next line (NUL-terminated, valid until the next call), FRAME_OVERSIZED once
+ * per line over MAX_LINE, or FRAME_EOF. A last line without '\n' is returned. */
+static frame_status framer_next(line_framer *f, char **line, size_t *len) {
+    for (;;) {
+        char *nl = memchr(f->buf + f->scan, '\n', f->end - f->scan);
+        if (nl) {
+            size_t line_start = f->start;
+            size_t n = (size_t)(nl - (f->buf + line_start));
+            f->start = f->scan = line_start + n + 1;
+            f->lines--;
+            if (f->discarding) { f->discarding = false; continue; } /* tail of a reported line */
+            if (n > MAX_LINE) return FRAME_OVERSIZED;
+            *nl = '\0';
+            *line = f->buf + line_start;
+            *len = n;
+            return FRAME_LINE;
+        }
+        f->scan = f->end;
+
+        /* No complete line buffered. Too long already? Report and drop it. */
+        if (!f->discarding && f->end - f->start > MAX_LINE) {
+            f->discarding = true;
+            f->start = f->scan = f->end = 0;
+            return FRAME_OVERSIZED;
+        }
+        if (f->discarding) f->start = f->scan = f->end = 0; /* nothing worth keeping */
+
+        if (f->eof) {
+            if (f->end == f->start) return FRAME_EOF;
+            f->buf[f->end] = '\0';
+            *line = f->buf + f->start;
+            *len = f->end - f->start;
+            f->start = f->scan = f->end;
+            return FRAME_LINE;
+        }
+        framer_fill(f);
+    }
+}
+
+/* True when no further request is waiting: no complete line buffered and
+ * nothing readable on stdin */
+static bool input_idle(const line_framer *f) {
+    if (memchr(f->buf + f->scan, '\n', f->end - f->scan)) return false;
+    struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+    return poll(&pfd, 1, 0) == 0;
+}
+
+/* Queue one response line. Without coalescing it is written at once; otherwise
+ * the buffer goes out when full, when FLUSH_US has passed since its first line
+ * (checked here and before each frame), or when the main loop finds stdin
+ * idle. A line never straddles two writes of the buffer. */
+static void out_line(const char *s, size_t n) {
+    stat_responses++;
+    if (outlen + n + 1 > sizeof(outbuf)) {
+        out_flush();
+        if (n + 1 > sizeof(outbuf)) {
+            struct iovec iov[2] = { { (void *)s, n }, { "\n", 1 } };
+            write_all(iov, 2);
+            return;
+        }
+    }
+    if (outlen == 0) clock_gettime(CLOCK_MONOTONIC, &out_first_pending);
+    memcpy(outbuf + outlen, s, n);
+    outbuf[outlen + n] = '\n';
+    outlen += n + 1;
+    if (FLUSH_US == 0 || outlen >= sizeof(outbuf) || elapsed_us(&out_first_pending) >= FLUSH_US) out_flush();
+}
+
+/* Steady-clock marks of a request, taken by the main loop */
+typedef struct {
+    struct timespec read;    /* line taken from the framer */
+    struct timespec parsed;  /* cJSON tree built */
+    struct timespec done;    /* handler returned */
+} stage_times;
+
+/* Serialize and queue a response. With stage timings, `"meta":{...}` is
+ * appended to the printed text in place of its closing brace, so it costs no
+ * cJSON nodes. The write stage cannot be part of its own response; "meta"
+ * reports its average instead. The text comes from the cJSON allocator (the
+ * arena, usually), so it is copied rather than realloc()ed. */
+static void respond_timed(cJSON *obj, const stage_times *t) {
+    struct timespec started, finished;
+    if (TIMINGS) clock_gettime(CLOCK_MONOTONIC, &started);
     char *s = cJSON_PrintUnformatted(obj);
     if (s) {
-        printf("%s\n", s);
-        fflush(stdout);
-        free(s);
+        size_t n = strlen(s);
+        char *line = s;
+        if (t && n > 0 && s[n - 1] == '}') {
+            long long total_us = elapsed_ns(&t->read, &t->done) / 1000;
+            char meta[128];
+            int m = snprintf(meta, sizeof(meta), ",\"meta\":{\"parse_ns\":%lld,\"handler_ns\":%lld,\"processing_time_ms\":%lld.%03lld}}",
+                             elapsed_ns(&t->read, &t->parsed), elapsed_ns(&t->parsed, &t->done), total_us / 1000, total_us % 1000);
+            line = cJSON_malloc(n + (size_t)m);
+            if (line) {
+                memcpy(line, s, n - 1);
+                memcpy(line + n - 1, meta, (size_t)m + 1);
+                n += (size_t)m - 1;
+            } else {
+                line = s; /* send it without timings */
+            }
+        }
+        out_line(line, n);
+        if (line != s) cJSON_free(line);
+        cJSON_free(s);
     } else {
         /* Fallback minimal error */
-        printf("{\"status\":\"error\",\"message\":\"serialization failed\"}\n");
-        fflush(stdout);
+        static const char fallback[] = "{\"status\":\"error\",\"message\":\"serialization failed\"}";
+        out_line(fallback, sizeof(fallback) - 1);
+    }
+    if (TIMINGS) {
+        clock_gettime(CLOCK_MONOTONIC, &finished);
+        write_ns_total += (unsigned long long)elapsed_ns(&started, &finished);
+        write_count++;
     }
 }
 
-static void respond_ok(const char *id, cJSON *body) {
+/* Response builders: handlers return the response object instead of writing it,
+ * so the same handler serves a top-level request and a "batch" item.
+ * make_ok() takes ownership of body. */
+static cJSON *make_ok(const char *id, cJSON *body) {
     cJSON *root = cJSON_CreateObject();
     if (id) cJSON_AddStringToObject(root, "id", id);
     cJSON_AddStringToObject(root, "status", "ok");
     if (body) cJSON_AddItemToObject(root, "body", body);
-    respond_json(root);
-    cJSON_Delete(root);
+    return root;
 }
 
-static void respond_error(const char *id, int code, const char *message) {
+static cJSON *make_error(const char *id, int code, const char *message) {
     cJSON *root = cJSON_CreateObject();
     if (id) cJSON_AddStringToObject(root, "id", id);
     cJSON_AddStringToObject(root, "status", "error");
     cJSON_AddNumberToObject(root, "code", code);
     if (message) cJSON_AddStringToObject(root, "message", message);
-    respond_json(root);
-    cJSON_Delete(root);
+    return root;
+}
+
+/* Write a response and free it */
+static void respond(cJSON *resp) {
+    respond_timed(resp, NULL);
+    cJSON_Delete(resp);
+}
+
+static void respond_ok(const char *id, cJSON *body) { respond(make_ok(id, body)); }
+
+static void respond_error(const char *id, int code, const char *message) { respond(make_error(id, code, message)); }
+
+/* ---------------- Admission control ----------------
+ * Requests are handled one at a time, so the queue is what has been read
+ * ahead of the current request. When it is over QUEUE_MAX lines or
+ * QUEUE_BYTES, exec/batch work is refused with status "busy" and a hint of
+ * how long the backlog takes to drain, so the host can shed load early.
+ * The framer only reads again once no complete line is left, so the
+ * read-ahead is what one read(2) returned; QUEUE_BYTES is clamped to
+ * READ_CHUNK, the most a pipe delivers at once, or it could never trigger. */
+static size_t queue_bytes(void) { return framer.end - framer.start; }
+
+static bool queue_full(void) {
+    return (QUEUE_MAX > 0 && framer.lines >= QUEUE_MAX) || (QUEUE_BYTES > 0 && queue_bytes() >= QUEUE_BYTES);
+}
+
+static cJSON *make_busy(const char *id) {
+    char msg[64];
+    snprintf(msg, sizeof(msg), "request queue full (%zu waiting)", framer.lines);
+    unsigned long long retry_ms = DEFAULT_RETRY_AFTER_MS;
+    if (mean_exec_us > 0) retry_ms = (mean_exec_us * framer.lines + 999) / 1000;
+    if (retry_ms == 0) retry_ms = 1;
+    cJSON *root = cJSON_CreateObject();
+    if (id) cJSON_AddStringToObject(root, "id", id);
+    cJSON_AddStringToObject(root, "status", "busy");
+    cJSON_AddNumberToObject(root, "code", 300);
+    cJSON_AddStringToObject(root, "message", msg);
+    cJSON *meta = cJSON_CreateObject();
+    cJSON_AddNumberToObject(meta, "retry_after_ms", (double)retry_ms);
+    cJSON_AddNumberToObject(meta, "queue_depth", (double)framer.lines);
+    cJSON_AddItemToObject(root, "meta", meta);
+    return root;
+}
+
+/* EWMA with weight 1/8 */
+static void record_exec_time(const struct timespec *started) {
+    long us = elapsed_us(started);
+    unsigned long long v = us > 0 ? (unsigned long long)us : 1;
+    mean_exec_us = mean_exec_us ? mean_exec_us - mean_exec_us / 8 + v / 8 : v;
 }
 
 /* ---------------- Background worker ---------------- */
@@ -187,19 +478,20 @@ static void handle_signal(int sig) {
 }
 
 /* ---------------- Message handlers ---------------- */
-static void handle_health(const char *id) {
+static cJSON *handle_health(const char *id) {
     cJSON *body = cJSON_CreateObject();
     cJSON_AddStringToObject(body, "status", "healthy");
     cJSON_AddStringToObject(body, "version", PLUGIN_VERSION);
-    respond_ok(id, body);
+    cJSON_AddNumberToObject(body, "queue_depth", (double)framer.lines);
+    return make_ok(id, body);
 }
 
-static void handle_exec(const char *id, cJSON *payload) {
+static cJSON *handle_exec(const char *id, cJSON *payload) {
     /* Example supported actions: echo, reverse, compute(sum)
      * Validate payload carefully. */
-    if (!payload) { respond_error(id, 400, "missing payload"); return; }
+    if (!payload) return make_error(id, 400, "missing payload");
     cJSON *action = cJSON_GetObjectItemCaseSensitive(payload, "action");
-    if (!cJSON_IsString(action)) { respond_error(id, 400, "missing or invalid 'action'"); return; }
+    if (!cJSON_IsString(action)) return make_error(id, 400, "missing or invalid 'action'");
 
     if (strcmp(action->valuestring, "echo") == 0) {
         cJSON *msg = cJSON_GetObjectItemCaseSensitive(payload, "message");
@@ -207,41 +499,117 @@ static void handle_exec(const char *id, cJSON *payload) {
         cJSON *body = cJSON_CreateObject();
         cJSON_AddStringToObject(body, "action", "echo");
         cJSON_AddStringToObject(body, "message", m);
-        respond_ok(id, body);
-        return;
+        return make_ok(id, body);
     }
     else if (strcmp(action->valuestring, "reverse") == 0) {
         cJSON *msg = cJSON_GetObjectItemCaseSensitive(payload, "message");
         const char *m = cJSON_IsString(msg) ? msg->valuestring : "";
         size_t n = strlen(m);
         char *rev = malloc(n + 1);
-        if (!rev) { respond_error(id, 500, "memory allocation failed"); return; }
-        for (size_t i = 0; i < n; ++i) rev[i] = m[n - 1 - i];
+        if (!rev) return make_error(id, 500, "memory allocation failed");
+        /* by code point, so multi-byte UTF-8 sequences stay intact */
+        size_t out = 0, end = n;
+        while (end > 0) {
+            size_t start = end - 1;
+            while (start > 0 && ((unsigned char)m[start] & 0xC0) == 0x80) start--;
+            memcpy(rev + out, m + start, end - start);
+            out += end - start;
+            end = start;
+        }
         rev[n] = '\0';
         cJSON *body = cJSON_CreateObject();
         cJSON_AddStringToObject(body, "action", "reverse");
         cJSON_AddStringToObject(body, "message", rev);
         free(rev);
-        respond_ok(id, body);
-        return;
+        return make_ok(id, body);
     }
     else if (strcmp(action->valuestring, "compute") == 0) {
         cJSON *arr = cJSON_GetObjectItemCaseSensitive(payload, "numbers");
-        if (!cJSON_IsArray(arr)) { respond_error(id, 400, "missing or invalid 'numbers' array"); return; }
+        if (!cJSON_IsArray(arr)) return make_error(id, 400, "missing or invalid 'numbers' array");
         long long sum = 0;
         cJSON *elem = NULL;
         cJSON_ArrayForEach(elem, arr) {
-            if (!cJSON_IsNumber(elem)) { respond_error(id, 400, "numbers must be numeric"); return; }
+            if (!cJSON_IsNumber(elem)) return make_error(id, 400, "numbers must be numeric");
             sum += (long long) elem->valuedouble;
         }
         cJSON *body = cJSON_CreateObject();
         cJSON_AddStringToObject(body, "action", "compute");
         cJSON_AddNumberToObject(body, "sum", sum);
-        respond_ok(id, body);
-        return;
+        return make_ok(id, body);
     }
 
-    respond_error(id, 422, "unsupported action");
+    return make_error(id, 422, "unsupported action");
+}
+
+/* meta: plugin identity and output batching statistics */
+static cJSON *handle_meta(const char *id) {
+    cJSON *output = cJSON_CreateObject();
+    cJSON_AddNumberToObject(output, "flush_us", (double)FLUSH_US);
+    cJSON_AddNumberToObject(output, "responses", (double)stat_responses);
+    cJSON_AddNumberToObject(output, "writes", (double)stat_writes);
+    cJSON_AddNumberToObject(output, "responses_per_write", stat_writes ? (double)stat_responses / (double)stat_writes : 0.0);
+    cJSON_AddNumberToObject(output, "write_ns_avg", write_count ? (double)(write_ns_total / write_count) : 0.0);
+    cJSON *body = cJSON_CreateObject();
+    cJSON_AddStringToObject(body, "name", PLUGIN_NAME);
+    cJSON_AddStringToObject(body, "version", PLUGIN_VERSION);
+    /* this template speaks NDJSON only; see protocol.md "Binary transport" */
+    cJSON_AddStringToObject(body, "transport", "ndjson");
+    cJSON *transports = cJSON_CreateArray();
+    cJSON_AddItemToArray(transports, cJSON_CreateString("ndjson"));
+    cJSON_AddItemToObject(body, "transports", transports);
+    cJSON_AddItemToObject(body, "output", output);
+    cJSON *queue = cJSON_CreateObject();
+    cJSON_AddNumberToObject(queue, "depth", (double)framer.lines);
+    cJSON_AddNumberToObject(queue, "bytes", (double)queue_bytes());
+    cJSON_AddNumberToObject(queue, "max", (double)QUEUE_MAX);
+    cJSON_AddNumberToObject(queue, "max_bytes", (double)QUEUE_BYTES);
+    cJSON_AddNumberToObject(queue, "mean_exec_us", (double)mean_exec_us);
+    cJSON_AddItemToObject(body, "queue", queue);
+    cJSON *mem = cJSON_CreateObject();
+    cJSON_AddNumberToObject(mem, "bytes", (double)arena.size);
+    cJSON_AddNumberToObject(mem, "high_water", (double)arena.high_water);
+    cJSON_AddNumberToObject(mem, "overflows", (double)arena.overflows);
+    cJSON_AddItemToObject(body, "arena", mem);
+    return make_ok(id, body);
+}
+
+/* One "batch" item: a request envelope without the outer framing. Items are
+ * answered independently; only exec and health may be batched. */
+static cJSON *handle_batch_item(cJSON *req) {
+    if (!cJSON_IsObject(req)) return make_error("", 400, "batch item must be an object");
+    cJSON *id = cJSON_GetObjectItemCaseSensitive(req, "id");
+    const char *idstr = cJSON_IsString(id) ? id->valuestring : "";
+    cJSON *type = cJSON_GetObjectItemCaseSensitive(req, "type");
+    if (!cJSON_IsString(type)) return make_error(idstr, 400, "missing or invalid 'type'");
+
+    const char *t = type->valuestring;
+    if (strcmp(t, "exec") == 0) return handle_exec(idstr, cJSON_GetObjectItemCaseSensitive(req, "payload"));
+    if (strcmp(t, "health") == 0) return handle_health(idstr);
+    if (strcmp(t, "batch") == 0) return make_error(idstr, 400, "nested batch not allowed");
+    if (strcmp(t, "shutdown") == 0 || strcmp(t, "quit") == 0) return make_error(idstr, 400, "shutdown not allowed in batch");
+    return make_error(idstr, 400, "unknown type");
+}
+
+/* batch: payload.requests[] is answered by one response whose body.responses[]
+ * holds one item response per sub-request, in request order (see protocol.md). */
+static cJSON *handle_batch(const char *id, cJSON *payload) {
+    cJSON *requests = payload ? cJSON_GetObjectItemCaseSensitive(payload, "requests") : NULL;
+    if (!cJSON_IsArray(requests)) return make_error(id, 400, "missing or invalid 'requests' array");
+    if (cJSON_GetArraySize(requests) > MAX_BATCH) return make_error(id, 400, "batch exceeds maximum number of requests");
+
+    cJSON *responses = cJSON_CreateArray();
+    int failed = 0;
+    cJSON *req = NULL;
+    cJSON_ArrayForEach(req, requests) {
+        cJSON *r = handle_batch_item(req);
+        cJSON *status = cJSON_GetObjectItemCaseSensitive(r, "status");
+        if (!cJSON_IsString(status) || strcmp(status->valuestring, "ok") != 0) failed++;
+        cJSON_AddItemToArray(responses, r);
+    }
+    cJSON *body = cJSON_CreateObject();
+    cJSON_AddItemToObject(body, "responses", responses);
+    cJSON_AddNumberToObject(body, "failed", failed);
+    return make_ok(id, body);
 }
 
 /* ---------------- Main loop ---------------- */
@@ -261,9 +629,36 @@ int main(int argc, char **argv) {
     }
     const char *lj = getenv("OMNIFLOW_LOG_JSON");
     if (lj && strlen(lj) > 0) LOG_JSON = true;
+    const char *fu = getenv("OMNIFLOW_PLUGIN_FLUSH_US");
+    if (fu) {
+        char *end = NULL; long v = strtol(fu, &end, 10);
+        if (end != fu && v > 0) FLUSH_US = v < MAX_FLUSH_US ? v : MAX_FLUSH_US;
+    }
+    const char *tm = getenv("OMNIFLOW_PLUGIN_TIMINGS");
+    if (tm && (strcmp(tm, "0") == 0 || strcmp(tm, "false") == 0 || strcmp(tm, "off") == 0)) TIMINGS = false;
+    const char *qm = getenv("OMNIFLOW_PLUGIN_QUEUE_MAX");
+    if (qm) {
+        char *end = NULL; unsigned long long v = strtoull(qm, &end, 10);
+        if (end != qm) QUEUE_MAX = (size_t)v;
+    }
+    const char *qb = getenv("OMNIFLOW_PLUGIN_QUEUE_BYTES");
+    if (qb) {
+        char *end = NULL; unsigned long long v = strtoull(qb, &end, 10);
+        if (end != qb) QUEUE_BYTES = (size_t)v;
+        if (QUEUE_BYTES > READ_CHUNK) {
+            log_warn("OMNIFLOW_PLUGIN_QUEUE_BYTES bounds the read-ahead; clamped to one read chunk");
+            QUEUE_BYTES = READ_CHUNK;
+        }
+    }
+    const char *ab = getenv("OMNIFLOW_PLUGIN_ARENA_BYTES");
+    if (ab) {
+        char *end = NULL; long v = strtol(ab, &end, 10);
+        if (end != ab && v >= 0) ARENA_BYTES = (size_t)(v < MAX_ARENA_BYTES ? v : MAX_ARENA_BYTES);
+    }
 
-    char buf[128];
-    snprintf(buf, sizeof(buf), "starting plugin version=%s max_line=%zu heartbeat=%d json_logs=%d", PLUGIN_VERSION, MAX_LINE, HEARTBEAT_SEC, LOG_JSON);
+    char buf[224];
+    snprintf(buf, sizeof(buf), "starting plugin version=%s max_line=%zu heartbeat=%d json_logs=%d flush_us=%ld queue_max=%zu queue_bytes=%zu timings=%d arena_bytes=%zu",
+             PLUGIN_VERSION, MAX_LINE, HEARTBEAT_SEC, LOG_JSON, FLUSH_US, QUEUE_MAX, QUEUE_BYTES, TIMINGS, ARENA_BYTES);
     log_info(buf);
 
     /* Install signal handlers */
@@ -280,31 +675,35 @@ int main(int argc, char **argv) {
     }
 
     /* Main read loop - read newline-terminated JSON messages */
-    char *linebuf = malloc(MAX_LINE + 1);
-    if (!linebuf) { log_err("failed to allocate input buffer"); return 1; }
+    if (framer_init(&framer) != 0) { log_err("failed to allocate input buffer"); return 1; }
+    char *arena_buf = ARENA_BYTES > 0 ? malloc(ARENA_BYTES) : NULL;
+    if (arena_buf) {
+        cJSON_InitArena(&arena, arena_buf, ARENA_BYTES);
+        cJSON_UseArena(&arena);
+    }
 
     while (atomic_load(&running)) {
-        if (!fgets(linebuf, (int)MAX_LINE + 1, stdin)) {
-            if (feof(stdin)) {
-                log_info("stdin closed (EOF), exiting");
-                break;
-            }
-            if (ferror(stdin)) {
-                log_warn("error reading stdin"); clearerr(stdin); continue;
-            }
+        /* the previous message's trees are all deleted by now */
+        if (arena_buf) cJSON_ArenaReset(&arena);
+        /* Push out coalesced responses before handling the next frame when
+         * nothing more is readable, or when the oldest has waited FLUSH_US
+         * (out_line() only checks that when the next response is queued) */
+        if (outlen > 0 && (elapsed_us(&out_first_pending) >= FLUSH_US || input_idle(&framer))) out_flush();
+        char *linebuf = NULL;
+        size_t len = 0;
+        frame_status fs = framer_next(&framer, &linebuf, &len);
+        stage_times st;
+        if (TIMINGS) clock_gettime(CLOCK_MONOTONIC, &st.read);
+        if (fs == FRAME_EOF) {
+            log_info("stdin closed (EOF), exiting");
+            break;
         }
-        size_t len = strnlen(linebuf, MAX_LINE + 1);
-        if (len == 0) continue;
-        /* If line length == MAX_LINE and last char isn't '\n', the message may be truncated */
-        if (len == MAX_LINE && linebuf[len-1] != '\n') {
-            log_warn("incoming message truncated to MAX_LINE");
-            /* drain remaining characters on this line to avoid corrupting next read */
-            int ch;
-            while ((ch = getchar()) != EOF && ch != '\n') { /* discard */ }
+        if (fs == FRAME_OVERSIZED) {
+            /* rejected without buffering it; the id is unknown at this point */
+            log_warn("incoming message exceeds MAX_LINE, rejected");
+            respond_error(NULL, 101, "message exceeds OMNIFLOW_PLUGIN_MAX_LINE");
+            continue;
         }
-
-        /* Trim newline */
-        if (linebuf[len-1] == '\n') { linebuf[len-1] = '\0'; len--; }
         if (len == 0) continue;
 
         /* Parse JSON using cJSON */
@@ -314,6 +713,7 @@ int main(int argc, char **argv) {
             respond_error(NULL, 400, "invalid JSON");
             continue;
         }
+        if (TIMINGS) clock_gettime(CLOCK_MONOTONIC, &st.parsed);
 
         cJSON *id = cJSON_GetObjectItemCaseSensitive(msg, "id");
         const char *idstr = NULL;
@@ -327,11 +727,22 @@ int main(int argc, char **argv) {
         }
 
         cJSON *payload = cJSON_GetObjectItemCaseSensitive(msg, "payload");
+        cJSON *resp = NULL;
         if (strcmp(type->valuestring, "health") == 0) {
-            handle_health(idstr);
+            resp = handle_health(idstr);
         }
-        else if (strcmp(type->valuestring, "exec") == 0) {
-            handle_exec(idstr, payload);
+        else if (strcmp(type->valuestring, "exec") == 0 || strcmp(type->valuestring, "batch") == 0) {
+            if (queue_full()) {
+                respond(make_busy(idstr));
+            } else {
+                struct timespec started;
+                clock_gettime(CLOCK_MONOTONIC, &started);
+                resp = strcmp(type->valuestring, "exec") == 0 ? handle_exec(idstr, payload) : handle_batch(idstr, payload);
+                record_exec_time(&started);
+            }
+        }
+        else if (strcmp(type->valuestring, "meta") == 0) {
+            resp = handle_meta(idstr);
         }
         else if (strcmp(type->valuestring, "shutdown") == 0 || strcmp(type->valuestring, "quit") == 0) {
             respond_ok(idstr, cJSON_CreateString("shutting_down"));
@@ -343,6 +754,11 @@ int main(int argc, char **argv) {
         else {
             respond_error(idstr, 400, "unknown type");
         }
+        if (resp) {
+            if (TIMINGS) clock_gettime(CLOCK_MONOTONIC, &st.done);
+            respond_timed(resp, TIMINGS ? &st : NULL);
+            cJSON_Delete(resp);
+        }
 
         cJSON_Delete(msg);
 
@@ -350,11 +766,14 @@ int main(int argc, char **argv) {
     }
 
     /* Graceful shutdown */
+    out_flush();
     atomic_store(&running, false);
     if (pthread_join(bg_thread, NULL) != 0) {
         log_warn("failed to join background thread");
     }
-    free(linebuf);
+    free(framer.buf);
+    cJSON_UseArena(NULL);
+    free(arena_buf);
 
     log_info("plugin shutdown complete");
     return 0;
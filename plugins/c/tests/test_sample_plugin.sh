@@ -3,44 +3,50 @@
 # test_sample_plugin.sh
 #
 # Integration tests for OmniFlow C plugin (plugins/c/sample_plugin.c)
-# - Builds plugin (prefer Makefile if present)
+# - Builds plugin into a temporary directory (prefer Makefile if present),
+#   unless SAMPLE_PLUGIN_BIN names an already built binary (`make test`)
 # - Runs plugin using FIFO for stdin, captures stdout/stderr
 # - Sends JSON newline-delimited messages and validates responses with jq
+# - Restarts it with OMNIFLOW_PLUGIN_FLUSH_US set to check output coalescing:
+#   a lone request is flushed at once, a burst shares write(2) calls, and a
+#   buffered response goes out on its timer while input stays busy (the
+#   last check reads a regular file, not the FIFO)
 #
 # Requirements:
-# - bash, mkfifo, jq, timeout (coreutils)
+# - bash, mkfifo, jq, timeout, stdbuf (coreutils)
 # - make & gcc (or clang) for build
 #
-# Usage:
-#   cd <repo-root>
+# Usage (from any directory; also run by ctest from plugins/cpp):
 #   ./plugins/c/tests/test_sample_plugin.sh
+#   SAMPLE_PLUGIN_BIN=plugins/c/build/sample_plugin ./plugins/c/tests/test_sample_plugin.sh
 #
 set -euo pipefail
 IFS=$'\n\t'
 
-REPO_ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/../.." && pwd)"
-PLUGIN_DIR="$REPO_ROOT/plugins/c"
+PLUGIN_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
 TEST_DIR="$(mktemp -d)"
 FIFO_IN="$TEST_DIR/plugin.stdin.fifo"
 STDOUT_LOG="$TEST_DIR/plugin.stdout.log"
 STDERR_LOG="$TEST_DIR/plugin.stderr.log"
-BIN_PATH="$PLUGIN_DIR/sample_plugin"   # target binary path
-MAKE_CMD="make -C \"$PLUGIN_DIR\""
+BUILD_DIR="$TEST_DIR/build"                # keeps the source tree clean
+BIN_PATH="${SAMPLE_PLUGIN_BIN:-}"
 
 # timeouts (seconds)
 BUILD_TIMEOUT=120
-TEST_TIMEOUT=10
 RESP_POLL_INTERVAL=0.1
-RESP_WAIT_TIMEOUT=5
+RESP_WAIT_TRIES=50                         # x RESP_POLL_INTERVAL = 5 s per response
 
 # Ensure cleanup
 cleanup() {
   local rc=$?
   set +e
   echo "=== Cleaning up ==="
+  exec 3>&- 2>/dev/null      # EOF on the plugin's stdin
   if [[ -n "${PLUGIN_PID:-}" ]]; then
     echo "Killing plugin pid $PLUGIN_PID"
     kill "$PLUGIN_PID" 2>/dev/null || true
+    for _ in $(seq 30); do kill -0 "$PLUGIN_PID" 2>/dev/null || break; sleep 0.1; done
+    kill -9 "$PLUGIN_PID" 2>/dev/null || true
     wait "$PLUGIN_PID" 2>/dev/null || true
   fi
   rm -rf "$TEST_DIR"
@@ -65,73 +71,52 @@ fail() {
 command -v jq >/dev/null 2>&1 || { echo "jq required but not found. Install jq."; exit 2; }
 command -v timeout >/dev/null 2>&1 || { echo "timeout required but not found. Install coreutils."; exit 2; }
 
+command -v stdbuf >/dev/null 2>&1 || { echo "stdbuf required but not found. Install coreutils."; exit 2; }
+
 # 1) Build plugin
-echo "Building plugin..."
-if [[ -f "$PLUGIN_DIR/Makefile" ]]; then
-  echo "Using Makefile..."
-  timeout "${BUILD_TIMEOUT}" bash -lc "$MAKE_CMD" || fail "Make failed"
-  # try to find built binary if not at expected path
-  if [[ ! -x "$BIN_PATH" ]]; then
-    found=$(find "$PLUGIN_DIR" -maxdepth 2 -type f -perm /111 -name 'sample_plugin*' -print -quit || true)
-    if [[ -n "$found" ]]; then
-      BIN_PATH="$found"
-    fi
-  fi
+mkdir -p "$BUILD_DIR"
+if [[ -n "$BIN_PATH" ]]; then
+  echo "Using prebuilt plugin..."
+elif [[ -f "$PLUGIN_DIR/Makefile" ]] && command -v make >/dev/null 2>&1; then
+  echo "Building plugin with the Makefile..."
+  timeout "${BUILD_TIMEOUT}" make -s -C "$PLUGIN_DIR" OUTDIR="$BUILD_DIR" > "$BUILD_DIR/build.log" 2>&1 \
+    || { cat "$BUILD_DIR/build.log"; fail "Make failed"; }
+  BIN_PATH="$BUILD_DIR/sample_plugin"
 else
-  echo "No Makefile found — attempting direct gcc build..."
-  GCC_OUT="$PLUGIN_DIR/sample_plugin"
-  timeout "${BUILD_TIMEOUT}" bash -lc "gcc -std=c11 -O2 -Wall -Wextra -pthread -I$PLUGIN_DIR/vendor/cjson -o '$GCC_OUT' '$PLUGIN_DIR/sample_plugin.c' '$PLUGIN_DIR/vendor/cjson/cJSON.c' 2>&1" || fail "gcc build failed"
-  BIN_PATH="$GCC_OUT"
+  echo "No Makefile (or make) — attempting direct gcc build..."
+  BIN_PATH="$BUILD_DIR/sample_plugin"
+  timeout "${BUILD_TIMEOUT}" "${CC:-gcc}" -std=c11 -O2 -Wall -Wextra -pthread -I"$PLUGIN_DIR/vendor/cJSON" \
+    -o "$BIN_PATH" "$PLUGIN_DIR/sample_plugin.c" "$PLUGIN_DIR/vendor/cJSON/cJSON.c" -lm || fail "gcc build failed"
 fi
 
 [[ -x "$BIN_PATH" ]] || fail "Built binary not found or not executable at $BIN_PATH"
 echo "Built binary: $BIN_PATH"
 
-# 2) Prepare FIFO and logs
+# 2) Prepare FIFO and logs. fd 3 keeps the FIFO open for writing, so the
+# plugin does not see EOF between messages.
 mkfifo "$FIFO_IN"
+exec 3<>"$FIFO_IN"
 : > "$STDOUT_LOG"
 : > "$STDERR_LOG"
 
-# 3) Start plugin (stdin from FIFO, stdout/stderr to logs)
-# Use unbuffered output to keep real-time logs. The plugin should flush stdout/stderr itself.
-bash -c "stdbuf -oL -eL '$BIN_PATH' < '$FIFO_IN' >> '$STDOUT_LOG' 2>> '$STDERR_LOG'" &
-PLUGIN_PID=$!
-sleep 0.15  # give it a moment to start
+# 3) Start plugin (stdin from FIFO, stdout/stderr to logs); arguments are
+# extra VAR=value settings for its environment
+start_plugin() {
+  : > "$STDOUT_LOG"
+  : > "$STDERR_LOG"
+  # Use unbuffered output to keep real-time logs. The plugin should flush stdout/stderr itself.
+  # A short heartbeat: shutdown waits for the background thread's sleep.
+  env OMNIFLOW_PLUGIN_HEARTBEAT=1 "$@" stdbuf -oL -eL "$BIN_PATH" < "$FIFO_IN" >> "$STDOUT_LOG" 2>> "$STDERR_LOG" &
+  PLUGIN_PID=$!
+  sleep 0.15  # give it a moment to start
+}
 
 # Utility: send JSON message and return id
 send_msg() {
   local id="$1"; shift
   local json="$1"; shift
   # write newline-terminated JSON into FIFO
-  printf '%s\n' "$json" >> "$FIFO_IN"
-}
-
-# Utility: wait for response with given id and optional jq filter; returns JSON line or empty
-wait_for_response() {
-  local id="$1"; shift
-  local jq_filter="${1:-.}"  # full object by default
-  local out=""
-  local waited=0
-  while (( $(echo "$waited < $RESP_WAIT_TIMEOUT" | bc -l) )); do
-    # read last lines from stdout log and try to find a JSON object with matching id
-    # use grep to approximate JSON lines, then jq to filter
-    if [[ -s "$STDOUT_LOG" ]]; then
-      out=$(tac "$STDOUT_LOG" | grep -m1 -o '{.*}' || true)
-      if [[ -n "$out" ]]; then
-        # try to parse and check id
-        echo "$out" | jq -e --arg ID "$id" "select(.id == \$ID)" >/dev/null 2>&1 && { echo "$out"; return 0; }
-        # If not matching, search all lines
-        match=$(jq -c --arg ID "$id" 'select(.id == $ID)' <(awk '/^\s*{/{p=1} p{print; if(/}[^}]*$/){p=0}}' "$STDOUT_LOG") 2>/dev/null | head -n1 || true)
-        if [[ -n "$match" ]]; then
-          echo "$match"
-          return 0
-        fi
-      fi
-    fi
-    sleep "$RESP_POLL_INTERVAL"
-    waited=$(awk "BEGIN {print $waited + $RESP_POLL_INTERVAL; exit}")
-  done
-  return 1
+  printf '%s\n' "$json" >&3
 }
 
 # For more robust matching, we'll append unique ids and verify via jq scanning of stdout.
@@ -146,6 +131,20 @@ find_response_by_id() {
   }' "$STDOUT_LOG" | jq -c --arg ID "$id" 'select(.id == $ID)' 2>/dev/null | head -n1 || true
 }
 
+# Poll stdout for the response with this id, up to `tries` polls (default
+# RESP_WAIT_TRIES); prints it, or nothing on timeout
+wait_for_response() {
+  local id="$1"
+  local tries="${2:-$RESP_WAIT_TRIES}"
+  local resp=""
+  for _ in $(seq "$tries"); do
+    resp="$(find_response_by_id "$id")"
+    [[ -n "$resp" ]] && break
+    sleep "$RESP_POLL_INTERVAL"
+  done
+  echo "$resp"
+}
+
 # Short wrapper to send and assert expected response content
 test_message_expect() {
   local test_name="$1"; shift
@@ -155,21 +154,11 @@ test_message_expect() {
 
   echo "== Test: $test_name (id=$id) =="
   send_msg "$id" "$payload_json"
-  # Wait for response by repeatedly scanning stdout for JSON matching id
-  local tries=0
-  local max_tries=$((RESP_WAIT_TIMEOUT / RESP_POLL_INTERVAL))
-  local resp=""
-  while (( tries < max_tries )); do
-    resp="$(find_response_by_id "$id")"
-    if [[ -n "$resp" ]]; then
-      break
-    fi
-    sleep "$RESP_POLL_INTERVAL"
-    tries=$((tries+1))
-  done
+  local resp
+  resp="$(wait_for_response "$id")"
 
   if [[ -z "$resp" ]]; then
-    echo "No response for id=$id within ${RESP_WAIT_TIMEOUT}s"
+    echo "No response for id=$id after $RESP_WAIT_TRIES polls"
     echo "=== STDOUT ==="; sed -n '1,200p' "$STDOUT_LOG"
     echo "=== STDERR ==="; sed -n '1,200p' "$STDERR_LOG"
     fail "$test_name: no response"
@@ -185,6 +174,34 @@ test_message_expect() {
   echo "OK: $test_name"
 }
 
+# Ask for shutdown with this id and check the plugin acknowledges and exits
+stop_plugin() {
+  local id="$1"
+  echo "== Test: shutdown ($id) =="
+  send_msg "$id" "{\"id\":\"$id\",\"type\":\"shutdown\"}"
+  local resp
+  resp="$(wait_for_response "$id")"
+  [[ -n "$resp" ]] || fail "shutdown: no response"
+  echo "$resp" | jq -e '.status == "ok"' >/dev/null 2>&1 || fail "shutdown: unexpected response $resp"
+
+  # Wait for process to exit (allow up to 3s)
+  for _ in $(seq 30); do
+    kill -0 "$PLUGIN_PID" 2>/dev/null || break
+    sleep "$RESP_POLL_INTERVAL"
+  done
+
+  if kill -0 "$PLUGIN_PID" 2>/dev/null; then
+    echo "Plugin did not exit after shutdown request; killing"
+    kill -9 "$PLUGIN_PID" 2>/dev/null || true
+    fail "Plugin failed to exit on shutdown"
+  fi
+  wait "$PLUGIN_PID" 2>/dev/null || true
+  PLUGIN_PID=""
+  echo "Plugin exited gracefully after shutdown (OK)"
+}
+
+start_plugin
+
 # Wait a bit for plugin warm-up (background worker may log)
 sleep 0.2
 
@@ -199,12 +216,12 @@ test_message_expect "exec-echo" "t-echo-1" '{"id":"t-echo-1","type":"exec","payl
 # 3) exec reverse (unicode test)
 test_message_expect "exec-reverse" "t-rev-1" '{"id":"t-rev-1","type":"exec","payload":{"action":"reverse","message":"Привет"}}' '.status == "ok" and .body.action == "reverse" and .body.message == "тевирП"'
 
-# 4) exec compute (sum)
-test_message_expect "exec-compute" "t-calc-1" '{"id":"t-calc-1","type":"exec","payload":{"action":"compute","numbers":[1,2,3,4.5]}}' '.status == "ok" and .body.action == "compute" and (.body.sum | (. == 10.5))'
+# 4) exec compute (integer sum, as in the C++ sample)
+test_message_expect "exec-compute" "t-calc-1" '{"id":"t-calc-1","type":"exec","payload":{"action":"compute","numbers":[1,2,3,4]}}' '.status == "ok" and .body.action == "compute" and .body.sum == 10'
 
 # 5) invalid JSON -> plugin should reply error (or at least not crash)
 echo "== Test: invalid-json =="
-printf '%s\n' 'this is not json' >> "$FIFO_IN"
+printf '%s\n' 'this is not json' >&3
 # Wait a moment to let plugin respond
 sleep 0.5
 # plugin may respond with status:error; we won't strict-check but ensure plugin still alive
@@ -220,13 +237,18 @@ echo "== Test: oversized payload =="
 LARGE_PAYLOAD_LEN=$((200 * 1024))
 LARGE_STR=$(head -c "$LARGE_PAYLOAD_LEN" < /dev/zero | tr '\0' 'A' | tr -d '\n')
 LARGE_JSON=$(printf '{"id":"t-large-1","type":"exec","payload":{"action":"echo","message":"%s"}}' "$LARGE_STR")
-# send via FIFO - may block if too large, so use background writer with timeout
-( printf '%s\n' "$LARGE_JSON" >> "$FIFO_IN" ) & pidwriter=$!
-sleep 0.5
-# If writer still running after 2s, kill to prevent blocking forever
+# send via FIFO from the background: it only completes while the plugin reads
+( printf '%s\n' "$LARGE_JSON" >&3 ) & pidwriter=$!
+for _ in $(seq 50); do
+  kill -0 "$pidwriter" 2>/dev/null || break
+  sleep "$RESP_POLL_INTERVAL"
+done
+# a writer cut off mid-line would corrupt the next message: fail instead
 if kill -0 "$pidwriter" 2>/dev/null; then
   kill "$pidwriter" 2>/dev/null || true
+  fail "Plugin stopped reading during the oversized payload"
 fi
+wait "$pidwriter" || true
 # plugin should not crash; if it responds with error, it's acceptable
 sleep 0.5
 if kill -0 "$PLUGIN_PID" 2>/dev/null; then
@@ -238,31 +260,58 @@ fi
 # 7) exec unsupported action -> expect error
 test_message_expect "exec-unsupported" "t-unk-1" '{"id":"t-unk-1","type":"exec","payload":{"action":"does_not_exist"}}' '.status == "error"'
 
-# 8) graceful shutdown
-echo "== Test: shutdown =="
-send_msg "t-shutdown-1" '{"id":"t-shutdown-1","type":"shutdown"}'
-# wait for shutdown ack
-sleep 0.5
-resp="$(find_response_by_id 't-shutdown-1' || true)"
-if [[ -z "$resp" ]]; then
-  echo "No explicit shutdown response found; check logs"
-  sed -n '1,200p' "$STDOUT_LOG"
-fi
+# 8) batch -> one response with a result per sub-request; a failed item does not fail the batch
+test_message_expect "batch" "t-batch-1" '{"id":"t-batch-1","type":"batch","payload":{"requests":[{"id":"t-batch-1.a","type":"exec","payload":{"action":"echo","message":"hi"}},{"id":"t-batch-1.b","type":"exec","payload":{"action":"does_not_exist"}}]}}' '.status == "ok" and (.body.responses | length) == 2 and .body.responses[0].id == "t-batch-1.a" and .body.responses[0].body.message == "hi" and .body.responses[1].status == "error" and .body.failed == 1'
 
-# Wait for process to exit (allow up to 3s)
-wait_secs=0
-while kill -0 "$PLUGIN_PID" 2>/dev/null && [[ $wait_secs -lt 3 ]]; do
-  sleep 0.2
-  wait_secs=$((wait_secs+1))
-done
+# 8b) batch edge cases: a malformed batch fails as a whole, disallowed items fail alone
+test_message_expect "batch-no-requests" "t-batch-2" '{"id":"t-batch-2","type":"batch","payload":{}}' '.status == "error" and .code == 400'
+test_message_expect "batch-items" "t-batch-3" '{"id":"t-batch-3","type":"batch","payload":{"requests":[{"id":"t-batch-3.a","type":"health"},{"id":"t-batch-3.b","type":"batch","payload":{"requests":[]}},{"id":"t-batch-3.c","type":"shutdown"},7]}}' '.status == "ok" and (.body.responses | length) == 4 and .body.responses[0].body.status == "healthy" and ([.body.responses[1:][] | .status] == ["error","error","error"]) and .body.failed == 3'
+test_message_expect "batch-empty" "t-batch-4" '{"id":"t-batch-4","type":"batch","payload":{"requests":[]}}' '.status == "ok" and .body.responses == [] and .body.failed == 0'
 
-if kill -0 "$PLUGIN_PID" 2>/dev/null; then
-  echo "Plugin did not exit after shutdown request; killing"
-  kill -9 "$PLUGIN_PID" 2>/dev/null || true
-  fail "Plugin failed to exit on shutdown"
-else
-  echo "Plugin exited gracefully after shutdown (OK)"
-fi
+# 9) meta -> output statistics (responses per write(2) call)
+test_message_expect "meta" "t-meta-1" '{"id":"t-meta-1","type":"meta"}' '.status == "ok" and .body.output.responses >= 1 and .body.output.responses_per_write >= 1'
+
+# 10) graceful shutdown
+stop_plugin "t-shutdown-1"
+
+# === Output coalescing (OMNIFLOW_PLUGIN_FLUSH_US) ===
+FLUSH_US=1000000                           # the plugin's largest window
+start_plugin OMNIFLOW_PLUGIN_FLUSH_US="$FLUSH_US"
+
+# 11) a lone request is flushed as soon as stdin is idle, not after the window
+echo "== Test: flush-when-idle =="
+send_msg "t-idle-1" '{"id":"t-idle-1","type":"health"}'
+[[ -n "$(wait_for_response "t-idle-1" 5)" ]] || fail "flush-when-idle: response held for the flush window"
+echo "OK: flush-when-idle"
+
+# 12) a burst arriving in one write is answered in fewer write(2) calls
+burst=""
+for i in $(seq 50); do burst+="{\"id\":\"t-burst-$i\",\"type\":\"health\"}"$'\n'; done
+printf '%s' "$burst" >&3
+[[ -n "$(wait_for_response "t-burst-50")" ]] || fail "burst: no response for the last request"
+test_message_expect "meta-coalesced" "t-meta-2" '{"id":"t-meta-2","type":"meta"}' ".status == \"ok\" and .body.output.flush_us == $FLUSH_US and .body.output.responses >= 51 and .body.output.responses_per_write > 1"
+
+stop_plugin "t-shutdown-2"
+
+# 13) while stdin stays busy, a buffered response still goes out once it has
+# waited FLUSH_US. A regular file as stdin never reads as idle, and blank lines
+# get no response, so only the flush timer can write the health response
+# before the trailing meta request is answered (output.writes >= 1 there).
+echo "== Test: flush-on-timer =="
+timer_in="$TEST_DIR/timer.ndjson"
+{
+  echo '{"id":"t-timer-1","type":"health"}'
+  head -c 2000000 /dev/zero | tr '\0' '\n'
+  echo '{"id":"t-timer-2","type":"meta"}'
+} > "$timer_in"
+env OMNIFLOW_PLUGIN_HEARTBEAT=1 OMNIFLOW_PLUGIN_FLUSH_US=1000 timeout 20 "$BIN_PATH" \
+  < "$timer_in" > "$STDOUT_LOG" 2>> "$STDERR_LOG" || fail "flush-on-timer: plugin failed"
+resp="$(find_response_by_id "t-timer-2")"
+echo "Response: $resp"
+[[ -n "$(find_response_by_id "t-timer-1")" ]] || fail "flush-on-timer: no health response"
+echo "$resp" | jq -e '.body.output.flush_us == 1000 and .body.output.writes >= 1' >/dev/null 2>&1 \
+  || fail "flush-on-timer: response still buffered after FLUSH_US"
+echo "OK: flush-on-timer"
 
 echo "All tests passed."
 
@@ -0,0 +1,113 @@
+/*
+ * inprocess_host.c
+ *
+ * Minimal host for the in-process plugin ABI (plugins/common/omniflow_plugin.h)
+ * License: Apache-2.0
+ *
+ * Loads a plugin shared library with dlopen(), then runs each line of stdin
+ * as an exec payload and prints "<status> <result>" per line. With
+ * `--bench N` it instead runs the first line N times and prints the mean
+ * time per call.
+ *
+ *   cc -O2 -I plugins/common -o inprocess_host plugins/common/examples/inprocess_host.c -ldl
+ *   echo '{"action":"reverse","message":"abc"}' | ./inprocess_host build/lib/libomni_plugin_cpp.so
+ *   # -> 0 {"action":"reverse","message":"cba"}
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../omniflow_plugin.h"
+
+struct plugin_api {
+    omniflow_plugin_abi_version_fn abi_version;
+    omniflow_plugin_init_fn init;
+    omniflow_plugin_exec_fn exec;
+    omniflow_plugin_free_fn free;
+};
+
+static int load(const char *path, struct plugin_api *api) {
+    void *lib = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!lib) {
+        fprintf(stderr, "dlopen: %s\n", dlerror());
+        return -1;
+    }
+    /* POSIX guarantees dlsym results convert to function pointers */
+    *(void **)&api->abi_version = dlsym(lib, "omniflow_plugin_abi_version");
+    *(void **)&api->init = dlsym(lib, "omniflow_plugin_init");
+    *(void **)&api->exec = dlsym(lib, "omniflow_plugin_exec");
+    *(void **)&api->free = dlsym(lib, "omniflow_plugin_free");
+    if (!api->abi_version || !api->init || !api->exec || !api->free) {
+        fprintf(stderr, "%s does not implement the OmniFlow plugin ABI\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+/* Runs one payload, growing `*buf` once if the result does not fit */
+static int exec_one(const struct plugin_api *api, omniflow_plugin *p, const char *payload, size_t len, char **buf,
+                    size_t *cap, size_t *out_len) {
+    int rc = api->exec(p, payload, len, *buf, *cap, out_len);
+    if (rc == OMNIFLOW_E_SPACE) {
+        char *bigger = realloc(*buf, *out_len);
+        if (!bigger) return OMNIFLOW_E_NOMEM;
+        *buf = bigger;
+        *cap = *out_len;
+        rc = api->exec(p, NULL, 0, *buf, *cap, out_len); /* the kept result */
+    }
+    return rc;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2 && !(argc == 4 && strcmp(argv[2], "--bench") == 0)) {
+        fprintf(stderr, "usage: %s <plugin.so> [--bench N] < payloads.ndjson\n", argv[0]);
+        return 2;
+    }
+    struct plugin_api api;
+    if (load(argv[1], &api) != 0) return 1;
+    if (api.abi_version() < OMNIFLOW_PLUGIN_ABI_VERSION) {
+        fprintf(stderr, "plugin implements ABI %u, need %u\n", api.abi_version(), OMNIFLOW_PLUGIN_ABI_VERSION);
+        return 1;
+    }
+    omniflow_plugin *p = NULL;
+    int rc = api.init(OMNIFLOW_PLUGIN_ABI_VERSION, NULL, 0, &p);
+    if (rc != OMNIFLOW_OK) {
+        fprintf(stderr, "init failed: %d\n", rc);
+        return 1;
+    }
+
+    size_t cap = 256, out_len = 0, line_cap = 0;
+    char *buf = malloc(cap), *line = NULL;
+    ssize_t n;
+    int status = 0;
+    while (buf && (n = getline(&line, &line_cap, stdin)) > 0) {
+        size_t len = (size_t)n;
+        if (line[len - 1] == '\n') --len;
+        if (argc == 4) {
+            long iterations = atol(argv[3]);
+            struct timespec t0, t1;
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            for (long i = 0; i < iterations; ++i) exec_one(&api, p, line, len, &buf, &cap, &out_len);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            double ns = (double)(t1.tv_sec - t0.tv_sec) * 1e9 + (double)(t1.tv_nsec - t0.tv_nsec);
+            printf("{\"iterations\":%ld,\"ns_per_call\":%.1f}\n", iterations, iterations > 0 ? ns / iterations : 0.0);
+            break;
+        }
+        rc = exec_one(&api, p, line, len, &buf, &cap, &out_len);
+        if (rc < 0) {
+            printf("%d\n", rc);
+            status = 1;
+        } else {
+            printf("%d %.*s\n", rc, (int)out_len, buf);
+        }
+    }
+    free(line);
+    free(buf);
+    api.free(p);
+    return status;
+}
@@ -0,0 +1,96 @@
+/*
+ * omniflow_plugin.h
+ *
+ * In-process plugin ABI for OmniFlow (plugins/common)
+ * License: Apache-2.0
+ *
+ * Purpose:
+ *   - A trusted plugin built as a shared library is loaded with dlopen() and
+ *     called directly: no process, no pipe, no NDJSON envelope. One exec call
+ *     is a function call on the host's thread.
+ *   - The ABI is plain C and only passes bytes in caller-owned buffers, so a
+ *     plugin written in any language (and built with any C++ runtime) can
+ *     implement it. See "In-process plugins (shared library ABI)" in
+ *     plugin-api.md.
+ *   - The stdio protocol stays the way to run untrusted plugins: an
+ *     in-process plugin shares the host's address space and privileges.
+ *
+ * Contract:
+ *   - omniflow_plugin_exec() takes an exec payload (the JSON object a stdio
+ *     request carries in `payload`, e.g. {"action":"echo","message":"hi"})
+ *     and writes the result into `out`. On success it returns OMNIFLOW_OK and
+ *     `out` holds the response body as JSON. A positive return is a protocol
+ *     error code (see plugin-api.md / protocol.md, e.g. 400, 422) and `out`
+ *     holds its message. Negative returns are ABI errors (omniflow_abi_status).
+ *   - `*out_len` is always set to the full length of the result. Results are
+ *     not NUL-terminated. If `out_cap` is too small, nothing is written and
+ *     OMNIFLOW_E_SPACE is returned; the result is kept for the calling thread,
+ *     and calling exec again on the same thread and handle with
+ *     `payload == NULL` copies it out instead of running the action again.
+ *   - exec may be called from any number of threads at once on one handle.
+ *     init and free must not race with exec on the same handle.
+ *   - An ABI is identified by OMNIFLOW_PLUGIN_ABI_VERSION; a host passes the
+ *     version it was built against to init, and init refuses versions it does
+ *     not implement. Changes are additive within a version.
+ */
+
+#ifndef OMNIFLOW_PLUGIN_H
+#define OMNIFLOW_PLUGIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OMNIFLOW_PLUGIN_ABI_VERSION 1u
+
+#if defined(_WIN32)
+#define OMNIFLOW_PLUGIN_EXPORT __declspec(dllexport)
+#elif defined(__GNUC__)
+#define OMNIFLOW_PLUGIN_EXPORT __attribute__((visibility("default")))
+#else
+#define OMNIFLOW_PLUGIN_EXPORT
+#endif
+
+/* Negative results of the ABI functions; positive ones are protocol codes */
+enum omniflow_abi_status {
+    OMNIFLOW_OK = 0,
+    OMNIFLOW_E_ARGS = -1,    /* NULL handle or out pointer, malformed config */
+    OMNIFLOW_E_VERSION = -2, /* abi_version not implemented by this plugin */
+    OMNIFLOW_E_SPACE = -3,   /* out_cap < *out_len; retry with payload == NULL */
+    OMNIFLOW_E_NOMEM = -4,
+    OMNIFLOW_E_INTERNAL = -5 /* the plugin failed outside of an action */
+};
+
+typedef struct omniflow_plugin omniflow_plugin;
+
+/* The highest ABI version the library implements */
+OMNIFLOW_PLUGIN_EXPORT uint32_t omniflow_plugin_abi_version(void);
+
+/*
+ * Creates a handle. `config` is optional plugin-defined JSON object text
+ * (NULL or empty for defaults). On success *out receives the handle.
+ */
+OMNIFLOW_PLUGIN_EXPORT int omniflow_plugin_init(uint32_t abi_version, const char *config, size_t config_len,
+                                                omniflow_plugin **out);
+
+/* Runs one exec payload; see the contract above */
+OMNIFLOW_PLUGIN_EXPORT int omniflow_plugin_exec(omniflow_plugin *plugin, const char *payload, size_t payload_len,
+                                                char *out, size_t out_cap, size_t *out_len);
+
+/* Releases a handle from init (NULL is ignored) */
+OMNIFLOW_PLUGIN_EXPORT void omniflow_plugin_free(omniflow_plugin *plugin);
+
+/* dlsym()-friendly function pointer types */
+typedef uint32_t (*omniflow_plugin_abi_version_fn)(void);
+typedef int (*omniflow_plugin_init_fn)(uint32_t, const char *, size_t, omniflow_plugin **);
+typedef int (*omniflow_plugin_exec_fn)(omniflow_plugin *, const char *, size_t, char *, size_t, size_t *);
+typedef void (*omniflow_plugin_free_fn)(omniflow_plugin *);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* OMNIFLOW_PLUGIN_H */
@@ -0,0 +1,128 @@
+/*
+ * action_registry.hpp
+ *
+ * Table-driven exec action registry for the OmniFlow C++ plugin (plugins/cpp)
+ * License: Apache-2.0
+ *
+ * Purpose:
+ *   - exec actions are registered once at startup with
+ *     register_action(name, handler, traits) instead of being matched by a
+ *     chain of string compares. find() is one hash of the name and, almost
+ *     always, one string compare, however many actions exist.
+ *   - The table is flat open addressing (linear probing, power-of-two size,
+ *     load factor at most 1/2) over an array of registered Actions.
+ *   - ActionTraits carry what the rest of the plugin needs to know about an
+ *     action without running it: whether its result may be memoized, whether
+ *     it burns CPU or mostly waits (for scheduling), and its own timeout.
+ *
+ * Contract:
+ *   - register_action() throws std::invalid_argument for an empty or
+ *     duplicate name. Registration happens before requests are served;
+ *     afterwards the registry is read-only and find()/at() may be called from
+ *     any thread without locking.
+ *   - Actions are numbered in registration order (Action::index, 0..size()-1),
+ *     which callers use to lay out per-action counters.
+ *   - `Handler` is any copyable callable type chosen by the plugin.
+ */
+
+#ifndef OMNIFLOW_PLUGIN_ACTION_REGISTRY_HPP
+#define OMNIFLOW_PLUGIN_ACTION_REGISTRY_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace omniflow {
+
+enum class ActionKind { Cpu, Io, Light };
+
+struct ActionTraits {
+    bool cacheable = false;                // result depends only on the payload
+    ActionKind kind = ActionKind::Cpu;     // Io: mostly waits (sleep, I/O); Cpu: computes;
+                                           // Light: short, bounded work (runs in the Control lane)
+    std::chrono::milliseconds timeout{0};  // 0 = the plugin-wide exec timeout
+};
+
+inline const char *action_kind_name(ActionKind k) noexcept {
+    switch (k) {
+    case ActionKind::Io: return "io";
+    case ActionKind::Light: return "light";
+    default: return "cpu";
+    }
+}
+
+template <typename Handler>
+class ActionRegistry {
+public:
+    struct Action {
+        std::string name;
+        Handler handler;
+        ActionTraits traits;
+        size_t index = 0;
+    };
+
+    ActionRegistry() = default;
+    ActionRegistry(const ActionRegistry &) = delete;
+    ActionRegistry &operator=(const ActionRegistry &) = delete;
+
+    size_t register_action(std::string name, Handler handler, ActionTraits traits = {}) {
+        if (name.empty()) throw std::invalid_argument("action name must not be empty");
+        if (find(name)) throw std::invalid_argument("action '" + name + "' is already registered");
+        size_t index = actions_.size();
+        actions_.push_back(std::make_unique<Action>(Action{std::move(name), std::move(handler), traits, index}));
+        if ((actions_.size()) * 2 > slots_.size()) rehash(slots_.empty() ? 16 : slots_.size() * 2);
+        else place(index);
+        return index;
+    }
+
+    // nullptr when no action has that name
+    const Action *find(std::string_view name) const noexcept {
+        if (slots_.empty()) return nullptr;
+        size_t mask = slots_.size() - 1;
+        for (size_t i = hash(name) & mask;; i = (i + 1) & mask) {
+            uint32_t s = slots_[i];
+            if (s == EMPTY) return nullptr;
+            const Action &a = *actions_[s];
+            if (a.name == name) return &a;
+        }
+    }
+
+    const Action &at(size_t index) const { return *actions_.at(index); }
+    size_t size() const noexcept { return actions_.size(); }
+
+private:
+    static constexpr uint32_t EMPTY = ~uint32_t(0);
+
+    // FNV-1a: names are short, and this runs once per exec request
+    static size_t hash(std::string_view s) noexcept {
+        uint64_t h = 0xcbf29ce484222325ULL;
+        for (unsigned char c : s) h = (h ^ c) * 0x100000001b3ULL;
+        return static_cast<size_t>(h ^ (h >> 32));
+    }
+
+    void place(size_t index) {
+        size_t mask = slots_.size() - 1;
+        size_t i = hash(actions_[index]->name) & mask;
+        while (slots_[i] != EMPTY) i = (i + 1) & mask;
+        slots_[i] = static_cast<uint32_t>(index);
+    }
+
+    void rehash(size_t n) {
+        slots_.assign(n, EMPTY);
+        for (size_t i = 0; i < actions_.size(); ++i) place(i);
+    }
+
+    // Actions are boxed so pointers from find() survive later registrations
+    std::vector<std::unique_ptr<Action>> actions_;
+    std::vector<uint32_t> slots_;
+};
+
+} // namespace omniflow
+
+#endif // OMNIFLOW_PLUGIN_ACTION_REGISTRY_HPP
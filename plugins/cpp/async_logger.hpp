@@ -0,0 +1,332 @@
+/*
+ * async_logger.hpp
+ *
+ * Asynchronous stderr logger for the OmniFlow C++ plugin (plugins/cpp)
+ * License: Apache-2.0
+ *
+ * Purpose:
+ *   - Keeps logging off the request path: log() stamps the record and moves it
+ *     into a bounded lock-free MPSC ring (one CAS, no mutex, no I/O). A
+ *     background thread formats records and hands them to write(2) in
+ *     batches, so a burst of log lines costs a few syscalls.
+ *   - Output is "[ts] [LEVEL] name: msg" lines, or JSON lines
+ *     ({"ts","level","plugin","msg"}) when constructed for structured output
+ *     (OMNIFLOW_LOG_JSON=true, see plugins/common/protocol.md).
+ *   - When the ring is full the record is dropped and counted; the writer
+ *     reports the number of dropped records in its next batch.
+ *
+ * Contract:
+ *   - log()/raw() are thread-safe and never block. Records from one thread
+ *     are written in the order they were logged.
+ *   - raw() lines are written as given (e.g. an already-serialized JSON line).
+ *   - stop() (and the destructor) writes out everything accepted so far and
+ *     joins the writer; records logged after it are written synchronously.
+ */
+
+#ifndef OMNIFLOW_PLUGIN_ASYNC_LOGGER_HPP
+#define OMNIFLOW_PLUGIN_ASYNC_LOGGER_HPP
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include <unistd.h>
+
+namespace omniflow {
+
+// Bounded multi-producer single-consumer ring (Vyukov's sequence-numbered
+// slots). Capacity is rounded up to a power of two.
+template <typename T>
+class MpscRing {
+public:
+    explicit MpscRing(size_t capacity) : mask_(round_up(capacity) - 1), slots_(new Slot[mask_ + 1]) {
+        for (size_t i = 0; i <= mask_; ++i) slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    MpscRing(const MpscRing &) = delete;
+    MpscRing &operator=(const MpscRing &) = delete;
+
+    size_t capacity() const noexcept { return mask_ + 1; }
+
+    // Any thread. False (and `v` untouched) when the ring is full.
+    bool try_push(T &v) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot &s = slots_[pos & mask_];
+            size_t seq = s.seq.load(std::memory_order_acquire);
+            if (seq == pos) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    s.value = std::move(v);
+                    s.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (seq < pos) {
+                return false; // the consumer has not freed this slot yet
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer thread only. False when nothing is ready.
+    bool try_pop(T &out) {
+        Slot &s = slots_[tail_ & mask_];
+        if (s.seq.load(std::memory_order_acquire) != tail_ + 1) return false;
+        out = std::move(s.value);
+        s.seq.store(tail_ + mask_ + 1, std::memory_order_release);
+        ++tail_;
+        return true;
+    }
+
+    // Consumer thread only. True when try_pop() would succeed.
+    bool ready() const {
+        return slots_[tail_ & mask_].seq.load(std::memory_order_acquire) == tail_ + 1;
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> seq{0};
+        T value{};
+    };
+
+    static size_t round_up(size_t n) {
+        size_t c = 2;
+        while (c < n) c <<= 1;
+        return c;
+    }
+
+    const size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) size_t tail_ = 0;
+};
+
+class AsyncLogger {
+public:
+    enum class Level : uint8_t { Debug, Info, Warn, Error, Raw };
+
+    static constexpr size_t BATCH_BYTES = 64 * 1024; // a batch is written once it holds this much
+
+    AsyncLogger(int fd, std::string name, bool json, size_t capacity = 4096)
+        : fd_(fd), name_(std::move(name)), json_(json), ring_(capacity) {
+        writer_ = std::thread([this] { run(); });
+    }
+
+    ~AsyncLogger() { stop(); }
+
+    AsyncLogger(const AsyncLogger &) = delete;
+    AsyncLogger &operator=(const AsyncLogger &) = delete;
+
+    bool json() const noexcept { return json_; }
+    uint64_t dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+    // False when the record was dropped (ring full).
+    bool log(Level level, std::string msg) {
+        Record r{level, std::chrono::system_clock::now(), std::move(msg)};
+        // stop() waits for active_ to reach zero before its final drain, so a
+        // record is either pushed before that drain or sees stopped_ set.
+        active_.fetch_add(1, std::memory_order_seq_cst);
+        if (stopped_.load(std::memory_order_seq_cst)) {
+            active_.fetch_sub(1, std::memory_order_release);
+            std::lock_guard<std::mutex> lock(mu_); // after stop(): written in place
+            std::string out;
+            format(r, out);
+            write_all(out);
+            return true;
+        }
+        bool pushed = ring_.try_push(r);
+        active_.fetch_sub(1, std::memory_order_release);
+        if (!pushed) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        // Pairs with the fence in run(): either the writer sees the record
+        // before it sleeps, or this thread sees it sleeping and wakes it.
+        // Taking mu_ first keeps the notify from landing between the
+        // writer's predicate check and its wait.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed)) {
+            { std::lock_guard<std::mutex> lock(mu_); }
+            cv_.notify_one();
+        }
+        return true;
+    }
+
+    bool raw(std::string line) { return log(Level::Raw, std::move(line)); }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (stopping_) return;
+            stopping_ = true;
+        }
+        cv_.notify_one();
+        if (writer_.joinable()) writer_.join();
+        // take over as the consumer: records pushed while the writer exited,
+        // including those of log() calls still in flight
+        std::lock_guard<std::mutex> lock(mu_);
+        stopped_.store(true, std::memory_order_seq_cst);
+        while (active_.load(std::memory_order_acquire) != 0) std::this_thread::yield();
+        std::string rest;
+        Record r;
+        while (ring_.try_pop(r)) format(r, rest);
+        write_all(rest);
+    }
+
+private:
+    struct Record {
+        Level level = Level::Info;
+        std::chrono::system_clock::time_point at{};
+        std::string msg;
+    };
+
+    void run() {
+        std::string batch;
+        Record r;
+        uint64_t reported = 0;
+        for (;;) {
+            bool stopping;
+            {
+                std::lock_guard<std::mutex> lock(mu_);
+                stopping = stopping_;
+            }
+            while (batch.size() < BATCH_BYTES && ring_.try_pop(r)) format(r, batch);
+            uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+            if (dropped != reported) {
+                format(Record{Level::Warn, std::chrono::system_clock::now(),
+                              std::to_string(dropped - reported) + " log records dropped (ring full)"},
+                       batch);
+                reported = dropped;
+            }
+            if (!batch.empty()) {
+                write_all(batch);
+                batch.clear();
+                continue;
+            }
+            if (stopping) return;
+
+            std::unique_lock<std::mutex> lock(mu_);
+            sleeping_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            // the timeout only paces drop reports; producers wake this thread
+            cv_.wait_for(lock, std::chrono::milliseconds(100), [this] { return stopping_ || ring_.ready(); });
+            sleeping_.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    static const char *level_name(Level l, bool json) {
+        switch (l) {
+        case Level::Debug: return json ? "debug" : "DEBUG";
+        case Level::Info: return json ? "info" : "INFO";
+        case Level::Warn: return json ? "warn" : "WARN";
+        case Level::Error: return json ? "error" : "ERROR";
+        case Level::Raw: break;
+        }
+        return "";
+    }
+
+    // Writer thread, or under mu_ once it has exited; the timestamp text is
+    // cached per second.
+    void format(const Record &r, std::string &out) {
+        if (r.level == Level::Raw) {
+            out += r.msg;
+            out += '\n';
+            return;
+        }
+        std::time_t t = std::chrono::system_clock::to_time_t(r.at);
+        if (t != ts_second_) {
+            std::tm tm{};
+            gmtime_r(&t, &tm);
+            std::strftime(ts_, sizeof(ts_), "%Y-%m-%dT%H:%M:%SZ", &tm);
+            ts_second_ = t;
+        }
+        if (json_) {
+            out += "{\"ts\":\"";
+            out += ts_;
+            out += "\",\"level\":\"";
+            out += level_name(r.level, true);
+            out += "\",\"plugin\":";
+            append_escaped(out, name_);
+            out += ",\"msg\":";
+            append_escaped(out, r.msg);
+            out += "}\n";
+        } else {
+            out += '[';
+            out += ts_;
+            out += "] [";
+            out += level_name(r.level, false);
+            out += "] ";
+            out += name_;
+            out += ": ";
+            out += r.msg;
+            out += '\n';
+        }
+    }
+
+    static void append_escaped(std::string &out, std::string_view s) {
+        out += '"';
+        for (char c : s) {
+            switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(static_cast<unsigned char>(c)));
+                    out += buf;
+                } else {
+                    out += c;
+                }
+            }
+        }
+        out += '"';
+    }
+
+    // Retries on EINTR and short writes; on any other error the batch is lost.
+    void write_all(const std::string &data) {
+        const char *p = data.data();
+        size_t left = data.size();
+        while (left > 0) {
+            ssize_t n = ::write(fd_, p, left);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return;
+            }
+            p += n;
+            left -= static_cast<size_t>(n);
+        }
+    }
+
+    const int fd_;
+    const std::string name_;
+    const bool json_;
+    MpscRing<Record> ring_;
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<bool> sleeping_{false};
+    std::atomic<bool> stopped_{false};
+    std::atomic<size_t> active_{0}; // log() calls between their stopped_ check and push
+    std::mutex mu_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+    std::time_t ts_second_ = -1;
+    char ts_[32] = {};
+    std::thread writer_;
+};
+
+} // namespace omniflow
+
+#endif // OMNIFLOW_PLUGIN_ASYNC_LOGGER_HPP
@@ -0,0 +1,268 @@
+/*
+ * coalescing_writer.hpp
+ *
+ * Coalescing stdout writer for the OmniFlow C++ plugin (plugins/cpp)
+ * License: Apache-2.0
+ *
+ * Purpose:
+ *   - Collects response lines in one buffer and hands them to write(2) together,
+ *     so a burst of N responses costs one syscall instead of N flushes.
+ *   - With a zero window every write() is flushed immediately (one write(2) per
+ *     response, the classic line-buffered behaviour).
+ *
+ * Flush policy (window > 0):
+ *   - flush() is called by the plugin whenever its input is idle, so a lone
+ *     request is answered without added latency;
+ *   - the buffer is flushed as soon as it holds `max_bytes` or more;
+ *   - otherwise a flusher thread writes it out `window` after the first
+ *     unflushed line, bounding the extra latency under load. A queued writer
+ *     has no thread: its owner's event loop flushes at flush_deadline().
+ *
+ * Queued writers (server-mode client sockets, see unix_server.hpp):
+ *   - The fd is non-blocking and is never waited on. What the socket does not
+ *     take is kept in a per-writer queue and `wake` asks the event loop to
+ *     flush it again once the socket is writable (EPOLLOUT).
+ *   - A peer whose queue exceeds `max_queued` bytes is considered gone: the
+ *     queue and every later write are dropped, and overflowed() turns true.
+ *
+ * Contract:
+ *   - write() takes complete, newline-terminated lines (or whole length-prefixed
+ *     frames in the binary transport); lines are never split or interleaved,
+ *     and lines are written in the order write() accepted them.
+ *   - A non-blocking fd given to the threaded writer is waited on with poll(2)
+ *     when its send buffer is full. A peer that accepts nothing for
+ *     STALL_TIMEOUT is considered gone: the pending data and every later write
+ *     are dropped.
+ *   - All methods are thread-safe, and `wake` is called without the writer's
+ *     locks held. The destructor flushes and stops the flusher; a queued
+ *     writer's destructor only makes one last non-blocking attempt.
+ */
+
+#ifndef OMNIFLOW_PLUGIN_COALESCING_WRITER_HPP
+#define OMNIFLOW_PLUGIN_COALESCING_WRITER_HPP
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include <poll.h>
+#include <unistd.h>
+
+namespace omniflow {
+
+class CoalescingWriter {
+public:
+    struct Stats {
+        uint64_t lines = 0;  // response lines accepted
+        uint64_t writes = 0; // write(2) calls issued
+    };
+
+    static constexpr std::chrono::milliseconds STALL_TIMEOUT{5000};
+
+    CoalescingWriter(int fd, std::chrono::microseconds window, size_t max_bytes)
+        : fd_(fd), window_(window), max_bytes_(max_bytes) {
+        if (coalescing()) flusher_ = std::thread([this] { run_flusher(); });
+    }
+
+    // Queued writer: no flusher thread and no waiting (see above).
+    CoalescingWriter(int fd, std::chrono::microseconds window, size_t max_bytes, size_t max_queued,
+                     std::function<void()> wake)
+        : fd_(fd), window_(window), max_bytes_(max_bytes), max_queued_(max_queued), wake_(std::move(wake)) {}
+
+    ~CoalescingWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        if (flusher_.joinable()) flusher_.join();
+        flush();
+    }
+
+    CoalescingWriter(const CoalescingWriter &) = delete;
+    CoalescingWriter &operator=(const CoalescingWriter &) = delete;
+
+    bool coalescing() const noexcept { return window_.count() > 0; }
+    std::chrono::microseconds window() const noexcept { return window_; }
+
+    bool queued() const noexcept { return static_cast<bool>(wake_); }
+
+    // Queue one or more complete lines; flushes per the policy above.
+    void write(std::string_view lines, uint64_t count = 1) {
+        bool flush_now, first;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            first = buf_.empty();
+            if (first) first_pending_ = std::chrono::steady_clock::now();
+            buf_.append(lines.data(), lines.size());
+            lines_ += count;
+            flush_now = !coalescing() || buf_.size() >= max_bytes_;
+        }
+        if (flush_now) flush();
+        else if (queued()) {
+            if (first) wake_(); // the loop arms a timer for flush_deadline()
+        } else {
+            cv_.notify_one();
+        }
+    }
+
+    // Write out everything accepted so far. A queued writer sends what the
+    // socket takes now and keeps the rest.
+    void flush() {
+        if (queued()) {
+            if (send_queued()) wake_();
+            return;
+        }
+        std::lock_guard<std::mutex> io(io_mu_);
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (buf_.empty()) return;
+            out_.swap(buf_);
+        }
+        write_all(out_);
+        out_.clear();
+    }
+
+    // Queued writer: bytes the socket has not taken yet (wait for EPOLLOUT).
+    size_t backlog() const {
+        std::lock_guard<std::mutex> io(io_mu_);
+        return out_.size();
+    }
+
+    // Queued writer: the peer fell more than max_queued bytes behind.
+    bool overflowed() const {
+        std::lock_guard<std::mutex> io(io_mu_);
+        return overflowed_;
+    }
+
+    // Queued writer: when the buffered lines are due, or time_point::max()
+    // when nothing is buffered.
+    std::chrono::steady_clock::time_point flush_deadline() const {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (buf_.empty()) return std::chrono::steady_clock::time_point::max();
+        return first_pending_ + window_;
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mu_);
+        return Stats{lines_, writes_};
+    }
+
+private:
+    // Called with io_mu_ held: write(2) the whole buffer, retrying on EINTR and
+    // short writes. On a broken pipe the host is gone; the data is dropped.
+    void write_all(const std::string &data) {
+        const char *p = data.data();
+        size_t left = data.size();
+        while (left > 0 && !stalled_) {
+            ssize_t n = ::write(fd_, p, left);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    struct pollfd pfd{fd_, POLLOUT, 0};
+                    int r = ::poll(&pfd, 1, static_cast<int>(STALL_TIMEOUT.count()));
+                    if (r == 0 || (r < 0 && errno != EINTR)) stalled_ = true;
+                    continue;
+                }
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mu_);
+                ++writes_;
+            }
+            p += n;
+            left -= static_cast<size_t>(n);
+        }
+    }
+
+    // Queued writer: move buf_ behind the queue and send until the socket is
+    // full. True when the loop must look at this writer again: bytes are
+    // still queued, or the writer has just overflowed.
+    bool send_queued() {
+        std::lock_guard<std::mutex> io(io_mu_);
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (buf_.empty() && out_.empty()) return false;
+            if (stalled_) {
+                buf_.clear();
+                return false;
+            }
+            if (out_.empty()) out_.swap(buf_);
+            else {
+                out_ += buf_;
+                buf_.clear();
+            }
+        }
+        size_t sent = 0;
+        while (sent < out_.size()) {
+            ssize_t n = ::write(fd_, out_.data() + sent, out_.size() - sent);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) stalled_ = true; // the peer is gone
+                break;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mu_);
+                ++writes_;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        out_.erase(0, sent);
+        if (stalled_) {
+            out_.clear();
+            return false;
+        }
+        if (out_.size() > max_queued_) {
+            out_.clear();
+            stalled_ = overflowed_ = true;
+        }
+        return !out_.empty() || overflowed_;
+    }
+
+    void run_flusher() {
+        std::unique_lock<std::mutex> lock(mu_);
+        for (;;) {
+            cv_.wait(lock, [this] { return stopping_ || !buf_.empty(); });
+            if (stopping_) return;
+            auto deadline = first_pending_ + window_;
+            if (cv_.wait_until(lock, deadline, [this] { return stopping_ || buf_.empty(); })) {
+                if (stopping_) return;
+                continue; // flushed by someone else in time
+            }
+            lock.unlock();
+            flush();
+            lock.lock();
+        }
+    }
+
+    const int fd_;
+    const std::chrono::microseconds window_;
+    const size_t max_bytes_;
+    const size_t max_queued_ = 0;
+    const std::function<void()> wake_; // set for a queued writer
+
+    mutable std::mutex mu_;   // guards buf_, counters, first_pending_, stopping_
+    mutable std::mutex io_mu_; // serializes flushes so lines keep their order
+    bool stalled_ = false;    // the peer stopped reading (guarded by io_mu_)
+    bool overflowed_ = false; // a queued writer's peer fell too far behind (io_mu_)
+    std::condition_variable cv_;
+    std::string buf_;
+    std::string out_;         // buffer being written (swapped with buf_); a queued writer's unsent bytes
+    std::chrono::steady_clock::time_point first_pending_{};
+    uint64_t lines_ = 0;
+    uint64_t writes_ = 0;
+    bool stopping_ = false;
+    std::thread flusher_;
+};
+
+} // namespace omniflow
+
+#endif // OMNIFLOW_PLUGIN_COALESCING_WRITER_HPP
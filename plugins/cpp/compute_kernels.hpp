@@ -0,0 +1,356 @@
+/*
+ * compute_kernels.hpp
+ *
+ * Numeric kernels behind the `compute` action of the C++ plugin (plugins/cpp)
+ * License: Apache-2.0
+ *
+ * Purpose:
+ *   - sum, min/max, mean, dot product and histogram over a contiguous int64
+ *     buffer (decoded once from the request's `numbers` array, or mapped from
+ *     shared memory), instead of walking json nodes per element.
+ *   - AVX2 (x86-64) and NEON (AArch64) variants with a scalar fallback; the
+ *     variant is chosen once at runtime from the CPU's capabilities and can be
+ *     pinned with OMNIFLOW_PLUGIN_SIMD=scalar.
+ *
+ * Overflow:
+ *   - Results are exact. Vector sums use 64-bit lanes and track lane overflow;
+ *     if any lane overflows, the buffer is re-summed in 128-bit arithmetic, so
+ *     sum() and dot() fail only when the exact result does not fit in int64.
+ *   - dot() vectorizes while every element fits in 32 bits (products then fit
+ *     comfortably in a lane); a wider element sends the call down the 128-bit
+ *     scalar path.
+ *
+ * Contract:
+ *   - Pure functions over caller-owned memory; thread-safe.
+ *   - minmax() and histogram() require n > 0.
+ */
+
+#ifndef OMNIFLOW_PLUGIN_COMPUTE_KERNELS_HPP
+#define OMNIFLOW_PLUGIN_COMPUTE_KERNELS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define OMNIFLOW_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__)
+#define OMNIFLOW_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace omniflow {
+namespace kernels {
+
+__extension__ typedef __int128 int128;
+
+enum class Isa { Scalar, Avx2, Neon };
+
+struct MinMax {
+    int64_t min;
+    int64_t max;
+};
+
+namespace detail {
+
+constexpr int128 I64_MIN = std::numeric_limits<int64_t>::min();
+constexpr int128 I64_MAX = std::numeric_limits<int64_t>::max();
+
+// ---------- scalar ----------
+inline int128 sum_scalar(const int64_t *v, size_t n) {
+    int128 acc = 0;
+    for (size_t i = 0; i < n; ++i) acc += v[i];
+    return acc;
+}
+
+inline MinMax minmax_scalar(const int64_t *v, size_t n) {
+    MinMax r{v[0], v[0]};
+    for (size_t i = 1; i < n; ++i) {
+        if (v[i] < r.min) r.min = v[i];
+        if (v[i] > r.max) r.max = v[i];
+    }
+    return r;
+}
+
+// false when the accumulator itself overflows (|result| >= 2^127)
+inline bool dot_scalar(const int64_t *a, const int64_t *b, size_t n, int128 &out) {
+    int128 acc = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (__builtin_add_overflow(acc, static_cast<int128>(a[i]) * b[i], &acc)) return false;
+    }
+    out = acc;
+    return true;
+}
+
+// ---------- AVX2 ----------
+#if defined(OMNIFLOW_KERNELS_X86)
+// Signed overflow of s = a + b happened iff a and b share a sign that s lacks.
+__attribute__((target("avx2"))) inline __m256i add_track(__m256i acc, __m256i x, __m256i &ovf) {
+    __m256i s = _mm256_add_epi64(acc, x);
+    ovf = _mm256_or_si256(ovf, _mm256_andnot_si256(_mm256_xor_si256(acc, x), _mm256_xor_si256(acc, s)));
+    return s;
+}
+
+__attribute__((target("avx2"))) inline int128 reduce_lanes(__m256i acc) {
+    alignas(32) int64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), acc);
+    return static_cast<int128>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+}
+
+__attribute__((target("avx2"))) inline int128 sum_avx2(const int64_t *v, size_t n) {
+    __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256(), ovf = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = add_track(acc0, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(v + i)), ovf);
+        acc1 = add_track(acc1, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(v + i + 4)), ovf);
+    }
+    if (_mm256_movemask_pd(_mm256_castsi256_pd(ovf))) return sum_scalar(v, n); // a lane wrapped
+    return reduce_lanes(acc0) + reduce_lanes(acc1) + sum_scalar(v + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline MinMax minmax_avx2(const int64_t *v, size_t n) {
+    if (n < 8) return minmax_scalar(v, n);
+    // two independent min/max chains hide the compare+blend latency
+    __m256i lo0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(v)), hi0 = lo0;
+    __m256i lo1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(v + 4)), hi1 = lo1;
+    size_t i = 8;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(v + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(v + i + 4));
+        lo0 = _mm256_blendv_epi8(lo0, x, _mm256_cmpgt_epi64(lo0, x));
+        hi0 = _mm256_blendv_epi8(hi0, x, _mm256_cmpgt_epi64(x, hi0));
+        lo1 = _mm256_blendv_epi8(lo1, y, _mm256_cmpgt_epi64(lo1, y));
+        hi1 = _mm256_blendv_epi8(hi1, y, _mm256_cmpgt_epi64(y, hi1));
+    }
+    alignas(32) int64_t l[8], h[8];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(l), lo0);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(l + 4), lo1);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(h), hi0);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(h + 4), hi1);
+    MinMax r{minmax_scalar(l, 8).min, minmax_scalar(h, 8).max};
+    for (; i < n; ++i) {
+        if (v[i] < r.min) r.min = v[i];
+        if (v[i] > r.max) r.max = v[i];
+    }
+    return r;
+}
+
+// _mm256_mul_epi32 multiplies the sign-extended low halves, so the product is
+// exact only for elements that fit in int32 (products are then below 2^62).
+// `wide` collects lanes that do not: x + 2^31 must have a zero upper half.
+__attribute__((target("avx2"))) inline void track_i32(__m256i x, __m256i &wide) {
+    const __m256i bias = _mm256_set1_epi64x(int64_t{1} << 31);
+    wide = _mm256_or_si256(wide, _mm256_srli_epi64(_mm256_add_epi64(x, bias), 32));
+}
+
+// Falls back to dot_scalar when an element does not fit in int32 or a lane
+// sum overflows.
+__attribute__((target("avx2"))) inline bool dot_avx2(const int64_t *a, const int64_t *b, size_t n, int128 &out) {
+    __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+    __m256i ovf = _mm256_setzero_si256(), wide = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        __m256i y0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+        __m256i x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i + 4));
+        __m256i y1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i + 4));
+        track_i32(x0, wide); track_i32(y0, wide); track_i32(x1, wide); track_i32(y1, wide);
+        acc0 = add_track(acc0, _mm256_mul_epi32(x0, y0), ovf);
+        acc1 = add_track(acc1, _mm256_mul_epi32(x1, y1), ovf);
+    }
+    if (!_mm256_testz_si256(wide, wide) || _mm256_movemask_pd(_mm256_castsi256_pd(ovf)))
+        return dot_scalar(a, b, n, out);
+    __m256i acc = add_track(acc0, acc1, ovf);
+    if (_mm256_movemask_pd(_mm256_castsi256_pd(ovf))) return dot_scalar(a, b, n, out);
+    int128 tail = 0;
+    if (!dot_scalar(a + i, b + i, n - i, tail)) return false;
+    out = reduce_lanes(acc) + tail;
+    return true;
+}
+
+inline bool cpu_has_avx2() { return __builtin_cpu_supports("avx2"); }
+#endif
+
+// ---------- NEON ----------
+#if defined(OMNIFLOW_KERNELS_NEON)
+inline int64x2_t add_track(int64x2_t acc, int64x2_t x, uint64x2_t &ovf) {
+    int64x2_t s = vaddq_s64(acc, x);
+    int64x2_t bad = vbicq_s64(veorq_s64(acc, s), veorq_s64(acc, x));
+    ovf = vorrq_u64(ovf, vreinterpretq_u64_s64(bad));
+    return s;
+}
+
+inline int128 sum_neon(const int64_t *v, size_t n) {
+    int64x2_t acc0 = vdupq_n_s64(0), acc1 = vdupq_n_s64(0);
+    uint64x2_t ovf = vdupq_n_u64(0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = add_track(acc0, vld1q_s64(v + i), ovf);
+        acc1 = add_track(acc1, vld1q_s64(v + i + 2), ovf);
+    }
+    if ((vgetq_lane_u64(ovf, 0) | vgetq_lane_u64(ovf, 1)) >> 63) return sum_scalar(v, n);
+    return static_cast<int128>(vgetq_lane_s64(acc0, 0)) + vgetq_lane_s64(acc0, 1) +
+           vgetq_lane_s64(acc1, 0) + vgetq_lane_s64(acc1, 1) + sum_scalar(v + i, n - i);
+}
+
+inline MinMax minmax_neon(const int64_t *v, size_t n) {
+    if (n < 2) return minmax_scalar(v, n);
+    int64x2_t lo = vld1q_s64(v), hi = lo;
+    size_t i = 2;
+    for (; i + 2 <= n; i += 2) {
+        int64x2_t x = vld1q_s64(v + i);
+        lo = vbslq_s64(vcgtq_s64(lo, x), x, lo);
+        hi = vbslq_s64(vcgtq_s64(x, hi), x, hi);
+    }
+    MinMax r{std::min(vgetq_lane_s64(lo, 0), vgetq_lane_s64(lo, 1)),
+             std::max(vgetq_lane_s64(hi, 0), vgetq_lane_s64(hi, 1))};
+    for (; i < n; ++i) {
+        if (v[i] < r.min) r.min = v[i];
+        if (v[i] > r.max) r.max = v[i];
+    }
+    return r;
+}
+
+// As dot_avx2: vmull_s32 of the narrowed halves is exact only for int32 elements.
+inline void track_i32(int64x2_t x, uint64x2_t &wide) {
+    const int64x2_t bias = vdupq_n_s64(int64_t{1} << 31);
+    wide = vorrq_u64(wide, vshrq_n_u64(vreinterpretq_u64_s64(vaddq_s64(x, bias)), 32));
+}
+
+inline bool dot_neon(const int64_t *a, const int64_t *b, size_t n, int128 &out) {
+    int64x2_t acc0 = vdupq_n_s64(0), acc1 = vdupq_n_s64(0);
+    uint64x2_t ovf = vdupq_n_u64(0), wide = vdupq_n_u64(0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int64x2_t x0 = vld1q_s64(a + i), y0 = vld1q_s64(b + i);
+        int64x2_t x1 = vld1q_s64(a + i + 2), y1 = vld1q_s64(b + i + 2);
+        track_i32(x0, wide); track_i32(y0, wide); track_i32(x1, wide); track_i32(y1, wide);
+        acc0 = add_track(acc0, vmull_s32(vmovn_s64(x0), vmovn_s64(y0)), ovf);
+        acc1 = add_track(acc1, vmull_s32(vmovn_s64(x1), vmovn_s64(y1)), ovf);
+    }
+    int64x2_t acc = add_track(acc0, acc1, ovf);
+    if ((vgetq_lane_u64(wide, 0) | vgetq_lane_u64(wide, 1)) ||
+        ((vgetq_lane_u64(ovf, 0) | vgetq_lane_u64(ovf, 1)) >> 63))
+        return dot_scalar(a, b, n, out);
+    int128 tail = 0;
+    if (!dot_scalar(a + i, b + i, n - i, tail)) return false;
+    out = static_cast<int128>(vgetq_lane_s64(acc, 0)) + vgetq_lane_s64(acc, 1) + tail;
+    return true;
+}
+#endif
+
+inline Isa detect_isa() {
+    const char *env = std::getenv("OMNIFLOW_PLUGIN_SIMD");
+    if (env && std::strcmp(env, "scalar") == 0) return Isa::Scalar;
+#if defined(OMNIFLOW_KERNELS_X86)
+    if (cpu_has_avx2()) return Isa::Avx2;
+#endif
+#if defined(OMNIFLOW_KERNELS_NEON)
+    return Isa::Neon; // baseline on AArch64
+#endif
+    return Isa::Scalar;
+}
+
+inline Isa &selected_isa() {
+    static Isa isa = detect_isa();
+    return isa;
+}
+
+} // namespace detail
+
+// Variant in use (detected on first call).
+inline Isa active_isa() { return detail::selected_isa(); }
+
+// Pin a variant, e.g. to compare against the scalar reference in tests. An
+// unsupported variant falls back to scalar.
+inline void set_isa(Isa isa) {
+#if defined(OMNIFLOW_KERNELS_X86)
+    if (isa == Isa::Avx2 && !detail::cpu_has_avx2()) isa = Isa::Scalar;
+#else
+    if (isa == Isa::Avx2) isa = Isa::Scalar;
+#endif
+#if !defined(OMNIFLOW_KERNELS_NEON)
+    if (isa == Isa::Neon) isa = Isa::Scalar;
+#endif
+    detail::selected_isa() = isa;
+}
+
+inline const char *isa_name(Isa isa) {
+    switch (isa) {
+        case Isa::Avx2: return "avx2";
+        case Isa::Neon: return "neon";
+        default: return "scalar";
+    }
+}
+
+// Exact sum in 128-bit arithmetic (every int64 buffer that fits in memory fits).
+inline int128 sum_wide(const int64_t *v, size_t n) {
+    switch (active_isa()) {
+#if defined(OMNIFLOW_KERNELS_X86)
+        case Isa::Avx2: return detail::sum_avx2(v, n);
+#endif
+#if defined(OMNIFLOW_KERNELS_NEON)
+        case Isa::Neon: return detail::sum_neon(v, n);
+#endif
+        default: return detail::sum_scalar(v, n);
+    }
+}
+
+// false when the exact sum does not fit in int64
+inline bool sum(const int64_t *v, size_t n, int64_t &out) {
+    int128 s = sum_wide(v, n);
+    if (s < detail::I64_MIN || s > detail::I64_MAX) return false;
+    out = static_cast<int64_t>(s);
+    return true;
+}
+
+inline MinMax minmax(const int64_t *v, size_t n) {
+    switch (active_isa()) {
+#if defined(OMNIFLOW_KERNELS_X86)
+        case Isa::Avx2: return detail::minmax_avx2(v, n);
+#endif
+#if defined(OMNIFLOW_KERNELS_NEON)
+        case Isa::Neon: return detail::minmax_neon(v, n);
+#endif
+        default: return detail::minmax_scalar(v, n);
+    }
+}
+
+// false when the exact dot product does not fit in int64
+inline bool dot(const int64_t *a, const int64_t *b, size_t n, int64_t &out) {
+    int128 d = 0;
+    bool ok;
+    switch (active_isa()) {
+#if defined(OMNIFLOW_KERNELS_X86)
+        case Isa::Avx2: ok = detail::dot_avx2(a, b, n, d); break;
+#endif
+#if defined(OMNIFLOW_KERNELS_NEON)
+        case Isa::Neon: ok = detail::dot_neon(a, b, n, d); break;
+#endif
+        default: ok = detail::dot_scalar(a, b, n, d); break;
+    }
+    if (!ok || d < detail::I64_MIN || d > detail::I64_MAX) return false;
+    out = static_cast<int64_t>(d);
+    return true;
+}
+
+// Count values into `bins` equal-width buckets covering [lo, hi] (lo <= hi);
+// values outside the range are not counted. Bucket of v: (v-lo)*bins/(hi-lo+1).
+inline void histogram(const int64_t *v, size_t n, int64_t lo, int64_t hi, uint64_t *counts, size_t bins) {
+    const int128 width = static_cast<int128>(hi) - lo + 1;
+    for (size_t b = 0; b < bins; ++b) counts[b] = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (v[i] < lo || v[i] > hi) continue;
+        ++counts[static_cast<size_t>((static_cast<int128>(v[i]) - lo) * static_cast<int128>(bins) / width)];
+    }
+}
+
+} // namespace kernels
+} // namespace omniflow
+
+#endif // OMNIFLOW_PLUGIN_COMPUTE_KERNELS_HPP
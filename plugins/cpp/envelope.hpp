@@ -0,0 +1,185 @@
+/*
+ * envelope.hpp
+ *
+ * Typed envelope decoder for the OmniFlow C++ plugin (plugins/cpp)
+ * License: Apache-2.0
+ *
+ * Purpose:
+ *   - Decodes the fixed part of a JSON message (`id`, `type`, `payload`,
+ *     `payload_ref`; see plugins/common/protocol.md) in one scan of the top
+ *     level, without building a json tree for the message.
+ *   - The fields to capture come from a constexpr table over an Envelope
+ *     struct; `type` is dispatched through a perfect hash that is checked at
+ *     compile time, so the per-message work is a few compares.
+ *   - `payload` and `payload_ref` are recorded as raw byte ranges of the frame:
+ *     the caller builds a tree for them only when its handler needs one
+ *     (health, meta and shutdown never do).
+ *
+ * Contract:
+ *   - decode_envelope() validates the whole frame with the grammar of
+ *     json::parse and throws nlohmann::detail::parse_error (with the same
+ *     messages) when it is not valid JSON. A top-level value that is not an
+ *     object decodes to an Envelope with no fields.
+ *   - As with json::parse, nesting deeper than nlohmann::detail::json_max_depth
+ *     is a parse_error, so a deeply nested frame cannot exhaust the stack.
+ *   - As with json::parse, the first occurrence of a duplicated key wins.
+ *   - `payload` / `payload_ref` are views into the frame: valid while it is.
+ */
+
+#ifndef OMNIFLOW_PLUGIN_ENVELOPE_HPP
+#define OMNIFLOW_PLUGIN_ENVELOPE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "third_party/nlohmann/json.hpp"
+
+namespace omniflow {
+
+enum class MessageType : uint8_t { Unknown, Health, Meta, Exec, Batch, Cancel, Shutdown, Quit, Metrics };
+
+struct MessageTypeName {
+    std::string_view name;
+    MessageType type = MessageType::Unknown;
+};
+
+inline constexpr MessageTypeName MESSAGE_TYPES[] = {
+    {"health", MessageType::Health}, {"meta", MessageType::Meta},     {"exec", MessageType::Exec},
+    {"batch", MessageType::Batch},   {"cancel", MessageType::Cancel}, {"shutdown", MessageType::Shutdown},
+    {"quit", MessageType::Quit},     {"metrics", MessageType::Metrics},
+};
+
+struct Envelope {
+    std::string id;                    // "" when absent or not a string
+    MessageType type = MessageType::Unknown;
+    bool has_type = false;             // `type` present and a string (type may still be Unknown)
+    std::string_view payload;          // raw JSON of `payload`; empty when absent
+    std::string_view payload_ref;      // raw JSON of `payload_ref`; empty when absent
+};
+
+namespace detail {
+
+// Raw value spans of the captured top-level members
+struct EnvelopeSpans {
+    std::string_view id, type, payload, payload_ref;
+};
+
+struct EnvelopeField {
+    std::string_view key;
+    std::string_view EnvelopeSpans::*span;
+};
+
+inline constexpr EnvelopeField ENVELOPE_FIELDS[] = {
+    {"id", &EnvelopeSpans::id},
+    {"type", &EnvelopeSpans::type},
+    {"payload", &EnvelopeSpans::payload},
+    {"payload_ref", &EnvelopeSpans::payload_ref},
+};
+
+constexpr size_t TYPE_SLOTS = 16;
+
+constexpr size_t type_slot(std::string_view name) noexcept {
+    if (name.empty()) return 0;
+    return (static_cast<unsigned char>(name.front()) + static_cast<unsigned char>(name.back()) + 2 * name.size()) &
+           (TYPE_SLOTS - 1);
+}
+
+struct TypeTable {
+    MessageTypeName slots[TYPE_SLOTS];
+    bool perfect = true;
+};
+
+constexpr TypeTable build_type_table() {
+    TypeTable t{};
+    for (const MessageTypeName &e : MESSAGE_TYPES) {
+        MessageTypeName &slot = t.slots[type_slot(e.name)];
+        if (!slot.name.empty()) t.perfect = false;
+        slot = e;
+    }
+    return t;
+}
+
+inline constexpr TypeTable TYPE_TABLE = build_type_table();
+static_assert(TYPE_TABLE.perfect, "type_slot() must give every message type its own slot");
+
+} // namespace detail
+
+constexpr MessageType message_type(std::string_view name) noexcept {
+    const MessageTypeName &e = detail::TYPE_TABLE.slots[detail::type_slot(name)];
+    return !name.empty() && e.name == name ? e.type : MessageType::Unknown;
+}
+
+static_assert(message_type("exec") == MessageType::Exec && message_type("quit") == MessageType::Quit &&
+              message_type("exe") == MessageType::Unknown, "message_type() lookup");
+
+inline Envelope decode_envelope(std::string_view s) {
+    namespace nd = nlohmann::detail;
+    Envelope env;
+    size_t idx = nd::skip_ws(s, 0);
+    if (idx >= s.size() || s[idx] != '{') {
+        nd::skip_value(s, idx); // valid JSON but not an envelope: no fields
+    } else {
+        detail::EnvelopeSpans spans;
+        idx = nd::skip_ws(s, idx + 1);
+        bool more = idx >= s.size() || s[idx] != '}';
+        if (!more) ++idx;
+        std::string decoded_key;
+        while (more) {
+            idx = nd::skip_ws(s, idx);
+            if (idx >= s.size() || s[idx] != '"') throw nd::parse_error("Expected string for object key");
+            size_t key_at = idx;
+            std::string_view key;
+            if (nd::skip_string(s, idx)) {
+                decoded_key.clear();
+                nd::decode_string(s, key_at, decoded_key);
+                key = decoded_key;
+            } else {
+                key = s.substr(key_at + 1, idx - key_at - 2);
+            }
+            idx = nd::skip_ws(s, idx);
+            if (idx >= s.size() || s[idx] != ':') throw nd::parse_error("Expected ':' after object key");
+            idx = nd::skip_ws(s, idx + 1);
+            size_t value_at = idx;
+            nd::skip_value(s, idx, 1); // inside the envelope object
+            for (const detail::EnvelopeField &f : detail::ENVELOPE_FIELDS) {
+                if (f.key != key) continue;
+                std::string_view &span = spans.*f.span;
+                if (span.empty()) span = s.substr(value_at, idx - value_at);
+                break;
+            }
+            idx = nd::skip_ws(s, idx);
+            if (idx >= s.size()) throw nd::parse_error("Unterminated object");
+            if (s[idx] == '}') { ++idx; break; }
+            if (s[idx] != ',') throw nd::parse_error("Expected ',' or '}' in object");
+            ++idx;
+        }
+
+        // strings were validated above; decode_string only unescapes here
+        if (!spans.id.empty() && spans.id[0] == '"') {
+            size_t at = 0;
+            nd::decode_string(spans.id, at, env.id);
+        }
+        if (!spans.type.empty() && spans.type[0] == '"') {
+            env.has_type = true;
+            std::string_view name = spans.type.substr(1, spans.type.size() - 2);
+            std::string unescaped;
+            if (name.find('\\') != std::string_view::npos) {
+                size_t at = 0;
+                nd::decode_string(spans.type, at, unescaped);
+                name = unescaped;
+            }
+            env.type = message_type(name);
+        }
+        env.payload = spans.payload;
+        env.payload_ref = spans.payload_ref;
+    }
+    idx = nd::skip_ws(s, idx);
+    if (idx != s.size()) throw nd::parse_error("Extra characters after JSON value");
+    return env;
+}
+
+} // namespace omniflow
+
+#endif // OMNIFLOW_PLUGIN_ENVELOPE_HPP
@@ -0,0 +1,128 @@
+/*
+ * line_framer.hpp
+ *
+ * NDJSON input framer for the OmniFlow C++ plugin (plugins/cpp)
+ * License: Apache-2.0
+ *
+ * Purpose:
+ *   - Reads the request stream with read(2) in large chunks into one buffer and
+ *     splits it on '\n' with memchr, handing out frames as std::string_view
+ *     slices of that buffer (no per-line copy, no iostream locking).
+ *   - Enforces the maximum line size while reading: a line that grows past
+ *     `max_line` is reported as Oversized as soon as that is known, and the rest
+ *     of it is skipped chunk by chunk without ever being buffered in full.
+ *
+ * Contract:
+ *   - A Frame view is valid until the next call to next(); the trailing '\n'
+ *     is not part of it. A final line without '\n' is returned at EOF.
+ *   - Oversized is returned once per offending line; the framer resumes with
+ *     the line after it.
+ *   - On a non-blocking fd (server mode), Again is returned when no complete
+ *     line is buffered and nothing is readable; call next() again once the fd
+ *     is readable.
+ *   - Not thread-safe; owned by the reader thread.
+ */
+
+#ifndef OMNIFLOW_PLUGIN_LINE_FRAMER_HPP
+#define OMNIFLOW_PLUGIN_LINE_FRAMER_HPP
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+
+#include <unistd.h>
+
+namespace omniflow {
+
+class LineFramer {
+public:
+    enum class Status { Frame, Oversized, Eof, Again };
+
+    static constexpr size_t DEFAULT_CHUNK = 64 * 1024;
+
+    // The buffer holds one maximal line plus one read chunk, so a partial line
+    // can always be completed without growing it.
+    LineFramer(int fd, size_t max_line, size_t chunk = DEFAULT_CHUNK)
+        : fd_(fd), max_line_(max_line), chunk_(chunk ? chunk : DEFAULT_CHUNK),
+          cap_(max_line + 1 + chunk_), buf_(new char[cap_]) {}
+
+    LineFramer(const LineFramer &) = delete;
+    LineFramer &operator=(const LineFramer &) = delete;
+
+    Status next(std::string_view &frame) {
+        for (;;) {
+            const char *base = buf_.get();
+            if (const char *nl = static_cast<const char *>(
+                    std::memchr(base + scan_, '\n', end_ - scan_))) {
+                size_t len = static_cast<size_t>(nl - (base + start_));
+                size_t line_start = start_;
+                start_ = scan_ = len + line_start + 1;
+                if (discarding_) { discarding_ = false; continue; } // tail of a reported line
+                if (len > max_line_) return Status::Oversized;
+                frame = std::string_view(base + line_start, len);
+                return Status::Frame;
+            }
+            scan_ = end_;
+
+            // No complete line buffered. Too long already? Report and drop it.
+            if (!discarding_ && end_ - start_ > max_line_) {
+                discarding_ = true;
+                start_ = scan_ = end_ = 0;
+                return Status::Oversized;
+            }
+            if (discarding_) start_ = scan_ = end_ = 0; // nothing worth keeping
+
+            if (eof_) {
+                if (end_ == start_) return Status::Eof;
+                frame = std::string_view(base + start_, end_ - start_);
+                start_ = scan_ = end_;
+                return Status::Frame;
+            }
+            if (!fill()) return Status::Again;
+        }
+    }
+
+    // True when a complete line is already buffered (next() will not block).
+    bool has_frame() const noexcept {
+        return std::memchr(buf_.get() + scan_, '\n', end_ - scan_) != nullptr;
+    }
+
+    size_t max_line() const noexcept { return max_line_; }
+
+private:
+    // Make room for one chunk (moving the partial line to the front) and read.
+    // False when a non-blocking fd has nothing to read yet.
+    bool fill() {
+        if (cap_ - end_ < chunk_ && start_ > 0) {
+            std::memmove(buf_.get(), buf_.get() + start_, end_ - start_);
+            end_ -= start_;
+            scan_ -= start_;
+            start_ = 0;
+        }
+        for (;;) {
+            ssize_t n = ::read(fd_, buf_.get() + end_, cap_ - end_);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return false;
+            if (n <= 0) { eof_ = true; return true; } // EOF or unrecoverable read error
+            end_ += static_cast<size_t>(n);
+            return true;
+        }
+    }
+
+    const int fd_;
+    const size_t max_line_;
+    const size_t chunk_;
+    const size_t cap_;
+    std::unique_ptr<char[]> buf_;
+    size_t start_ = 0; // first byte of the current (partial) line
+    size_t scan_ = 0;  // bytes before this offset contain no '\n'
+    size_t end_ = 0;   // end of buffered data
+    bool discarding_ = false;
+    bool eof_ = false;
+};
+
+} // namespace omniflow
+
+#endif // OMNIFLOW_PLUGIN_LINE_FRAMER_HPP
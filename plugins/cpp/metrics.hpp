@@ -0,0 +1,204 @@
+/*
+ * metrics.hpp
+ *
+ * In-process metrics registry for the OmniFlow C++ plugin (plugins/cpp)
+ * License: Apache-2.0
+ *
+ * Purpose:
+ *   - Aggregates for the `metrics` request type and the heartbeat log:
+ *     counters (requests per type, exec actions, response codes) and latency
+ *     histograms per request type with p50/p99/p999.
+ *   - Histograms are HDR-style: log-linear buckets with 32 sub-buckets per
+ *     power of two, so any recorded value is reported within ~3% and the
+ *     range is covered up to 2^44 ns (about 4.9 hours) in fixed memory.
+ *   - Recording is lock-free: every thread writes its own shard with relaxed
+ *     stores (no read-modify-write, no shared cache lines). Shards are merged
+ *     when a snapshot is taken.
+ *
+ * Contract:
+ *   - Counter and histogram ids are indexes into the name lists given to
+ *     the constructor; out-of-range ids are ignored.
+ *   - A thread's shard is created on its first add()/record() (under a
+ *     mutex, once) and lives as long as the registry, so counts of threads
+ *     that have exited are kept.
+ *   - snapshot() may run concurrently with recording; it sees each counter
+ *     at some recent value (counts are never torn, but a snapshot is not
+ *     an atomic cut across counters).
+ */
+
+#ifndef OMNIFLOW_PLUGIN_METRICS_HPP
+#define OMNIFLOW_PLUGIN_METRICS_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace omniflow {
+
+namespace hdr {
+
+constexpr unsigned SUB_BITS = 5;
+constexpr uint64_t SUB_BUCKETS = uint64_t{1} << SUB_BITS;
+constexpr unsigned MAX_BITS = 44;                                    // values >= 2^44 are clamped
+constexpr size_t BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS; // 1280
+
+constexpr size_t index_of(uint64_t v) noexcept {
+    if (v >= (uint64_t{1} << MAX_BITS)) return BUCKETS - 1;
+    if (v < SUB_BUCKETS) return static_cast<size_t>(v);
+    unsigned msb = 63u - static_cast<unsigned>(__builtin_clzll(v));
+    unsigned shift = msb - SUB_BITS;
+    return static_cast<size_t>((shift + 1) * SUB_BUCKETS + ((v >> shift) - SUB_BUCKETS));
+}
+
+// Largest value that maps to bucket `i`
+constexpr uint64_t highest_of(size_t i) noexcept {
+    uint64_t b = i / SUB_BUCKETS, sub = i % SUB_BUCKETS;
+    if (b == 0) return sub;
+    return ((SUB_BUCKETS + sub + 1) << (b - 1)) - 1;
+}
+
+static_assert(index_of(31) == 31 && index_of(32) == 32 && index_of(63) == 63 && index_of(64) == 64, "hdr index");
+static_assert(highest_of(index_of(1000)) >= 1000 && highest_of(index_of(1000) - 1) < 1000, "hdr bounds");
+
+} // namespace hdr
+
+// Merged, immutable view of a latency histogram
+class HistogramSnapshot {
+public:
+    uint64_t count() const noexcept { return count_; }
+    uint64_t max() const noexcept { return max_; }
+    uint64_t mean() const noexcept { return count_ ? sum_ / count_ : 0; }
+
+    // Value at quantile q in [0, 1]: the highest value equivalent to the
+    // recorded one at that rank (0 when empty).
+    uint64_t percentile(double q) const noexcept {
+        if (count_ == 0) return 0;
+        q = std::min(std::max(q, 0.0), 1.0);
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * static_cast<double>(count_) + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < hdr::BUCKETS; ++i) {
+            seen += counts_[i];
+            if (seen >= rank) return std::min(hdr::highest_of(i), max_);
+        }
+        return max_;
+    }
+
+private:
+    friend class MetricsRegistry;
+    std::vector<uint64_t> counts_ = std::vector<uint64_t>(hdr::BUCKETS);
+    uint64_t count_ = 0, sum_ = 0, max_ = 0;
+};
+
+class MetricsRegistry {
+public:
+    struct Snapshot {
+        std::vector<uint64_t> counters;
+        std::vector<HistogramSnapshot> histograms;
+    };
+
+    MetricsRegistry(std::vector<std::string> counter_names, std::vector<std::string> histogram_names)
+        : counter_names_(std::move(counter_names)), histogram_names_(std::move(histogram_names)),
+          id_(next_id().fetch_add(1, std::memory_order_relaxed)) {}
+
+    MetricsRegistry(const MetricsRegistry &) = delete;
+    MetricsRegistry &operator=(const MetricsRegistry &) = delete;
+
+    const std::vector<std::string> &counter_names() const noexcept { return counter_names_; }
+    const std::vector<std::string> &histogram_names() const noexcept { return histogram_names_; }
+
+    void add(size_t counter, uint64_t n = 1) {
+        if (counter >= counter_names_.size()) return;
+        bump(shard().counters[counter], n);
+    }
+
+    void record(size_t histogram, uint64_t value) {
+        if (histogram >= histogram_names_.size()) return;
+        Histogram &h = shard().histograms[histogram];
+        bump(h.counts[hdr::index_of(value)], 1);
+        bump(h.count, 1);
+        bump(h.sum, value);
+        if (value > h.max.load(std::memory_order_relaxed)) h.max.store(value, std::memory_order_relaxed);
+    }
+
+    Snapshot snapshot() const {
+        Snapshot s;
+        s.counters.assign(counter_names_.size(), 0);
+        s.histograms.resize(histogram_names_.size());
+        std::lock_guard<std::mutex> lock(mu_);
+        for (const auto &sh : shards_) {
+            for (size_t c = 0; c < s.counters.size(); ++c) s.counters[c] += sh->counters[c].load(std::memory_order_relaxed);
+            for (size_t i = 0; i < s.histograms.size(); ++i) {
+                const Histogram &h = sh->histograms[i];
+                HistogramSnapshot &out = s.histograms[i];
+                if (h.count.load(std::memory_order_relaxed) == 0) continue;
+                uint64_t n = 0;
+                for (size_t b = 0; b < hdr::BUCKETS; ++b) {
+                    uint64_t v = h.counts[b].load(std::memory_order_relaxed);
+                    out.counts_[b] += v;
+                    n += v;
+                }
+                out.count_ += n; // from the buckets, so percentiles stay consistent
+                out.sum_ += h.sum.load(std::memory_order_relaxed);
+                out.max_ = std::max(out.max_, h.max.load(std::memory_order_relaxed));
+            }
+        }
+        return s;
+    }
+
+private:
+    struct Histogram {
+        std::array<std::atomic<uint64_t>, hdr::BUCKETS> counts{};
+        std::atomic<uint64_t> count{0}, sum{0}, max{0};
+    };
+
+    struct Shard {
+        Shard(size_t counters_, size_t histograms_) : counters(counters_), histograms(histograms_) {}
+        std::vector<std::atomic<uint64_t>> counters;
+        std::vector<Histogram> histograms;
+    };
+
+    // Only the owning thread writes a shard: a relaxed load + store is enough
+    // and avoids a locked instruction per update.
+    static void bump(std::atomic<uint64_t> &c, uint64_t n) noexcept {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static std::atomic<uint64_t> &next_id() {
+        static std::atomic<uint64_t> id{1};
+        return id;
+    }
+
+    // This thread's shard; registries are told apart by id, so a destroyed
+    // registry's cache entry is never reused by a new one at the same address.
+    Shard &shard() {
+        thread_local std::vector<std::pair<uint64_t, Shard *>> cache;
+        for (const auto &e : cache) {
+            if (e.first == id_) return *e.second;
+        }
+        auto owned = std::make_unique<Shard>(counter_names_.size(), histogram_names_.size());
+        Shard *s = owned.get();
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            shards_.push_back(std::move(owned));
+        }
+        cache.emplace_back(id_, s);
+        return *s;
+    }
+
+    const std::vector<std::string> counter_names_;
+    const std::vector<std::string> histogram_names_;
+    const uint64_t id_;
+    mutable std::mutex mu_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+} // namespace omniflow
+
+#endif // OMNIFLOW_PLUGIN_METRICS_HPP
@@ -0,0 +1,149 @@
+/*
+ * prefixed_framer.hpp
+ *
+ * Length-prefixed input framer for the OmniFlow C++ plugin (plugins/cpp)
+ * License: Apache-2.0
+ *
+ * Purpose:
+ *   - Input side of the binary ("cbor") transport: each frame is a 4-byte
+ *     big-endian payload length followed by that many bytes (one CBOR item).
+ *   - Same buffering scheme and interface as LineFramer (line_framer.hpp): the
+ *     stream is read with read(2) in large chunks into one buffer and frames are
+ *     handed out as std::string_view slices of it.
+ *   - A frame whose declared length exceeds `max_frame` is reported as
+ *     Oversized from its header alone; its body is skipped chunk by chunk
+ *     without being buffered.
+ *
+ * Contract:
+ *   - A Frame view is valid until the next call to next(); it excludes the
+ *     length prefix. EOF in the middle of a frame ends the stream (the partial
+ *     frame is dropped).
+ *   - Oversized is returned once per offending frame; the framer resumes with
+ *     the frame after it.
+ *   - On a non-blocking fd, Again is returned when no complete frame is
+ *     buffered and nothing is readable (as LineFramer).
+ *   - Not thread-safe; owned by the reader thread.
+ */
+
+#ifndef OMNIFLOW_PLUGIN_PREFIXED_FRAMER_HPP
+#define OMNIFLOW_PLUGIN_PREFIXED_FRAMER_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+
+#include <unistd.h>
+
+namespace omniflow {
+
+class PrefixedFramer {
+public:
+    enum class Status { Frame, Oversized, Eof, Again };
+
+    static constexpr size_t DEFAULT_CHUNK = 64 * 1024;
+    static constexpr size_t PREFIX_BYTES = 4;
+
+    // The buffer holds one maximal frame plus one read chunk, so a partial frame
+    // can always be completed without growing it.
+    PrefixedFramer(int fd, size_t max_frame, size_t chunk = DEFAULT_CHUNK)
+        : fd_(fd), max_frame_(max_frame), chunk_(chunk ? chunk : DEFAULT_CHUNK),
+          cap_(PREFIX_BYTES + max_frame + chunk_), buf_(new char[cap_]) {}
+
+    PrefixedFramer(const PrefixedFramer &) = delete;
+    PrefixedFramer &operator=(const PrefixedFramer &) = delete;
+
+    Status next(std::string_view &frame) {
+        for (;;) {
+            if (skip_ > 0) {
+                // body of a reported frame: drop what is buffered, read the rest
+                size_t n = std::min<uint64_t>(skip_, end_ - start_);
+                start_ += n;
+                skip_ -= n;
+                if (skip_ > 0) {
+                    start_ = end_ = 0;
+                    if (eof_) return Status::Eof;
+                    if (!fill()) return Status::Again;
+                    continue;
+                }
+            }
+            size_t avail = end_ - start_;
+            if (avail >= PREFIX_BYTES) {
+                uint64_t len = frame_length(buf_.get() + start_);
+                if (len > max_frame_) {
+                    start_ += PREFIX_BYTES;
+                    skip_ = len;
+                    return Status::Oversized;
+                }
+                if (avail - PREFIX_BYTES >= len) {
+                    frame = std::string_view(buf_.get() + start_ + PREFIX_BYTES, static_cast<size_t>(len));
+                    start_ += PREFIX_BYTES + static_cast<size_t>(len);
+                    return Status::Frame;
+                }
+            }
+            if (eof_) return Status::Eof;
+            if (!fill()) return Status::Again;
+        }
+    }
+
+    // True when a complete frame is already buffered (next() will not block).
+    bool has_frame() const noexcept {
+        if (skip_ > 0) return false;
+        size_t avail = end_ - start_;
+        if (avail < PREFIX_BYTES) return false;
+        uint64_t len = frame_length(buf_.get() + start_);
+        return len > max_frame_ || avail - PREFIX_BYTES >= len;
+    }
+
+    size_t max_frame() const noexcept { return max_frame_; }
+
+    // Store the 4-byte big-endian prefix for a frame of `len` bytes at `p`
+    // (output side: reserve PREFIX_BYTES, encode the body, then patch them in).
+    static void store_prefix(char *p, uint32_t len) noexcept {
+        p[0] = static_cast<char>(len >> 24);
+        p[1] = static_cast<char>(len >> 16);
+        p[2] = static_cast<char>(len >> 8);
+        p[3] = static_cast<char>(len);
+    }
+
+private:
+    static uint64_t frame_length(const char *p) noexcept {
+        const unsigned char *u = reinterpret_cast<const unsigned char *>(p);
+        return (uint64_t{u[0]} << 24) | (uint64_t{u[1]} << 16) | (uint64_t{u[2]} << 8) | u[3];
+    }
+
+    // Make room for one chunk (moving the partial frame to the front) and read.
+    // False when a non-blocking fd has nothing to read yet.
+    bool fill() {
+        if (cap_ - end_ < chunk_ && start_ > 0) {
+            std::memmove(buf_.get(), buf_.get() + start_, end_ - start_);
+            end_ -= start_;
+            start_ = 0;
+        }
+        for (;;) {
+            ssize_t n = ::read(fd_, buf_.get() + end_, cap_ - end_);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return false;
+            if (n <= 0) { eof_ = true; return true; } // EOF or unrecoverable read error
+            end_ += static_cast<size_t>(n);
+            return true;
+        }
+    }
+
+    const int fd_;
+    const size_t max_frame_;
+    const size_t chunk_;
+    const size_t cap_;
+    std::unique_ptr<char[]> buf_;
+    size_t start_ = 0; // first byte of the current (partial) frame
+    size_t end_ = 0;   // end of buffered data
+    uint64_t skip_ = 0; // body bytes of an oversized frame still to drop
+    bool eof_ = false;
+};
+
+} // namespace omniflow
+
+#endif // OMNIFLOW_PLUGIN_PREFIXED_FRAMER_HPP
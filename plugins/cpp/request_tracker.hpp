@@ -0,0 +1,263 @@
+/*
+ * request_tracker.hpp
+ *
+ * In-flight request tracking, deadlines and cancellation for the OmniFlow C++
+ * plugin (plugins/cpp)
+ * License: Apache-2.0
+ *
+ * Purpose:
+ *   - Every exec/batch request in flight gets a Request record: its id, a
+ *     deadline (OMNIFLOW_EXEC_TIMEOUT) and a state that doubles as the
+ *     cancellation token handlers poll (see "Cancellation and timeouts" in
+ *     plugins/common/protocol.md).
+ *   - Deadlines live in a hashed timer wheel: insert and remove are O(1) and
+ *     advancing costs one slot per tick, however many requests are in flight.
+ *     The background thread drives it with run_until().
+ *   - find() resolves a request id for the `cancel` message type.
+ *   - A request may carry an opaque owner (the client connection in server
+ *     mode). Ids are scoped to their owner: clients reusing the same id never
+ *     shadow or cancel each other's requests, and whoever answers a timeout
+ *     knows where to send it.
+ *
+ * Contract:
+ *   - Exactly one party answers a request: whoever wins Request::claim()
+ *     (the handler with Done, the wheel with TimedOut, a `cancel` with
+ *     Cancelled). Losers drop their response.
+ *   - Handlers stop cooperatively: stopped() turns true as soon as another
+ *     party has claimed the request; nothing is interrupted.
+ *   - A handler streaming partial responses writes each one through
+ *     write_partial(); whoever claims the request with TimedOut or Cancelled
+ *     calls fence() before answering, so no partial response follows the
+ *     terminal one.
+ *   - finish() must be called once per start(), after the request has been
+ *     answered (or its answer dropped).
+ *   - All members are thread-safe.
+ */
+
+#ifndef OMNIFLOW_PLUGIN_REQUEST_TRACKER_HPP
+#define OMNIFLOW_PLUGIN_REQUEST_TRACKER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace omniflow {
+
+class RequestTracker {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum State : int { Running, Done, TimedOut, Cancelled };
+
+    class Request {
+    public:
+        explicit Request(std::string id_, std::shared_ptr<void> owner_ = nullptr,
+                         std::chrono::milliseconds timeout_ = std::chrono::milliseconds(0))
+            : id(std::move(id_)), owner(std::move(owner_)), timeout(timeout_) {}
+
+        // Move from Running to `s`; true for the one caller that gets to answer.
+        bool claim(State s) noexcept {
+            int expected = Running;
+            return state_.compare_exchange_strong(expected, s, std::memory_order_acq_rel);
+        }
+
+        // The cancellation token: true once timed out, cancelled or answered.
+        bool stopped() const noexcept { return state_.load(std::memory_order_acquire) != Running; }
+
+        State state() const noexcept { return static_cast<State>(state_.load(std::memory_order_acquire)); }
+
+        // Run `write` (emitting a partial response) unless the request has
+        // been claimed; false if it was not run.
+        template <typename F>
+        bool write_partial(F &&write) const {
+            std::lock_guard<std::mutex> lock(partial_mu_);
+            if (stopped()) return false;
+            write();
+            return true;
+        }
+
+        // After a claim: wait out a write_partial() in progress.
+        void fence() const { std::lock_guard<std::mutex> lock(partial_mu_); }
+
+        const std::string id;
+        const std::shared_ptr<void> owner;
+        const std::chrono::milliseconds timeout; // as passed to start(); 0 = none
+
+    private:
+        friend class RequestTracker;
+        std::atomic<int> state_{Running};
+        mutable std::mutex partial_mu_;
+        // wheel position, guarded by the tracker's mutex
+        uint64_t expiry_tick_ = 0;
+        size_t slot_ = NOT_SCHEDULED;
+        size_t pos_ = 0;
+    };
+
+    using Ptr = std::shared_ptr<Request>;
+
+    static constexpr std::chrono::milliseconds DEFAULT_TICK{10};
+    static constexpr size_t DEFAULT_SLOTS = 1024; // 10.24 s per revolution at the default tick
+
+    explicit RequestTracker(std::chrono::milliseconds tick = DEFAULT_TICK, size_t slots = DEFAULT_SLOTS)
+        : tick_(tick.count() > 0 ? tick : DEFAULT_TICK), wheel_(slots ? slots : DEFAULT_SLOTS),
+          epoch_(Clock::now()) {}
+
+    RequestTracker(const RequestTracker &) = delete;
+    RequestTracker &operator=(const RequestTracker &) = delete;
+
+    // Register a request; a zero timeout means no deadline. A newer request
+    // with the same id (and owner) shadows the older one for find().
+    Ptr start(std::string id, std::chrono::milliseconds timeout, std::shared_ptr<void> owner = nullptr) {
+        Ptr r = std::make_shared<Request>(std::move(id), std::move(owner), timeout);
+        bool wake = false;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            by_id_[Key{r->owner.get(), r->id}] = r;
+            if (timeout.count() > 0) {
+                // round up: a request never expires before its timeout
+                uint64_t ticks = static_cast<uint64_t>((timeout + tick_ - std::chrono::milliseconds(1)) / tick_);
+                r->expiry_tick_ = tick_of(Clock::now()) + std::max<uint64_t>(ticks, 1);
+                insert(r);
+                wake = scheduled_ == 1; // the wheel was idle: the waiter sleeps until its `until`
+            }
+        }
+        if (wake) cv_.notify_all();
+        return r;
+    }
+
+    void finish(const Ptr &r) {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (r->slot_ != NOT_SCHEDULED) remove(*r);
+        auto it = by_id_.find(Key{r->owner.get(), r->id});
+        if (it != by_id_.end() && it->second == r) by_id_.erase(it);
+    }
+
+    Ptr find(std::string_view id, const void *owner = nullptr) const {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto it = by_id_.find(Key{owner, std::string(id)});
+        return it == by_id_.end() ? nullptr : it->second;
+    }
+
+    size_t inflight() const {
+        std::lock_guard<std::mutex> lock(mu_);
+        return by_id_.size();
+    }
+
+    // Fire expiries as they fall due until `until` or stop(). Each request
+    // whose deadline passes while it is still Running is claimed as TimedOut
+    // and handed to `on_expired` (outside the lock).
+    template <typename F>
+    void run_until(Clock::time_point until, F &&on_expired) {
+        std::vector<Ptr> expired;
+        std::unique_lock<std::mutex> lock(mu_);
+        while (!stopping_) {
+            Clock::time_point now = Clock::now();
+            advance(tick_of(now), expired);
+            if (!expired.empty()) {
+                lock.unlock();
+                for (const Ptr &r : expired) on_expired(r);
+                expired.clear();
+                lock.lock();
+                continue;
+            }
+            if (now >= until) return;
+            Clock::time_point wake = until;
+            if (scheduled_ > 0) wake = std::min(wake, time_of(cursor_ + 1));
+            cv_.wait_until(lock, wake);
+        }
+    }
+
+    // Make run_until() return now and from then on.
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+    }
+
+private:
+    static constexpr size_t NOT_SCHEDULED = static_cast<size_t>(-1);
+
+    struct Key {
+        const void *owner;
+        std::string id;
+        bool operator==(const Key &o) const noexcept { return owner == o.owner && id == o.id; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key &k) const noexcept {
+            return std::hash<std::string>()(k.id) ^ (std::hash<const void *>()(k.owner) * 31);
+        }
+    };
+
+    uint64_t tick_of(Clock::time_point t) const noexcept {
+        return static_cast<uint64_t>((t - epoch_) / tick_);
+    }
+
+    Clock::time_point time_of(uint64_t tick) const noexcept {
+        return epoch_ + std::chrono::duration_cast<Clock::duration>(tick_ * static_cast<int64_t>(tick));
+    }
+
+    void insert(const Ptr &r) {
+        uint64_t tick = std::max(r->expiry_tick_, cursor_ + 1); // never into a slot already passed
+        r->expiry_tick_ = tick;
+        std::vector<Ptr> &slot = wheel_[tick % wheel_.size()];
+        r->slot_ = tick % wheel_.size();
+        r->pos_ = slot.size();
+        slot.push_back(r);
+        ++scheduled_;
+    }
+
+    // O(1): swap with the slot's last entry
+    void remove(Request &r) {
+        std::vector<Ptr> &slot = wheel_[r.slot_];
+        if (r.pos_ + 1 != slot.size()) {
+            slot[r.pos_] = std::move(slot.back());
+            slot[r.pos_]->pos_ = r.pos_;
+        }
+        slot.pop_back();
+        r.slot_ = NOT_SCHEDULED;
+        --scheduled_;
+    }
+
+    // Visit the slots of every tick up to `target`; entries of later
+    // revolutions stay where they are.
+    void advance(uint64_t target, std::vector<Ptr> &expired) {
+        if (scheduled_ == 0) { cursor_ = std::max(cursor_, target); return; }
+        while (cursor_ < target && scheduled_ > 0) {
+            ++cursor_;
+            std::vector<Ptr> &slot = wheel_[cursor_ % wheel_.size()];
+            for (size_t i = 0; i < slot.size();) {
+                if (slot[i]->expiry_tick_ > cursor_) { ++i; continue; }
+                Ptr r = slot[i];
+                remove(*r); // moves another entry into position i
+                if (r->claim(TimedOut)) expired.push_back(std::move(r));
+            }
+        }
+        cursor_ = std::max(cursor_, target);
+    }
+
+    const std::chrono::milliseconds tick_;
+    std::vector<std::vector<Ptr>> wheel_;
+    const Clock::time_point epoch_;
+    uint64_t cursor_ = 0;   // last tick whose slot has been visited
+    size_t scheduled_ = 0;  // entries in the wheel
+    bool stopping_ = false;
+    std::unordered_map<Key, Ptr, KeyHash> by_id_;
+    mutable std::mutex mu_;
+    std::condition_variable cv_;
+};
+
+} // namespace omniflow
+
+#endif // OMNIFLOW_PLUGIN_REQUEST_TRACKER_HPP
@@ -0,0 +1,160 @@
+/*
+ * response_template.hpp
+ *
+ * Precompiled response templates for the OmniFlow C++ plugin (plugins/cpp)
+ * License: Apache-2.0
+ *
+ * Purpose:
+ *   - Some responses are the same text every time except for a few values:
+ *     the `health` answer, `shutdown` acks, `busy` rejections. Building them
+ *     as a json tree and dump()ing it costs far more than the bytes involved,
+ *     on exactly the paths that must stay cheap under load (orchestrators
+ *     probe `health` constantly, and `busy` is what a saturated plugin sends).
+ *   - A ResponseTemplate is parsed once at startup from a printf-like pattern.
+ *     render() then concatenates its literal pieces and the values spliced into
+ *     its holes into a caller-supplied buffer (usually on the stack): no json
+ *     tree, no heap allocation.
+ *
+ * Contract:
+ *   - In a pattern, `%s` is a string hole (written as a quoted, escaped JSON
+ *     string), `%d` an integer hole and `%%` a literal '%'. Any other '%'
+ *     sequence makes the constructor throw std::invalid_argument.
+ *   - render() takes one value per hole, in order. It returns the number of
+ *     bytes written, or 0 if they do not fit in `cap` or the values do not
+ *     match the holes; callers then fall back to building the response.
+ *   - String values must be valid UTF-8 (ids taken from a parsed request
+ *     are); only '"', '\\' and control characters are escaped.
+ *   - Templates are immutable after construction; render() may be called
+ *     from any thread.
+ */
+
+#ifndef OMNIFLOW_PLUGIN_RESPONSE_TEMPLATE_HPP
+#define OMNIFLOW_PLUGIN_RESPONSE_TEMPLATE_HPP
+
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace omniflow {
+
+class ResponseTemplate {
+public:
+    // One value for a hole: a string for `%s`, an integer for `%d`
+    struct Value {
+        Value(std::string_view s) noexcept : is_string(true), str(s) {}
+        Value(const std::string &s) noexcept : is_string(true), str(s) {}
+        Value(const char *s) noexcept : is_string(true), str(s) {}
+        template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+        Value(T n) noexcept : integer(static_cast<long long>(n)) {}
+
+        bool is_string = false;
+        std::string_view str;
+        long long integer = 0;
+    };
+
+    explicit ResponseTemplate(std::string_view pattern) {
+        std::string literal;
+        for (size_t i = 0; i < pattern.size(); ++i) {
+            char c = pattern[i];
+            if (c != '%') {
+                literal.push_back(c);
+                continue;
+            }
+            char next = i + 1 < pattern.size() ? pattern[i + 1] : '\0';
+            ++i;
+            if (next == '%') {
+                literal.push_back('%');
+            } else if (next == 's' || next == 'd') {
+                pieces_.push_back({std::move(literal), next == 's' ? Hole::String : Hole::Integer});
+                literal.clear();
+            } else {
+                throw std::invalid_argument("response template: bad hole in \"" + std::string(pattern) + "\"");
+            }
+        }
+        pieces_.push_back({std::move(literal), Hole::None});
+    }
+
+    size_t holes() const noexcept { return pieces_.size() - 1; }
+
+    // Write the response into out[0, cap); see the contract above.
+    size_t render(char *out, size_t cap, std::initializer_list<Value> values) const noexcept {
+        if (values.size() != holes()) return 0;
+        char *p = out, *end = out + cap;
+        const Value *v = values.begin();
+        for (const Piece &piece : pieces_) {
+            if (static_cast<size_t>(end - p) < piece.literal.size()) return 0;
+            std::memcpy(p, piece.literal.data(), piece.literal.size());
+            p += piece.literal.size();
+            if (piece.hole == Hole::None) break;
+            if (v->is_string != (piece.hole == Hole::String)) return 0;
+            p = v->is_string ? put_string(p, end, v->str) : put_integer(p, end, v->integer);
+            if (!p) return 0;
+            ++v;
+        }
+        return static_cast<size_t>(p - out);
+    }
+
+private:
+    enum class Hole { None, String, Integer };
+
+    struct Piece {
+        std::string literal; // written before the hole
+        Hole hole;
+    };
+
+    static char *put_integer(char *p, char *end, long long n) noexcept {
+        auto res = std::to_chars(p, end, n);
+        return res.ec == std::errc() ? res.ptr : nullptr;
+    }
+
+    static char *put_string(char *p, char *end, std::string_view s) noexcept {
+        static constexpr char HEX[] = "0123456789abcdef";
+        if (p == end) return nullptr;
+        *p++ = '"';
+        for (char ch : s) {
+            auto c = static_cast<unsigned char>(ch);
+            if (c >= 0x20 && c != '"' && c != '\\') {
+                if (p == end) return nullptr;
+                *p++ = ch;
+                continue;
+            }
+            const char *esc = nullptr;
+            switch (c) {
+            case '"': esc = "\\\""; break;
+            case '\\': esc = "\\\\"; break;
+            case '\b': esc = "\\b"; break;
+            case '\f': esc = "\\f"; break;
+            case '\n': esc = "\\n"; break;
+            case '\r': esc = "\\r"; break;
+            case '\t': esc = "\\t"; break;
+            default: break;
+            }
+            if (esc) {
+                if (end - p < 2) return nullptr;
+                *p++ = esc[0];
+                *p++ = esc[1];
+            } else {
+                if (end - p < 6) return nullptr;
+                std::memcpy(p, "\\u00", 4);
+                p[4] = HEX[c >> 4];
+                p[5] = HEX[c & 0xf];
+                p += 6;
+            }
+        }
+        if (p == end) return nullptr;
+        *p++ = '"';
+        return p;
+    }
+
+    std::vector<Piece> pieces_;
+};
+
+} // namespace omniflow
+
+#endif // OMNIFLOW_PLUGIN_RESPONSE_TEMPLATE_HPP
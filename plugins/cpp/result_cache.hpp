@@ -0,0 +1,372 @@
+/*
+ * result_cache.hpp
+ *
+ * Result memoization for deterministic exec actions in the OmniFlow C++
+ * plugin (plugins/cpp)
+ * License: Apache-2.0
+ *
+ * Purpose:
+ *   - Hosts resend identical requests (retries, fan-in duplicates). For actions
+ *     whose result depends only on their payload, the serialized response
+ *     fragment of the first answer is kept and replayed: a hit costs one hash
+ *     of the payload text and one copy, no handler run and no dump().
+ *   - canonical_hash() hashes a JSON payload in one pass over its text without
+ *     building a tree. It ignores insignificant whitespace and object member
+ *     order, so `{"a":1, "b":2}` and `{"b":2,"a":1}` share an entry. Strings
+ *     and numbers are hashed as written (`"\u0041"` and `"A"`, or `1.0`
+ *     and `1`, are different keys).
+ *   - Texts whose meaning the hash cannot capture get no key: an object with a
+ *     duplicate member name (which member wins is up to the reader), and any
+ *     member named `*_ref`, which points at shared memory whose contents are
+ *     not part of the text. Member names written with escapes get no key
+ *     either, so neither check can be sidestepped by spelling a name
+ *     differently.
+ *   - ResultCache is a sharded CLOCK cache bounded by a byte budget, with a
+ *     TTL per entry. Values are immutable shared strings, so a hit holds no
+ *     lock while the response is written.
+ *
+ * Contract:
+ *   - Keys are 64-bit hashes; a collision would replay another payload's
+ *     result (about 1 in 10^10 at a million cached entries).
+ *   - lookup() returns nullptr on a miss or an expired entry. insert()
+ *     replaces an entry with the same key. A value larger than a shard's
+ *     share of the budget is not cached.
+ *   - Entry cost is the value's size plus ENTRY_OVERHEAD bytes.
+ *   - All members are thread-safe.
+ */
+
+#ifndef OMNIFLOW_PLUGIN_RESULT_CACHE_HPP
+#define OMNIFLOW_PLUGIN_RESULT_CACHE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace omniflow {
+
+namespace detail {
+
+inline uint64_t mix64(uint64_t h) noexcept {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// 8 bytes at a time; the length is folded in so prefixes differ
+inline uint64_t hash_bytes(const char *p, size_t n, uint64_t seed) noexcept {
+    uint64_t h = seed ^ (n * 0x9e3779b97f4a7c15ULL);
+    for (; n >= 8; p += 8, n -= 8) {
+        uint64_t w;
+        std::memcpy(&w, p, 8);
+        h = mix64(h ^ w) * 0x9e3779b97f4a7c15ULL;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, p, n);
+    return mix64(h ^ tail);
+}
+
+class CanonicalHasher {
+public:
+    static constexpr int MAX_DEPTH = 256;
+
+    explicit CanonicalHasher(std::string_view text) noexcept : p_(text.data()), end_(text.data() + text.size()) {}
+
+    std::optional<uint64_t> run() noexcept {
+        uint64_t h;
+        if (!value(h, 0)) return std::nullopt;
+        skip_ws();
+        if (p_ != end_) return std::nullopt;
+        return h;
+    }
+
+private:
+    void skip_ws() noexcept {
+        while (p_ != end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) ++p_;
+    }
+
+    bool value(uint64_t &h, int depth) noexcept {
+        skip_ws();
+        if (p_ == end_ || depth > MAX_DEPTH) return false;
+        switch (*p_) {
+        case '{': return object(h, depth);
+        case '[': return array(h, depth);
+        case '"': return string(h);
+        default: return scalar(h);
+        }
+    }
+
+    // Members are combined with a commutative sum: order does not matter.
+    // Duplicate names are rejected, since a sum cannot tell {"a":1,"a":2}
+    // from {"a":2,"a":1} while readers that keep the first member can.
+    bool object(uint64_t &h, int depth) noexcept {
+        ++p_;
+        uint64_t sum = 0, count = 0;
+        std::vector<uint64_t> names;
+        skip_ws();
+        if (p_ != end_ && *p_ == '}') {
+            ++p_;
+        } else {
+            for (;;) {
+                uint64_t k, v;
+                skip_ws();
+                if (p_ == end_ || *p_ != '"') return false;
+                const char *name = p_ + 1;
+                if (!string(k)) return false;
+                std::string_view key(name, static_cast<size_t>(p_ - 1 - name));
+                if (!keyable_name(key)) return false;
+                try {
+                    names.push_back(k);
+                } catch (...) {
+                    return false;
+                }
+                skip_ws();
+                if (p_ == end_ || *p_ != ':') return false;
+                ++p_;
+                if (!value(v, depth + 1)) return false;
+                sum += mix64(k ^ (v * 0x9e3779b97f4a7c15ULL));
+                ++count;
+                skip_ws();
+                if (p_ == end_) return false;
+                if (*p_ == ',') { ++p_; continue; }
+                if (*p_ != '}') return false;
+                ++p_;
+                break;
+            }
+        }
+        std::sort(names.begin(), names.end());
+        if (std::adjacent_find(names.begin(), names.end()) != names.end()) return false;
+        h = mix64(sum ^ mix64(count ^ 0x6f626a));
+        return true;
+    }
+
+    // A `*_ref` member names out-of-band data; an escaped name could be one
+    static bool keyable_name(std::string_view key) noexcept {
+        static constexpr std::string_view REF_SUFFIX = "_ref";
+        if (key.find('\\') != std::string_view::npos) return false;
+        return key.size() < REF_SUFFIX.size() || key.substr(key.size() - REF_SUFFIX.size()) != REF_SUFFIX;
+    }
+
+    bool array(uint64_t &h, int depth) noexcept {
+        ++p_;
+        uint64_t acc = 0x617272;
+        skip_ws();
+        if (p_ != end_ && *p_ == ']') {
+            ++p_;
+        } else {
+            for (;;) {
+                uint64_t v;
+                if (!value(v, depth + 1)) return false;
+                acc = mix64(acc * 0x100000001b3ULL ^ v);
+                skip_ws();
+                if (p_ == end_) return false;
+                if (*p_ == ',') { ++p_; continue; }
+                if (*p_ != ']') return false;
+                ++p_;
+                break;
+            }
+        }
+        h = acc;
+        return true;
+    }
+
+    bool string(uint64_t &h) noexcept {
+        const char *start = ++p_;
+        while (p_ != end_ && *p_ != '"') {
+            if (*p_ == '\\' && ++p_ == end_) return false;
+            ++p_;
+        }
+        if (p_ == end_) return false;
+        h = hash_bytes(start, static_cast<size_t>(p_ - start), 0x737472);
+        ++p_;
+        return true;
+    }
+
+    // numbers, true, false, null: the token as written
+    bool scalar(uint64_t &h) noexcept {
+        const char *start = p_;
+        while (p_ != end_ && *p_ != ',' && *p_ != '}' && *p_ != ']' && *p_ != ' ' && *p_ != '\t' &&
+               *p_ != '\n' && *p_ != '\r')
+            ++p_;
+        if (p_ == start) return false;
+        h = hash_bytes(start, static_cast<size_t>(p_ - start), 0x6e756d);
+        return true;
+    }
+
+    const char *p_;
+    const char *end_;
+};
+
+} // namespace detail
+
+// Hash of a JSON value's text, insensitive to whitespace and member order;
+// nullopt if the text is not well-formed or cannot be keyed (duplicate or
+// `*_ref` member names; such payloads are not cached).
+inline std::optional<uint64_t> canonical_hash(std::string_view json_text) noexcept {
+    return detail::CanonicalHasher(json_text).run();
+}
+
+class ResultCache {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Value = std::shared_ptr<const std::string>;
+
+    static constexpr size_t ENTRY_OVERHEAD = 64;
+    static constexpr size_t DEFAULT_SHARDS = 16;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t insertions = 0;
+        uint64_t evictions = 0; // pushed out by the byte budget
+        uint64_t expirations = 0; // found past their TTL
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    ResultCache(size_t max_bytes, std::chrono::milliseconds ttl, size_t shards = DEFAULT_SHARDS)
+        : max_bytes_(max_bytes), ttl_(ttl), shards_(shards ? shards : DEFAULT_SHARDS) {
+        for (Shard &s : shards_) s.budget = max_bytes_ / shards_.size();
+    }
+
+    ResultCache(const ResultCache &) = delete;
+    ResultCache &operator=(const ResultCache &) = delete;
+
+    Value lookup(uint64_t key) {
+        Shard &s = shard(key);
+        std::lock_guard<std::mutex> lock(s.mu);
+        auto it = s.index.find(key);
+        if (it == s.index.end()) {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        Entry &e = s.slots[it->second];
+        if (Clock::now() >= e.expires) {
+            expirations_.fetch_add(1, std::memory_order_relaxed);
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            erase(s, it->second);
+            return nullptr;
+        }
+        e.referenced = true;
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return e.value;
+    }
+
+    void insert(uint64_t key, std::string value) {
+        size_t cost = value.size() + ENTRY_OVERHEAD;
+        Shard &s = shard(key);
+        if (cost > s.budget) return;
+        Value v = std::make_shared<const std::string>(std::move(value));
+        std::lock_guard<std::mutex> lock(s.mu);
+        if (auto it = s.index.find(key); it != s.index.end()) erase(s, it->second);
+        while (s.bytes + cost > s.budget) evict_one(s);
+        size_t slot;
+        if (!s.free.empty()) {
+            slot = s.free.back();
+            s.free.pop_back();
+        } else {
+            slot = s.slots.size();
+            s.slots.emplace_back();
+        }
+        s.slots[slot] = Entry{key, std::move(v), Clock::now() + ttl_, false, cost};
+        s.index.emplace(key, slot);
+        s.bytes += cost;
+        insertions_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Stats stats() const {
+        Stats st;
+        st.hits = hits_.load(std::memory_order_relaxed);
+        st.misses = misses_.load(std::memory_order_relaxed);
+        st.insertions = insertions_.load(std::memory_order_relaxed);
+        st.evictions = evictions_.load(std::memory_order_relaxed);
+        st.expirations = expirations_.load(std::memory_order_relaxed);
+        for (const Shard &s : shards_) {
+            std::lock_guard<std::mutex> lock(s.mu);
+            st.entries += s.index.size();
+            st.bytes += s.bytes;
+        }
+        return st;
+    }
+
+    size_t max_bytes() const noexcept { return max_bytes_; }
+    std::chrono::milliseconds ttl() const noexcept { return ttl_; }
+
+private:
+    struct Entry {
+        uint64_t key = 0;
+        Value value; // nullptr = free slot
+        Clock::time_point expires{};
+        bool referenced = false;
+        size_t cost = 0;
+    };
+
+    struct Shard {
+        mutable std::mutex mu;
+        std::vector<Entry> slots;
+        std::vector<size_t> free;
+        std::unordered_map<uint64_t, size_t> index;
+        size_t hand = 0;
+        size_t bytes = 0;
+        size_t budget = 0;
+    };
+
+    Shard &shard(uint64_t key) noexcept { return shards_[detail::mix64(key) % shards_.size()]; }
+
+    static void erase(Shard &s, size_t slot) {
+        Entry &e = s.slots[slot];
+        s.index.erase(e.key);
+        s.bytes -= e.cost;
+        e = Entry{};
+        s.free.push_back(slot);
+    }
+
+    // CLOCK: sweep the hand, giving referenced entries a second chance.
+    // Expired entries go first, whatever their bit.
+    void evict_one(Shard &s) {
+        Clock::time_point now = Clock::now();
+        for (;;) {
+            if (s.hand >= s.slots.size()) s.hand = 0;
+            Entry &e = s.slots[s.hand];
+            size_t slot = s.hand++;
+            if (!e.value) continue;
+            if (now >= e.expires) {
+                expirations_.fetch_add(1, std::memory_order_relaxed);
+                erase(s, slot);
+                return;
+            }
+            if (e.referenced) {
+                e.referenced = false;
+                continue;
+            }
+            evictions_.fetch_add(1, std::memory_order_relaxed);
+            erase(s, slot);
+            return;
+        }
+    }
+
+    const size_t max_bytes_;
+    const std::chrono::milliseconds ttl_;
+    std::vector<Shard> shards_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> insertions_{0};
+    std::atomic<uint64_t> evictions_{0};
+    std::atomic<uint64_t> expirations_{0};
+};
+
+} // namespace omniflow
+
+#endif // OMNIFLOW_PLUGIN_RESULT_CACHE_HPP
@@ -26,7 +26,80 @@
  *   - Host sends newline-terminated JSON messages to plugin's stdin.
  *   - Plugin writes newline-terminated JSON responses to stdout.
  *   - Message format (example):
- *       { "id": "<uuid>", "type": "exec|health|shutdown", "payload": {...} }
+ *       { "id": "<uuid>", "type": "exec|batch|cancel|health|metrics|shutdown", "payload": {...} }
+ *   - `batch` carries payload.requests[] (exec/health envelopes) and is answered
+ *     by one line whose body.responses[] has a response per sub-request.
+ *   - By default requests are handled one at a time. Setting
+ *     OMNIFLOW_PLUGIN_WORKERS=<n> (or "auto") runs `exec` work on a fixed pool
+ *     of n threads; responses may then arrive out of order and are matched by id.
+ *     The pool admits at most OMNIFLOW_PLUGIN_QUEUE_MAX requests (default 1024)
+ *     and OMNIFLOW_PLUGIN_QUEUE_BYTES of them (default 64 MiB) in flight; beyond
+ *     that they are answered `busy` with meta.retry_after_ms at once.
+ *     Light actions (echo, reverse) run in the pool's Control lane, which is
+ *     admitted separately and keeps one worker free of Bulk work (compute,
+ *     sleep, batch), so they stay fast behind a Bulk backlog.
+ *   - Setting OMNIFLOW_PLUGIN_FLUSH_US=<us> coalesces responses into fewer
+ *     write(2) calls: output is flushed when the input goes idle, when 64 KiB
+ *     are buffered, or <us> after the first unflushed response. The `meta`
+ *     request reports the achieved responses-per-write ratio.
+ *   - Setting OMNIFLOW_PLUGIN_TRANSPORT=cbor switches both directions to the
+ *     binary transport: every message is a 4-byte big-endian length followed by
+ *     one CBOR item with the same structure as the JSON message (see
+ *     protocol.md). `meta` lists the transports this build supports.
+ *   - Setting OMNIFLOW_PLUGIN_SHM_MAX=<bytes> accepts `exec`/`batch` requests
+ *     whose payload is passed out of band: `payload_ref` names a shm object or
+ *     memfd holding the encoded payload, which is mapped and parsed in place.
+ *   - Responses carry steady-clock stage timings in `meta` (parse_ns,
+ *     queue_ns, handler_ns, processing_time_ms) unless
+ *     OMNIFLOW_PLUGIN_TIMINGS=0; they are appended to the serialized text.
+ *   - exec actions are registered once at startup with their traits
+ *     (cacheable, cpu/io, timeout) and dispatched by a hash lookup of the
+ *     action name (action_registry.hpp, register_builtin_actions()). The
+ *     `sleep` action used to test timeouts and cancel is only registered
+ *     with OMNIFLOW_PLUGIN_TEST_ACTIONS=on.
+ *   - `exec`/`batch` requests not answered within OMNIFLOW_EXEC_TIMEOUT seconds
+ *     (or their action's own timeout) get code 301; `cancel` (payload.id) answers one early with code 302.
+ *     Handlers poll request_stopped() and a late result is dropped.
+ *   - `metrics` answers with request/action/response counters and per-type
+ *     latency percentiles (metrics.hpp); OMNIFLOW_PLUGIN_METRICS_LOG=on also
+ *     logs them to stderr with every heartbeat.
+ *   - Setting OMNIFLOW_PLUGIN_CACHE_BYTES=<bytes> memoizes cacheable exec
+ *     actions (traits.cacheable): a repeated payload is answered from the cached
+ *     response text with its id spliced in (result_cache.hpp).
+ *   - An exec payload with "stream": true gets a large array result (compute
+ *     op "cumsum") in `partial` frames of OMNIFLOW_PLUGIN_CHUNK_BYTES before
+ *     the final response (ResultArray; "Partial responses" in protocol.md).
+ *   - Setting OMNIFLOW_PLUGIN_SOCKET=<path> runs a resident server instead:
+ *     hosts connect to that Unix socket and each connection carries the
+ *     NDJSON protocol unchanged, multiplexed by one epoll loop onto one worker
+ *     pool (unix_server.hpp). Ids, timeouts and cancel are per connection.
+ *   - Built as a shared library, the same code serves trusted hosts in process
+ *     through the C ABI of plugins/common/omniflow_plugin.h (init/exec/free
+ *     with caller-owned buffers; see omniflow_plugin_exec() below).
+ *   - Logging never blocks a request: records go to a lock-free ring and a
+ *     logger thread writes them to stderr in batches (async_logger.hpp),
+ *     as JSON lines when OMNIFLOW_LOG_JSON=true; a full ring drops records.
+ *   - Setting OMNIFLOW_PLUGIN_LEAN=on trims startup for hosts that spawn a
+ *     process per workflow run: the background thread starts with the first
+ *     exec/batch request, the worker pool's threads with its first task, and
+ *     the log ring is small. OMNIFLOW_PLUGIN_READY (default: on in lean mode)
+ *     writes one unsolicited {"status":"ready",...} line before the first
+ *     read, so the host knows when to send. I/O is on raw fds throughout; no
+ *     iostreams are used.
+ *
+ * Parsing:
+ *   - JSON messages are not parsed into a tree: envelope.hpp scans the top
+ *     level once for id/type/payload, and exec/batch handlers read their
+ *     payload through nlohmann::lazy_json, which only parses the members
+ *     they look up.
+ *
+ * Memory:
+ *   - Each message's json trees (request, payload, responses) are
+ *     nlohmann::pmr::ordered_json values allocated from a per-message
+ *     monotonic arena, so a request is torn down with one release() instead
+ *     of a free per node.
+ *     The reader reuses one arena; a request handed to a worker is copied into
+ *     an arena owned by that job.
  *
  * Security notes:
  *   - Limits incoming line length to avoid DoS.
@@ -35,178 +108,1744 @@
  *     use strict allowlists and sandboxing outside of this plugin.
  */
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <charconv>
 #include <csignal>
 #include <cstring>
-#include <fstream>
-#include <iostream>
+#include <memory>
+#include <memory_resource>
 #include <mutex>
+#include <new>
 #include <optional>
-#include <sstream>
 #include <string>
 #include <thread>
 #include <vector>
 
+#include <poll.h>
+#include <unistd.h>
+
 // Include nlohmann::json single-header. Put json.hpp in include path or third_party.
 #include "nlohmann/json.hpp"
-using json = nlohmann::json;
+// Objects are insertion-ordered flat storage: envelopes have a handful of keys
+// and are built once, so a contiguous vector beats one tree node per member.
+using json = nlohmann::pmr::ordered_json; // allocates from the current per-message arena
+
+#include "../common/omniflow_plugin.h"
+#include "action_registry.hpp"
+#include "async_logger.hpp"
+#include "coalescing_writer.hpp"
+#include "compute_kernels.hpp"
+#include "envelope.hpp"
+#include "line_framer.hpp"
+#include "metrics.hpp"
+#include "prefixed_framer.hpp"
+#include "request_tracker.hpp"
+#include "response_template.hpp"
+#include "result_cache.hpp"
+#include "shm_payload.hpp"
+#include "unix_server.hpp"
+#include "worker_pool.hpp"
 
 // Plugin metadata
 static constexpr const char *PLUGIN_NAME = "OmniFlowCppSample";
 static constexpr const char *PLUGIN_VERSION = "1.0.0";
-static constexpr size_t MAX_LINE = 128 * 1024; // 128KiB per message (tunable)
+// Release variant (ISA tier, LTO, PGO) set by CMakeLists.txt; reported by `meta`
+#ifndef OMNIFLOW_BUILD_VARIANT
+#define OMNIFLOW_BUILD_VARIANT "unspecified"
+#endif
+static constexpr size_t DEFAULT_MAX_LINE = 128 * 1024; // 128KiB per message (OMNIFLOW_PLUGIN_MAX_LINE)
+static constexpr size_t MAX_LINE_LIMIT = 10 * 1024 * 1024;
 static constexpr int DEFAULT_HEARTBEAT_SEC = 5;
+static constexpr size_t DEFAULT_LOG_RING = 4096; // log records in flight
+static constexpr size_t LEAN_LOG_RING = 256;     // ... with OMNIFLOW_PLUGIN_LEAN
+static constexpr size_t MAX_WORKERS = 256;
+static constexpr size_t MAX_BATCH = 1024; // sub-requests per `batch` message
+static constexpr size_t FLUSH_BYTES = 64 * 1024; // coalesced output is flushed at this size
+static constexpr long MAX_FLUSH_US = 1000000;
+static constexpr size_t MAX_HISTOGRAM_BINS = 4096;
+static constexpr size_t ARENA_BYTES = 16 * 1024; // initial per-message arena; grows from the heap if exceeded
+static constexpr int DEFAULT_EXEC_TIMEOUT_SEC = 10;  // OMNIFLOW_EXEC_TIMEOUT
+static constexpr long MAX_SLEEP_MS = 60000;          // `sleep` action
+static constexpr size_t DEFAULT_QUEUE_MAX = 1024;              // OMNIFLOW_PLUGIN_QUEUE_MAX
+static constexpr size_t DEFAULT_QUEUE_BYTES = 64 * 1024 * 1024; // OMNIFLOW_PLUGIN_QUEUE_BYTES
+static constexpr long long DEFAULT_RETRY_AFTER_MS = 100;        // `busy` hint before any task time is known
+static constexpr long long DEFAULT_CACHE_TTL_MS = 60000;        // OMNIFLOW_PLUGIN_CACHE_TTL_MS
+static constexpr size_t DEFAULT_CHUNK_BYTES = 64 * 1024;        // OMNIFLOW_PLUGIN_CHUNK_BYTES
 
 // Graceful shutdown control
 static std::atomic<bool> running{true};
 static std::atomic<bool> shutdown_requested{false};
+static volatile std::sig_atomic_t received_signal = 0; // logged by main once the loop ends
 
-// Background worker
+// Background worker, started by ensure_background()
 static std::thread bg_thread;
-static std::mutex log_mutex;
+static std::once_flag bg_started;
+static int heartbeat_sec = DEFAULT_HEARTBEAT_SEC; // OMNIFLOW_PLUGIN_HEARTBEAT
+
+// Lean mode (OMNIFLOW_PLUGIN_LEAN): threads that only serve requests start
+// with the first request that needs them instead of at startup
+static bool lean_mode = false;
+static std::unique_ptr<omniflow::AsyncLogger> logger; // created first thing in main()
+static bool debug_enabled = false;                      // OMNIFLOW_PLUGIN_DEBUG
+
+// Single stdout writer shared by workers and the reader thread
+static std::unique_ptr<omniflow::CoalescingWriter> out_writer;
+
+// Set while the reader is about to block on an idle stdin (coalescing mode)
+static std::atomic<bool> reader_waiting{false};
+
+// Server mode (OMNIFLOW_PLUGIN_SOCKET): hosts connect to a Unix socket instead
+// of stdin/stdout. The client a thread is answering is current_client (the
+// loop while handling its frame, a worker while running its job); responses
+// go to that client's writer, and its requests are tracked under it.
+static std::unique_ptr<omniflow::UnixServer> server;
+static thread_local omniflow::UnixServer::Connection *current_client = nullptr;
+
+// Where this thread's responses go: its client's writer, or stdout
+static omniflow::CoalescingWriter &response_writer() { return current_client ? current_client->out() : *out_writer; }
+
+// The owner a request is tracked under (nullptr on stdio)
+static std::shared_ptr<void> client_ref() {
+    return current_client ? current_client->shared_from_this() : nullptr;
+}
+
+// The pid a memfd payload_ref must name: the connected host's (none on stdio)
+static std::optional<long> payload_ref_peer() {
+    return current_client ? std::optional<long>(current_client->peer_pid()) : std::nullopt;
+}
+
+// Wire format of requests and responses, fixed at startup (OMNIFLOW_PLUGIN_TRANSPORT)
+enum class Transport { Ndjson, Cbor };
+static Transport transport = Transport::Ndjson;
+
+static const char *transport_name(Transport t) { return t == Transport::Cbor ? "cbor" : "ndjson"; }
+
+// Largest payload accepted through `payload_ref` (OMNIFLOW_PLUGIN_SHM_MAX); 0 = disabled
+static size_t shm_max = 0;
+
+// Memoized responses of cacheable exec actions (OMNIFLOW_PLUGIN_CACHE_BYTES; NDJSON only)
+static std::unique_ptr<omniflow::ResultCache> result_cache;
+
+// Exec worker pool (only created when OMNIFLOW_PLUGIN_WORKERS > 0)
+static std::unique_ptr<omniflow::WorkerPool> exec_pool;
+
+// In-flight exec/batch requests: deadlines (fired by the background thread)
+// and cancellation. A handler polls request_stopped() for the request it runs.
+static std::unique_ptr<omniflow::RequestTracker> tracker;
+static std::chrono::seconds exec_timeout{DEFAULT_EXEC_TIMEOUT_SEC};
+static thread_local const omniflow::RequestTracker::Request *current_request = nullptr;
+
+// Streamed exec results (see ResultArray); the stream of the top-level exec
+// this thread runs, nullptr where results cannot stream (CBOR, batch items)
+struct ResultStream;
+static thread_local ResultStream *current_stream = nullptr;
+static size_t chunk_bytes = DEFAULT_CHUNK_BYTES; // OMNIFLOW_PLUGIN_CHUNK_BYTES
+
+// Stage timings in response meta (OMNIFLOW_PLUGIN_TIMINGS=0 turns them off)
+using SteadyClock = std::chrono::steady_clock;
+static bool timings_enabled = true;
+static std::atomic<uint64_t> write_ns_total{0}; // respond(): serialize + hand to the writer
+static std::atomic<uint64_t> write_count{0};
+
+// Steady-clock marks of one request, taken by the reader
+struct StageTimes {
+    SteadyClock::time_point read;   // frame taken from the framer
+    SteadyClock::time_point parsed; // envelope (and any payload tree) decoded
+    omniflow::MessageType type = omniflow::MessageType::Unknown; // latency histogram
+};
+
+// An exec action's handler, instantiated for both payload representations
+// (see "Request handlers" below)
+struct ExecHandler {
+    json (*tree)(const std::string &id, const json &payload);
+    json (*lazy)(const std::string &id, const nlohmann::lazy_json &payload);
+
+    json operator()(const std::string &id, const json &payload) const { return tree(id, payload); }
+    json operator()(const std::string &id, const nlohmann::lazy_json &payload) const { return lazy(id, payload); }
+};
+
+// exec actions by name, filled by register_builtin_actions() before the first
+// request. traits.cacheable marks those whose result depends on nothing but the
+// payload: with OMNIFLOW_PLUGIN_CACHE_BYTES set, their serialized responses are
+// memoized (result_cache.hpp).
+using ExecRegistry = omniflow::ActionRegistry<ExecHandler>;
+static ExecRegistry exec_actions;
+static bool action_timeouts = false; // some action sets traits.timeout
+
+// Aggregates for `metrics` (metrics.hpp). Counter ids are laid out as
+// [requests per MessageType][responses by status / error code][exec actions,
+// then "other"]; the action block is sized by the registry at startup.
+// Histogram ids are MessageType values (read -> handler done, in ns).
+static constexpr int ERROR_CODES[] = {100, 101, 102, 200, 201, 300, 301, 302, 400, 422, 500};
+
+static constexpr size_t type_count() {
+    size_t n = 0;
+    for (const auto &t : omniflow::MESSAGE_TYPES) n = std::max(n, static_cast<size_t>(t.type) + 1);
+    return n;
+}
+
+static constexpr size_t TYPE_COUNT = type_count();
+static constexpr size_t RESPONSES_OK = TYPE_COUNT;
+static constexpr size_t RESPONSES_BUSY = RESPONSES_OK + 1;
+static constexpr size_t RESPONSES_PARTIAL = RESPONSES_BUSY + 1;
+static constexpr size_t ERROR_BASE = RESPONSES_PARTIAL + 1; // ERROR_CODES, then "other"
+static constexpr size_t ACTION_BASE = ERROR_BASE + std::size(ERROR_CODES) + 1;
+
+static std::string_view type_name(size_t t) {
+    for (const auto &e : omniflow::MESSAGE_TYPES) {
+        if (static_cast<size_t>(e.type) == t) return e.name;
+    }
+    return "unknown";
+}
+
+static std::unique_ptr<omniflow::MetricsRegistry> metrics;
+static bool metrics_log = false; // OMNIFLOW_PLUGIN_METRICS_LOG: heartbeat logs a metrics line
+static const SteadyClock::time_point started_at = SteadyClock::now();
+
+static std::unique_ptr<omniflow::MetricsRegistry> make_metrics() {
+    std::vector<std::string> counters(ACTION_BASE + exec_actions.size() + 1), histograms(TYPE_COUNT);
+    for (size_t t = 0; t < TYPE_COUNT; ++t) histograms[t] = counters[t] = "requests." + std::string(type_name(t));
+    counters[RESPONSES_OK] = "responses.ok";
+    counters[RESPONSES_BUSY] = "responses.busy";
+    counters[RESPONSES_PARTIAL] = "responses.partial";
+    for (size_t c = 0; c < std::size(ERROR_CODES); ++c) counters[ERROR_BASE + c] = "errors." + std::to_string(ERROR_CODES[c]);
+    counters[ACTION_BASE - 1] = "errors.other";
+    for (size_t a = 0; a < exec_actions.size(); ++a) counters[ACTION_BASE + a] = "actions." + exec_actions.at(a).name;
+    counters.back() = "actions.other";
+    return std::make_unique<omniflow::MetricsRegistry>(std::move(counters), std::move(histograms));
+}
+
+// nullptr (an unknown action) is counted as "other"
+static void count_action(const ExecRegistry::Action *action) {
+    metrics->add(ACTION_BASE + (action ? action->index : exec_actions.size()));
+}
+
+static void count_error(long long code) {
+    size_t c = 0;
+    while (c < std::size(ERROR_CODES) && ERROR_CODES[c] != code) ++c;
+    metrics->add(ERROR_BASE + c);
+}
+
+// What respond() reports in `meta` for a request, in nanoseconds
+struct StageNs {
+    long long parse = 0;   // read -> envelope decoded
+    long long queue = 0;   // decoded -> handler started (worker hand-off)
+    long long handler = 0; // the handler, including reading a lazy payload
+    long long total = 0;   // read -> handler done
+};
+
+static bool request_stopped() { return current_request && current_request->stopped(); }
 
-// Logging helper (thread-safe)
-static void log_stderr(const std::string &level, const std::string &msg) {
-    std::lock_guard<std::mutex> lock(log_mutex);
-    auto now = std::chrono::system_clock::now();
-    std::time_t t = std::chrono::system_clock::to_time_t(now);
-    char buf[64];
-    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&t));
-    std::cerr << "[" << buf << "] [" << level << "] " << PLUGIN_NAME << ": " << msg << "\n";
-    std::cerr.flush();
+// Logging helpers (thread-safe, never block: records go to the logger's ring
+// and are written to stderr by its thread; dropped when the ring is full)
+static void log_stderr(omniflow::AsyncLogger::Level level, std::string msg) {
+    if (logger) logger->log(level, std::move(msg));
 }
 
-static void info(const std::string &msg) { log_stderr("INFO", msg); }
-static void warn(const std::string &msg) { log_stderr("WARN", msg); }
-static void error_log(const std::string &msg) { log_stderr("ERROR", msg); }
+// A machine-readable line (e.g. the heartbeat metrics), written as is
+static void log_line(std::string line) { log_stderr(omniflow::AsyncLogger::Level::Raw, std::move(line)); }
+
+static void debug(std::string msg) {
+    if (debug_enabled) log_stderr(omniflow::AsyncLogger::Level::Debug, std::move(msg));
+}
+static void info(std::string msg) { log_stderr(omniflow::AsyncLogger::Level::Info, std::move(msg)); }
+static void warn(std::string msg) { log_stderr(omniflow::AsyncLogger::Level::Warn, std::move(msg)); }
+static void error_log(std::string msg) { log_stderr(omniflow::AsyncLogger::Level::Error, std::move(msg)); }
 
 // Utility: safe string escape for JSON (for manual assembly if needed)
 static std::string json_escape(const std::string &s) {
     return json(s).dump(); // uses library to escape correctly (returns quoted string)
 }
 
-// Respond helpers: write JSON to stdout followed by newline and flush
-static void respond(const json &obj) {
-    std::string out = obj.dump();
-    std::cout << out << '\n';
-    std::cout.flush();
+// Utility: reverse by code point, so multi-byte UTF-8 sequences stay intact
+static std::string utf8_reverse(const std::string &s) {
+    std::string out;
+    out.reserve(s.size());
+    size_t end = s.size();
+    while (end > 0) {
+        size_t start = end - 1;
+        while (start > 0 && (static_cast<unsigned char>(s[start]) & 0xC0) == 0x80) --start;
+        out.append(s, start, end - start);
+        end = start;
+    }
+    return out;
+}
+
+// Response builders. Handlers return the response object instead of writing
+// it, so the same handler serves a top-level request and a `batch` item.
+static json make_ok(const std::string &id, json body = json::object()) {
+    json r = { {"id", id}, {"status", "ok"} };
+    r["body"] = std::move(body);
+    return r;
+}
+
+static json make_error(const std::string &id, int code, const std::string &message) {
+    return { {"id", id}, {"status", "error"}, {"code", code}, {"message", message} };
 }
 
-static void respond_ok(const std::string &id, const json &body = json::object()) {
-    json r = {
-        {"id", id},
-        {"status", "ok"},
-        {"time", std::chrono::duration_cast<std::chrono::seconds>(
-                     std::chrono::system_clock::now().time_since_epoch())
-                     .count()},
-        {"body", body}
+// Refused by admission control: the host may retry after meta.retry_after_ms
+static json make_busy(const std::string &id, size_t depth, long long retry_after_ms) {
+    json r = { {"id", id}, {"status", "busy"}, {"code", 300},
+               {"message", "exec queue full (" + std::to_string(depth) + " in flight)"} };
+    r["meta"] = { {"retry_after_ms", retry_after_ms}, {"queue_depth", depth} };
+    return r;
+}
+
+// `,"meta":{...}}`: closes a response serialized without its final brace.
+// processing_time_ms is written with microsecond resolution. Writes at most
+// STAGES_MAX bytes at `p` and returns the end.
+static constexpr size_t STAGES_MAX = 160;
+static char *put_stages(char *p, const StageNs &st) {
+    auto field = [&p](std::string_view key, long long v) {
+        std::memcpy(p, key.data(), key.size());
+        p = std::to_chars(p + key.size(), p + key.size() + 20, v).ptr;
     };
-    respond(r);
+    long long us = st.total / 1000;
+    field(",\"meta\":{\"parse_ns\":", st.parse);
+    field(",\"queue_ns\":", st.queue);
+    field(",\"handler_ns\":", st.handler);
+    field(",\"processing_time_ms\":", us / 1000);
+    char frac[] = {'.', static_cast<char>('0' + us % 1000 / 100), static_cast<char>('0' + us % 100 / 10),
+                   static_cast<char>('0' + us % 10), '}', '}'};
+    std::memcpy(p, frac, sizeof(frac));
+    return p + sizeof(frac);
+}
+
+static void append_stages(std::string &out, const StageNs &st) {
+    char buf[STAGES_MAX];
+    out.append(buf, static_cast<size_t>(put_stages(buf, st) - buf));
+}
+
+// Hand one serialized response to this thread's writer (stdout, or the current
+// client's in server mode) and account for the time spent since `started`
+static void emit(std::string_view frame, SteadyClock::time_point started) {
+    omniflow::CoalescingWriter &dest = response_writer();
+    dest.write(frame);
+    if (timings_enabled) {
+        write_ns_total.fetch_add(static_cast<uint64_t>((SteadyClock::now() - started).count()), std::memory_order_relaxed);
+        write_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    // In worker mode the reader may already be blocked on an idle stdin; the
+    // last job of a burst then flushes on its behalf.
+    if (!current_client && exec_pool && dest.coalescing() && reader_waiting.load() && exec_pool->pending() <= 1)
+        dest.flush();
+}
+
+// Write a response: a JSON line, or a length-prefixed CBOR frame in
+// the binary transport. Top-level responses are stamped with the emission time
+// (batch items share their batch's). Serialization happens outside any lock
+// into a per-thread buffer that is reused across responses; the writer keeps
+// frames whole and decides when to flush (see coalescing_writer.hpp).
+// Stage timings are appended as `meta` text after serialization, so they cost
+// no tree nodes on the NDJSON path.
+static void respond(json obj, const StageNs *stages = nullptr) {
+    SteadyClock::time_point started;
+    if (timings_enabled) started = SteadyClock::now();
+    std::string_view status = obj["status"].template get<std::string_view>();
+    if (status == "ok") metrics->add(RESPONSES_OK);
+    else if (status == "busy") metrics->add(RESPONSES_BUSY);
+    else if (obj.contains("code")) count_error(obj["code"].template get<long long>());
+    obj["time"] = std::chrono::duration_cast<std::chrono::seconds>(
+                      std::chrono::system_clock::now().time_since_epoch())
+                      .count();
+    thread_local std::string out;
+    out.clear();
+    if (transport == Transport::Cbor) {
+        out.resize(omniflow::PrefixedFramer::PREFIX_BYTES);
+        if (stages) {
+            obj["meta"] = { {"parse_ns", stages->parse}, {"queue_ns", stages->queue},
+                            {"handler_ns", stages->handler},
+                            {"processing_time_ms", static_cast<double>(stages->total) / 1e6} };
+        }
+        obj.dump_cbor_to(out);
+        omniflow::PrefixedFramer::store_prefix(
+            out.data(), static_cast<uint32_t>(out.size() - omniflow::PrefixedFramer::PREFIX_BYTES));
+    } else {
+        obj.dump_to(out);
+        if (stages) {
+            out.pop_back(); // the response object's '}'
+            append_stages(out, *stages);
+        }
+        out.push_back('\n');
+    }
+    emit(out, started);
+}
+
+// Write a memoized exec response. `fragment` is the cached
+// `,"status":"ok","body":{...}` text; only the id, the emission time and the
+// stage timings are new, so neither the handler nor dump() runs.
+static void respond_fragment(const std::string &id, std::string_view fragment, const StageNs *stages) {
+    SteadyClock::time_point started;
+    if (timings_enabled) started = SteadyClock::now();
+    metrics->add(RESPONSES_OK);
+    char num[24];
+    long long now = std::chrono::duration_cast<std::chrono::seconds>(
+                        std::chrono::system_clock::now().time_since_epoch()).count();
+    thread_local std::string out;
+    out.assign("{\"id\":");
+    out.append(json_escape(id));
+    out.append(fragment);
+    out.append(",\"time\":");
+    out.append(num, std::to_chars(num, num + sizeof(num), now).ptr);
+    if (stages) append_stages(out, *stages);
+    else out.push_back('}');
+    out.push_back('\n');
+    emit(out, started);
+}
+
+// Fixed-shape responses, rendered by respond_template() without a json tree.
+// Each is a response up to (not including) `,"time":...}`, as make_ok(),
+// make_busy() and respond() would write it.
+static const omniflow::ResponseTemplate HEALTH_RESPONSE(
+    std::string("{\"id\":%s,\"status\":\"ok\",\"body\":{\"status\":\"healthy\",\"version\":\"") + PLUGIN_VERSION +
+    "\",\"queue_depth\":%d}");
+static const omniflow::ResponseTemplate SHUTDOWN_RESPONSE(
+    "{\"id\":%s,\"status\":\"ok\",\"body\":{\"result\":\"shutting_down\"}");
+static const omniflow::ResponseTemplate CLOSING_RESPONSE("{\"id\":%s,\"status\":\"ok\",\"body\":{\"result\":\"closing\"}");
+static const omniflow::ResponseTemplate BUSY_RESPONSE(
+    "{\"id\":%s,\"status\":\"busy\",\"code\":300,\"message\":\"exec queue full (%d in flight)\","
+    "\"meta\":{\"retry_after_ms\":%d,\"queue_depth\":%d}");
+
+// Write a templated response from a stack buffer: the rendered template, the
+// emission time and the stage timings. False if it was not written (the CBOR
+// transport, or an id too long for the buffer); the caller then builds it.
+static bool respond_template(const omniflow::ResponseTemplate &tmpl, size_t counter,
+                             std::initializer_list<omniflow::ResponseTemplate::Value> values,
+                             const StageNs *stages = nullptr) {
+    if (transport != Transport::Ndjson) return false;
+    SteadyClock::time_point started;
+    if (timings_enabled) started = SteadyClock::now();
+    char buf[512];
+    constexpr size_t TAIL = 32 + STAGES_MAX; // `,"time":<n>`, the stages, '}' and '\n'
+    size_t n = tmpl.render(buf, sizeof(buf) - TAIL, values);
+    if (n == 0) return false;
+    metrics->add(counter);
+    long long now = std::chrono::duration_cast<std::chrono::seconds>(
+                        std::chrono::system_clock::now().time_since_epoch()).count();
+    char *p = buf + n;
+    std::memcpy(p, ",\"time\":", 8);
+    p = std::to_chars(p + 8, p + 28, now).ptr;
+    if (stages) p = put_stages(p, *stages);
+    else *p++ = '}';
+    *p++ = '\n';
+    emit(std::string_view(buf, static_cast<size_t>(p - buf)), started);
+    return true;
+}
+
+// Streamed exec results. An exec payload with "stream": true asks for the
+// array field of a large result to arrive in pieces: its handler pushes the
+// elements through a ResultArray, which serializes each one as it comes, and
+// writes a {"id","status":"partial","seq":n,"body":{"<field>":[...]}} frame
+// whenever chunk_bytes of them are buffered. The terminal response carries
+// the elements left over and "seq" = the number of partials before it, so
+// neither the whole array nor its text is ever held at once (protocol.md,
+// "Partial responses"). NDJSON only; elsewhere the result is built whole.
+struct ResultStream {
+    explicit ResultStream(std::string_view id_) : id(id_) {}
+    std::string_view id;
+    std::string field; // set by the ResultArray streaming into it
+    std::string items; // serialized elements since the last partial, ','-separated
+    uint64_t seq = 0;  // partial frames written
+};
+
+// One array field of an exec body, built element by element
+class ResultArray {
+public:
+    ResultArray(json &body, std::string field, bool stream) : body_(body), field_(std::move(field)) {
+        if (stream && current_stream && current_stream->field.empty()) {
+            stream_ = current_stream;
+            stream_->field = field_;
+        } else {
+            array_ = json::array();
+        }
+    }
+
+    // False once the request has been answered by a timeout or cancel (the
+    // handler should stop); only noticed when a partial is due.
+    bool push(long long v) {
+        if (!stream_) {
+            array_.push_back(v);
+            return true;
+        }
+        char num[24];
+        if (!stream_->items.empty()) stream_->items.push_back(',');
+        stream_->items.append(num, std::to_chars(num, num + sizeof(num), v).ptr);
+        return stream_->items.size() < chunk_bytes || write_partial();
+    }
+
+    // Puts the elements into the body, unless they stream.
+    void close() {
+        if (!stream_) body_[field_] = std::move(array_);
+    }
+
+private:
+    bool write_partial() {
+        thread_local std::string frame;
+        frame.assign("{\"id\":");
+        frame.append(json_escape(std::string(stream_->id)));
+        frame.append(",\"status\":\"partial\",\"seq\":");
+        frame.append(std::to_string(stream_->seq));
+        frame.append(",\"body\":{");
+        frame.append(json_escape(field_));
+        frame.append(":[");
+        frame.append(stream_->items);
+        frame.append("]}}\n");
+        stream_->items.clear();
+        bool written = !current_request || current_request->write_partial([] {
+            metrics->add(RESPONSES_PARTIAL);
+            emit(frame, SteadyClock::now());
+        });
+        if (written) ++stream_->seq;
+        return written;
+    }
+
+    json &body_;
+    std::string field_;
+    ResultStream *stream_ = nullptr;
+    json array_;
+};
+
+// The terminal response of a streamed result: `r` is its `ok` response
+// without the streamed field, which gets the remaining elements.
+static void respond_streamed(json &r, const ResultStream &stream, const StageNs *stages) {
+    SteadyClock::time_point started;
+    if (timings_enabled) started = SteadyClock::now();
+    metrics->add(RESPONSES_OK);
+    char num[24];
+    long long now = std::chrono::duration_cast<std::chrono::seconds>(
+                        std::chrono::system_clock::now().time_since_epoch()).count();
+    const json &body = r["body"];
+    thread_local std::string out;
+    out.assign("{\"id\":");
+    out.append(json_escape(std::string(stream.id)));
+    out.append(",\"status\":\"ok\",\"seq\":");
+    out.append(num, std::to_chars(num, num + sizeof(num), stream.seq).ptr);
+    out.append(",\"body\":");
+    body.dump_to(out);
+    out.pop_back(); // the body's '}'
+    if (body.size() > 0) out.push_back(',');
+    out.append(json_escape(stream.field));
+    out.append(":[");
+    out.append(stream.items);
+    out.append("]},\"time\":");
+    out.append(num, std::to_chars(num, num + sizeof(num), now).ptr);
+    if (stages) append_stages(out, *stages);
+    else out.push_back('}');
+    out.push_back('\n');
+    emit(out, started);
+}
+
+// Cache an `ok` exec response under `key` and write it from the cached text.
+static void respond_memoized(uint64_t key, json &r, const StageNs *stages) {
+    thread_local std::string fragment;
+    fragment.assign(",\"status\":\"ok\",\"body\":");
+    r["body"].dump_to(fragment);
+    result_cache->insert(key, fragment);
+    respond_fragment(r["id"].template get<std::string>(), fragment, stages);
+}
+
+static void respond_ok(const std::string &id, json body = json::object()) {
+    respond(make_ok(id, std::move(body)));
 }
 
 static void respond_error(const std::string &id, int code, const std::string &message) {
-    json r = {
-        {"id", id},
-        {"status", "error"},
-        {"code", code},
-        {"message", message},
-        {"time", std::chrono::duration_cast<std::chrono::seconds>(
-                     std::chrono::system_clock::now().time_since_epoch())
-                     .count()}
+    respond(make_error(id, code, message));
+}
+
+// Aggregates since startup: request counts per type, exec actions, responses
+// by status / error code and latency percentiles (read -> handler done) per type.
+static json metrics_body() {
+    omniflow::MetricsRegistry::Snapshot snap = metrics->snapshot();
+    auto suffix = [](const std::string &name) { return name.substr(name.find('.') + 1); };
+    const auto &names = metrics->counter_names();
+    json requests = json::object(), actions = json::object(), errors = json::object(), latency = json::object();
+    for (size_t t = 0; t < TYPE_COUNT; ++t) requests[suffix(names[t])] = snap.counters[t];
+    for (size_t a = ACTION_BASE; a < names.size(); ++a) actions[suffix(names[a])] = snap.counters[a];
+    for (size_t c = ERROR_BASE; c < ACTION_BASE; ++c) {
+        if (snap.counters[c]) errors[suffix(names[c])] = snap.counters[c];
+    }
+    for (size_t t = 0; t < TYPE_COUNT; ++t) {
+        const omniflow::HistogramSnapshot &h = snap.histograms[t];
+        if (h.count() == 0) continue;
+        latency[std::string(type_name(t))] = {
+            {"count", h.count()}, {"mean", h.mean()}, {"p50", h.percentile(0.5)},
+            {"p99", h.percentile(0.99)}, {"p999", h.percentile(0.999)}, {"max", h.max()}
+        };
+    }
+    json responses = { {"ok", snap.counters[RESPONSES_OK]}, {"busy", snap.counters[RESPONSES_BUSY]},
+                       {"partial", snap.counters[RESPONSES_PARTIAL]} };
+    responses["errors"] = std::move(errors);
+    json body = {
+        {"uptime_ms", static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                          SteadyClock::now() - started_at).count())}
     };
-    respond(r);
+    body["requests"] = std::move(requests);
+    body["actions"] = std::move(actions);
+    body["responses"] = std::move(responses);
+    body["latency_ns"] = std::move(latency);
+    if (result_cache) {
+        omniflow::ResultCache::Stats cs = result_cache->stats();
+        body["cache"] = {
+            {"hits", cs.hits}, {"misses", cs.misses}, {"insertions", cs.insertions},
+            {"evictions", cs.evictions}, {"expirations", cs.expirations},
+            {"entries", cs.entries}, {"bytes", cs.bytes}, {"max_bytes", result_cache->max_bytes()}
+        };
+    }
+    return body;
 }
 
-// Background worker: emits heartbeat logs and can perform periodic maintenance
+// A request whose deadline passed: the wheel has claimed it, answer with 301.
+// The handler (if it is running) sees request_stopped() and its result is dropped.
+static void answer_timeout(const omniflow::RequestTracker::Ptr &req) {
+    warn("exec request '" + req->id + "' timed out");
+    req->fence(); // after any partial response the handler is writing
+    current_client = static_cast<omniflow::UnixServer::Connection *>(req->owner.get());
+    if (req->timeout == exec_timeout)
+        respond_error(req->id, 301, "exec timeout after " + std::to_string(exec_timeout.count()) +
+                                    "s (OMNIFLOW_EXEC_TIMEOUT)");
+    else
+        respond_error(req->id, 301, "exec timeout after " + std::to_string(req->timeout.count()) +
+                                    "ms (action timeout)");
+    if (response_writer().coalescing() && (current_client || reader_waiting.load())) response_writer().flush();
+    current_client = nullptr;
+}
+
+// Background worker: emits heartbeat logs and drives the request deadline
+// wheel; it sleeps until the next heartbeat or the next wheel tick.
 static void background_worker(int heartbeat_sec) {
     info("background worker started");
     int counter = 0;
+    auto next_beat = std::chrono::steady_clock::now() + std::chrono::seconds(heartbeat_sec);
     while (running.load()) {
-        std::this_thread::sleep_for(std::chrono::seconds(heartbeat_sec));
+        tracker->run_until(next_beat, answer_timeout); // returns early on tracker->stop()
         if (!running.load()) break;
+        if (std::chrono::steady_clock::now() < next_beat) continue;
+        next_beat += std::chrono::seconds(heartbeat_sec);
         ++counter;
-        info("heartbeat: " + std::to_string(counter));
+        if (metrics_log) {
+            json line = { {"heartbeat", counter} };
+            line["metrics"] = metrics_body();
+            log_line(line.dump());
+        } else {
+            info("heartbeat: " + std::to_string(counter));
+        }
         // Place lightweight maintenance here: e.g., cache cleanup, metrics flush
     }
     info("background worker stopping");
 }
 
-// Signal handler
+// Start the background thread unless it runs: at startup, or in lean mode
+// when the first request with a deadline is tracked.
+static void ensure_background() {
+    std::call_once(bg_started, [] { bg_thread = std::thread(background_worker, heartbeat_sec); });
+}
+
+// Track a request under this thread's client; its deadline needs the wheel
+// the background thread drives.
+static omniflow::RequestTracker::Ptr track(const std::string &id, std::chrono::milliseconds timeout) {
+    ensure_background();
+    return tracker->start(id, timeout, client_ref());
+}
+
+// The unsolicited ready line (OMNIFLOW_PLUGIN_READY), written once before the
+// first read so a host can wait for it instead of probing with `health`. It
+// has no id; startup_us counts from main(). Server mode writes it to stdout
+// once the socket listens.
+static void announce_ready(SteadyClock::time_point started) {
+    json body = {
+        {"name", PLUGIN_NAME},
+        {"version", PLUGIN_VERSION},
+        {"pid", static_cast<long long>(::getpid())},
+        {"transport", transport_name(transport)},
+        {"lean", lean_mode},
+        {"startup_us", static_cast<long long>(
+            std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - started).count())}
+    };
+    if (server) body["socket"] = server->path();
+    respond(json{ {"status", "ready"}, {"body", std::move(body)} });
+    if (out_writer->coalescing()) out_writer->flush();
+}
+
+// Signal handler: async-signal-safe only (no logging, the logger allocates)
 static void handle_signal(int sig) {
-    warn(std::string("received signal ") + std::to_string(sig));
+    received_signal = sig;
     shutdown_requested.store(true);
     running.store(false);
+    if (server) server->stop(); // wakes the event loop (only writes an eventfd)
 }
 
-// Safe read line with size limit; returns optional string; nullopt on EOF
-static std::optional<std::string> safe_getline(std::istream &in) {
-    std::string line;
-    if (!std::getline(in, line)) return std::nullopt;
-    if (line.size() > MAX_LINE) {
-        warn("incoming line exceeds MAX_LINE, truncated");
-        line.resize(MAX_LINE);
-    }
-    return line;
+// True when no further request is already waiting: no complete frame in the
+// framer's buffer and nothing readable on fd 0.
+template <typename Framer>
+static bool input_idle(const Framer &framer) {
+    if (framer.has_frame()) return false;
+    struct pollfd pfd{STDIN_FILENO, POLLIN, 0};
+    return ::poll(&pfd, 1, 0) == 0;
 }
 
+// Request handlers take the payload as a template parameter: a json tree
+// (CBOR transport, batch items built from one) or a nlohmann::lazy_json view
+// of the raw JSON text, which reads only the members a handler asks for.
+
+// Defined below, next to the payload_ref parser it shares
+template <typename Payload>
+static json handle_compute(const std::string &id, const Payload &payload);
+
 // Command handlers
-static void handle_health(const std::string &id) {
+static json handle_health(const std::string &id) {
     json body = {
         {"status", "healthy"},
-        {"version", PLUGIN_VERSION}
+        {"version", PLUGIN_VERSION},
+        {"queue_depth", exec_pool ? exec_pool->pending() : 0}
     };
-    respond_ok(id, body);
+    return make_ok(id, std::move(body));
+}
+
+// exec actions. Each is instantiated for both payload types and registered,
+// with its traits, in register_builtin_actions().
+template <typename Payload>
+static json exec_echo(const std::string &id, const Payload &payload) {
+    std::string message = "";
+    if (payload.contains("message") && payload["message"].is_string())
+        message = payload["message"].template get<std::string>();
+    json body = { {"action", "echo"}, {"message", message} };
+    return make_ok(id, std::move(body));
+}
+
+template <typename Payload>
+static json exec_reverse(const std::string &id, const Payload &payload) {
+    std::string message = "";
+    if (payload.contains("message") && payload["message"].is_string())
+        message = payload["message"].template get<std::string>();
+    std::string rev = utf8_reverse(message);
+    json body = { {"action", "reverse"}, {"message", rev} };
+    return make_ok(id, std::move(body));
 }
 
-static void handle_exec(const std::string &id, const json &payload) {
-    // Example actions: echo, reverse, compute
+// stand-in for long-running work: sleeps payload.ms, polling for timeout/cancel
+// (test action: see register_builtin_actions())
+template <typename Payload>
+static json exec_sleep(const std::string &id, const Payload &payload) {
+    long ms = 0;
+    if (payload.contains("ms")) {
+        const auto &v = payload["ms"];
+        if (!v.is_number_integer() || v.template get<long long>() < 0 || v.template get<long long>() > MAX_SLEEP_MS)
+            return make_error(id, 400, "'ms' must be an integer in 0.." + std::to_string(MAX_SLEEP_MS));
+        ms = v.template get<long>();
+    }
+    auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    while (std::chrono::steady_clock::now() < until) {
+        if (request_stopped()) return make_error(id, 302, "stopped"); // already answered; dropped
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+            std::chrono::milliseconds(5), until - std::chrono::steady_clock::now()));
+    }
+    json body = { {"action", "sleep"}, {"ms", ms} };
+    return make_ok(id, std::move(body));
+}
+
+// Called once in main() (or by the ABI's first init), before metrics are laid
+// out and requests are read. Add actions here; traits.timeout overrides
+// OMNIFLOW_EXEC_TIMEOUT for one, and Light actions run in the worker pool's
+// Control lane. `sleep` only exists to exercise timeouts and cancel and ties up
+// a worker for as long as it is asked to, so it is registered only for tests
+// (OMNIFLOW_PLUGIN_TEST_ACTIONS=on) and never for the in-process ABI.
+static void register_builtin_actions(bool with_sleep) {
+    using omniflow::ActionKind;
+    exec_actions.register_action("echo", {exec_echo<json>, exec_echo<nlohmann::lazy_json>},
+                                 {true, ActionKind::Light, {}});
+    exec_actions.register_action("reverse", {exec_reverse<json>, exec_reverse<nlohmann::lazy_json>},
+                                 {true, ActionKind::Light, {}});
+    exec_actions.register_action("compute", {handle_compute<json>, handle_compute<nlohmann::lazy_json>},
+                                 {true, ActionKind::Cpu, {}});
+    if (with_sleep)
+        exec_actions.register_action("sleep", {exec_sleep<json>, exec_sleep<nlohmann::lazy_json>},
+                                     {false, ActionKind::Io, {}});
+    for (size_t a = 0; a < exec_actions.size(); ++a)
+        action_timeouts = action_timeouts || exec_actions.at(a).traits.timeout.count() > 0;
+}
+
+template <typename Payload>
+static json handle_exec(const std::string &id, const Payload &payload) {
     if (!payload.contains("action") || !payload["action"].is_string()) {
-        respond_error(id, 400, "missing or invalid 'action' in payload");
-        return;
-    }
-    std::string action = payload["action"].get<std::string>();
-
-    if (action == "echo") {
-        std::string message = "";
-        if (payload.contains("message") && payload["message"].is_string())
-            message = payload["message"].get<std::string>();
-        json body = { {"action", "echo"}, {"message", message} };
-        respond_ok(id, body);
-        return;
-    }
-    else if (action == "reverse") {
-        std::string message = "";
-        if (payload.contains("message") && payload["message"].is_string())
-            message = payload["message"].get<std::string>();
-        std::string rev(message.rbegin(), message.rend());
-        json body = { {"action", "reverse"}, {"message", rev} };
-        respond_ok(id, body);
-        return;
-    }
-    else if (action == "compute") {
-        // simple safe compute example: sum array of ints
-        if (!payload.contains("numbers") || !payload["numbers"].is_array()) {
-            respond_error(id, 400, "missing or invalid 'numbers' array");
-            return;
+        return make_error(id, 400, "missing or invalid 'action' in payload");
+    }
+    std::string action = payload["action"].template get<std::string>();
+    const ExecRegistry::Action *a = exec_actions.find(action);
+    count_action(a);
+    if (debug_enabled) debug("handling exec id=" + id + " action=" + action);
+    if (!a) return make_error(id, 422, "unsupported action");
+    return a->handler(id, payload);
+}
+
+// Run an exec request and guarantee a response for its id, even if a handler throws.
+template <typename Payload>
+static json run_exec(const std::string &id, const Payload &payload) {
+    try {
+        return handle_exec(id, payload);
+    } catch (const std::exception &ex) {
+        error_log(std::string("exec handler failed: ") + ex.what());
+        return make_error(id, 400, std::string("internal error: ") + ex.what());
+    } catch (...) {
+        error_log("exec handler failed: unknown exception");
+        return make_error(id, 400, "internal error");
+    }
+}
+
+// meta: plugin identity, supported transports and output batching statistics
+static json handle_meta(const std::string &id) {
+    omniflow::CoalescingWriter::Stats st = response_writer().stats(); // this client's, in server mode
+    uint64_t timed_writes = write_count.load(std::memory_order_relaxed);
+    json output = {
+        {"flush_us", static_cast<long long>(response_writer().window().count())},
+        {"responses", st.lines},
+        {"writes", st.writes},
+        {"responses_per_write", st.writes ? static_cast<double>(st.lines) / static_cast<double>(st.writes) : 0.0},
+        {"write_ns_avg", timed_writes ? write_ns_total.load(std::memory_order_relaxed) / timed_writes : 0}
+    };
+    json body = {
+        {"name", PLUGIN_NAME},
+        {"version", PLUGIN_VERSION},
+        {"build", OMNIFLOW_BUILD_VARIANT},
+        {"lean", lean_mode},
+        {"exec_workers", exec_pool ? exec_pool->size() : 0},
+        {"transport", transport_name(transport)},
+        {"transports", {"ndjson", "cbor"}},
+        {"shm_max", shm_max},
+        {"stream_chunk_bytes", transport == Transport::Ndjson ? chunk_bytes : 0},
+        {"exec_timeout_ms", static_cast<long long>(std::chrono::milliseconds(exec_timeout).count())},
+        {"inflight", tracker->inflight()},
+        {"timings", timings_enabled},
+        {"log_dropped", logger->dropped()},
+        {"simd", omniflow::kernels::isa_name(omniflow::kernels::active_isa())}
+    };
+    json actions = json::array();
+    for (size_t a = 0; a < exec_actions.size(); ++a) {
+        const ExecRegistry::Action &act = exec_actions.at(a);
+        json entry = { {"name", act.name}, {"cacheable", act.traits.cacheable},
+                       {"kind", omniflow::action_kind_name(act.traits.kind)} };
+        if (act.traits.timeout.count() > 0) entry["timeout_ms"] = static_cast<long long>(act.traits.timeout.count());
+        actions.push_back(std::move(entry));
+    }
+    body["actions"] = std::move(actions);
+    body["output"] = std::move(output);
+    if (server) {
+        omniflow::UnixServer::Stats ss = server->stats();
+        body["server"] = {
+            {"socket", server->path()},
+            {"clients", ss.clients},
+            {"max_clients", server->max_clients()},
+            {"max_queued", server->max_queued()},
+            {"accepted", ss.accepted},
+            {"rejected", ss.rejected},
+            {"overflowed", ss.overflowed}
+        };
+    }
+    if (exec_pool) {
+        body["queue"] = {
+            {"depth", exec_pool->pending()},
+            {"control", exec_pool->pending(omniflow::WorkerPool::Lane::Control)},
+            {"bulk", exec_pool->pending(omniflow::WorkerPool::Lane::Bulk)},
+            {"bytes", exec_pool->pending_bytes()},
+            {"max", exec_pool->limits().max_inflight},
+            {"max_bytes", exec_pool->limits().max_bytes},
+            {"mean_task_us", static_cast<long long>(exec_pool->mean_task_time().count())}
+        };
+    }
+    return make_ok(id, std::move(body));
+}
+
+// One `batch` item: a request envelope without the outer framing. Items are
+// answered independently; only `exec` and `health` may be batched.
+template <typename Item>
+static json handle_batch_item(const Item &req) {
+    if (!req.is_object()) return make_error("", 400, "batch item must be an object");
+    std::string id = "";
+    if (req.contains("id") && req["id"].is_string()) id = req["id"].template get<std::string>();
+    if (!req.contains("type") || !req["type"].is_string()) return make_error(id, 400, "missing 'type' field");
+    std::string type = req["type"].template get<std::string>();
+
+    if (type == "exec") return req.contains("payload") ? run_exec(id, req["payload"]) : run_exec(id, json::object());
+    if (type == "health") return handle_health(id);
+    if (type == "batch") return make_error(id, 400, "nested batch not allowed");
+    if (type == "shutdown" || type == "quit") return make_error(id, 400, "shutdown not allowed in batch");
+    return make_error(id, 400, "unknown type");
+}
+
+// batch: payload.requests[] is answered by one response whose body.responses[]
+// holds one item response per sub-request, in request order (see protocol.md).
+template <typename Payload>
+static json handle_batch(const std::string &id, const Payload &payload) {
+    if (!payload.contains("requests") || !payload["requests"].is_array()) {
+        return make_error(id, 400, "missing or invalid 'requests' array");
+    }
+    current_stream = nullptr; // items are answered inside the batch response
+    const auto &requests = payload["requests"];
+    if (requests.size() > MAX_BATCH) {
+        return make_error(id, 400, "batch exceeds " + std::to_string(MAX_BATCH) + " requests");
+    }
+    json responses = json::array();
+    long long failed = 0;
+    for (const auto &req : requests) {
+        if (request_stopped()) break; // timed out or cancelled: the batch is already answered
+        json r = handle_batch_item(req);
+        if (r["status"].get<std::string_view>() != "ok") ++failed;
+        responses.push_back(std::move(r));
+    }
+    json body = json::object();
+    body["responses"] = std::move(responses);
+    body["failed"] = failed;
+    return make_ok(id, std::move(body));
+}
+
+// Run an exec or batch request over a payload of either representation
+template <typename Payload>
+static json run_request(omniflow::MessageType type, const std::string &id, const Payload &payload) {
+    return type == omniflow::MessageType::Exec ? run_exec(id, payload) : handle_batch(id, payload);
+}
+
+static long long ns_between(SteadyClock::time_point from, SteadyClock::time_point to) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+}
+
+// Where a response's latency went; the total goes to the request type's
+// histogram. Returns nullptr with timings off. The write stage cannot be part
+// of its own response: `meta` reports its average.
+static const StageNs *measure(const StageTimes &t, SteadyClock::time_point started, StageNs &out) {
+    auto done = SteadyClock::now();
+    out.parse = ns_between(t.read, t.parsed);
+    out.queue = ns_between(t.parsed, started);
+    out.handler = ns_between(started, done);
+    out.total = ns_between(t.read, done);
+    metrics->record(static_cast<size_t>(t.type), static_cast<uint64_t>(out.total));
+    return timings_enabled ? &out : nullptr;
+}
+
+// Estimated wait until a lane of the pool has room: the queue ahead drains at
+// about one mean task time per worker that may run it (a fixed guess until a
+// task has finished).
+static long long retry_after_ms(omniflow::WorkerPool::Lane lane) {
+    auto mean = exec_pool->mean_task_time();
+    if (mean.count() == 0) return DEFAULT_RETRY_AFTER_MS;
+    size_t workers = lane == omniflow::WorkerPool::Lane::Bulk ? exec_pool->bulk_slots() : exec_pool->size();
+    auto wait = mean * static_cast<long long>(exec_pool->pending(lane)) / static_cast<long long>(workers);
+    return std::max<long long>(1, std::chrono::duration_cast<std::chrono::milliseconds>(
+                                      wait + std::chrono::microseconds(999)).count());
+}
+
+// Run `work` for a tracked request and answer it (to the client that sent it),
+// unless a timeout or a cancel got there first (then the result is dropped).
+// Requests that stopped while still queued are not run at all. With a
+// `cache_key`, an `ok` result is memoized on the way out.
+template <typename Work>
+static void run_tracked(const omniflow::RequestTracker::Ptr &req, const StageTimes &times, Work &&work,
+                        std::optional<uint64_t> cache_key = std::nullopt) {
+    omniflow::UnixServer::Connection *caller = current_client;
+    current_client = static_cast<omniflow::UnixServer::Connection *>(req->owner.get());
+    if (!req->stopped()) {
+        auto started = SteadyClock::now();
+        ResultStream stream(req->id);
+        current_request = req.get();
+        current_stream = transport == Transport::Ndjson ? &stream : nullptr;
+        json r;
+        try {
+            r = work();
+        } catch (const std::exception &ex) {
+            r = make_error(req->id, 400, std::string("internal error: ") + ex.what());
+        }
+        current_request = nullptr;
+        current_stream = nullptr;
+        StageNs ns;
+        if (req->claim(omniflow::RequestTracker::Done)) {
+            bool ok = r["status"].template get<std::string_view>() == "ok";
+            if (ok && !stream.field.empty())
+                respond_streamed(r, stream, measure(times, started, ns)); // never memoized
+            else if (cache_key && ok)
+                respond_memoized(*cache_key, r, measure(times, started, ns));
+            else
+                respond(std::move(r), measure(times, started, ns));
+        }
+    }
+    current_client = caller;
+    tracker->finish(req);
+}
+
+// cancel: stop the in-flight exec/batch request payload.id. It is answered at
+// once with code 302 and its handler's result (if it still runs) is dropped.
+template <typename Payload>
+static json handle_cancel(const std::string &id, const Payload &payload) {
+    if (!payload.contains("id") || !payload["id"].is_string()) {
+        return make_error(id, 400, "missing or invalid 'id' in payload");
+    }
+    std::string target = payload["id"].template get<std::string>();
+    omniflow::RequestTracker::Ptr req = tracker->find(target, current_client); // only the sender's own
+    bool cancelled = req && req->claim(omniflow::RequestTracker::Cancelled);
+    if (cancelled) {
+        req->fence(); // after any partial response the handler is writing
+        respond_error(target, 302, "cancelled by host");
+    }
+    json body = { {"id", target}, {"cancelled", cancelled} };
+    return make_ok(id, std::move(body));
+}
+
+// An exec or batch request handed to the pool. The payload is copied out of the
+// reader's arena into one owned by the job; members are destroyed in reverse
+// order, so the payload goes before its arena.
+struct ExecJob {
+    // CBOR transport: the payload tree is copied
+    ExecJob(std::string id_, omniflow::MessageType type_, std::chrono::milliseconds timeout, const json &src)
+        : id(std::move(id_)), type(type_), tracked(track(id, timeout)), arena(ARENA_BYTES) {
+        nlohmann::pmr::arena_scope scope(&arena);
+        payload = src;
+    }
+
+    // JSON transport: the raw payload text is copied and read lazily by the worker
+    ExecJob(std::string id_, omniflow::MessageType type_, std::chrono::milliseconds timeout, std::string_view raw)
+        : id(std::move(id_)), type(type_), tracked(track(id, timeout)), arena(ARENA_BYTES),
+          lazy(true), raw_payload(raw, &arena) {}
+
+    // The payload is in shared memory: it is mapped and parsed by the worker.
+    ExecJob(std::string id_, omniflow::MessageType type_, std::chrono::milliseconds timeout,
+            const omniflow::MappedPayload::Ref &ref_, bool cbor_)
+        : id(std::move(id_)), type(type_), tracked(track(id, timeout)), arena(ARENA_BYTES),
+          by_ref(true), ref(ref_), ref_cbor(cbor_) {}
+
+    std::string id;
+    omniflow::MessageType type;
+    omniflow::RequestTracker::Ptr tracked; // deadline starts when the request is accepted
+    StageTimes times;
+    std::pmr::monotonic_buffer_resource arena;
+    json payload;
+    bool lazy = false;
+    std::pmr::string raw_payload;
+    bool by_ref = false;
+    omniflow::MappedPayload::Ref ref;
+    bool ref_cbor = false;
+    std::optional<uint64_t> cache_key;
+};
+
+// Run an exec or batch request whose payload is behind a payload_ref: map it
+// and run the handler on it. CBOR is decoded into the current arena; JSON is
+// validated and read lazily in place, so the mapping is kept until the
+// handler returns.
+static json run_by_ref(const std::string &id, omniflow::MessageType type, const omniflow::MappedPayload::Ref &ref,
+                       bool cbor) {
+    omniflow::MappedPayload mapped;
+    json tree;
+    nlohmann::lazy_json view;
+    try {
+        mapped = omniflow::MappedPayload::map(ref, shm_max, payload_ref_peer());
+        if (cbor) tree = json::from_cbor(mapped.bytes());
+        else view = nlohmann::lazy_json::parse(mapped.bytes());
+    } catch (const omniflow::ShmError &ex) {
+        warn(std::string("payload_ref rejected: ") + ex.what());
+        return make_error(id, ex.code, ex.what());
+    } catch (const std::exception &ex) {
+        return make_error(id, 400, std::string("invalid shared-memory payload: ") + ex.what());
+    }
+    return cbor ? run_request(type, id, tree) : run_request(type, id, view);
+}
+
+// Read a `payload_ref` descriptor (see protocol.md); throws ShmError(400) when
+// it is malformed. `cbor` is set from its encoding (default: the transport's).
+template <typename Desc>
+static omniflow::MappedPayload::Ref parse_payload_ref(const Desc &desc, bool &cbor) {
+    if (!desc.is_object()) throw omniflow::ShmError(400, "payload_ref must be an object");
+    auto uint_field = [&desc](std::string_view key) -> uint64_t {
+        if (!desc.contains(key)) return 0;
+        const auto &v = desc[key];
+        if (!v.is_number_integer() || v.template get<long long>() < 0)
+            throw omniflow::ShmError(400, "payload_ref." + std::string(key) + " must be a non-negative integer");
+        return v.template get<uint64_t>();
+    };
+    omniflow::MappedPayload::Ref ref;
+    if (desc.contains("shm")) {
+        if (!desc["shm"].is_string()) throw omniflow::ShmError(400, "payload_ref.shm must be a string");
+        ref.shm = desc["shm"].template get<std::string>();
+    } else {
+        ref.pid = static_cast<long>(uint_field("pid"));
+        ref.fd = desc.contains("fd") ? static_cast<int>(uint_field("fd")) : -1;
+    }
+    ref.offset = uint_field("offset");
+    ref.length = uint_field("length");
+
+    cbor = transport == Transport::Cbor;
+    if (desc.contains("encoding")) {
+        if (!desc["encoding"].is_string()) throw omniflow::ShmError(400, "payload_ref.encoding must be a string");
+        std::string enc = desc["encoding"].template get<std::string>();
+        if (enc == "cbor") cbor = true;
+        else if (enc == "json") cbor = false;
+        else throw omniflow::ShmError(400, "payload_ref.encoding must be \"json\" or \"cbor\"");
+    }
+    return ref;
+}
+
+// An int64 column for the compute kernels: decoded once from a json array
+// into the current arena, or mapped in place from a `<key>_ref` descriptor.
+struct Int64Column {
+    std::pmr::vector<int64_t> decoded{nlohmann::pmr::current_resource()};
+    omniflow::MappedPayload mapped;
+    const int64_t *data = nullptr;
+    size_t size = 0;
+};
+
+// Load payload[key] (an integer array) or payload[key + "_ref"] (shared memory
+// holding little-endian int64 values). On failure `err` holds the response.
+template <typename Payload>
+static bool load_column(const std::string &id, const Payload &payload, const std::string &key,
+                        Int64Column &col, json &err) {
+    const std::string ref_key = key + "_ref";
+    if (payload.contains(ref_key)) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+        err = make_error(id, 400, "'" + ref_key + "' needs a little-endian host");
+        return false;
+#endif
+        if (shm_max == 0) {
+            err = make_error(id, 400, "'" + ref_key + "' not enabled (OMNIFLOW_PLUGIN_SHM_MAX unset)");
+            return false;
+        }
+        try {
+            bool unused_cbor;
+            omniflow::MappedPayload::Ref ref = parse_payload_ref(payload[ref_key], unused_cbor);
+            if (ref.offset % sizeof(int64_t) != 0 || ref.length % sizeof(int64_t) != 0)
+                throw omniflow::ShmError(400, "'" + ref_key + "' offset and length must be multiples of 8");
+            col.mapped = omniflow::MappedPayload::map(ref, shm_max, payload_ref_peer());
+        } catch (const omniflow::ShmError &ex) {
+            err = make_error(id, ex.code, ex.what());
+            return false;
         }
-        long long sum = 0;
-        for (const auto &v : payload["numbers"]) {
-            if (!v.is_number_integer()) { respond_error(id, 400, "numbers must be integers"); return; }
-            sum += v.get<long long>();
+        if (col.mapped.bytes().size() % sizeof(int64_t) != 0) {
+            err = make_error(id, 400, "'" + ref_key + "' size must be a multiple of 8");
+            return false;
         }
-        json body = { {"action", "compute"}, {"sum", sum} };
-        respond_ok(id, body);
-        return;
+        // page-aligned mapping + offset % 8 == 0: suitably aligned for int64_t
+        col.data = reinterpret_cast<const int64_t *>(col.mapped.bytes().data());
+        col.size = col.mapped.bytes().size() / sizeof(int64_t);
+        return true;
     }
-    else {
-        respond_error(id, 422, "unsupported action");
-        return;
+    if (!payload.contains(key) || !payload[key].is_array()) {
+        err = make_error(id, 400, "missing or invalid '" + key + "' array");
+        return false;
+    }
+    const auto &arr = payload[key];
+    col.decoded.reserve(arr.size());
+    for (const auto &v : arr) {
+        if (!v.is_number_integer()) {
+            err = make_error(id, 400, key + " must be integers");
+            return false;
+        }
+        col.decoded.push_back(v.template get<long long>());
+    }
+    col.data = col.decoded.data();
+    col.size = col.decoded.size();
+    return true;
+}
+
+// compute: payload.op (default "sum") over payload.numbers (or numbers_ref):
+// sum | min | max | mean | dot (with weights/weights_ref) | histogram (bins, range)
+// | cumsum (prefix sums, streamed with payload.stream)
+template <typename Payload>
+static json handle_compute(const std::string &id, const Payload &payload) {
+    namespace k = omniflow::kernels;
+    std::string op = "sum";
+    if (payload.contains("op")) {
+        if (!payload["op"].is_string()) return make_error(id, 400, "'op' must be a string");
+        op = payload["op"].template get<std::string>();
+    }
+    Int64Column numbers;
+    json err;
+    if (!load_column(id, payload, "numbers", numbers, err)) return err;
+    json body = { {"action", "compute"}, {"op", op} };
+
+    if (op == "sum") {
+        int64_t sum;
+        if (!k::sum(numbers.data, numbers.size, sum)) return make_error(id, 400, "integer overflow in sum");
+        body["sum"] = sum;
+    } else if (op == "min" || op == "max" || op == "mean") {
+        if (numbers.size == 0) return make_error(id, 400, "'numbers' must not be empty for " + op);
+        if (op == "mean") {
+            body["mean"] = static_cast<double>(k::sum_wide(numbers.data, numbers.size)) /
+                           static_cast<double>(numbers.size);
+        } else {
+            k::MinMax mm = k::minmax(numbers.data, numbers.size);
+            body[op] = op == "min" ? mm.min : mm.max;
+        }
+    } else if (op == "dot") {
+        Int64Column weights;
+        if (!load_column(id, payload, "weights", weights, err)) return err;
+        if (weights.size != numbers.size) return make_error(id, 400, "'numbers' and 'weights' differ in length");
+        int64_t dot;
+        if (!k::dot(numbers.data, weights.data, numbers.size, dot)) return make_error(id, 400, "integer overflow in dot");
+        body["dot"] = dot;
+    } else if (op == "histogram") {
+        if (numbers.size == 0) return make_error(id, 400, "'numbers' must not be empty for histogram");
+        size_t bins = 10;
+        if (payload.contains("bins")) {
+            const auto &b = payload["bins"];
+            if (!b.is_number_integer() || b.template get<long long>() < 1 || b.template get<long long>() > static_cast<long long>(MAX_HISTOGRAM_BINS))
+                return make_error(id, 400, "'bins' must be an integer in 1.." + std::to_string(MAX_HISTOGRAM_BINS));
+            bins = b.template get<size_t>();
+        }
+        int64_t lo, hi;
+        if (payload.contains("range")) {
+            const auto &r = payload["range"];
+            if (!r.is_array() || r.size() != 2 || !r[0].is_number_integer() || !r[1].is_number_integer() ||
+                r[0].template get<long long>() > r[1].template get<long long>())
+                return make_error(id, 400, "'range' must be [lo, hi] integers with lo <= hi");
+            lo = r[0].template get<long long>();
+            hi = r[1].template get<long long>();
+        } else {
+            k::MinMax mm = k::minmax(numbers.data, numbers.size);
+            lo = mm.min;
+            hi = mm.max;
+        }
+        std::pmr::vector<uint64_t> counts(bins, 0, nlohmann::pmr::current_resource());
+        k::histogram(numbers.data, numbers.size, lo, hi, counts.data(), bins);
+        json jcounts = json::array();
+        for (uint64_t c : counts) jcounts.push_back(c);
+        json hist = { {"lo", lo}, {"hi", hi} };
+        hist["counts"] = std::move(jcounts);
+        body["histogram"] = std::move(hist);
+    } else if (op == "cumsum") {
+        bool stream = payload.contains("stream") && payload["stream"].is_boolean() &&
+                      payload["stream"].template get<bool>();
+        ResultArray sums(body, "cumsum", stream);
+        int64_t acc = 0;
+        for (size_t i = 0; i < numbers.size; ++i) {
+            if (__builtin_add_overflow(acc, numbers.data[i], &acc)) return make_error(id, 400, "integer overflow in cumsum");
+            if (!sums.push(acc)) break; // already answered: the rest is dropped
+        }
+        sums.close();
+    } else {
+        return make_error(id, 422, "unsupported compute op");
+    }
+    return make_ok(id, std::move(body));
+}
+
+// Parse OMNIFLOW_PLUGIN_WORKERS: unset/0 = synchronous, "auto" = one per core
+static size_t configured_workers() {
+    const char *env = std::getenv("OMNIFLOW_PLUGIN_WORKERS");
+    if (!env || !*env) return 0;
+    if (std::strcmp(env, "auto") == 0) {
+        unsigned hc = std::thread::hardware_concurrency();
+        return std::min<size_t>(hc ? hc : 1, MAX_WORKERS);
+    }
+    try {
+        int v = std::stoi(env);
+        if (v > 0) return std::min<size_t>(static_cast<size_t>(v), MAX_WORKERS);
+    } catch (...) { /* ignore invalid */ }
+    return 0;
+}
+
+// Parse OMNIFLOW_PLUGIN_MAX_LINE (bytes, capped at 10 MiB)
+static size_t configured_max_line() {
+    const char *env = std::getenv("OMNIFLOW_PLUGIN_MAX_LINE");
+    if (!env || !*env) return DEFAULT_MAX_LINE;
+    try {
+        long v = std::stol(env);
+        if (v > 0) return std::min<size_t>(static_cast<size_t>(v), MAX_LINE_LIMIT);
+    } catch (...) { /* ignore invalid */ }
+    return DEFAULT_MAX_LINE;
+}
+
+// Parse OMNIFLOW_PLUGIN_TRANSPORT: unset/"ndjson" = text lines, "cbor" = binary
+static Transport configured_transport() {
+    const char *env = std::getenv("OMNIFLOW_PLUGIN_TRANSPORT");
+    if (!env || !*env || std::strcmp(env, "ndjson") == 0) return Transport::Ndjson;
+    if (std::strcmp(env, "cbor") == 0) return Transport::Cbor;
+    warn(std::string("unknown OMNIFLOW_PLUGIN_TRANSPORT '") + env + "', using ndjson");
+    return Transport::Ndjson;
+}
+
+// Parse OMNIFLOW_PLUGIN_SHM_MAX: unset/0 = payload_ref disabled
+static size_t configured_shm_max() {
+    const char *env = std::getenv("OMNIFLOW_PLUGIN_SHM_MAX");
+    if (!env || !*env) return 0;
+    try {
+        unsigned long long v = std::stoull(env);
+        return static_cast<size_t>(v);
+    } catch (...) { /* ignore invalid */ }
+    return 0;
+}
+
+// Parse OMNIFLOW_PLUGIN_FLUSH_US: unset/0 = flush every response
+static std::chrono::microseconds configured_flush_window() {
+    const char *env = std::getenv("OMNIFLOW_PLUGIN_FLUSH_US");
+    if (!env || !*env) return std::chrono::microseconds(0);
+    try {
+        long v = std::stol(env);
+        if (v > 0) return std::chrono::microseconds(std::min(v, MAX_FLUSH_US));
+    } catch (...) { /* ignore invalid */ }
+    return std::chrono::microseconds(0);
+}
+
+// Parse a count or size setting (OMNIFLOW_PLUGIN_QUEUE_MAX, _QUEUE_BYTES,
+// _CACHE_BYTES, _CHUNK_BYTES, _MAX_CLIENTS): a non-negative integer, or
+// `fallback` when unset/invalid. What 0 means is up to the caller.
+static size_t configured_size(const char *name, size_t fallback) {
+    const char *env = std::getenv(name);
+    if (!env || !*env) return fallback;
+    try {
+        unsigned long long v = std::stoull(env);
+        return static_cast<size_t>(v);
+    } catch (...) { /* ignore invalid */ }
+    return fallback;
+}
+
+// Parse an on/off switch (OMNIFLOW_PLUGIN_TIMINGS, OMNIFLOW_PLUGIN_METRICS_LOG,
+// OMNIFLOW_LOG_JSON, OMNIFLOW_PLUGIN_DEBUG):
+// "0", "false" or "off" = off, any other value = on, unset = `fallback`
+static bool configured_flag(const char *name, bool fallback) {
+    const char *env = std::getenv(name);
+    if (!env || !*env) return fallback;
+    return std::strcmp(env, "0") != 0 && std::strcmp(env, "false") != 0 && std::strcmp(env, "off") != 0;
+}
+
+// Parse OMNIFLOW_PLUGIN_CACHE_BYTES (unset/0 = no result cache) and
+// OMNIFLOW_PLUGIN_CACHE_TTL_MS (entry lifetime, default 60 s)
+static size_t configured_cache_bytes() { return configured_size("OMNIFLOW_PLUGIN_CACHE_BYTES", 0); }
+
+static std::chrono::milliseconds configured_cache_ttl() {
+    const char *env = std::getenv("OMNIFLOW_PLUGIN_CACHE_TTL_MS");
+    if (!env || !*env) return std::chrono::milliseconds(DEFAULT_CACHE_TTL_MS);
+    try {
+        long long v = std::stoll(env);
+        if (v > 0) return std::chrono::milliseconds(v);
+    } catch (...) { /* ignore invalid */ }
+    return std::chrono::milliseconds(DEFAULT_CACHE_TTL_MS);
+}
+
+// Parse OMNIFLOW_PLUGIN_CHUNK_BYTES: elements buffered per partial response of a
+// streamed result; unset/invalid/0 = the default
+static size_t configured_chunk_bytes() {
+    size_t v = configured_size("OMNIFLOW_PLUGIN_CHUNK_BYTES", DEFAULT_CHUNK_BYTES);
+    return v ? std::min(v, MAX_LINE_LIMIT) : DEFAULT_CHUNK_BYTES;
+}
+
+// Parse OMNIFLOW_PLUGIN_SOCKET_MODE: permissions of the socket file (octal,
+// e.g. 660 to let the owner's group connect); default 600
+static mode_t configured_socket_mode() {
+    const char *env = std::getenv("OMNIFLOW_PLUGIN_SOCKET_MODE");
+    if (!env || !*env) return 0600;
+    try {
+        unsigned long v = std::stoul(env, nullptr, 8);
+        if (v <= 0777) return static_cast<mode_t>(v);
+    } catch (...) { /* ignore invalid */ }
+    return 0600;
+}
+
+// Parse OMNIFLOW_EXEC_TIMEOUT (seconds, 1..3600); invalid values use the default
+static std::chrono::seconds configured_exec_timeout() {
+    const char *env = std::getenv("OMNIFLOW_EXEC_TIMEOUT");
+    if (!env || !*env) return std::chrono::seconds(DEFAULT_EXEC_TIMEOUT_SEC);
+    try {
+        int v = std::stoi(env);
+        if (v > 0 && v <= 3600) return std::chrono::seconds(v);
+    } catch (...) { /* ignore invalid */ }
+    return std::chrono::seconds(DEFAULT_EXEC_TIMEOUT_SEC);
+}
+
+// The registered action an inline exec payload names; nullptr if it names none
+template <typename Payload>
+static const ExecRegistry::Action *exec_action_of(const Payload &payload) {
+    if (!payload.is_object() || !payload.contains("action") || !payload["action"].is_string()) return nullptr;
+    return exec_actions.find(payload["action"].template get<std::string>());
+}
+
+// A request's deadline: its action's own timeout, else OMNIFLOW_EXEC_TIMEOUT
+static std::chrono::milliseconds exec_deadline(const ExecRegistry::Action *action) {
+    if (action && action->traits.timeout.count() > 0) return action->traits.timeout;
+    return exec_timeout;
+}
+
+// The memoization key of an NDJSON exec request: the canonical hash of its raw
+// payload, if the cache is on and the action is cacheable. canonical_hash()
+// gives no key to payloads with `*_ref` (shared memory) or duplicate members.
+static std::optional<uint64_t> exec_cache_key(std::string_view raw_payload, const ExecRegistry::Action *action) {
+    if (!result_cache || !action || !action->traits.cacheable) return std::nullopt;
+    return omniflow::canonical_hash(raw_payload);
+}
+
+// CBOR frames are decoded into a tree; the envelope fields are read from it.
+static omniflow::Envelope envelope_of(const json &msg) {
+    omniflow::Envelope env;
+    if (msg.contains("id") && msg["id"].is_string()) env.id = msg["id"].get<std::string>();
+    if (msg.contains("type") && msg["type"].is_string()) {
+        env.has_type = true;
+        env.type = omniflow::message_type(msg["type"].get<std::string_view>());
     }
+    return env;
+}
+
+// A top-level member as a tree: moved out of the decoded CBOR message, or
+// parsed from the raw span recorded by the envelope decoder. Null when absent.
+static json envelope_member(json &msg, const char *key, std::string_view raw) {
+    if (transport == Transport::Cbor) return msg.contains(key) ? std::move(msg[key]) : json();
+    return raw.empty() ? json() : json::parse(raw);
+}
+
+// Handle one request frame; returns false once the loop should stop (shutdown).
+// Runs under the reader's arena_scope, so every tree built here is arena-backed.
+static bool process_message(std::string_view frame, SteadyClock::time_point read_at) {
+    // Decode the envelope (JSON: one scan, no tree; CBOR: from the decoded tree)
+    const bool cbor = transport == Transport::Cbor;
+    omniflow::Envelope env;
+    json msg;
+    try {
+        if (cbor) {
+            msg = json::from_cbor(frame);
+            env = envelope_of(msg);
+        } else {
+            env = omniflow::decode_envelope(frame);
+        }
+    } catch (const std::exception &ex) {
+        warn(std::string(cbor ? "failed to parse CBOR: " : "failed to parse JSON: ") + ex.what());
+        respond_error("", 400, std::string(cbor ? "invalid CBOR: " : "invalid JSON: ") + ex.what());
+        return true;
+    }
+    const std::string &id = env.id;
+
+    // type required
+    if (!env.has_type) {
+        respond_error(id, 400, "missing 'type' field");
+        return true;
+    }
+    const omniflow::MessageType type = env.type;
+    metrics->add(static_cast<size_t>(type));
+    const bool takes_payload = type == omniflow::MessageType::Exec || type == omniflow::MessageType::Batch;
+    const bool reads_payload = takes_payload || type == omniflow::MessageType::Cancel;
+
+    // payload optional; exec and batch may instead reference it in shared memory.
+    // Only those (and cancel) read it: a CBOR payload is moved out of the decoded
+    // message, a JSON one is never parsed into a tree but read lazily from its
+    // raw span by the handler.
+    json payload;
+    std::string_view raw_payload = env.payload.empty() ? std::string_view("{}") : env.payload;
+    std::optional<omniflow::MappedPayload::Ref> ref;
+    bool ref_cbor = false;
+    try {
+        bool has_ref = cbor ? msg.contains("payload_ref") : !env.payload_ref.empty();
+        if (has_ref) {
+            if (shm_max == 0) {
+                respond_error(id, 400, "payload_ref not enabled (OMNIFLOW_PLUGIN_SHM_MAX unset)");
+                return true;
+            }
+            if (!takes_payload) {
+                respond_error(id, 400, "payload_ref is only supported for exec and batch");
+                return true;
+            }
+            ref = parse_payload_ref(envelope_member(msg, "payload_ref", env.payload_ref), ref_cbor);
+        }
+        if (cbor && reads_payload && !ref) {
+            payload = envelope_member(msg, "payload", env.payload);
+            if (payload.is_null()) payload = json::object();
+        }
+    } catch (const omniflow::ShmError &ex) {
+        respond_error(id, ex.code, ex.what());
+        return true;
+    } catch (const std::exception &ex) { // e.g. a payload_ref number out of double range
+        respond_error(id, 400, std::string("invalid JSON: ") + ex.what());
+        return true;
+    }
+    StageTimes times{read_at, SteadyClock::now(), type};
+    auto answer = [&](json r) {
+        StageNs ns;
+        respond(std::move(r), measure(times, times.parsed, ns));
+    };
+
+    switch (type) {
+    case omniflow::MessageType::Health: {
+        size_t depth = exec_pool ? exec_pool->pending() : 0;
+        StageNs ns;
+        const StageNs *stages = measure(times, times.parsed, ns);
+        if (!respond_template(HEALTH_RESPONSE, RESPONSES_OK, {id, depth}, stages)) respond(handle_health(id), stages);
+        break;
+    }
+    case omniflow::MessageType::Meta:
+        answer(handle_meta(id));
+        break;
+    case omniflow::MessageType::Metrics:
+        answer(make_ok(id, metrics_body()));
+        break;
+    case omniflow::MessageType::Exec:
+    case omniflow::MessageType::Batch: {
+        // The action of an inline exec payload is looked up here when its traits
+        // matter before the handler runs (deadline, memoization, pool lane);
+        // batch items and payload_ref payloads use OMNIFLOW_EXEC_TIMEOUT and
+        // the Bulk lane.
+        const ExecRegistry::Action *action = nullptr;
+        if (type == omniflow::MessageType::Exec && !ref) {
+            if (cbor) action = exec_action_of(payload);
+            else if (result_cache || action_timeouts || exec_pool)
+                action = exec_action_of(nlohmann::lazy_json(raw_payload));
+        }
+        const std::chrono::milliseconds deadline = exec_deadline(action);
+        // A repeated cacheable exec is answered here from its memoized text
+        std::optional<uint64_t> cache_key;
+        if (!cbor) {
+            cache_key = exec_cache_key(raw_payload, action);
+            if (cache_key) {
+                if (omniflow::ResultCache::Value hit = result_cache->lookup(*cache_key)) {
+                    count_action(action);
+                    if (debug_enabled) debug("exec id=" + id + " answered from cache");
+                    StageNs ns;
+                    respond_fragment(id, *hit, measure(times, times.parsed, ns));
+                    break;
+                }
+            }
+        }
+        if (exec_pool) {
+            auto job = ref    ? std::make_shared<ExecJob>(id, type, deadline, *ref, ref_cbor)
+                       : cbor ? std::make_shared<ExecJob>(id, type, deadline, payload)
+                              : std::make_shared<ExecJob>(id, type, deadline, raw_payload);
+            job->times = times;
+            job->cache_key = cache_key;
+            const auto lane = action && action->traits.kind == omniflow::ActionKind::Light
+                                  ? omniflow::WorkerPool::Lane::Control
+                                  : omniflow::WorkerPool::Lane::Bulk;
+            bool admitted = exec_pool->try_submit([job] {
+                nlohmann::pmr::arena_scope scope(&job->arena);
+                run_tracked(job->tracked, job->times, [&] {
+                    if (job->by_ref) return run_by_ref(job->id, job->type, job->ref, job->ref_cbor);
+                    if (job->lazy) return run_request(job->type, job->id, nlohmann::lazy_json(job->raw_payload));
+                    return run_request(job->type, job->id, job->payload);
+                }, job->cache_key);
+            }, frame.size(), lane);
+            if (!admitted) {
+                tracker->finish(job->tracked);
+                size_t depth = exec_pool->pending(lane);
+                long long retry = retry_after_ms(lane);
+                if (!respond_template(BUSY_RESPONSE, RESPONSES_BUSY, {id, depth, retry, depth}))
+                    respond(make_busy(id, depth, retry));
+            }
+        } else {
+            run_tracked(track(id, deadline), times, [&] {
+                if (ref) return run_by_ref(id, type, *ref, ref_cbor);
+                if (cbor) return run_request(type, id, payload);
+                return run_request(type, id, nlohmann::lazy_json(raw_payload));
+            }, cache_key);
+        }
+        break;
+    }
+    case omniflow::MessageType::Cancel:
+        if (cbor) answer(handle_cancel(id, payload));
+        else answer(handle_cancel(id, nlohmann::lazy_json(raw_payload)));
+        break;
+    case omniflow::MessageType::Shutdown:
+    case omniflow::MessageType::Quit:
+        // server mode: one host leaving must not stop the others' plugin. Its
+        // in-flight requests are still answered; the socket closes after them.
+        if (current_client) {
+            if (!respond_template(CLOSING_RESPONSE, RESPONSES_OK, {id})) respond_ok(id, { {"result", "closing"} });
+            return false;
+        }
+        // finish in-flight exec work so every id is answered before the ack
+        if (exec_pool) exec_pool->drain();
+        if (!respond_template(SHUTDOWN_RESPONSE, RESPONSES_OK, {id})) respond_ok(id, { {"result", "shutting_down"} });
+        // request shutdown and break loop after responding
+        shutdown_requested.store(true);
+        running.store(false);
+        return false;
+    default:
+        respond_error(id, 400, "unknown type");
+        break;
+    }
+    return true;
+}
+
+// Reader loop, shared by both transports: frames come from `framer` (stdin is
+// read with read(2) in large chunks; frames are views into its buffer).
+template <typename Framer>
+static void read_loop(Framer &framer, size_t max_line) {
+    // Per-message arena for the reader thread, reused across messages
+    alignas(std::max_align_t) static char arena_buf[ARENA_BYTES];
+    std::pmr::monotonic_buffer_resource arena(arena_buf, sizeof(arena_buf));
+
+    // Main loop: read messages from stdin
+    while (running.load()) {
+        // Nothing more to read right now: push out coalesced responses before blocking
+        if (out_writer->coalescing() && input_idle(framer)) {
+            reader_waiting.store(true);
+            out_writer->flush();
+        }
+        std::string_view frame;
+        auto status = framer.next(frame);
+        reader_waiting.store(false);
+        auto read_at = SteadyClock::now();
+        if (status == Framer::Status::Eof) {
+            // EOF; break and shutdown
+            info("stdin closed (EOF)");
+            break;
+        }
+        if (status == Framer::Status::Again) {
+            // stdin was inherited non-blocking: wait for it instead of spinning
+            struct pollfd pfd{STDIN_FILENO, POLLIN, 0};
+            ::poll(&pfd, 1, -1);
+            continue;
+        }
+        if (status == Framer::Status::Oversized) {
+            // rejected without buffering it; the id is unknown at this point
+            warn("incoming message exceeds max_line, rejected");
+            respond_error("", 101, "message exceeds OMNIFLOW_PLUGIN_MAX_LINE (" +
+                                   std::to_string(max_line) + " bytes)");
+            continue;
+        }
+        if (frame.empty()) continue;
+
+        // Every json built while handling the message lives in `arena`; the
+        // trees are gone when process_message() returns, so reset it in one go.
+        bool keep_going;
+        {
+            nlohmann::pmr::arena_scope scope(&arena);
+            keep_going = process_message(frame, read_at);
+        }
+        arena.release();
+        if (!keep_going) break;
+
+        // check if signal requested shutdown
+        if (shutdown_requested.load()) break;
+    }
+}
+
+// Server mode: the event loop hands over frames per client; each one is
+// handled exactly like a stdin frame, with that client as current_client.
+static void serve_socket(size_t max_line) {
+    alignas(std::max_align_t) static char arena_buf[ARENA_BYTES];
+    std::pmr::monotonic_buffer_resource arena(arena_buf, sizeof(arena_buf));
+    server->run(
+        [&arena](const omniflow::UnixServer::ConnectionPtr &client, std::string_view frame,
+                 SteadyClock::time_point read_at) {
+            current_client = client.get();
+            bool keep_going;
+            {
+                nlohmann::pmr::arena_scope scope(&arena);
+                keep_going = process_message(frame, read_at);
+            }
+            arena.release();
+            current_client = nullptr;
+            return keep_going;
+        },
+        [max_line](const omniflow::UnixServer::ConnectionPtr &client) {
+            current_client = client.get();
+            warn("incoming message exceeds max_line, rejected (client " + std::to_string(client->id()) + ")");
+            respond_error("", 101, "message exceeds OMNIFLOW_PLUGIN_MAX_LINE (" +
+                                   std::to_string(max_line) + " bytes)");
+            current_client = nullptr;
+        });
+}
+
+// In-process ABI (plugins/common/omniflow_plugin.h). The same sources built
+// as a shared library (BUILD_SHARED_LIBS=ON, `make shared`) let a trusted
+// host call exec payloads on its own threads: no reader, pool, tracker or
+// logger is started. Handlers see no deadline (the host owns the thread), and
+// the result cache is not used. Handles share the process-wide state, which
+// the first init sets up.
+struct omniflow_plugin {
+    uint32_t abi_version;
+};
+
+static std::once_flag abi_once;
+static bool abi_ready = false;
+
+// A result that did not fit the caller's buffer, kept for its retry
+struct AbiPending {
+    const omniflow_plugin *plugin = nullptr;
+    int status = 0;
+    std::string text;
+};
+static thread_local AbiPending abi_pending;
+
+static void abi_setup() {
+    try {
+        register_builtin_actions(false);
+        metrics = make_metrics();
+        exec_timeout = configured_exec_timeout();
+        shm_max = configured_shm_max();
+        abi_ready = true;
+    } catch (...) { /* abi_ready stays false: init fails */ }
+}
+
+static int abi_copy_out(const omniflow_plugin *plugin, int status, std::string text, char *out, size_t out_cap,
+                        size_t *out_len) {
+    *out_len = text.size();
+    if (text.size() > out_cap || (!out && !text.empty())) {
+        abi_pending = AbiPending{plugin, status, std::move(text)};
+        return OMNIFLOW_E_SPACE;
+    }
+    if (!text.empty()) std::memcpy(out, text.data(), text.size());
+    return status;
+}
+
+extern "C" uint32_t omniflow_plugin_abi_version(void) { return OMNIFLOW_PLUGIN_ABI_VERSION; }
+
+extern "C" int omniflow_plugin_init(uint32_t abi_version, const char *config, size_t config_len,
+                                    omniflow_plugin **out) {
+    if (!out) return OMNIFLOW_E_ARGS;
+    *out = nullptr;
+    if (abi_version != OMNIFLOW_PLUGIN_ABI_VERSION) return OMNIFLOW_E_VERSION;
+    // no settings are read from config yet (the environment applies, as on
+    // stdio), but it must be a JSON object when given
+    if (config && config_len > 0) {
+        try {
+            if (!nlohmann::lazy_json::parse(std::string_view(config, config_len)).is_object()) return OMNIFLOW_E_ARGS;
+        } catch (...) {
+            return OMNIFLOW_E_ARGS;
+        }
+    }
+    std::call_once(abi_once, abi_setup);
+    if (!abi_ready) return OMNIFLOW_E_INTERNAL;
+    *out = new (std::nothrow) omniflow_plugin{abi_version};
+    return *out ? OMNIFLOW_OK : OMNIFLOW_E_NOMEM;
+}
+
+extern "C" int omniflow_plugin_exec(omniflow_plugin *plugin, const char *payload, size_t payload_len, char *out,
+                                    size_t out_cap, size_t *out_len) {
+    if (!plugin || !out_len) return OMNIFLOW_E_ARGS;
+    if (!payload) {
+        // retry of a result that did not fit
+        if (abi_pending.plugin != plugin) return OMNIFLOW_E_ARGS;
+        AbiPending pending = std::move(abi_pending);
+        abi_pending = AbiPending{};
+        return abi_copy_out(plugin, pending.status, std::move(pending.text), out, out_cap, out_len);
+    }
+    abi_pending = AbiPending{};
+    alignas(std::max_align_t) char arena_buf[ARENA_BYTES / 4];
+    std::pmr::monotonic_buffer_resource arena(arena_buf, sizeof(arena_buf));
+    try {
+        nlohmann::pmr::arena_scope scope(&arena);
+        nlohmann::lazy_json view;
+        try {
+            view = nlohmann::lazy_json::parse(std::string_view(payload, payload_len));
+        } catch (const std::exception &ex) {
+            return abi_copy_out(plugin, 400, std::string("invalid JSON: ") + ex.what(), out, out_cap, out_len);
+        }
+        if (!view.is_object()) return abi_copy_out(plugin, 400, "payload must be an object", out, out_cap, out_len);
+        json r = run_exec("", view);
+        if (r["status"].get<std::string_view>() == "ok")
+            return abi_copy_out(plugin, OMNIFLOW_OK, r["body"].dump(), out, out_cap, out_len);
+        return abi_copy_out(plugin, r["code"].get<int>(), r["message"].get<std::string>(), out, out_cap, out_len);
+    } catch (const std::bad_alloc &) {
+        return OMNIFLOW_E_NOMEM;
+    } catch (...) {
+        return OMNIFLOW_E_INTERNAL;
+    }
+}
+
+extern "C" void omniflow_plugin_free(omniflow_plugin *plugin) {
+    if (abi_pending.plugin == plugin) abi_pending = AbiPending{};
+    delete plugin;
 }
 
 int main(int argc, char **argv) {
     (void)argc; (void)argv;
+    auto started_at = SteadyClock::now();
+
+    lean_mode = configured_flag("OMNIFLOW_PLUGIN_LEAN", false);
+    logger = std::make_unique<omniflow::AsyncLogger>(STDERR_FILENO, PLUGIN_NAME,
+                                                     configured_flag("OMNIFLOW_LOG_JSON", false),
+                                                     lean_mode ? LEAN_LOG_RING : DEFAULT_LOG_RING);
+    debug_enabled = configured_flag("OMNIFLOW_PLUGIN_DEBUG", false);
 
     // Install signal handlers
 #if defined(SIGINT)
@@ -216,86 +1855,116 @@ int main(int argc, char **argv) {
     std::signal(SIGTERM, handle_signal);
 #endif
 
-    // Start background worker
-    int hb = DEFAULT_HEARTBEAT_SEC;
+    // Start background worker (lean mode: with the first tracked request)
     if (const char *env = std::getenv("OMNIFLOW_PLUGIN_HEARTBEAT")) {
         try {
             int v = std::stoi(env);
-            if (v > 0 && v <= 3600) hb = v;
+            if (v > 0 && v <= 3600) heartbeat_sec = v;
         } catch (...) { /* ignore invalid */ }
     }
+    register_builtin_actions(configured_flag("OMNIFLOW_PLUGIN_TEST_ACTIONS", false));
+    metrics = make_metrics();
+    metrics_log = configured_flag("OMNIFLOW_PLUGIN_METRICS_LOG", false);
+    exec_timeout = configured_exec_timeout();
+    timings_enabled = configured_flag("OMNIFLOW_PLUGIN_TIMINGS", true);
+    tracker = std::make_unique<omniflow::RequestTracker>();
     running.store(true);
-    bg_thread = std::thread(background_worker, hb);
-
-    info(std::string("plugin initialized, version=") + PLUGIN_VERSION);
+    if (!lean_mode) ensure_background();
 
-    // Main loop: read newline-terminated JSON messages from stdin
-    while (running.load()) {
-        auto opt_line = safe_getline(std::cin);
-        if (!opt_line) {
-            // EOF; break and shutdown
-            info("stdin closed (EOF)");
-            break;
-        }
-        std::string line = std::move(*opt_line);
-        if (line.empty()) continue;
+    // Optional concurrent exec dispatch
+    size_t workers = configured_workers();
+    omniflow::WorkerPool::Limits limits;
+    limits.max_inflight = configured_size("OMNIFLOW_PLUGIN_QUEUE_MAX", DEFAULT_QUEUE_MAX);
+    limits.max_bytes = configured_size("OMNIFLOW_PLUGIN_QUEUE_BYTES", DEFAULT_QUEUE_BYTES);
+    if (workers > 0) exec_pool = std::make_unique<omniflow::WorkerPool>(workers, limits, lean_mode);
 
-        // Parse JSON safely
-        json msg;
-        try {
-            msg = json::parse(line);
-        } catch (const std::exception &ex) {
-            warn(std::string("failed to parse JSON: ") + ex.what());
-            respond_error("", 400, std::string("invalid JSON: ") + ex.what());
-            continue;
-        }
+    auto flush_window = configured_flush_window();
+    out_writer = std::make_unique<omniflow::CoalescingWriter>(STDOUT_FILENO, flush_window, FLUSH_BYTES);
 
-        // Extract id (optional)
-        std::string id = "";
-        if (msg.contains("id") && msg["id"].is_string()) id = msg["id"].get<std::string>();
+    transport = configured_transport();
+    shm_max = configured_shm_max();
+    size_t max_line = configured_max_line();
+    chunk_bytes = configured_chunk_bytes();
+    size_t cache_bytes = configured_cache_bytes();
+    if (cache_bytes > 0 && transport == Transport::Ndjson)
+        result_cache = std::make_unique<omniflow::ResultCache>(cache_bytes, configured_cache_ttl());
+    else if (cache_bytes > 0)
+        warn("OMNIFLOW_PLUGIN_CACHE_BYTES is ignored with the cbor transport");
 
-        // type required
-        if (!msg.contains("type") || !msg["type"].is_string()) {
-            respond_error(id, 400, "missing 'type' field");
-            continue;
+    // Optional server mode: listen on a Unix socket instead of stdin/stdout
+    int exit_code = 0;
+    const char *socket_path = std::getenv("OMNIFLOW_PLUGIN_SOCKET");
+    if (socket_path && *socket_path) {
+        if (transport != Transport::Ndjson) {
+            error_log("OMNIFLOW_PLUGIN_SOCKET requires the ndjson transport");
+            exit_code = 2;
+        } else {
+            server = std::make_unique<omniflow::UnixServer>(
+                socket_path, max_line,
+                configured_size("OMNIFLOW_PLUGIN_MAX_CLIENTS", omniflow::UnixServer::DEFAULT_MAX_CLIENTS),
+                flush_window, FLUSH_BYTES, configured_socket_mode(),
+                configured_size("OMNIFLOW_PLUGIN_CLIENT_QUEUE_BYTES", omniflow::UnixServer::DEFAULT_MAX_QUEUED));
+            try {
+                server->listen();
+            } catch (const std::system_error &ex) {
+                error_log(std::string("cannot listen: ") + ex.what());
+                server.reset();
+                exit_code = 1;
+            }
+#if defined(SIGPIPE)
+            std::signal(SIGPIPE, SIG_IGN); // a client hanging up must not kill the others
+#endif
         }
-        std::string type = msg["type"].get<std::string>();
+    }
 
-        // payload optional
-        json payload = json::object();
-        if (msg.contains("payload")) payload = msg["payload"];
+    info(std::string("plugin initialized, version=") + PLUGIN_VERSION +
+         ", max_line=" + std::to_string(max_line) +
+         ", transport=" + transport_name(transport) +
+         ", shm_max=" + std::to_string(shm_max) +
+         ", exec_workers=" + std::to_string(workers) +
+         (workers > 0 ? ", queue_max=" + std::to_string(limits.max_inflight) +
+                        ", queue_bytes=" + std::to_string(limits.max_bytes) : std::string()) +
+         ", exec_timeout=" + std::to_string(exec_timeout.count()) + "s" +
+         ", timings=" + (timings_enabled ? "on" : "off") +
+         ", flush_us=" + std::to_string(flush_window.count()) +
+         (result_cache ? ", cache_bytes=" + std::to_string(result_cache->max_bytes()) +
+                         ", cache_ttl_ms=" + std::to_string(result_cache->ttl().count()) : std::string()) +
+         (server ? ", socket=" + server->path() + ", max_clients=" + std::to_string(server->max_clients())
+                 : std::string()) +
+         (lean_mode ? ", lean=on" : ""));
 
-        if (type == "health") {
-            handle_health(id);
-        }
-        else if (type == "exec") {
-            // Consider delegating long-running tasks to worker threads and enforcing timeouts.
-            handle_exec(id, payload);
-        }
-        else if (type == "shutdown" || type == "quit") {
-            respond_ok(id, { {"result", "shutting_down"} });
-            // request shutdown and break loop after responding
-            shutdown_requested.store(true);
-            running.store(false);
-            break;
-        }
-        else {
-            respond_error(id, 400, "unknown type");
-        }
+    if (exit_code == 0 && configured_flag("OMNIFLOW_PLUGIN_READY", lean_mode)) announce_ready(started_at);
 
-        // check if signal requested shutdown
-        if (shutdown_requested.load()) break;
+    if (exit_code != 0) {
+        // configuration error: nothing to serve, tear down below
+    } else if (server) {
+        serve_socket(max_line); // until SIGINT/SIGTERM
+    } else if (transport == Transport::Cbor) {
+        omniflow::PrefixedFramer framer(STDIN_FILENO, max_line);
+        read_loop(framer, max_line);
+    } else {
+        omniflow::LineFramer framer(STDIN_FILENO, max_line);
+        read_loop(framer, max_line);
     }
+    if (received_signal) warn("received signal " + std::to_string(received_signal));
 
-    // Clean shutdown: join background thread with timeout
+    // Answer everything still queued (EOF or signal), then stop the workers.
+    // Drain before reset(): running jobs still read exec_pool in respond().
+    if (exec_pool) exec_pool->drain();
+    exec_pool.reset();
+
+    // Stop the background thread before the writer goes: it may answer timeouts.
+    running.store(false);
+    tracker->stop(); // wakes it from its heartbeat wait
     if (bg_thread.joinable()) {
-        // allow a short timeout for bg thread to finish
-        running.store(false);
         if (std::this_thread::get_id() != bg_thread.get_id()) {
             bg_thread.join();
         }
     }
+    server.reset();     // flushes and closes the clients, removes the socket file
+    out_writer.reset(); // flushes anything still buffered
 
     info("plugin exiting");
-    return 0;
+    logger->stop(); // writes out the ring; anything later (a late signal) is written in place
+    return exit_code;
 }
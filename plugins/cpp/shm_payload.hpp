@@ -0,0 +1,235 @@
+/*
+ * shm_payload.hpp
+ *
+ * Shared-memory payload channel for the OmniFlow C++ plugin (plugins/cpp)
+ * License: Apache-2.0
+ *
+ * Purpose:
+ *   - Lets the host pass a large exec payload out of band: it writes the encoded
+ *     payload into a POSIX shared-memory object (shm_open) or a memfd and sends
+ *     only a small `payload_ref` descriptor on stdin (see "Shared-memory
+ *     payloads" in plugins/common/protocol.md).
+ *   - The plugin maps a memfd's bytes read-only and parses them straight out
+ *     of the mapping: no pipe copies and no OMNIFLOW_PLUGIN_MAX_LINE limit.
+ *     The memfd must be sealed against shrinking and writes, so the mapping
+ *     can neither fault (SIGBUS after an ftruncate) nor change underneath the
+ *     parser. A named shm object cannot be sealed: it is copied with pread(2),
+ *     which only comes up short if the owner truncates it meanwhile.
+ *
+ * Contract:
+ *   - MappedPayload::map() validates the reference, maps it and returns the
+ *     mapping; it throws ShmError (carrying the protocol error code) when the
+ *     reference is invalid, the object cannot be opened or is too small, or the
+ *     range exceeds `max_bytes`.
+ *   - Only shm names ("/name") and memfds reachable through /proc/<pid>/fd/<n>
+ *     are accepted, never arbitrary file paths: what /proc/<pid>/fd/<n> opens
+ *     must be a memfd (F_GET_SEALS succeeds and it links to "/memfd:...")
+ *     carrying F_SEAL_SHRINK and F_SEAL_WRITE.
+ *   - With `peer_pid` set (server mode: the SO_PEERCRED pid of the connected
+ *     host), a memfd reference must name that pid, so one client cannot make
+ *     the plugin read another process's descriptors. Shm names are refused
+ *     there: any client could name another client's object.
+ *   - bytes() stays valid until the MappedPayload is destroyed (or moved from).
+ *   - Move-only; not synchronized (one owner at a time).
+ */
+
+#ifndef OMNIFLOW_PLUGIN_SHM_PAYLOAD_HPP
+#define OMNIFLOW_PLUGIN_SHM_PAYLOAD_HPP
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace omniflow {
+
+struct ShmError : std::runtime_error {
+    ShmError(int code_, const std::string &msg) : std::runtime_error(msg), code(code_) {}
+    int code; // protocol error code for the response (101 or 400)
+};
+
+class MappedPayload {
+public:
+    // Where the payload lives: either `shm` (a POSIX shm name) or `pid`/`fd`
+    // (a memfd of the host). length 0 means "to the end of the object".
+    struct Ref {
+        std::string shm;
+        long pid = -1;
+        int fd = -1;
+        uint64_t offset = 0;
+        uint64_t length = 0;
+    };
+
+    static MappedPayload map(const Ref &ref, size_t max_bytes, std::optional<long> peer_pid = std::nullopt) {
+        std::string path = resolve(ref);
+        if (peer_pid && !ref.shm.empty())
+            throw ShmError(400, "payload_ref shm names are not accepted on a socket connection (use a memfd)");
+        if (ref.shm.empty() && peer_pid && ref.pid != *peer_pid)
+            throw ShmError(400, "payload_ref pid is not the connected host's");
+        int fd = ref.shm.empty() ? ::open(path.c_str(), O_RDONLY | O_CLOEXEC)
+                                 : ::shm_open(path.c_str(), O_RDONLY, 0);
+        if (fd < 0) throw ShmError(400, "cannot open payload " + path + ": " + std::strerror(errno));
+        if (ref.shm.empty() && !is_memfd(fd)) {
+            ::close(fd);
+            throw ShmError(400, "payload " + path + " is not a memfd");
+        }
+        if (ref.shm.empty() && !is_sealed(fd)) {
+            ::close(fd);
+            throw ShmError(400, "payload memfd must be sealed with F_SEAL_SHRINK and F_SEAL_WRITE");
+        }
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            int err = errno;
+            ::close(fd);
+            throw ShmError(400, std::string("cannot stat payload: ") + std::strerror(err));
+        }
+        uint64_t size = static_cast<uint64_t>(st.st_size);
+        if (ref.offset > size) {
+            ::close(fd);
+            throw ShmError(400, "payload offset beyond end of segment");
+        }
+        uint64_t length = ref.length ? ref.length : size - ref.offset;
+        if (length > size - ref.offset) {
+            ::close(fd);
+            throw ShmError(400, "payload range beyond end of segment");
+        }
+        if (length > max_bytes) {
+            ::close(fd);
+            throw ShmError(101, "payload exceeds OMNIFLOW_PLUGIN_SHM_MAX (" + std::to_string(max_bytes) + " bytes)");
+        }
+
+        MappedPayload m;
+        if (length == 0) { ::close(fd); return m; }
+        if (!ref.shm.empty()) {
+            m.copy_.resize(static_cast<size_t>(length));
+            size_t got = 0;
+            while (got < m.copy_.size()) {
+                ssize_t n = ::pread(fd, &m.copy_[got], m.copy_.size() - got, static_cast<off_t>(ref.offset + got));
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) {
+                    int err = n < 0 ? errno : 0;
+                    ::close(fd);
+                    throw ShmError(400, err ? std::string("cannot read payload: ") + std::strerror(err)
+                                            : std::string("payload truncated while being read"));
+                }
+                got += static_cast<size_t>(n);
+            }
+            ::close(fd);
+            m.size_ = m.copy_.size();
+            return m;
+        }
+
+        // mmap offsets must be page aligned: map from the page holding `offset`
+        uint64_t page = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+        uint64_t base = ref.offset - ref.offset % page;
+        m.map_len_ = static_cast<size_t>(length + (ref.offset - base));
+        int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+        flags |= MAP_POPULATE; // the parser touches every byte anyway
+#endif
+        void *p = ::mmap(nullptr, m.map_len_, PROT_READ, flags, fd, static_cast<off_t>(base));
+        int err = errno;
+        ::close(fd); // the mapping keeps the object alive
+        if (p == MAP_FAILED) {
+            m.map_len_ = 0;
+            throw ShmError(400, std::string("cannot map payload: ") + std::strerror(err));
+        }
+        ::madvise(p, m.map_len_, MADV_SEQUENTIAL);
+        m.map_ = p;
+        m.data_ = static_cast<const char *>(p) + (ref.offset - base);
+        m.size_ = static_cast<size_t>(length);
+        return m;
+    }
+
+    MappedPayload() = default;
+    MappedPayload(MappedPayload &&o) noexcept { *this = std::move(o); }
+    MappedPayload &operator=(MappedPayload &&o) noexcept {
+        if (this != &o) {
+            unmap();
+            map_ = std::exchange(o.map_, nullptr);
+            map_len_ = std::exchange(o.map_len_, 0);
+            data_ = std::exchange(o.data_, nullptr);
+            size_ = std::exchange(o.size_, 0);
+            copy_ = std::move(o.copy_);
+            o.copy_.clear();
+        }
+        return *this;
+    }
+    MappedPayload(const MappedPayload &) = delete;
+    MappedPayload &operator=(const MappedPayload &) = delete;
+    ~MappedPayload() { unmap(); }
+
+    std::string_view bytes() const noexcept {
+        if (!data_) return std::string_view(copy_.data(), size_);
+        return std::string_view(data_, size_);
+    }
+
+private:
+    // Map a reference to the path to open, rejecting anything but shm names and
+    // /proc/<pid>/fd/<n> memfd links.
+    static std::string resolve(const Ref &ref) {
+        if (!ref.shm.empty()) {
+            if (ref.shm.size() < 2 || ref.shm.size() > 255 || ref.shm[0] != '/' ||
+                ref.shm.find('/', 1) != std::string::npos)
+                throw ShmError(400, "invalid shm name (expected \"/name\")");
+            return ref.shm;
+        }
+        if (ref.pid <= 0 || ref.fd < 0) throw ShmError(400, "payload_ref needs 'shm' or 'pid' and 'fd'");
+        return "/proc/" + std::to_string(ref.pid) + "/fd/" + std::to_string(ref.fd);
+    }
+
+    // Checked on the opened descriptor, so a link swapped after resolve() is
+    // caught too. Any tmpfs file answers F_GET_SEALS, so the link name
+    // ("/memfd:<name> (deleted)") has to match as well.
+    static bool is_memfd(int fd) noexcept {
+#ifdef F_GET_SEALS
+        if (::fcntl(fd, F_GET_SEALS) < 0) return false;
+#endif
+        static constexpr char PREFIX[] = "/memfd:";
+        char target[64];
+        char link[32];
+        std::snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+        ssize_t n = ::readlink(link, target, sizeof(target));
+        return n >= static_cast<ssize_t>(sizeof(PREFIX) - 1) && std::memcmp(target, PREFIX, sizeof(PREFIX) - 1) == 0;
+    }
+
+    // The seals that make a MAP_PRIVATE mapping safe to read for as long as
+    // it exists: the object can neither shrink nor be written.
+    static bool is_sealed(int fd) noexcept {
+#ifdef F_GET_SEALS
+        int seals = ::fcntl(fd, F_GET_SEALS);
+        return seals >= 0 && (seals & (F_SEAL_SHRINK | F_SEAL_WRITE)) == (F_SEAL_SHRINK | F_SEAL_WRITE);
+#else
+        (void)fd;
+        return false;
+#endif
+    }
+
+    void unmap() noexcept {
+        if (map_) ::munmap(map_, map_len_);
+        map_ = nullptr;
+        map_len_ = 0;
+    }
+
+    void *map_ = nullptr;
+    size_t map_len_ = 0;
+    const char *data_ = nullptr; // into map_; null for a copied payload
+    size_t size_ = 0;
+    std::string copy_; // a named shm object's bytes
+};
+
+} // namespace omniflow
+
+#endif // OMNIFLOW_PLUGIN_SHM_PAYLOAD_HPP
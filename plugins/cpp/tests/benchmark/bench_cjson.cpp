@@ -0,0 +1,158 @@
+// plugins/cpp/tests/benchmark/bench_cjson.cpp
+//
+// Microbenchmarks for the vendored cJSON used by the C plugin
+// (plugins/c/vendor/cJSON). Written with Google Benchmark and linked into the
+// same binary as bench_vendored_json.cpp, over the same corpus
+// (json_corpus.hpp), so results line up with the C++ parser's.
+//
+// Benchmarks are registered per corpus as cjson/<operation>/<corpus> with
+// bytes_per_second and allocs_per_msg (counted through cJSON_InitHooks).
+// The *_arena operations run the same loop in arena mode (cJSON_UseArena),
+// reset after every document the way the C plugin resets it per message;
+// their allocs_per_msg counts only what overflowed the arena.
+//
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "../../../c/vendor/cJSON/cJSON.h"
+}
+
+#include "json_corpus.hpp"
+
+namespace bench = omniflow::bench;
+
+namespace {
+
+void *counting_malloc(size_t n) {
+    bench::g_allocs.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(n);
+}
+
+void counting_free(void *p) { std::free(p); }
+
+void install_hooks() {
+    static bool installed = [] {
+        cJSON_Hooks hooks;
+        hooks.malloc_fn = counting_malloc;
+        hooks.free_fn = counting_free;
+        cJSON_InitHooks(&hooks);
+        return true;
+    }();
+    (void)installed;
+}
+
+constexpr size_t ARENA_BYTES = 1 << 20;
+
+// Arena mode for the duration of one benchmark (hooks stay the counting ones)
+struct ArenaScope {
+    ArenaScope() : buf(ARENA_BYTES) {
+        cJSON_InitArena(&arena, buf.data(), buf.size());
+        cJSON_UseArena(&arena);
+    }
+    ~ArenaScope() { cJSON_UseArena(nullptr); }
+    void reset() { cJSON_ArenaReset(&arena); }
+
+    std::vector<char> buf;
+    cJSON_Arena arena;
+};
+
+void parse_arena(benchmark::State &state, const bench::Corpus &corpus) {
+    install_hooks();
+    ArenaScope scope;
+    uint64_t allocs = 0;
+    for (auto _ : state) {
+        uint64_t before = bench::alloc_count();
+        for (const std::string &doc : corpus.docs) {
+            cJSON *root = cJSON_Parse(doc.c_str());
+            if (!root) {
+                state.SkipWithError("cJSON_Parse failed");
+                return;
+            }
+            benchmark::DoNotOptimize(root);
+            cJSON_Delete(root);
+            scope.reset();
+        }
+        allocs += bench::alloc_count() - before;
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * corpus.bytes));
+    state.counters["allocs_per_msg"] = benchmark::Counter(
+        static_cast<double>(allocs) / static_cast<double>(corpus.docs.size()), benchmark::Counter::kAvgIterations);
+}
+
+void parse(benchmark::State &state, const bench::Corpus &corpus) {
+    install_hooks();
+    uint64_t allocs = 0;
+    for (auto _ : state) {
+        uint64_t before = bench::alloc_count();
+        for (const std::string &doc : corpus.docs) {
+            cJSON *root = cJSON_Parse(doc.c_str());
+            if (!root) {
+                state.SkipWithError("cJSON_Parse failed");
+                return;
+            }
+            benchmark::DoNotOptimize(root);
+            cJSON_Delete(root);
+        }
+        allocs += bench::alloc_count() - before;
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * corpus.bytes));
+    state.counters["allocs_per_msg"] = benchmark::Counter(
+        static_cast<double>(allocs) / static_cast<double>(corpus.docs.size()), benchmark::Counter::kAvgIterations);
+}
+
+void print(benchmark::State &state, const bench::Corpus &corpus) {
+    install_hooks();
+    std::vector<cJSON *> trees;
+    size_t out_bytes = 0;
+    for (const std::string &doc : corpus.docs) {
+        cJSON *root = cJSON_Parse(doc.c_str());
+        char *text = root ? cJSON_PrintUnformatted(root) : nullptr;
+        if (!text) {
+            cJSON_Delete(root);
+            for (cJSON *t : trees) cJSON_Delete(t);
+            state.SkipWithError("cJSON parse/print failed");
+            return;
+        }
+        out_bytes += std::string(text).size();
+        counting_free(text);
+        trees.push_back(root);
+    }
+    uint64_t allocs = 0;
+    for (auto _ : state) {
+        uint64_t before = bench::alloc_count();
+        for (cJSON *root : trees) {
+            char *text = cJSON_PrintUnformatted(root);
+            benchmark::DoNotOptimize(text);
+            counting_free(text);
+        }
+        allocs += bench::alloc_count() - before;
+    }
+    for (cJSON *t : trees) cJSON_Delete(t);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * out_bytes));
+    state.counters["allocs_per_msg"] = benchmark::Counter(
+        static_cast<double>(allocs) / static_cast<double>(corpus.docs.size()), benchmark::Counter::kAvgIterations);
+}
+
+const std::vector<bench::Corpus> &corpora() {
+    static const std::vector<bench::Corpus> all = bench::corpora();
+    return all;
+}
+
+const bool registered = [] {
+    for (const bench::Corpus &c : corpora()) {
+        benchmark::RegisterBenchmark((std::string("cjson/parse/") + c.name).c_str(),
+                                     [&c](benchmark::State &state) { parse(state, c); });
+        benchmark::RegisterBenchmark((std::string("cjson/print/") + c.name).c_str(),
+                                     [&c](benchmark::State &state) { print(state, c); });
+        benchmark::RegisterBenchmark((std::string("cjson/parse_arena/") + c.name).c_str(),
+                                     [&c](benchmark::State &state) { parse_arena(state, c); });
+    }
+    return true;
+}();
+
+} // namespace
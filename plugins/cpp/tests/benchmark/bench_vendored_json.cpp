@@ -0,0 +1,153 @@
+// plugins/cpp/tests/benchmark/bench_vendored_json.cpp
+//
+// Microbenchmarks for the vendored JSON header used by the C++ plugin
+// (plugins/cpp/third_party/nlohmann/json.hpp) and for the envelope decoder
+// built on it (plugins/cpp/envelope.hpp). Written with Google Benchmark;
+// linked into one binary (omni_plugin_json_bench) with bench_cjson.cpp so the
+// libraries run the same corpus (json_corpus.hpp) side by side.
+//
+// Every benchmark is registered per corpus as <library>/<operation>/<corpus>
+// and reports:
+//  - bytes_per_second: input (parse) or output (dump) bytes, shown as MB/s
+//  - allocs_per_msg:   heap allocations per document, from the replaced
+//                      operator new below
+//
+// Run:      omni_plugin_json_bench --benchmark_min_time=0.2
+// Baseline: omni_plugin_json_bench --benchmark_out=new.json --benchmark_out_format=json
+//           python3 compare_bench.py json_baseline.json new.json
+//
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../../envelope.hpp"
+#include "json_corpus.hpp"
+
+namespace bench = omniflow::bench;
+
+// Count every heap allocation made by the process (benchmark bookkeeping
+// happens outside the timed loop, so per-iteration deltas are the library's).
+// GCC flags malloc/free pairs it sees through these replacements; they match.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void *operator new(std::size_t n) {
+    bench::g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void *operator new[](std::size_t n) { return ::operator new(n); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+// Runs `fn(doc)` over the whole corpus per iteration and sets the counters.
+template <typename Fn>
+void run_corpus(benchmark::State &state, const bench::Corpus &corpus, size_t bytes_per_pass, Fn &&fn) {
+    uint64_t allocs = 0;
+    for (auto _ : state) {
+        uint64_t before = bench::alloc_count();
+        for (const std::string &doc : corpus.docs) fn(doc);
+        allocs += bench::alloc_count() - before;
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes_per_pass));
+    state.counters["allocs_per_msg"] = benchmark::Counter(
+        static_cast<double>(allocs) / static_cast<double>(corpus.docs.size()), benchmark::Counter::kAvgIterations);
+}
+
+template <typename Json>
+void parse(benchmark::State &state, const bench::Corpus &corpus) {
+    run_corpus(state, corpus, corpus.bytes, [](const std::string &doc) {
+        Json j = Json::parse(doc);
+        benchmark::DoNotOptimize(j);
+    });
+}
+
+// What the plugin does per message: parse into a reused monotonic arena.
+void parse_arena(benchmark::State &state, const bench::Corpus &corpus) {
+    std::pmr::monotonic_buffer_resource arena(16 * 1024);
+    run_corpus(state, corpus, corpus.bytes, [&arena](const std::string &doc) {
+        {
+            nlohmann::pmr::arena_scope scope(&arena);
+            nlohmann::pmr::ordered_json j = nlohmann::pmr::ordered_json::parse(doc);
+            benchmark::DoNotOptimize(j);
+        }
+        arena.release();
+    });
+}
+
+void parse_view(benchmark::State &state, const bench::Corpus &corpus) {
+    run_corpus(state, corpus, corpus.bytes, [](const std::string &doc) {
+        nlohmann::json_view v = nlohmann::json::parse_view(doc);
+        benchmark::DoNotOptimize(v);
+    });
+}
+
+void decode_envelope(benchmark::State &state, const bench::Corpus &corpus) {
+    run_corpus(state, corpus, corpus.bytes, [](const std::string &doc) {
+        omniflow::Envelope env = omniflow::decode_envelope(doc);
+        benchmark::DoNotOptimize(env);
+    });
+}
+
+// Serialize pre-built trees into one reused buffer (as respond() does).
+template <typename Json>
+void dump(benchmark::State &state, const bench::Corpus &corpus) {
+    std::vector<Json> trees;
+    size_t out_bytes = 0;
+    for (const std::string &doc : corpus.docs) {
+        trees.push_back(Json::parse(doc));
+        out_bytes += trees.back().dump().size();
+    }
+    std::string out;
+    out.reserve(out_bytes);
+    uint64_t allocs = 0;
+    for (auto _ : state) {
+        uint64_t before = bench::alloc_count();
+        for (const Json &j : trees) {
+            out.clear();
+            j.dump_to(out);
+            benchmark::DoNotOptimize(out.data());
+        }
+        allocs += bench::alloc_count() - before;
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * out_bytes));
+    state.counters["allocs_per_msg"] = benchmark::Counter(
+        static_cast<double>(allocs) / static_cast<double>(trees.size()), benchmark::Counter::kAvgIterations);
+}
+
+const std::vector<bench::Corpus> &corpora() {
+    static const std::vector<bench::Corpus> all = bench::corpora();
+    return all;
+}
+
+template <typename Fn>
+void register_each(const char *name, Fn fn) {
+    for (const bench::Corpus &c : corpora()) {
+        benchmark::RegisterBenchmark((std::string(name) + "/" + c.name).c_str(),
+                                     [fn, &c](benchmark::State &state) { fn(state, c); });
+    }
+}
+
+const bool registered = [] {
+    register_each("nlohmann/parse", parse<nlohmann::json>);
+    register_each("nlohmann/parse_ordered", parse<nlohmann::ordered_json>);
+    register_each("nlohmann/parse_arena", parse_arena);
+    register_each("nlohmann/parse_view", parse_view);
+    register_each("nlohmann/dump", dump<nlohmann::ordered_json>);
+    const bench::Corpus &envelopes = corpora().front();
+    benchmark::RegisterBenchmark("envelope/decode/envelopes",
+                                 [&envelopes](benchmark::State &state) { decode_envelope(state, envelopes); });
+    return true;
+}();
+
+} // namespace
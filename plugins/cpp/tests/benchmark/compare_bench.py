@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+#
+# compare_bench.py
+#
+# Compares two Google Benchmark JSON outputs of omni_plugin_json_bench
+# (--benchmark_out=<file> --benchmark_out_format=json), usually the tracked
+# baseline (json_baseline.json) and a fresh run:
+#
+#   python3 compare_bench.py json_baseline.json new.json [--threshold 10]
+#
+# Prints MB/s and allocations per message side by side. Exits 1 when a
+# benchmark present in both lost more than --threshold percent of its
+# throughput or allocates more per message. Timings only compare on the
+# same machine; allocation counts compare anywhere.
+#
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path, encoding="utf-8") as f:
+        data = json.load(f)
+    out = {}
+    for b in data.get("benchmarks", []):
+        if b.get("run_type") == "aggregate" and b.get("aggregate_name") != "median":
+            continue
+        name = b.get("run_name", b["name"])
+        out[name] = (b.get("bytes_per_second", 0.0) / 1e6, b.get("allocs_per_msg", 0.0))
+    return out
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__)
+    ap.add_argument("baseline")
+    ap.add_argument("current")
+    ap.add_argument("--threshold", type=float, default=10.0, help="allowed throughput loss in percent")
+    args = ap.parse_args()
+
+    base, cur = load(args.baseline), load(args.current)
+    failed = []
+    print(f"{'benchmark':40} {'MB/s base':>10} {'MB/s now':>10} {'delta':>8} {'allocs base':>12} {'allocs now':>11}")
+    for name in sorted(set(base) | set(cur)):
+        if name not in base or name not in cur:
+            where = "baseline" if name in base else "current run"
+            print(f"{name:40} (only in {where})")
+            continue
+        (b_mbs, b_alloc), (c_mbs, c_alloc) = base[name], cur[name]
+        delta = (c_mbs - b_mbs) / b_mbs * 100.0 if b_mbs else 0.0
+        mark = ""
+        if delta < -args.threshold or c_alloc > b_alloc + 1e-6:
+            failed.append(name)
+            mark = "  <-- regression"
+        print(f"{name:40} {b_mbs:10.1f} {c_mbs:10.1f} {delta:+7.1f}% {b_alloc:12.2f} {c_alloc:11.2f}{mark}")
+
+    if failed:
+        print(f"\n{len(failed)} regression(s): {', '.join(failed)}", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
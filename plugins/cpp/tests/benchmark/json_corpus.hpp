@@ -0,0 +1,102 @@
+// plugins/cpp/tests/benchmark/json_corpus.hpp
+//
+// Shared inputs for the JSON microbenchmarks (bench_vendored_json.cpp,
+// bench_cjson.cpp): the same documents go through every parser so results
+// are comparable across libraries and across changes.
+//
+// Corpora:
+//  - envelopes: representative protocol messages and responses (health,
+//    exec, compute, batch, errors, meta) - many small documents
+//  - numbers:   one large array of integers and doubles (compute payloads)
+//  - escapes:   string-heavy objects full of \n, \", \\ and \u escapes
+//  - nesting:   objects/arrays nested 256 levels deep
+//
+// Allocation counting: the replaced operator new (bench_vendored_json.cpp)
+// and the cJSON malloc hook (bench_cjson.cpp) bump g_allocs.
+//
+
+#ifndef OMNIFLOW_PLUGIN_BENCH_JSON_CORPUS_HPP
+#define OMNIFLOW_PLUGIN_BENCH_JSON_CORPUS_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace omniflow::bench {
+
+inline std::atomic<uint64_t> g_allocs{0};
+
+inline uint64_t alloc_count() noexcept { return g_allocs.load(std::memory_order_relaxed); }
+
+struct Corpus {
+    const char *name;
+    std::vector<std::string> docs;
+    size_t bytes = 0;
+};
+
+inline std::vector<std::string> envelope_docs() {
+    return {
+        R"({"id":"h-1","type":"health"})",
+        R"({"id":"0b5f6c1e-7d2a-4c8e-9f3b-2a1d0e9c8b7a","type":"exec","payload":{"action":"echo","message":"hello, world"}})",
+        R"({"id":"r-17","type":"exec","payload":{"action":"reverse","message":"The quick brown fox jumps over the lazy dog"},"meta":{"trace_id":"4bf92f3577b34da6a3ce929d0e0e4736"}})",
+        R"({"id":"c-3","type":"exec","payload":{"action":"compute","op":"sum","numbers":[1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16]}})",
+        R"({"id":"b-9","type":"batch","payload":{"requests":[{"id":"b-9.1","type":"exec","payload":{"action":"echo","message":"a"}},{"id":"b-9.2","type":"exec","payload":{"action":"reverse","message":"bc"}},{"id":"b-9.3","type":"health"}]}})",
+        R"({"id":"h-1","status":"ok","body":{"status":"healthy","version":"1.0.0","queue_depth":0},"time":1791990867,"meta":{"parse_ns":1265,"queue_ns":0,"handler_ns":6878,"processing_time_ms":0.008}})",
+        R"({"id":"c-3","status":"ok","body":{"action":"compute","op":"sum","result":136},"time":1791990867})",
+        R"({"id":"x","status":"error","code":422,"message":"unsupported action","time":1791990867})",
+        R"({"id":"m","status":"ok","body":{"name":"OmniFlowCppSample","version":"1.0.0","exec_workers":4,"transport":"ndjson","transports":["ndjson","cbor"],"shm_max":0,"timings":true,"output":{"flush_us":200,"responses":2000,"writes":34,"responses_per_write":58.8}}})",
+    };
+}
+
+inline std::string numbers_doc(size_t count = 8192) {
+    std::mt19937_64 rng(7);
+    std::string s = R"({"id":"n","type":"exec","payload":{"action":"compute","numbers":[)";
+    for (size_t i = 0; i < count; ++i) {
+        if (i) s += ',';
+        if (i % 4 == 3) {
+            s += std::to_string(static_cast<double>(rng() % 2000000) / 1000.0 - 1000.0);
+        } else {
+            s += std::to_string(static_cast<int64_t>(rng() % 2000000000) - 1000000000);
+        }
+    }
+    return s + "]}}";
+}
+
+inline std::string escapes_doc(size_t fields = 64) {
+    std::string s = "{";
+    for (size_t i = 0; i < fields; ++i) {
+        if (i) s += ',';
+        s += "\"key\\t" + std::to_string(i) + "\":";
+        s += "\"line one\\nline \\\"two\\\"\\r\\n\\tpath C:\\\\tmp\\\\x caf\\u00e9 \\u65e5\\u672c "
+             "\\ud83d\\ude00 end\\/\\b\\f\"";
+    }
+    return s + "}";
+}
+
+inline std::string nesting_doc(size_t depth = 256) {
+    std::string s;
+    for (size_t i = 0; i < depth; ++i) s += (i % 2) ? "[" : "{\"k\":";
+    s += "null";
+    for (size_t i = depth; i-- > 0;) s += (i % 2) ? "]" : "}";
+    return s;
+}
+
+inline std::vector<Corpus> corpora() {
+    std::vector<Corpus> out = {
+        {"envelopes", envelope_docs()},
+        {"numbers", {numbers_doc()}},
+        {"escapes", {escapes_doc()}},
+        {"nesting", {nesting_doc()}},
+    };
+    for (Corpus &c : out) {
+        for (const std::string &d : c.docs) c.bytes += d.size();
+    }
+    return out;
+}
+
+} // namespace omniflow::bench
+
+#endif // OMNIFLOW_PLUGIN_BENCH_JSON_CORPUS_HPP
@@ -0,0 +1,445 @@
+// plugins/cpp/tests/benchmark/plugin_loadgen.cpp
+//
+// Load generator for the native OmniFlow sample plugins (plugins/cpp and
+// plugins/c). Starts a plugin binary with pipes for stdin/stdout, drives it
+// with NDJSON `exec` requests and prints a JSON report with throughput and
+// latency percentiles, which benchmarks/run_benchmarks.sh collects into
+// benchmarks/results/<timestamp>/.
+//
+// Build:  cmake --build build --target bench   (or: make bench)
+// Run:    omni_plugin_loadgen --plugin build/bin/omni_plugin_cpp --concurrency 32
+//             --size 256 --mix echo=2,reverse=1,compute=1 --out cpp.json
+//
+// Model:
+//  - One thread and poll(2): up to --concurrency requests are in flight at
+//    once (1 = strict request/response); a new one is sent as each response
+//    arrives. Responses are matched by id, so out-of-order answers (worker
+//    pools) are fine.
+//  - Latency is measured from handing a request line to the pipe until its
+//    response line is read, so it includes pipe time and any queueing in
+//    the plugin. The first --warmup requests are not measured.
+//  - Requests are `exec` with action echo/reverse (message padded to about
+//    --size bytes per line) or compute (a `numbers` array of that size).
+//
+// `ok`/`errors` in the report count measured requests. Exit status is 0 only
+// when every request, warmup included, got an `ok` response.
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string plugin;
+    std::string name;
+    std::string out;
+    size_t requests = 20000;
+    size_t warmup = 1000;
+    size_t concurrency = 1;
+    size_t size = 128;
+    int timeout_s = 30;
+    uint64_t seed = 1;
+    bool plugin_stderr = false;
+    std::vector<std::pair<std::string, unsigned>> mix = {{"echo", 1}, {"reverse", 1}, {"compute", 1}};
+    std::vector<std::string> env;
+    std::vector<std::string> args; // after `--`: passed to the plugin
+};
+
+void usage(const char *argv0) {
+    std::fprintf(stderr,
+                 "usage: %s --plugin PATH [options] [-- plugin args]\n"
+                 "  --name NAME          label in the report (default: plugin file name)\n"
+                 "  --requests N         measured requests (default 20000)\n"
+                 "  --warmup N           unmeasured requests sent first (default 1000)\n"
+                 "  --concurrency N      requests in flight (default 1)\n"
+                 "  --size BYTES         approximate request line size (default 128)\n"
+                 "  --mix A=W,...        action weights from echo, reverse, compute (default echo=1,reverse=1,compute=1)\n"
+                 "  --env KEY=VALUE      extra plugin environment (repeatable)\n"
+                 "  --timeout SECONDS    give up when no response arrives for this long (default 30)\n"
+                 "  --seed N             action-mix seed (default 1)\n"
+                 "  --stderr             keep the plugin's stderr (default: /dev/null)\n"
+                 "  --out FILE           write the JSON report to FILE (default: stdout)\n",
+                 argv0);
+}
+
+bool parse_size(const char *s, size_t &out) {
+    char *end = nullptr;
+    errno = 0;
+    unsigned long long v = std::strtoull(s, &end, 10);
+    if (errno != 0 || end == s || *end != '\0') return false;
+    out = static_cast<size_t>(v);
+    return true;
+}
+
+bool parse_mix(const std::string &spec, Options &o) {
+    o.mix.clear();
+    size_t at = 0;
+    while (at <= spec.size()) {
+        size_t comma = spec.find(',', at);
+        std::string item = spec.substr(at, comma == std::string::npos ? std::string::npos : comma - at);
+        size_t eq = item.find('=');
+        std::string action = item.substr(0, eq);
+        size_t weight = 1;
+        if (eq != std::string::npos && !parse_size(item.c_str() + eq + 1, weight)) return false;
+        if (action != "echo" && action != "reverse" && action != "compute") return false;
+        if (weight > 0) o.mix.emplace_back(action, static_cast<unsigned>(weight));
+        if (comma == std::string::npos) break;
+        at = comma + 1;
+    }
+    return !o.mix.empty();
+}
+
+bool parse_args(int argc, char **argv, Options &o) {
+    for (int i = 1; i < argc; ++i) {
+        std::string_view a = argv[i];
+        auto value = [&](const char *&v) {
+            if (i + 1 >= argc) return false;
+            v = argv[++i];
+            return true;
+        };
+        const char *v = nullptr;
+        if (a == "--") {
+            for (++i; i < argc; ++i) o.args.emplace_back(argv[i]);
+            break;
+        } else if (a == "--stderr") {
+            o.plugin_stderr = true;
+        } else if (a == "--plugin" && value(v)) {
+            o.plugin = v;
+        } else if (a == "--name" && value(v)) {
+            o.name = v;
+        } else if (a == "--out" && value(v)) {
+            o.out = v;
+        } else if (a == "--env" && value(v) && std::strchr(v, '=')) {
+            o.env.emplace_back(v);
+        } else if (a == "--mix" && value(v)) {
+            if (!parse_mix(v, o)) return false;
+        } else if (a == "--requests" && value(v)) {
+            if (!parse_size(v, o.requests) || o.requests == 0) return false;
+        } else if (a == "--warmup" && value(v)) {
+            if (!parse_size(v, o.warmup)) return false;
+        } else if (a == "--concurrency" && value(v)) {
+            if (!parse_size(v, o.concurrency) || o.concurrency == 0) return false;
+        } else if (a == "--size" && value(v)) {
+            if (!parse_size(v, o.size)) return false;
+        } else if (a == "--timeout" && value(v)) {
+            size_t t;
+            if (!parse_size(v, t) || t == 0) return false;
+            o.timeout_s = static_cast<int>(std::min<size_t>(t, 3600));
+        } else if (a == "--seed" && value(v)) {
+            size_t s;
+            if (!parse_size(v, s)) return false;
+            o.seed = s;
+        } else {
+            return false;
+        }
+    }
+    if (o.plugin.empty()) return false;
+    if (o.name.empty()) {
+        size_t slash = o.plugin.rfind('/');
+        o.name = slash == std::string::npos ? o.plugin : o.plugin.substr(slash + 1);
+    }
+    return true;
+}
+
+// `"payload":{...}` text per action, sized so a request line is about `size` bytes
+std::string make_payload(const std::string &action, size_t size) {
+    constexpr size_t ENVELOPE = 48; // {"id":"r123456","type":"exec","payload":...}\n
+    size_t room = size > ENVELOPE ? size - ENVELOPE : 0;
+    std::string p = "{\"action\":\"" + action + "\",";
+    if (action == "compute") {
+        p += "\"numbers\":[";
+        std::mt19937 rng(42);
+        bool first = true;
+        do {
+            if (!first) p += ',';
+            p += std::to_string(rng() % 1000);
+            first = false;
+        } while (p.size() + 2 < room);
+        p += "]}";
+    } else {
+        p += "\"message\":\"";
+        static const char ALPHABET[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+        size_t len = room > p.size() + 2 ? room - p.size() - 2 : 1;
+        for (size_t i = 0; i < len; ++i) p += ALPHABET[i % (sizeof(ALPHABET) - 1)];
+        p += "\"}";
+    }
+    return p;
+}
+
+struct Plugin {
+    pid_t pid = -1;
+    int in = -1;  // plugin's stdin (we write)
+    int out = -1; // plugin's stdout (we read)
+};
+
+bool spawn(const Options &o, Plugin &p) {
+    int to_child[2], from_child[2];
+    if (pipe(to_child) != 0) return false;
+    if (pipe(from_child) != 0) {
+        close(to_child[0]);
+        close(to_child[1]);
+        return false;
+    }
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        dup2(to_child[0], STDIN_FILENO);
+        dup2(from_child[1], STDOUT_FILENO);
+        if (!o.plugin_stderr) {
+            int devnull = open("/dev/null", O_WRONLY);
+            if (devnull >= 0) dup2(devnull, STDERR_FILENO);
+        }
+        close(to_child[0]);
+        close(to_child[1]);
+        close(from_child[0]);
+        close(from_child[1]);
+        for (const std::string &kv : o.env) putenv(const_cast<char *>(kv.c_str()));
+        std::vector<char *> argv;
+        argv.push_back(const_cast<char *>(o.plugin.c_str()));
+        for (const std::string &a : o.args) argv.push_back(const_cast<char *>(a.c_str()));
+        argv.push_back(nullptr);
+        execv(o.plugin.c_str(), argv.data());
+        std::fprintf(stderr, "exec %s: %s\n", o.plugin.c_str(), std::strerror(errno));
+        _exit(127);
+    }
+    close(to_child[0]);
+    close(from_child[1]);
+    p.pid = pid;
+    p.in = to_child[1];
+    p.out = from_child[0];
+    fcntl(p.in, F_SETFL, fcntl(p.in, F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+// Sequence number from a response line's `"id":"r<n>"`; false when absent
+bool response_seq(std::string_view line, size_t &seq) {
+    size_t at = line.find("\"id\":\"r");
+    if (at == std::string_view::npos) return false;
+    at += 7;
+    size_t n = 0;
+    bool any = false;
+    while (at < line.size() && line[at] >= '0' && line[at] <= '9') {
+        n = n * 10 + static_cast<size_t>(line[at++] - '0');
+        any = true;
+    }
+    if (!any || at >= line.size() || line[at] != '"') return false;
+    seq = n;
+    return true;
+}
+
+bool response_ok(std::string_view line) { return line.find("\"status\":\"ok\"") != std::string_view::npos; }
+
+struct Result {
+    size_t sent = 0, received = 0, unmatched = 0;
+    size_t ok = 0, errors = 0;       // measured requests
+    size_t warmup_errors = 0;
+    uint64_t request_bytes = 0;
+    bool timed_out = false;
+    Clock::time_point measured_from{}, measured_to{};
+    std::vector<uint64_t> latency_ns; // measured requests, in completion order
+};
+
+void run(const Options &o, Plugin &p, Result &r) {
+    std::vector<std::string> payloads;
+    std::vector<unsigned> weights;
+    for (const auto &m : o.mix) {
+        payloads.push_back(make_payload(m.first, o.size));
+        weights.push_back(m.second);
+    }
+    std::mt19937_64 rng(o.seed);
+    std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+
+    const size_t total = o.warmup + o.requests;
+    std::vector<Clock::time_point> sent_at(total);
+    std::vector<bool> answered(total);
+    r.latency_ns.reserve(o.requests);
+
+    std::string outbuf, inbuf;
+    size_t out_off = 0;
+    char chunk[64 * 1024];
+    auto last_progress = Clock::now();
+
+    while (r.received < total) {
+        // top up the window
+        while (r.sent < total && r.sent - r.received < o.concurrency) {
+            size_t seq = r.sent++;
+            size_t before = outbuf.size();
+            outbuf += "{\"id\":\"r";
+            outbuf += std::to_string(seq);
+            outbuf += "\",\"type\":\"exec\",\"payload\":";
+            outbuf += payloads[pick(rng)];
+            outbuf += "}\n";
+            if (seq >= o.warmup) r.request_bytes += outbuf.size() - before;
+            sent_at[seq] = Clock::now();
+            if (seq == o.warmup) r.measured_from = sent_at[seq];
+        }
+
+        pollfd fds[2] = {{p.out, POLLIN, 0}, {p.in, POLLOUT, 0}};
+        nfds_t nfds = out_off < outbuf.size() ? 2 : 1;
+        int rc = poll(fds, nfds, 100);
+        if (rc < 0 && errno != EINTR) break;
+
+        if (nfds == 2 && (fds[1].revents & (POLLOUT | POLLERR | POLLHUP))) {
+            ssize_t n = write(p.in, outbuf.data() + out_off, outbuf.size() - out_off);
+            if (n > 0) {
+                out_off += static_cast<size_t>(n);
+                if (out_off == outbuf.size()) {
+                    outbuf.clear();
+                    out_off = 0;
+                }
+            } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+                break; // plugin went away
+            }
+        }
+
+        if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            ssize_t n = read(p.out, chunk, sizeof(chunk));
+            if (n == 0) break; // plugin closed stdout
+            if (n > 0) {
+                inbuf.append(chunk, static_cast<size_t>(n));
+                auto now = Clock::now();
+                size_t start = 0, nl;
+                while ((nl = inbuf.find('\n', start)) != std::string::npos) {
+                    std::string_view line(inbuf.data() + start, nl - start);
+                    start = nl + 1;
+                    size_t seq;
+                    if (!response_seq(line, seq) || seq >= r.sent || answered[seq]) {
+                        ++r.unmatched;
+                        continue;
+                    }
+                    answered[seq] = true;
+                    ++r.received;
+                    bool ok = response_ok(line);
+                    if (seq < o.warmup) {
+                        if (!ok) ++r.warmup_errors;
+                    } else {
+                        ++(ok ? r.ok : r.errors);
+                        r.latency_ns.push_back(static_cast<uint64_t>(
+                            std::chrono::duration_cast<std::chrono::nanoseconds>(now - sent_at[seq]).count()));
+                        r.measured_to = now;
+                    }
+                }
+                inbuf.erase(0, start);
+                last_progress = now;
+            }
+        }
+
+        if (Clock::now() - last_progress > std::chrono::seconds(o.timeout_s)) {
+            r.timed_out = true;
+            break;
+        }
+    }
+}
+
+std::string json_string(const std::string &s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) continue;
+        out += c;
+    }
+    return out + "\"";
+}
+
+std::string report(const Options &o, Result &r, int exit_status) {
+    std::vector<uint64_t> &lat = r.latency_ns;
+    std::sort(lat.begin(), lat.end());
+    auto pct = [&](double q) -> double {
+        if (lat.empty()) return 0.0;
+        size_t rank = static_cast<size_t>(q * static_cast<double>(lat.size()) + 0.5);
+        rank = std::min(std::max<size_t>(rank, 1), lat.size());
+        return static_cast<double>(lat[rank - 1]) / 1000.0;
+    };
+    double sum = 0;
+    for (uint64_t v : lat) sum += static_cast<double>(v);
+    double elapsed_s = lat.empty() ? 0.0 : std::chrono::duration<double>(r.measured_to - r.measured_from).count();
+    size_t measured = lat.size();
+
+    std::string mix = "{";
+    for (size_t i = 0; i < o.mix.size(); ++i) {
+        if (i) mix += ',';
+        mix += json_string(o.mix[i].first) + ":" + std::to_string(o.mix[i].second);
+    }
+    mix += "}";
+    std::string env = "[";
+    for (size_t i = 0; i < o.env.size(); ++i) env += (i ? "," : "") + json_string(o.env[i]);
+    env += "]";
+
+    char buf[1024];
+    std::snprintf(buf, sizeof(buf),
+                  "\"requests\":%zu,\"warmup\":%zu,\"concurrency\":%zu,\"message_bytes\":%.1f,"
+                  "\"completed\":%zu,\"ok\":%zu,\"errors\":%zu,\"unmatched\":%zu,\"timed_out\":%s,\"exit_status\":%d,"
+                  "\"elapsed_s\":%.6f,\"throughput_rps\":%.1f,\"throughput_mb_s\":%.3f,"
+                  "\"latency_us\":{\"min\":%.1f,\"mean\":%.1f,\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f}",
+                  o.requests, o.warmup, o.concurrency,
+                  measured ? static_cast<double>(r.request_bytes) / static_cast<double>(o.requests) : 0.0, measured,
+                  r.ok, r.errors, r.unmatched, r.timed_out ? "true" : "false", exit_status, elapsed_s,
+                  elapsed_s > 0 ? static_cast<double>(measured) / elapsed_s : 0.0,
+                  elapsed_s > 0 ? static_cast<double>(r.request_bytes) / elapsed_s / 1e6 : 0.0,
+                  lat.empty() ? 0.0 : static_cast<double>(lat.front()) / 1000.0,
+                  measured ? sum / static_cast<double>(measured) / 1000.0 : 0.0, pct(0.50), pct(0.90), pct(0.99),
+                  pct(0.999), lat.empty() ? 0.0 : static_cast<double>(lat.back()) / 1000.0);
+    return "{\"plugin\":" + json_string(o.name) + ",\"binary\":" + json_string(o.plugin) + ",\"mix\":" + mix +
+           ",\"env\":" + env + "," + buf + "}\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options o;
+    if (!parse_args(argc, argv, o)) {
+        usage(argv[0]);
+        return 2;
+    }
+    signal(SIGPIPE, SIG_IGN); // a dying plugin must not kill the generator
+
+    Plugin p;
+    if (!spawn(o, p)) {
+        std::fprintf(stderr, "failed to start %s: %s\n", o.plugin.c_str(), std::strerror(errno));
+        return 1;
+    }
+    Result r;
+    run(o, p, r);
+
+    close(p.in); // EOF: the plugin drains and exits
+    int status = 0;
+    if (r.timed_out) kill(p.pid, SIGKILL);
+    waitpid(p.pid, &status, 0);
+    close(p.out);
+    int exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+
+    std::string json = report(o, r, exit_status);
+    if (o.out.empty()) {
+        std::fputs(json.c_str(), stdout);
+    } else {
+        FILE *f = std::fopen(o.out.c_str(), "w");
+        if (!f) {
+            std::fprintf(stderr, "cannot write %s: %s\n", o.out.c_str(), std::strerror(errno));
+            return 1;
+        }
+        std::fputs(json.c_str(), f);
+        std::fclose(f);
+    }
+    bool complete = r.received == o.warmup + o.requests && r.errors == 0 && r.warmup_errors == 0 && r.unmatched == 0;
+    return complete ? 0 : 1;
+}
@@ -0,0 +1,334 @@
+// plugins/cpp/tests/benchmark/plugin_startup.cpp
+//
+// Startup benchmark for the native OmniFlow sample plugins (plugins/cpp and
+// plugins/c). Starts a plugin binary --runs times, sends each process one
+// `health` request and closes its stdin, and prints a JSON report with the
+// time to the ready line, the time to the first response and the peak RSS of
+// the processes. For hosts that spawn a plugin per workflow run these decide
+// how densely plugins pack; plugin_loadgen.cpp covers the steady state.
+//
+// Build:  cmake --build build --target bench   (or: make bench)
+// Run:    omni_plugin_startup --plugin build/bin/omni_plugin_cpp --runs 200
+//             --env OMNIFLOW_PLUGIN_LEAN=on --wait-ready --out startup.json
+//
+// Model:
+//  - Times are measured from fork(2) until the line arrives on the plugin's
+//    stdout, so they include exec, dynamic linking and static initialization.
+//  - `ready_ms` is the time to the unsolicited `{"status":"ready",...}` line
+//    (see plugins/common/protocol.md); runs whose plugin sends none are not
+//    counted in it. `first_response_ms` is the time to the `health` answer.
+//  - By default the request is written right after fork(), as a host that
+//    does not wait would; with --wait-ready it is written once the ready line
+//    has arrived, so first_response_ms is what a handshaking host sees.
+//  - `peak_rss_kib` is ru_maxrss of each process, from wait4(2).
+//
+// Exit status is 0 only when every run answered `ok` and exited with 0.
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string plugin;
+    std::string name;
+    std::string out;
+    size_t runs = 100;
+    int timeout_s = 10;
+    bool wait_ready = false;
+    bool plugin_stderr = false;
+    std::vector<std::string> env;
+    std::vector<std::string> args; // after `--`: passed to the plugin
+};
+
+void usage(const char *argv0) {
+    std::fprintf(stderr,
+                 "usage: %s --plugin PATH [options] [-- plugin args]\n"
+                 "  --name NAME          label in the report (default: plugin file name)\n"
+                 "  --runs N             processes to start, one after another (default 100)\n"
+                 "  --wait-ready         send the request only after the ready line\n"
+                 "  --env KEY=VALUE      extra plugin environment (repeatable)\n"
+                 "  --timeout SECONDS    give up on a run after this long (default 10)\n"
+                 "  --stderr             keep the plugin's stderr (default: /dev/null)\n"
+                 "  --out FILE           write the JSON report to FILE (default: stdout)\n",
+                 argv0);
+}
+
+bool parse_size(const char *s, size_t &out) {
+    char *end = nullptr;
+    errno = 0;
+    unsigned long long v = std::strtoull(s, &end, 10);
+    if (errno != 0 || end == s || *end != '\0') return false;
+    out = static_cast<size_t>(v);
+    return true;
+}
+
+bool parse_args(int argc, char **argv, Options &o) {
+    for (int i = 1; i < argc; ++i) {
+        std::string_view a = argv[i];
+        auto value = [&](const char *&v) {
+            if (i + 1 >= argc) return false;
+            v = argv[++i];
+            return true;
+        };
+        const char *v = nullptr;
+        if (a == "--") {
+            for (++i; i < argc; ++i) o.args.emplace_back(argv[i]);
+            break;
+        } else if (a == "--stderr") {
+            o.plugin_stderr = true;
+        } else if (a == "--wait-ready") {
+            o.wait_ready = true;
+        } else if (a == "--plugin" && value(v)) {
+            o.plugin = v;
+        } else if (a == "--name" && value(v)) {
+            o.name = v;
+        } else if (a == "--out" && value(v)) {
+            o.out = v;
+        } else if (a == "--env" && value(v) && std::strchr(v, '=')) {
+            o.env.emplace_back(v);
+        } else if (a == "--runs" && value(v)) {
+            if (!parse_size(v, o.runs) || o.runs == 0) return false;
+        } else if (a == "--timeout" && value(v)) {
+            size_t t;
+            if (!parse_size(v, t) || t == 0) return false;
+            o.timeout_s = static_cast<int>(std::min<size_t>(t, 3600));
+        } else {
+            return false;
+        }
+    }
+    if (o.plugin.empty()) return false;
+    if (o.name.empty()) {
+        size_t slash = o.plugin.rfind('/');
+        o.name = slash == std::string::npos ? o.plugin : o.plugin.substr(slash + 1);
+    }
+    return true;
+}
+
+struct Plugin {
+    pid_t pid = -1;
+    int in = -1;  // plugin's stdin (we write)
+    int out = -1; // plugin's stdout (we read)
+};
+
+bool spawn(const Options &o, Plugin &p) {
+    int to_child[2], from_child[2];
+    if (pipe(to_child) != 0) return false;
+    if (pipe(from_child) != 0) {
+        close(to_child[0]);
+        close(to_child[1]);
+        return false;
+    }
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        dup2(to_child[0], STDIN_FILENO);
+        dup2(from_child[1], STDOUT_FILENO);
+        if (!o.plugin_stderr) {
+            int devnull = open("/dev/null", O_WRONLY);
+            if (devnull >= 0) dup2(devnull, STDERR_FILENO);
+        }
+        close(to_child[0]);
+        close(to_child[1]);
+        close(from_child[0]);
+        close(from_child[1]);
+        for (const std::string &kv : o.env) putenv(const_cast<char *>(kv.c_str()));
+        std::vector<char *> argv;
+        argv.push_back(const_cast<char *>(o.plugin.c_str()));
+        for (const std::string &a : o.args) argv.push_back(const_cast<char *>(a.c_str()));
+        argv.push_back(nullptr);
+        execv(o.plugin.c_str(), argv.data());
+        std::fprintf(stderr, "exec %s: %s\n", o.plugin.c_str(), std::strerror(errno));
+        _exit(127);
+    }
+    close(to_child[0]);
+    close(from_child[1]);
+    p.pid = pid;
+    p.in = to_child[1];
+    p.out = from_child[0];
+    return true;
+}
+
+constexpr std::string_view REQUEST = "{\"id\":\"startup\",\"type\":\"health\",\"payload\":{}}\n";
+
+struct Run {
+    double ready_ms = -1;          // < 0: no ready line
+    double first_response_ms = -1; // < 0: no answer
+    bool ok = false;
+    int exit_status = -1;
+    long peak_rss_kib = 0;
+};
+
+bool send_request(int fd) {
+    size_t off = 0;
+    while (off < REQUEST.size()) {
+        ssize_t n = write(fd, REQUEST.data() + off, REQUEST.size() - off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        off += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// One process: ready line (if any), then the health answer, then EOF and wait4
+Run run_once(const Options &o) {
+    Run r;
+    auto started = Clock::now();
+    Plugin p;
+    if (!spawn(o, p)) return r;
+    auto since = [&](Clock::time_point t) { return std::chrono::duration<double, std::milli>(t - started).count(); };
+
+    bool sent = !o.wait_ready && send_request(p.in);
+    std::string inbuf;
+    char chunk[4096];
+    auto deadline = started + std::chrono::seconds(o.timeout_s);
+    bool timed_out = false;
+    while (r.first_response_ms < 0) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+        if (left <= 0) {
+            timed_out = true;
+            break;
+        }
+        pollfd pfd{p.out, POLLIN, 0};
+        int rc = poll(&pfd, 1, static_cast<int>(left));
+        if (rc < 0 && errno != EINTR) break;
+        if (rc <= 0) continue;
+        ssize_t n = read(p.out, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break; // plugin closed stdout
+        auto now = Clock::now();
+        inbuf.append(chunk, static_cast<size_t>(n));
+        size_t start = 0, nl;
+        while ((nl = inbuf.find('\n', start)) != std::string::npos) {
+            std::string_view line(inbuf.data() + start, nl - start);
+            start = nl + 1;
+            if (line.find("\"id\":\"startup\"") != std::string_view::npos) {
+                r.first_response_ms = since(now);
+                r.ok = line.find("\"status\":\"ok\"") != std::string_view::npos;
+            } else if (r.ready_ms < 0 && line.find("\"status\":\"ready\"") != std::string_view::npos) {
+                r.ready_ms = since(now);
+                if (!sent) sent = send_request(p.in);
+            }
+        }
+        inbuf.erase(0, start);
+    }
+
+    close(p.in); // EOF: the plugin exits
+    if (timed_out) kill(p.pid, SIGKILL);
+    int status = 0;
+    rusage ru{};
+    while (wait4(p.pid, &status, 0, &ru) < 0 && errno == EINTR) {}
+    close(p.out);
+    r.exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    r.peak_rss_kib = ru.ru_maxrss; // KiB on Linux
+    return r;
+}
+
+std::string json_string(const std::string &s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) continue;
+        out += c;
+    }
+    return out + "\"";
+}
+
+// {"min","mean","p50","p90","p99","max"} of the values, or null when there are none
+std::string summary(std::vector<double> v, const char *fmt) {
+    if (v.empty()) return "null";
+    std::sort(v.begin(), v.end());
+    auto pct = [&](double q) {
+        size_t rank = static_cast<size_t>(q * static_cast<double>(v.size()) + 0.5);
+        rank = std::min(std::max<size_t>(rank, 1), v.size());
+        return v[rank - 1];
+    };
+    double sum = 0;
+    for (double x : v) sum += x;
+    const double values[] = {v.front(), sum / static_cast<double>(v.size()), pct(0.50), pct(0.90), pct(0.99), v.back()};
+    const char *keys[] = {"min", "mean", "p50", "p90", "p99", "max"};
+    std::string out = "{";
+    char buf[64];
+    for (size_t i = 0; i < 6; ++i) {
+        std::snprintf(buf, sizeof(buf), fmt, values[i]);
+        out += (i ? ",\"" : "\"") + std::string(keys[i]) + "\":" + buf;
+    }
+    return out + "}";
+}
+
+std::string report(const Options &o, const std::vector<Run> &runs) {
+    std::vector<double> ready, first, rss;
+    size_t ok = 0, failed = 0;
+    for (const Run &r : runs) {
+        if (r.ready_ms >= 0) ready.push_back(r.ready_ms);
+        if (r.first_response_ms >= 0) first.push_back(r.first_response_ms);
+        rss.push_back(static_cast<double>(r.peak_rss_kib));
+        if (r.ok && r.exit_status == 0) ++ok;
+        else ++failed;
+    }
+    std::string env = "[";
+    for (size_t i = 0; i < o.env.size(); ++i) env += (i ? "," : "") + json_string(o.env[i]);
+    env += "]";
+
+    char buf[256];
+    std::snprintf(buf, sizeof(buf), "\"runs\":%zu,\"wait_ready\":%s,\"ok\":%zu,\"failed\":%zu,\"ready_lines\":%zu,",
+                  o.runs, o.wait_ready ? "true" : "false", ok, failed, ready.size());
+    return "{\"plugin\":" + json_string(o.name) + ",\"binary\":" + json_string(o.plugin) + ",\"env\":" + env + "," +
+           buf + "\"ready_ms\":" + summary(ready, "%.3f") + ",\"first_response_ms\":" + summary(first, "%.3f") +
+           ",\"peak_rss_kib\":" + summary(rss, "%.0f") + "}\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options o;
+    if (!parse_args(argc, argv, o)) {
+        usage(argv[0]);
+        return 2;
+    }
+    signal(SIGPIPE, SIG_IGN); // a dying plugin must not kill the benchmark
+
+    std::vector<Run> runs;
+    runs.reserve(o.runs);
+    for (size_t i = 0; i < o.runs; ++i) {
+        runs.push_back(run_once(o));
+        if (runs.back().exit_status == 127) {
+            std::fprintf(stderr, "failed to start %s\n", o.plugin.c_str());
+            return 1;
+        }
+    }
+
+    std::string json = report(o, runs);
+    if (o.out.empty()) {
+        std::fputs(json.c_str(), stdout);
+    } else {
+        FILE *f = std::fopen(o.out.c_str(), "w");
+        if (!f) {
+            std::fprintf(stderr, "cannot write %s: %s\n", o.out.c_str(), std::strerror(errno));
+            return 1;
+        }
+        std::fputs(json.c_str(), f);
+        std::fclose(f);
+    }
+    bool complete = std::all_of(runs.begin(), runs.end(), [](const Run &r) { return r.ok && r.exit_status == 0; });
+    return complete ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+#!/usr/bin/env bash
+#
+# test_inprocess_abi.sh
+#
+# Integration tests for the in-process plugin ABI (plugins/common/omniflow_plugin.h)
+# - Builds libomni_plugin_cpp.so (`make shared`) and the example host
+#   (plugins/common/examples/inprocess_host.c) into a temp workspace
+# - Runs exec payloads through dlopen()ed calls and checks results and codes
+# - Tests: echo/reverse/compute, unsupported action (including `sleep`, which
+#   is not offered in-process), invalid payload, over-deep nesting, a result
+#   larger than the host's buffer (OMNIFLOW_E_SPACE and the retry)
+#
+# Requirements:
+#  - bash, make, g++ (or $CXX), cc (or $CC), libdl
+#
+# Usage:
+#   cd <repo-root>
+#   ./plugins/cpp/tests/integration/test_inprocess_abi.sh
+#
+set -euo pipefail
+
+REPO_ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/../../../.." && pwd)"
+PLUGIN_DIR="$REPO_ROOT/plugins/cpp"
+COMMON_DIR="$REPO_ROOT/plugins/common"
+TEST_DIR="$(mktemp -d)"
+trap 'rm -rf "$TEST_DIR"' EXIT
+
+fail() {
+  echo "FAIL: $*" >&2
+  exit 1
+}
+
+echo "=== Building libomni_plugin_cpp.so and the example host in $TEST_DIR ==="
+make -s -C "$PLUGIN_DIR" shared OUT_DIR="$TEST_DIR" >/dev/null
+"${CC:-cc}" -std=c11 -O2 -Wall -Wextra -I "$COMMON_DIR" -o "$TEST_DIR/inprocess_host" \
+  "$COMMON_DIR/examples/inprocess_host.c" -ldl
+LIB="$TEST_DIR/libomni_plugin_cpp.so"
+
+# expect <payload> <expected "<status> <result>" line>
+expect() {
+  local got
+  got="$(printf '%s\n' "$1" | "$TEST_DIR/inprocess_host" "$LIB")"
+  [[ "$got" == "$2" ]] || fail "payload $1: expected '$2', got '$got'"
+  echo "ok: ${1:0:60}"
+}
+
+expect '{"action":"echo","message":"hello"}' '0 {"action":"echo","message":"hello"}'
+expect '{"action":"reverse","message":"abc"}' '0 {"action":"reverse","message":"cba"}'
+expect '{"action":"compute","numbers":[1,2,3]}' '0 {"action":"compute","op":"sum","sum":6}'
+expect '{"action":"nope"}' '422 unsupported action'
+expect '{"message":"hi"}' "400 missing or invalid 'action' in payload"
+expect '[1,2]' '400 payload must be an object'
+expect '{"action":"sleep","ms":1}' '422 unsupported action'
+
+# nested far beyond the limit: refused, the host keeps running
+deep="$(head -c 60000 /dev/zero | tr '\0' '[')$(head -c 60000 /dev/zero | tr '\0' ']')"
+expect "{\"action\":\"echo\",\"x\":$deep}" '400 invalid JSON: JSON nesting too deep'
+
+# larger than the host's initial 256-byte buffer: served by the retry
+big="$(head -c 4000 /dev/zero | tr '\0' 'x')"
+expect "{\"action\":\"echo\",\"message\":\"$big\"}" "0 {\"action\":\"echo\",\"message\":\"$big\"}"
+
+# several payloads on one handle
+got="$(printf '%s\n' '{"action":"echo","message":"a"}' '{"action":"bad"}' '{"action":"echo","message":"b"}' \
+  | "$TEST_DIR/inprocess_host" "$LIB")"
+[[ "$got" == $'0 {"action":"echo","message":"a"}\n422 unsupported action\n0 {"action":"echo","message":"b"}' ]] \
+  || fail "sequence: got '$got'"
+echo "ok: sequence on one handle"
+
+echo "=== In-process ABI tests passed ==="
@@ -6,7 +6,8 @@
 # - Builds the plugin (CMake preferred, Makefile fallback)
 # - Runs the plugin in an isolated temp workspace using a FIFO for stdin
 # - Sends newline-delimited JSON requests and validates responses using jq
-# - Tests: health, exec (echo/reverse/compute), invalid JSON, oversized payload, unsupported action, graceful shutdown
+# - Tests: health, exec (echo/reverse/compute), invalid JSON, oversized payload, unsupported action (including the
+#   sleep test action when it is not enabled), graceful shutdown
 #
 # Requirements:
 #  - bash (or compatible), mkfifo, jq, timeout (coreutils), cmake or make, gcc/clang
@@ -19,13 +20,13 @@
 set -euo pipefail
 IFS=$'\n\t'
 
-REPO_ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/../../.." && pwd)"
+REPO_ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/../../../.." && pwd)"
 PLUGIN_DIR="$REPO_ROOT/plugins/cpp"
 TEST_DIR="$(mktemp -d)"
 FIFO_IN="$TEST_DIR/plugin.stdin.fifo"
 STDOUT_LOG="$TEST_DIR/plugin.stdout.log"
 STDERR_LOG="$TEST_DIR/plugin.stderr.log"
-BIN_PATH="$PLUGIN_DIR/build/omni_plugin_cpp"   # expected build path
+BIN_PATH="$PLUGIN_DIR/build/bin/omni_plugin_cpp"   # expected build path
 CMAKE_BUILD_DIR="$PLUGIN_DIR/build"
 BUILD_TIMEOUT=180
 RESP_POLL_INTERVAL=0.1
@@ -68,7 +69,7 @@ echo "=== Building C++ plugin in $PLUGIN_DIR ==="
 if [[ -f "$PLUGIN_DIR/CMakeLists.txt" ]]; then
   echo "Found CMakeLists.txt — using CMake build"
   mkdir -p "$CMAKE_BUILD_DIR"
-  (cd "$CMAKE_BUILD_DIR" && cmake .. -DCMAKE_BUILD_TYPE=Release) || fail "cmake configuration failed"
+  (cd "$CMAKE_BUILD_DIR" && cmake .. -DCMAKE_BUILD_TYPE=Release -DBUILD_TESTS=OFF) || fail "cmake configuration failed"
   (cd "$CMAKE_BUILD_DIR" && cmake --build . -- -j$(nproc)) || fail "cmake --build failed"
   # Try to discover binary if not at expected path
   if [[ ! -x "$BIN_PATH" ]]; then
@@ -109,6 +110,9 @@ mkfifo "$FIFO_IN"
 # Use stdbuf to disable buffering; plugin should flush stdout for real-time interaction
 bash -c "stdbuf -oL -eL '$BIN_PATH' < '$FIFO_IN' >> '$STDOUT_LOG' 2>> '$STDERR_LOG'" &
 PLUGIN_PID=$!
+# Hold a write end open so the plugin only sees EOF when the test ends
+# (every send_msg opens and closes the FIFO).
+exec 3>"$FIFO_IN"
 sleep 0.15  # give plugin a moment to initialize
 
 # Ensure plugin is still running initially
@@ -129,7 +133,7 @@ find_response_by_id() {
   local id="$1"
   # extract candidate JSON objects from stdout log (lines starting with { and ending with })
   # then filter via jq to select matching id
-  awk 'match($0,/^\s*{.*}\s*$/,m){ print m[0] }' "$STDOUT_LOG" 2>/dev/null \
+  grep -E '^[[:space:]]*\{.*\}[[:space:]]*$' "$STDOUT_LOG" 2>/dev/null \
     | jq -c --arg ID "$id" 'select(.id == $ID)' 2>/dev/null | head -n1 || true
 }
 
@@ -138,7 +142,7 @@ wait_for_response() {
   local id="$1"
   local timeout_sec="${2:-$RESP_WAIT_TIMEOUT}"
   local elapsed=0
-  while (( $(echo "$elapsed < $timeout_sec" | bc -l) )); do
+  while awk "BEGIN { exit !($elapsed < $timeout_sec) }"; do
     local resp
     resp="$(find_response_by_id "$id")"
     if [[ -n "$resp" ]]; then
@@ -182,13 +186,13 @@ sleep 0.2
 assert_response "health" "cpp-health-1" '{"id":"cpp-health-1","type":"health","payload":null}' '.status == "ok" and .body.status == "healthy"'
 
 # 2) exec echo
-assert_response "exec-echo" "cpp-echo-1" '{"id":"cpp-echo-1","type":"exec","payload":{"action":"echo","args":{"message":"hello cpp"}}}' '.status == "ok" and .body.action == "echo" and .body.message == "hello cpp"'
+assert_response "exec-echo" "cpp-echo-1" '{"id":"cpp-echo-1","type":"exec","payload":{"action":"echo","message":"hello cpp"}}' '.status == "ok" and .body.action == "echo" and .body.message == "hello cpp"'
 
 # 3) exec reverse (unicode test)
-assert_response "exec-reverse" "cpp-rev-1" '{"id":"cpp-rev-1","type":"exec","payload":{"action":"reverse","args":{"message":"Привет"}}}' '.status == "ok" and .body.action == "reverse" and .body.message == "тевирП"'
+assert_response "exec-reverse" "cpp-rev-1" '{"id":"cpp-rev-1","type":"exec","payload":{"action":"reverse","message":"Привет"}}' '.status == "ok" and .body.action == "reverse" and .body.message == "тевирП"'
 
 # 4) exec compute (sum)
-assert_response "exec-compute" "cpp-calc-1" '{"id":"cpp-calc-1","type":"exec","payload":{"action":"compute","args":{"numbers":[1,2,3,4.5]}}}' '.status == "ok" and .body.action == "compute" and (.body.sum | ( (. == 10.5) or (. == 10.5) ))'
+assert_response "exec-compute" "cpp-calc-1" '{"id":"cpp-calc-1","type":"exec","payload":{"action":"compute","numbers":[1,2,3,4]}}' '.status == "ok" and .body.action == "compute" and .body.sum == 10'
 
 # 5) invalid JSON — plugin should not crash (we don't assert specific response, only liveness)
 echo "=== Test: invalid-json ==="
@@ -204,7 +208,7 @@ fi
 echo "=== Test: oversized payload ==="
 LARGE_LEN=$((200 * 1024))
 LARGE_STR=$(head -c "$LARGE_LEN" < /dev/zero | tr '\0' 'A' | tr -d '\n')
-LARGE_JSON=$(printf '{"id":"cpp-large-1","type":"exec","payload":{"action":"echo","args":{"message":"%s"}}}' "$LARGE_STR")
+LARGE_JSON=$(printf '{"id":"cpp-large-1","type":"exec","payload":{"action":"echo","message":"%s"}}' "$LARGE_STR")
 ( printf '%s\n' "$LARGE_JSON" >> "$FIFO_IN" ) & writer=$!
 sleep 0.5
 if kill -0 "$writer" 2>/dev/null; then
@@ -220,7 +224,19 @@ fi
 # 7) unsupported action -> expect status:error (2xx range)
 assert_response "exec-unsupported" "cpp-unk-1" '{"id":"cpp-unk-1","type":"exec","payload":{"action":"does_not_exist"}}' '.status == "error"'
 
-# 8) graceful shutdown
+# 7b) the sleep test action is not registered without OMNIFLOW_PLUGIN_TEST_ACTIONS
+assert_response "exec-sleep-off" "cpp-sleep-1" '{"id":"cpp-sleep-1","type":"exec","payload":{"action":"sleep","ms":1}}' '.status == "error" and .code == 422'
+
+# 8) batch -> one response with a result per sub-request; a failed item does not fail the batch
+assert_response "batch" "cpp-batch-1" '{"id":"cpp-batch-1","type":"batch","payload":{"requests":[{"id":"cpp-batch-1.a","type":"health"},{"id":"cpp-batch-1.b","type":"exec","payload":{"action":"does_not_exist"}}]}}' '.status == "ok" and (.body.responses | length) == 2 and .body.responses[0].id == "cpp-batch-1.a" and .body.responses[0].status == "ok" and .body.responses[1].status == "error" and .body.failed == 1'
+
+# 8b) streamed exec result -> a result smaller than one chunk comes whole, with seq 0
+assert_response "exec-stream" "cpp-stream-1" '{"id":"cpp-stream-1","type":"exec","payload":{"action":"compute","op":"cumsum","numbers":[1,2,3],"stream":true}}' '.status == "ok" and .seq == 0 and .body.cumsum == [1,3,6]'
+
+# 9) meta -> output statistics (responses per write(2) call)
+assert_response "meta" "cpp-meta-1" '{"id":"cpp-meta-1","type":"meta"}' '.status == "ok" and .body.output.responses >= 1 and .body.output.responses_per_write >= 1'
+
+# 10) graceful shutdown
 echo "=== Test: shutdown ==="
 send_msg '{"id":"cpp-shutdown-1","type":"shutdown","payload":null}'
 # wait for ack (optional)
@@ -245,5 +261,16 @@ else
   echo "Plugin exited gracefully after shutdown (OK)"
 fi
 
+# 11) lean mode -> the first line is the unsolicited ready line, then requests are answered as usual
+echo "=== Test: lean-ready ==="
+LEAN_OUT="$(printf '%s\n' '{"id":"cpp-lean-1","type":"health"}' \
+  | OMNIFLOW_PLUGIN_LEAN=on timeout 5 "$BIN_PATH" 2>/dev/null)" || fail "lean-ready: plugin failed"
+echo "Output: $LEAN_OUT"
+echo "$LEAN_OUT" | head -n1 | jq -e '.status == "ready" and (has("id") | not) and .body.lean == true and .body.startup_us >= 0' >/dev/null \
+  || fail "lean-ready: first line is not the ready line"
+echo "$LEAN_OUT" | sed -n 2p | jq -e '.id == "cpp-lean-1" and .status == "ok"' >/dev/null \
+  || fail "lean-ready: no health answer after the ready line"
+echo "OK: lean-ready"
+
 echo "=== All tests passed for C++ plugin ==="
 exit 0
@@ -0,0 +1,80 @@
+// plugins/cpp/tests/unit/test_action_registry.cpp
+//
+// Unit tests for the exec action registry used by the C++ plugin
+// (plugins/cpp/action_registry.hpp). Written with Google Test and linked into
+// the same test binary as the other unit tests.
+//
+// The test suite checks:
+//  - registered actions are found by name with their handler and traits;
+//    unknown names (including prefixes) are not
+//  - indices follow registration order and survive table growth
+//  - empty and duplicate names are rejected
+//
+// Keep tests small, deterministic and safe to run inside CI.
+//
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+#include "../../action_registry.hpp"
+
+using omniflow::ActionKind;
+using omniflow::ActionRegistry;
+using omniflow::ActionTraits;
+using namespace std::chrono_literals;
+
+namespace {
+
+using Handler = int (*)(int);
+
+int twice(int v) { return 2 * v; }
+int negate(int v) { return -v; }
+
+} // namespace
+
+TEST(ActionRegistry, FindsActionsWithTheirTraits) {
+    ActionRegistry<Handler> r;
+    EXPECT_EQ(r.find("echo"), nullptr); // empty registry
+    r.register_action("twice", twice, {true, ActionKind::Cpu, 0ms});
+    r.register_action("negate", negate, {false, ActionKind::Io, 250ms});
+
+    const auto *a = r.find("negate");
+    ASSERT_NE(a, nullptr);
+    EXPECT_EQ(a->name, "negate");
+    EXPECT_EQ(a->handler(3), -3);
+    EXPECT_FALSE(a->traits.cacheable);
+    EXPECT_EQ(a->traits.kind, ActionKind::Io);
+    EXPECT_EQ(a->traits.timeout, 250ms);
+    EXPECT_EQ(r.find("twice")->handler(4), 8);
+    EXPECT_TRUE(r.find("twice")->traits.cacheable);
+
+    EXPECT_EQ(r.find("twic"), nullptr);
+    EXPECT_EQ(r.find("twicex"), nullptr);
+    EXPECT_EQ(r.find(""), nullptr);
+}
+
+TEST(ActionRegistry, IndicesFollowRegistrationOrderAcrossGrowth) {
+    ActionRegistry<Handler> r;
+    const auto *first = &(r.at(r.register_action("action0", twice)));
+    for (int i = 1; i < 100; ++i) EXPECT_EQ(r.register_action("action" + std::to_string(i), twice), size_t(i));
+    ASSERT_EQ(r.size(), 100u);
+    for (int i = 0; i < 100; ++i) {
+        const auto *a = r.find("action" + std::to_string(i));
+        ASSERT_NE(a, nullptr);
+        EXPECT_EQ(a->index, size_t(i));
+        EXPECT_EQ(&r.at(a->index), a);
+    }
+    EXPECT_EQ(r.find("action0"), first); // not moved by rehashing
+    EXPECT_EQ(r.find("action100"), nullptr);
+}
+
+TEST(ActionRegistry, RejectsEmptyAndDuplicateNames) {
+    ActionRegistry<Handler> r;
+    r.register_action("twice", twice);
+    EXPECT_THROW(r.register_action("twice", negate), std::invalid_argument);
+    EXPECT_THROW(r.register_action("", negate), std::invalid_argument);
+    EXPECT_EQ(r.size(), 1u);
+    EXPECT_EQ(r.find("twice")->handler(1), 2); // the first registration stands
+}
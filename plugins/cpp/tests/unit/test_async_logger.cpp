@@ -0,0 +1,218 @@
+// plugins/cpp/tests/unit/test_async_logger.cpp
+//
+// Unit tests for the asynchronous stderr logger used by the C++ plugin
+// (plugins/cpp/async_logger.hpp). Written with Google Test and linked into the
+// same test binary as the other unit tests.
+//
+// The test suite checks:
+//  - the MPSC ring refuses pushes when full and hands records out in order,
+//    and records pushed from several threads all arrive exactly once
+//  - text and JSON (OMNIFLOW_LOG_JSON) line formats, including escaping and
+//    raw lines
+//  - stop() writes out everything logged before it, and every record accepted
+//    by a log() call racing stop()
+//  - a record logged while the writer sleeps wakes it (no wait for the
+//    100 ms backstop timeout)
+//
+// Keep tests small, deterministic and safe to run inside CI.
+//
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include "../../async_logger.hpp"
+
+using omniflow::AsyncLogger;
+using omniflow::MpscRing;
+
+namespace {
+
+// Everything written to the read end of `fd` until EOF
+std::string read_all(int fd) {
+    std::string out;
+    char buf[4096];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof(buf))) > 0) out.append(buf, static_cast<size_t>(n));
+    return out;
+}
+
+std::vector<std::string> lines_of(const std::string &s) {
+    std::vector<std::string> out;
+    std::istringstream in(s);
+    for (std::string line; std::getline(in, line);) out.push_back(line);
+    return out;
+}
+
+} // namespace
+
+TEST(AsyncLogger, RingBoundsAndOrder) {
+    MpscRing<int> ring(3); // rounded up to 4
+    EXPECT_EQ(ring.capacity(), 4u);
+    for (int i = 0; i < 4; ++i) {
+        int v = i;
+        EXPECT_TRUE(ring.try_push(v));
+    }
+    int extra = 9;
+    EXPECT_FALSE(ring.try_push(extra));
+    EXPECT_EQ(extra, 9);
+    int out = -1;
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(ring.try_pop(out));
+        EXPECT_EQ(out, i);
+    }
+    EXPECT_FALSE(ring.try_pop(out));
+    EXPECT_TRUE(ring.try_push(extra)); // slots are reused
+    ASSERT_TRUE(ring.try_pop(out));
+    EXPECT_EQ(out, 9);
+}
+
+TEST(AsyncLogger, RingManyProducers) {
+    MpscRing<int> ring(64);
+    constexpr int PER_THREAD = 2000;
+    std::vector<std::thread> producers;
+    for (int t = 0; t < 4; ++t) {
+        producers.emplace_back([&ring, t] {
+            for (int i = 0; i < PER_THREAD; ++i) {
+                int v = t * PER_THREAD + i;
+                while (!ring.try_push(v)) std::this_thread::yield();
+            }
+        });
+    }
+    std::vector<int> last(4, -1);
+    std::vector<bool> seen(4 * PER_THREAD);
+    int v;
+    for (int got = 0; got < 4 * PER_THREAD;) {
+        if (!ring.try_pop(v)) continue;
+        ++got;
+        EXPECT_FALSE(seen[v]) << v;
+        seen[v] = true;
+        int t = v / PER_THREAD;
+        EXPECT_GT(v, last[t]); // per-producer order is kept
+        last[t] = v;
+    }
+    for (auto &p : producers) p.join();
+    EXPECT_FALSE(ring.try_pop(v));
+}
+
+TEST(AsyncLogger, TextAndJsonLines) {
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+    {
+        AsyncLogger text(fds[1], "Plug", false);
+        EXPECT_TRUE(text.log(AsyncLogger::Level::Info, "hello"));
+        text.stop();
+        AsyncLogger js(fds[1], "Plug", true);
+        EXPECT_TRUE(js.log(AsyncLogger::Level::Warn, "say \"hi\"\n\x01"));
+        EXPECT_TRUE(js.raw("{\"heartbeat\":1}"));
+    }
+    ::close(fds[1]);
+    std::vector<std::string> lines = lines_of(read_all(fds[0]));
+    ::close(fds[0]);
+    ASSERT_EQ(lines.size(), 3u);
+
+    // [2025-12-02T00:00:00Z] [INFO] Plug: hello
+    ASSERT_EQ(lines[0].size(), std::string("[2025-12-02T00:00:00Z] [INFO] Plug: hello").size()) << lines[0];
+    EXPECT_EQ(lines[0].front(), '[');
+    EXPECT_EQ(lines[0].substr(21), "] [INFO] Plug: hello");
+
+    const std::string &j = lines[1];
+    EXPECT_EQ(j.rfind("{\"ts\":\"", 0), 0u) << j;
+    EXPECT_NE(j.find("Z\",\"level\":\"warn\",\"plugin\":\"Plug\",\"msg\":\"say \\\"hi\\\"\\n\\u0001\"}"),
+              std::string::npos) << j;
+    EXPECT_EQ(lines[2], "{\"heartbeat\":1}");
+}
+
+TEST(AsyncLogger, StopWritesEverything) {
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+    std::string out;
+    std::thread reader([&] { out = read_all(fds[0]); }); // keeps the pipe from filling
+    uint64_t dropped;
+    {
+        AsyncLogger log(fds[1], "p", false, 1024);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&log, t] {
+                for (int i = 0; i < 200; ++i) log.log(AsyncLogger::Level::Info, std::to_string(t * 1000 + i));
+            });
+        }
+        for (auto &th : threads) th.join();
+        log.stop();
+        dropped = log.dropped();
+        EXPECT_TRUE(log.log(AsyncLogger::Level::Error, "after stop")); // written in place
+    }
+    ::close(fds[1]);
+    reader.join();
+    ::close(fds[0]);
+    std::vector<std::string> lines = lines_of(out);
+    size_t records = static_cast<size_t>(std::count_if(lines.begin(), lines.end(), [](const std::string &l) {
+        return l.find("] [INFO] p: ") != std::string::npos;
+    }));
+    EXPECT_EQ(records + dropped, 800u);
+    ASSERT_FALSE(lines.empty());
+    EXPECT_NE(lines.back().find("[ERROR] p: after stop"), std::string::npos);
+}
+
+TEST(AsyncLogger, LogRacingStopIsNotLost) {
+    for (int round = 0; round < 20; ++round) {
+        int fds[2];
+        ASSERT_EQ(::pipe(fds), 0);
+        std::string out;
+        std::thread reader([&] { out = read_all(fds[0]); });
+        std::atomic<size_t> accepted{0};
+        {
+            AsyncLogger log(fds[1], "p", false, 1 << 16);
+            std::atomic<bool> go{false};
+            std::vector<std::thread> threads;
+            for (int t = 0; t < 4; ++t) {
+                threads.emplace_back([&] {
+                    while (!go.load()) std::this_thread::yield();
+                    for (int i = 0; i < 500; ++i)
+                        if (log.log(AsyncLogger::Level::Info, "r")) accepted.fetch_add(1);
+                });
+            }
+            go.store(true);
+            log.stop();
+            for (auto &th : threads) th.join();
+        }
+        ::close(fds[1]);
+        reader.join();
+        ::close(fds[0]);
+        std::vector<std::string> lines = lines_of(out);
+        size_t records = static_cast<size_t>(std::count_if(lines.begin(), lines.end(), [](const std::string &l) {
+            return l.find("] [INFO] p: r") != std::string::npos;
+        }));
+        ASSERT_EQ(records, accepted.load()) << "round " << round;
+    }
+}
+
+TEST(AsyncLogger, LogWakesSleepingWriter) {
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+    AsyncLogger log(fds[1], "p", false);
+    // Each record is logged after the writer has gone to sleep; a lost
+    // wakeup would hold it for the rest of the 100 ms timeout.
+    auto start = std::chrono::steady_clock::now();
+    char buf[256];
+    for (int i = 0; i < 10; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ASSERT_TRUE(log.log(AsyncLogger::Level::Info, "tick"));
+        pollfd p{fds[0], POLLIN, 0};
+        ASSERT_EQ(::poll(&p, 1, 1000), 1);
+        ASSERT_GT(::read(fds[0], buf, sizeof(buf)), 0);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_LT(elapsed, std::chrono::milliseconds(700));
+    log.stop();
+    ::close(fds[1]);
+    ::close(fds[0]);
+}
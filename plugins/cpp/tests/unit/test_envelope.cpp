@@ -0,0 +1,92 @@
+// plugins/cpp/tests/unit/test_envelope.cpp
+//
+// Unit tests for the typed envelope decoder used by the C++ plugin
+// (plugins/cpp/envelope.hpp). Written with Google Test and linked into the
+// same test binary as the other unit tests.
+//
+// The test suite checks:
+//  - id, type and the raw payload / payload_ref spans are captured in one
+//    scan, in any key order, with escapes decoded and first-key-wins
+//  - the perfect-hash type lookup recognizes every protocol type and nothing
+//    else
+//  - malformed JSON anywhere in the frame (including members that are only
+//    skipped) is rejected like json::parse does
+//  - nesting beyond json_max_depth is rejected instead of exhausting the
+//    stack, in skipped members and at the top level alike
+//
+// Keep tests small, deterministic and safe to run inside CI.
+//
+
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "../../envelope.hpp"
+
+using omniflow::decode_envelope;
+using omniflow::Envelope;
+using omniflow::MessageType;
+
+TEST(Envelope, CapturesFieldsAndRawPayload) {
+    Envelope e = decode_envelope(R"( {"payload" : {"action":"echo","n":[1,{"a":"}"}]}, "x":[true,null],)"
+                                 R"("type":"exec","id":"req-1","payload_ref":{"shm":"/p"}} )");
+    EXPECT_EQ(e.id, "req-1");
+    EXPECT_TRUE(e.has_type);
+    EXPECT_EQ(e.type, MessageType::Exec);
+    EXPECT_EQ(e.payload, R"({"action":"echo","n":[1,{"a":"}"}]})");
+    EXPECT_EQ(e.payload_ref, R"({"shm":"/p"})");
+    EXPECT_EQ(nlohmann::json::parse(e.payload)["action"].get<std::string>(), "echo");
+}
+
+TEST(Envelope, DecodesEscapesAndKeepsFirstKey) {
+    Envelope e = decode_envelope(R"({"id":"a\"b","type":"health","id":"second","type":"exec"})");
+    EXPECT_EQ(e.id, "a\"b");
+    EXPECT_EQ(e.type, MessageType::Health);
+    EXPECT_TRUE(e.payload.empty());
+}
+
+TEST(Envelope, MissingOrNonStringFields) {
+    Envelope e = decode_envelope(R"({"id":7,"type":["exec"]})");
+    EXPECT_EQ(e.id, "");
+    EXPECT_FALSE(e.has_type);
+
+    Envelope u = decode_envelope(R"({"type":"exec2"})");
+    EXPECT_TRUE(u.has_type);
+    EXPECT_EQ(u.type, MessageType::Unknown);
+
+    EXPECT_FALSE(decode_envelope("[1,2]").has_type); // valid JSON, not an envelope
+    EXPECT_FALSE(decode_envelope("{}").has_type);
+}
+
+TEST(Envelope, TypeLookup) {
+    for (const auto &t : omniflow::MESSAGE_TYPES) EXPECT_EQ(omniflow::message_type(t.name), t.type);
+    for (std::string_view name : {"", "h", "Health", "healths", "meta ", "batcH", "shutdow", "quiz"})
+        EXPECT_EQ(omniflow::message_type(name), MessageType::Unknown) << name;
+}
+
+TEST(Envelope, RejectsMalformedJson) {
+    for (std::string_view bad : {R"({"type":"health","payload":{"a":tru}})", R"({"type":"health",})",
+                                 R"({"type":"health"} x)", R"({"type":"health","p":"\q"})",
+                                 R"({"type":"health","p":[1,})", R"({"type":"health","p":-})", "", "   ",
+                                 R"({"type" "health"})", R"({"type":"health","p":"\u12x4"})"}) {
+        EXPECT_THROW(decode_envelope(bad), nlohmann::detail::parse_error) << bad;
+        EXPECT_THROW(nlohmann::json::parse(bad), nlohmann::detail::parse_error) << bad;
+    }
+}
+
+TEST(Envelope, RejectsExcessiveNesting) {
+    auto nested = [](size_t depth) { return std::string(depth, '[') + std::string(depth, ']'); };
+    const size_t max = nlohmann::detail::json_max_depth;
+
+    // a 120 KB frame, under the default max_line, that used to overflow the stack
+    std::string deep = R"({"id":"d","type":"health","x":)" + nested(60000) + "}";
+    EXPECT_THROW(decode_envelope(deep), nlohmann::detail::parse_error);
+    EXPECT_THROW(decode_envelope(nested(60000)), nlohmann::detail::parse_error);
+    EXPECT_THROW(nlohmann::json::parse(deep), nlohmann::detail::parse_error);
+
+    // the envelope object itself is one level
+    EXPECT_NO_THROW(decode_envelope(R"({"type":"health","x":)" + nested(max - 1) + "}"));
+    EXPECT_THROW(decode_envelope(R"({"type":"health","x":)" + nested(max) + "}"), nlohmann::detail::parse_error);
+    EXPECT_NO_THROW(decode_envelope(nested(max)));
+}
@@ -14,9 +14,8 @@
 //   ./tests/test_json_parsing
 //
 // Or quick manual build (for developers without full CMake):
-//   g++ -std=c++17 -I../../plugins/c/vendor/cJSON -I$(gtest/include) \
-//       ../../../plugins/c/vendor/cJSON/cJSON.c test_json_parsing.cpp \
-//       -L/path/to/gtest/lib -lgtest -lgtest_main -pthread -o test_json_parsing
+//   gcc -c ../../../c/vendor/cJSON/cJSON.c -o cJSON.o
+//   g++ -std=c++17 cJSON.o test_json_parsing.cpp -lgtest -pthread -o test_json_parsing
 //
 // NOTE: These tests assume the vendor cJSON sources are available at
 //       plugins/c/vendor/cJSON/cJSON.c and plugins/c/vendor/cJSON/cJSON.h
@@ -170,14 +169,10 @@ TEST(JsonParsing, LargeButSafeStringParsing) {
     ASSERT_NE(root, nullptr) << "Parser failed on a 64KiB JSON payload";
     cJSON* payload = cJSON_GetObjectItem(root, "payload");
     ASSERT_NE(payload, nullptr);
-    cJSON* msg = cJSON_GetObjectItem(cJSON_GetObjectItem(payload, "payload") ? cJSON_GetObjectItem(payload, "payload") : cJSON_GetObjectItem(payload, "args"));
-    // It's enough that parser succeeded and produced strings — verify message exists somewhere
-    // Retrieve the "message" by traversing
-    cJSON* payload_obj = cJSON_GetObjectItem(root, "payload");
-    if (payload_obj) {
-        cJSON* action_node = cJSON_GetObjectItem(payload_obj, "action");
-        // In this structure action may be nested; just ensure parsing didn't crash and we can free memory
-    }
+    cJSON* msg = cJSON_GetObjectItem(payload, "message");
+    ASSERT_NE(msg, nullptr);
+    ASSERT_NE(msg->valuestring, nullptr);
+    EXPECT_EQ(std::strlen(msg->valuestring), len);
     cJSON_Delete(root);
 }
 
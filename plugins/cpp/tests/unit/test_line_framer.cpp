@@ -0,0 +1,144 @@
+// plugins/cpp/tests/unit/test_line_framer.cpp
+//
+// Unit tests for the read(2)-based input framers used by the C++ plugin
+// (plugins/cpp/line_framer.hpp, plugins/cpp/prefixed_framer.hpp). Written with Google Test and linked into the
+// same test binary as the other unit tests.
+//
+// The test suite checks:
+//  - frames are split on '\n' across read chunk boundaries
+//  - a final line without '\n' is returned at EOF
+//  - lines over max_line are reported once as Oversized, are never buffered
+//    in full, and framing resumes with the next line
+//  - length-prefixed frames (binary transport) are split by their prefix,
+//    oversized ones are rejected from the header and their bodies skipped
+//
+// Keep tests small, deterministic and safe to run inside CI.
+//
+
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../../line_framer.hpp"
+#include "../../prefixed_framer.hpp"
+
+using omniflow::LineFramer;
+using omniflow::PrefixedFramer;
+
+namespace {
+
+// Feeds `input` through a pipe (from a writer thread, so inputs larger than
+// the pipe buffer work) and collects everything the framer returns.
+struct Collected {
+    std::vector<std::string> frames; // "<oversized>" marks an Oversized result
+};
+
+template <typename Framer = LineFramer>
+Collected run_framer(const std::string &input, size_t max_line, size_t chunk) {
+    int fds[2];
+    EXPECT_EQ(pipe(fds), 0);
+    std::thread writer([&] {
+        size_t off = 0;
+        while (off < input.size()) {
+            ssize_t n = write(fds[1], input.data() + off, input.size() - off);
+            if (n <= 0) break;
+            off += static_cast<size_t>(n);
+        }
+        close(fds[1]);
+    });
+
+    Collected out;
+    Framer framer(fds[0], max_line, chunk);
+    std::string_view frame;
+    for (;;) {
+        auto st = framer.next(frame);
+        if (st == Framer::Status::Eof) break;
+        out.frames.push_back(st == Framer::Status::Frame ? std::string(frame) : "<oversized>");
+    }
+    writer.join();
+    close(fds[0]);
+    return out;
+}
+
+// 4-byte big-endian length prefix + body
+std::string prefixed(const std::string &body) {
+    std::string out(PrefixedFramer::PREFIX_BYTES, '\0');
+    PrefixedFramer::store_prefix(out.data(), static_cast<uint32_t>(body.size()));
+    return out + body;
+}
+
+} // namespace
+
+TEST(LineFramer, SplitsAcrossChunkBoundaries) {
+    auto got = run_framer("{\"id\":\"1\"}\n\n{\"id\":\"22\"}\nabc\n", 64, 3);
+    std::vector<std::string> want = {"{\"id\":\"1\"}", "", "{\"id\":\"22\"}", "abc"};
+    EXPECT_EQ(got.frames, want);
+}
+
+TEST(LineFramer, FinalLineWithoutNewline) {
+    auto got = run_framer("one\ntwo", 16, 4);
+    std::vector<std::string> want = {"one", "two"};
+    EXPECT_EQ(got.frames, want);
+}
+
+TEST(LineFramer, LineOfExactlyMaxLineIsAccepted) {
+    std::string line(32, 'x');
+    auto got = run_framer(line + "\n" + line + "y\nok\n", 32, 8);
+    std::vector<std::string> want = {line, "<oversized>", "ok"};
+    EXPECT_EQ(got.frames, want);
+}
+
+TEST(LineFramer, OversizedLineIsSkippedWithoutBuffering) {
+    // 1 MiB line against a 64-byte limit and 16-byte chunks: the framer's
+    // buffer is 81 bytes, so the line can only be handled by discarding it.
+    std::string huge(1 << 20, 'A');
+    auto got = run_framer("first\n" + huge + "\nlast\n", 64, 16);
+    std::vector<std::string> want = {"first", "<oversized>", "last"};
+    EXPECT_EQ(got.frames, want);
+}
+
+TEST(LineFramer, HasFrameReflectsBufferedLines) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    const std::string input = "a\nb\npartial";
+    ASSERT_EQ(write(fds[1], input.data(), input.size()), static_cast<ssize_t>(input.size()));
+
+    LineFramer framer(fds[0], 64);
+    std::string_view frame;
+    EXPECT_FALSE(framer.has_frame()); // nothing read yet
+    ASSERT_EQ(framer.next(frame), LineFramer::Status::Frame);
+    EXPECT_EQ(frame, "a");
+    EXPECT_TRUE(framer.has_frame()); // "b\n" already buffered
+    ASSERT_EQ(framer.next(frame), LineFramer::Status::Frame);
+    EXPECT_FALSE(framer.has_frame()); // only a partial line left
+
+    close(fds[1]);
+    ASSERT_EQ(framer.next(frame), LineFramer::Status::Frame);
+    EXPECT_EQ(frame, "partial");
+    EXPECT_EQ(framer.next(frame), LineFramer::Status::Eof);
+    close(fds[0]);
+}
+
+TEST(PrefixedFramer, SplitsOnLengthPrefixes) {
+    std::string body(300, '\n'); // newlines are payload bytes here
+    auto got = run_framer<PrefixedFramer>(prefixed("\xa0") + prefixed("") + prefixed(body) + prefixed("ab"), 512, 5);
+    std::vector<std::string> want = {"\xa0", "", body, "ab"};
+    EXPECT_EQ(got.frames, want);
+}
+
+TEST(PrefixedFramer, OversizedFrameIsSkippedFromItsHeader) {
+    std::string huge(1 << 20, 'A');
+    auto got = run_framer<PrefixedFramer>(prefixed("x") + prefixed(huge) + prefixed("y"), 64, 16);
+    std::vector<std::string> want = {"x", "<oversized>", "y"};
+    EXPECT_EQ(got.frames, want);
+}
+
+TEST(PrefixedFramer, TruncatedFrameEndsTheStream) {
+    auto got = run_framer<PrefixedFramer>(prefixed("ok") + prefixed("partial").substr(0, 6), 64, 8);
+    std::vector<std::string> want = {"ok"};
+    EXPECT_EQ(got.frames, want);
+}
@@ -0,0 +1,82 @@
+// plugins/cpp/tests/unit/test_metrics.cpp
+//
+// Unit tests for the metrics registry used by the C++ plugin
+// (plugins/cpp/metrics.hpp). Written with Google Test and linked into the
+// same test binary as the other unit tests.
+//
+// The test suite checks:
+//  - HDR bucket bounds: every value lands in a bucket whose highest value is
+//    within ~3% of it
+//  - percentiles, mean and max of known distributions
+//  - counters and histograms recorded from several threads are merged, and
+//    counts of exited threads are kept
+//
+// Keep tests small, deterministic and safe to run inside CI.
+//
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../../metrics.hpp"
+
+using omniflow::MetricsRegistry;
+namespace hdr = omniflow::hdr;
+
+TEST(Metrics, BucketBounds) {
+    std::mt19937_64 rng(7);
+    for (int i = 0; i < 20000; ++i) {
+        uint64_t v = rng() >> (rng() % 44 + 20); // spread over the whole range (< 2^44)
+        size_t b = hdr::index_of(v);
+        ASSERT_LT(b, hdr::BUCKETS);
+        uint64_t hi = hdr::highest_of(b);
+        EXPECT_GE(hi, v);
+        EXPECT_LE(hi - v, v / 32 + 1) << v;
+        if (b > 0) {
+            EXPECT_LT(hdr::highest_of(b - 1), v) << v;
+        }
+    }
+    EXPECT_EQ(hdr::index_of(~uint64_t{0}), hdr::BUCKETS - 1); // clamped
+}
+
+TEST(Metrics, Percentiles) {
+    MetricsRegistry m({}, {"lat"});
+    for (uint64_t v = 1; v <= 10000; ++v) m.record(0, v * 1000); // 1us .. 10ms
+    auto h = m.snapshot().histograms[0];
+    EXPECT_EQ(h.count(), 10000u);
+    EXPECT_EQ(h.max(), 10000u * 1000);
+    EXPECT_EQ(h.mean(), 5000500u);
+    auto near = [](uint64_t got, uint64_t want) { return got >= want && got - want <= want / 32 + 1; };
+    EXPECT_TRUE(near(h.percentile(0.5), 5000000)) << h.percentile(0.5);
+    EXPECT_TRUE(near(h.percentile(0.99), 9900000)) << h.percentile(0.99);
+    EXPECT_TRUE(near(h.percentile(0.999), 9990000)) << h.percentile(0.999);
+    EXPECT_EQ(h.percentile(1.0), 10000000u);
+
+    MetricsRegistry empty({}, {"lat"});
+    EXPECT_EQ(empty.snapshot().histograms[0].percentile(0.99), 0u);
+}
+
+TEST(Metrics, MergesThreads) {
+    MetricsRegistry m({"a", "b"}, {"lat"});
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&m, t] {
+            for (int i = 0; i < 1000; ++i) {
+                m.add(0);
+                m.record(0, static_cast<uint64_t>(t + 1) * 100);
+            }
+            m.add(1, 5);
+            m.add(7); // unknown id: ignored
+        });
+    }
+    for (auto &th : threads) th.join(); // shards outlive their threads
+    m.add(0);
+    auto s = m.snapshot();
+    EXPECT_EQ(s.counters[0], 4001u);
+    EXPECT_EQ(s.counters[1], 20u);
+    EXPECT_EQ(s.histograms[0].count(), 4000u);
+    EXPECT_EQ(s.histograms[0].max(), 400u);
+    EXPECT_EQ(s.histograms[0].percentile(0.25), hdr::highest_of(hdr::index_of(100)));
+}
@@ -0,0 +1,141 @@
+// plugins/cpp/tests/unit/test_request_tracker.cpp
+//
+// Unit tests for in-flight request tracking used by the C++ plugin
+// (plugins/cpp/request_tracker.hpp). Written with Google Test and linked into
+// the same test binary as the other unit tests.
+//
+// The test suite checks:
+//  - a deadline fires once, not before its timeout, and is handed to the
+//    callback as TimedOut; finished requests never fire
+//  - claim() lets exactly one party answer a request
+//  - partial writes stop at a claim, and fence() waits out one in progress
+//  - find() resolves ids for cancellation and forgets finished requests
+//  - ids are scoped to their owner (server-mode client connections)
+//  - stop() makes a waiting run_until() return
+//
+// Keep tests small, deterministic and safe to run inside CI.
+//
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../request_tracker.hpp"
+
+using omniflow::RequestTracker;
+using namespace std::chrono_literals;
+
+TEST(RequestTracker, DeadlineFiresAfterTimeout) {
+    RequestTracker t(1ms, 16); // small wheel: the 40ms deadline takes several revolutions
+    auto started = RequestTracker::Clock::now();
+    RequestTracker::Ptr slow = t.start("slow", 40ms);
+    RequestTracker::Ptr done = t.start("done", 5ms);
+    RequestTracker::Ptr open = t.start("open", 0ms); // no deadline
+    t.finish(done);
+
+    std::vector<std::string> fired;
+    t.run_until(started + 200ms, [&](const RequestTracker::Ptr &r) {
+        EXPECT_GE(RequestTracker::Clock::now() - started, 40ms);
+        fired.push_back(r->id);
+    });
+    ASSERT_EQ(fired, std::vector<std::string>{"slow"});
+    EXPECT_EQ(slow->state(), RequestTracker::TimedOut);
+    EXPECT_EQ(slow->timeout, 40ms); // what answer_timeout() reports
+    EXPECT_TRUE(slow->stopped());
+    EXPECT_FALSE(open->stopped());
+    t.finish(slow);
+    t.finish(open);
+    EXPECT_EQ(t.inflight(), 0u);
+}
+
+TEST(RequestTracker, ClaimIsExclusive) {
+    RequestTracker t;
+    RequestTracker::Ptr r = t.start("a", 10s);
+    EXPECT_TRUE(r->claim(RequestTracker::Cancelled));
+    EXPECT_FALSE(r->claim(RequestTracker::Done));
+    EXPECT_FALSE(r->claim(RequestTracker::TimedOut));
+    EXPECT_EQ(r->state(), RequestTracker::Cancelled);
+    t.finish(r);
+
+    // a claimed request is not handed out again when its deadline passes
+    RequestTracker w(1ms, 8);
+    RequestTracker::Ptr q = w.start("q", 2ms);
+    ASSERT_TRUE(q->claim(RequestTracker::Done));
+    int fired = 0;
+    w.run_until(RequestTracker::Clock::now() + 20ms, [&](const RequestTracker::Ptr &) { ++fired; });
+    EXPECT_EQ(fired, 0);
+    w.finish(q);
+}
+
+TEST(RequestTracker, PartialWritesStopAtClaim) {
+    RequestTracker t;
+    RequestTracker::Ptr r = t.start("s", 10s);
+    int written = 0;
+    EXPECT_TRUE(r->write_partial([&] { ++written; }));
+
+    std::atomic<bool> writing{false}, wrote{false};
+    std::thread streamer([&] {
+        r->write_partial([&] {
+            writing = true;
+            std::this_thread::sleep_for(20ms);
+            wrote = true;
+        });
+    });
+    while (!writing) std::this_thread::yield();
+    ASSERT_TRUE(r->claim(RequestTracker::TimedOut));
+    r->fence(); // the terminal answer goes out only after the partial in progress
+    EXPECT_TRUE(wrote);
+    streamer.join();
+    EXPECT_FALSE(r->write_partial([&] { ++written; }));
+    EXPECT_EQ(written, 1);
+    t.finish(r);
+}
+
+TEST(RequestTracker, FindForCancel) {
+    RequestTracker t;
+    RequestTracker::Ptr a = t.start("a", 10s);
+    RequestTracker::Ptr b = t.start("b", 0ms);
+    EXPECT_EQ(t.find("a"), a);
+    EXPECT_EQ(t.find("b"), b);
+    EXPECT_EQ(t.find("c"), nullptr);
+    EXPECT_EQ(t.inflight(), 2u);
+
+    RequestTracker::Ptr a2 = t.start("a", 10s); // reused id shadows the older request
+    EXPECT_EQ(t.find("a"), a2);
+    t.finish(a); // finishing the shadowed one keeps the newer
+    EXPECT_EQ(t.find("a"), a2);
+    t.finish(a2);
+    t.finish(b);
+    EXPECT_EQ(t.find("a"), nullptr);
+    EXPECT_EQ(t.inflight(), 0u);
+}
+
+TEST(RequestTracker, IdsAreScopedToTheirOwner) {
+    RequestTracker t;
+    auto client1 = std::make_shared<int>(1), client2 = std::make_shared<int>(2);
+    RequestTracker::Ptr a1 = t.start("a", 10s, client1);
+    RequestTracker::Ptr a2 = t.start("a", 10s, client2);
+    EXPECT_EQ(t.find("a", client1.get()), a1);
+    EXPECT_EQ(t.find("a", client2.get()), a2);
+    EXPECT_EQ(t.find("a"), nullptr); // no owner: the stdio requests
+    EXPECT_EQ(a1->owner, client1);
+    t.finish(a1);
+    EXPECT_EQ(t.find("a", client2.get()), a2);
+    t.finish(a2);
+    EXPECT_EQ(t.inflight(), 0u);
+}
+
+TEST(RequestTracker, StopWakesRunUntil) {
+    RequestTracker t;
+    auto started = RequestTracker::Clock::now();
+    std::thread runner([&] { t.run_until(started + 30s, [](const RequestTracker::Ptr &) {}); });
+    std::this_thread::sleep_for(10ms);
+    t.stop();
+    runner.join();
+    EXPECT_LT(RequestTracker::Clock::now() - started, 5s);
+    t.run_until(RequestTracker::Clock::now() + 30s, [](const RequestTracker::Ptr &) {}); // returns at once
+}
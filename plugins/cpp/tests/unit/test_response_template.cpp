@@ -0,0 +1,59 @@
+// plugins/cpp/tests/unit/test_response_template.cpp
+//
+// Unit tests for the precompiled response templates used by the C++ plugin
+// (plugins/cpp/response_template.hpp). Written with Google Test and linked into
+// the same test binary as the other unit tests.
+//
+// The test suite checks:
+//  - holes are filled in order, and strings are escaped exactly as json.hpp's
+//    dump() escapes them
+//  - render() returns 0 when the output does not fit or the values do not
+//    match the holes; bad patterns are rejected
+//
+// Keep tests small, deterministic and safe to run inside CI.
+//
+
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+
+#include "../../response_template.hpp"
+#include "nlohmann/json.hpp"
+
+using omniflow::ResponseTemplate;
+
+namespace {
+
+std::string render(const ResponseTemplate &t, std::initializer_list<ResponseTemplate::Value> values) {
+    char buf[256];
+    return std::string(buf, t.render(buf, sizeof(buf), values));
+}
+
+} // namespace
+
+TEST(ResponseTemplate, FillsHolesInOrder) {
+    ResponseTemplate t(R"({"id":%s,"n":%d,"m":%d,"pct":"100%%"})");
+    EXPECT_EQ(t.holes(), 3u);
+    EXPECT_EQ(render(t, {"req-1", 42, -7LL}), R"({"id":"req-1","n":42,"m":-7,"pct":"100%"})");
+    EXPECT_EQ(render(ResponseTemplate("plain"), {}), "plain");
+}
+
+TEST(ResponseTemplate, EscapesLikeDump) {
+    ResponseTemplate t("%s");
+    for (std::string id : {std::string("q\"uo\\te"), std::string("tab\tnl\ncr\r\b\f"), std::string("ctl\x01\x1f\x7f"),
+                           std::string("utf8 \xc3\xa9\xe2\x82\xac"), std::string()})
+        EXPECT_EQ(render(t, {id}), nlohmann::json(id).dump()) << id;
+}
+
+TEST(ResponseTemplate, RefusesWhatDoesNotFit) {
+    ResponseTemplate t(R"({"id":%s,"n":%d})");
+    char buf[18];
+    EXPECT_EQ(t.render(buf, sizeof(buf), {"abc", 1}), 18u); // {"id":"abc","n":1}: exactly fits
+    EXPECT_EQ(t.render(buf, sizeof(buf) - 1, {"abc", 1}), 0u);
+    EXPECT_EQ(t.render(buf, sizeof(buf), {"a\nc", 1}), 0u);  // the escape does not fit
+    EXPECT_EQ(t.render(buf, sizeof(buf), {"abc", 10}), 0u);
+    EXPECT_EQ(t.render(buf, sizeof(buf), {"a"}), 0u);    // too few values
+    EXPECT_EQ(t.render(buf, sizeof(buf), {1, "a"}), 0u); // wrong kinds
+    EXPECT_THROW(ResponseTemplate("bad %x"), std::invalid_argument);
+    EXPECT_THROW(ResponseTemplate("trailing %"), std::invalid_argument);
+}
@@ -0,0 +1,125 @@
+// plugins/cpp/tests/unit/test_result_cache.cpp
+//
+// Unit tests for exec result memoization used by the C++ plugin
+// (plugins/cpp/result_cache.hpp). Written with Google Test and linked into the
+// same test binary as the other unit tests.
+//
+// The test suite checks:
+//  - canonical_hash() ignores whitespace and member order, keeps array order
+//    and value differences, and rejects malformed text
+//  - payloads with duplicate member names or `*_ref` members get no key
+//  - lookup() hits after insert(), misses otherwise, and counts both
+//  - entries expire after their TTL
+//  - the byte budget is enforced; CLOCK keeps recently hit entries longer
+//  - values over a shard's budget are not cached; insert() replaces
+//
+// Keep tests small, deterministic and safe to run inside CI.
+//
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "../../result_cache.hpp"
+
+using omniflow::ResultCache;
+using omniflow::canonical_hash;
+using namespace std::chrono_literals;
+
+TEST(CanonicalHash, IgnoresWhitespaceAndMemberOrder) {
+    auto a = canonical_hash(R"({"action":"reverse","message":"hi","n":[1,2,{"x":1,"y":2}]})");
+    auto b = canonical_hash(" { \"n\" : [ 1 , 2 , {\"y\":2,\"x\":1} ],\n\t\"message\":\"hi\", \"action\":\"reverse\" } ");
+    ASSERT_TRUE(a && b);
+    EXPECT_EQ(*a, *b);
+}
+
+TEST(CanonicalHash, DistinguishesValues) {
+    auto base = canonical_hash(R"({"a":[1,2],"b":"x"})");
+    EXPECT_NE(base, canonical_hash(R"({"a":[2,1],"b":"x"})")); // array order matters
+    EXPECT_NE(base, canonical_hash(R"({"a":[1,2],"b":"y"})"));
+    EXPECT_NE(base, canonical_hash(R"({"a":[1,2],"c":"x"})"));
+    EXPECT_NE(base, canonical_hash(R"({"a":[1,2],"b":"x","c":null})"));
+    EXPECT_NE(canonical_hash(R"({"a":{"b":1},"c":2})"), canonical_hash(R"({"a":{"c":2},"b":1})"));
+    EXPECT_NE(canonical_hash(R"({"s":"a\"b"})"), canonical_hash(R"({"s":"a\\b"})"));
+}
+
+TEST(CanonicalHash, RejectsMalformedText) {
+    EXPECT_FALSE(canonical_hash(""));
+    EXPECT_FALSE(canonical_hash(R"({"a":1)"));
+    EXPECT_FALSE(canonical_hash(R"({"a" 1})"));
+    EXPECT_FALSE(canonical_hash(R"({"a":"open})"));
+    EXPECT_FALSE(canonical_hash(R"({"a":1} x)"));
+    std::string deep(300, '[');
+    deep += std::string(300, ']');
+    EXPECT_FALSE(canonical_hash(deep));
+}
+
+TEST(CanonicalHash, RejectsDuplicateMemberNames) {
+    // a commutative sum would give these two the same key, yet a reader that
+    // keeps the first member sees "a":1 in one and "a":2 in the other
+    EXPECT_FALSE(canonical_hash(R"({"a":1,"a":2})"));
+    EXPECT_FALSE(canonical_hash(R"({"a":2,"a":1})"));
+    EXPECT_FALSE(canonical_hash(R"({"x":{"m":"hi","n":1,"m":"bye"}})"));
+    EXPECT_FALSE(canonical_hash(R"({"a":1,"\u0061":2})")); // same name, spelled differently
+    EXPECT_TRUE(canonical_hash(R"({"a":{"a":1},"b":[{"a":1},{"a":2}]})")); // same name, different objects
+}
+
+TEST(CanonicalHash, RejectsSharedMemoryReferences) {
+    // the descriptor is identical while the mapped numbers may have changed
+    EXPECT_FALSE(canonical_hash(R"({"action":"compute","numbers_ref":{"pid":1,"fd":3,"len":64}})"));
+    EXPECT_FALSE(canonical_hash(R"({"action":"compute","numbers":[1],"weights_ref":{"pid":1,"fd":4,"len":8}})"));
+    EXPECT_FALSE(canonical_hash(R"({"nested":{"payload_ref":{"pid":1,"fd":3,"len":8}}})"));
+    EXPECT_FALSE(canonical_hash(R"({"numbers\u005fref":{"pid":1,"fd":3,"len":64}})"));
+    EXPECT_TRUE(canonical_hash(R"({"action":"echo","message":"numbers_ref","ref":1,"_re":2})"));
+}
+
+TEST(ResultCache, HitAfterInsertAndCounts) {
+    ResultCache c(64 * 1024, 60s, 1);
+    EXPECT_EQ(c.lookup(1), nullptr);
+    c.insert(1, "one");
+    ResultCache::Value v = c.lookup(1);
+    ASSERT_NE(v, nullptr);
+    EXPECT_EQ(*v, "one");
+    c.insert(1, "uno"); // replaces
+    EXPECT_EQ(*c.lookup(1), "uno");
+    ResultCache::Stats st = c.stats();
+    EXPECT_EQ(st.hits, 2u);
+    EXPECT_EQ(st.misses, 1u);
+    EXPECT_EQ(st.entries, 1u);
+    EXPECT_EQ(st.bytes, 3 + ResultCache::ENTRY_OVERHEAD);
+}
+
+TEST(ResultCache, EntriesExpire) {
+    ResultCache c(64 * 1024, 5ms, 1);
+    c.insert(7, "seven");
+    ASSERT_NE(c.lookup(7), nullptr);
+    std::this_thread::sleep_for(10ms);
+    EXPECT_EQ(c.lookup(7), nullptr);
+    EXPECT_EQ(c.stats().expirations, 1u);
+    EXPECT_EQ(c.stats().entries, 0u);
+}
+
+TEST(ResultCache, BudgetEvictsUnreferencedFirst) {
+    const size_t cost = 100 + ResultCache::ENTRY_OVERHEAD;
+    ResultCache c(3 * cost, 60s, 1); // room for three entries
+    std::string value(100, 'v');
+    c.insert(1, value);
+    c.insert(2, value);
+    c.insert(3, value);
+    ASSERT_NE(c.lookup(1), nullptr); // 1 gets a second chance
+    c.insert(4, value);
+    EXPECT_NE(c.lookup(1), nullptr);
+    EXPECT_EQ(c.lookup(2), nullptr);
+    EXPECT_NE(c.lookup(4), nullptr);
+    ResultCache::Stats st = c.stats();
+    EXPECT_EQ(st.evictions, 1u);
+    EXPECT_LE(st.bytes, 3 * cost);
+}
+
+TEST(ResultCache, OversizedValuesAreNotCached) {
+    ResultCache c(1024, 60s, 4); // 256 bytes per shard
+    c.insert(9, std::string(512, 'x'));
+    EXPECT_EQ(c.lookup(9), nullptr);
+    EXPECT_EQ(c.stats().insertions, 0u);
+}
@@ -0,0 +1,179 @@
+// plugins/cpp/tests/unit/test_shm_payload.cpp
+//
+// Unit tests for the shared-memory payload channel used by the C++ plugin
+// (plugins/cpp/shm_payload.hpp). Written with Google Test and linked into the
+// same test binary as the other unit tests.
+//
+// The test suite checks:
+//  - sealed memfds (via /proc/<pid>/fd/<n>) are mapped read-only and exposed
+//    in place, including at offsets that are not page aligned; unsealed ones
+//    are refused
+//  - named shm objects are copied, so truncating them afterwards is harmless
+//  - malformed references, out-of-range windows and missing objects throw
+//    ShmError with code 400; payloads over the limit throw code 101
+//  - a /proc/<pid>/fd/<n> reference to anything but a memfd is refused
+//  - with a peer pid given, a memfd reference must name that pid and shm
+//    names are refused
+//
+// Keep tests small, deterministic and safe to run inside CI.
+//
+
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <optional>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../../shm_payload.hpp"
+
+using omniflow::MappedPayload;
+using omniflow::ShmError;
+
+namespace {
+
+// A memfd holding `content` (sealed the way hosts must seal it unless
+// `seals` says otherwise), closed on scope exit
+struct MemFd {
+    explicit MemFd(const std::string &content, int seals = F_SEAL_SHRINK | F_SEAL_WRITE)
+        : fd(::memfd_create("omniflow-test", MFD_CLOEXEC | MFD_ALLOW_SEALING)) {
+        EXPECT_GE(fd, 0);
+        EXPECT_EQ(::write(fd, content.data(), content.size()), static_cast<ssize_t>(content.size()));
+        if (seals) {
+            EXPECT_EQ(::fcntl(fd, F_ADD_SEALS, seals), 0);
+        }
+    }
+    ~MemFd() { if (fd >= 0) ::close(fd); }
+    MappedPayload::Ref ref(uint64_t offset = 0, uint64_t length = 0) const {
+        MappedPayload::Ref r;
+        r.pid = static_cast<long>(::getpid());
+        r.fd = fd;
+        r.offset = offset;
+        r.length = length;
+        return r;
+    }
+    int fd;
+};
+
+int error_code(const MappedPayload::Ref &ref, size_t max_bytes, std::optional<long> peer_pid = std::nullopt) {
+    try {
+        MappedPayload::map(ref, max_bytes, peer_pid);
+    } catch (const ShmError &ex) {
+        return ex.code;
+    }
+    return 0;
+}
+
+} // namespace
+
+TEST(ShmPayload, MapsMemfdInPlace) {
+    std::string content(10000, 'x');
+    content.replace(5000, 11, R"({"a":[1,2]})");
+    MemFd mem(content);
+
+    MappedPayload whole = MappedPayload::map(mem.ref(), 1 << 20);
+    EXPECT_EQ(whole.bytes(), content);
+
+    MappedPayload window = MappedPayload::map(mem.ref(5000, 11), 1 << 20); // unaligned offset
+    EXPECT_EQ(window.bytes(), R"({"a":[1,2]})");
+
+    MappedPayload moved = std::move(window);
+    EXPECT_EQ(moved.bytes(), R"({"a":[1,2]})");
+    EXPECT_TRUE(window.bytes().empty());
+}
+
+TEST(ShmPayload, MapsNamedShmObject) {
+    const std::string name = "/omniflow-test-" + std::to_string(::getpid());
+    int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(::write(fd, "hello", 5), 5);
+    ::close(fd);
+
+    MappedPayload::Ref ref;
+    ref.shm = name;
+    MappedPayload m = MappedPayload::map(ref, 64);
+    ref.offset = 1;
+    ref.length = 3;
+    MappedPayload window = MappedPayload::map(ref, 64);
+
+    // the owner truncating the object cannot fault the plugin: it holds a copy
+    fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(::ftruncate(fd, 0), 0);
+    ::close(fd);
+    ::shm_unlink(name.c_str());
+    EXPECT_EQ(m.bytes(), "hello");
+    MappedPayload moved = std::move(window);
+    EXPECT_EQ(moved.bytes(), "ell");
+}
+
+TEST(ShmPayload, RejectsUnsealedMemfds) {
+    MemFd open_fd("0123456789", 0);
+    EXPECT_EQ(error_code(open_fd.ref(), 64), 400);
+    MemFd shrink_only("0123456789", F_SEAL_SHRINK);
+    EXPECT_EQ(error_code(shrink_only.ref(), 64), 400);
+    MemFd write_only("0123456789", F_SEAL_WRITE);
+    EXPECT_EQ(error_code(write_only.ref(), 64), 400);
+    MemFd sealed("0123456789", F_SEAL_SHRINK | F_SEAL_WRITE | F_SEAL_GROW | F_SEAL_SEAL);
+    EXPECT_EQ(error_code(sealed.ref(), 64), 0);
+}
+
+TEST(ShmPayload, RejectsBadReferences) {
+    MemFd mem("0123456789");
+    EXPECT_EQ(error_code(mem.ref(11), 64), 400);    // offset past the end
+    EXPECT_EQ(error_code(mem.ref(4, 7), 64), 400);  // window past the end
+    EXPECT_EQ(error_code(mem.ref(), 9), 101);       // over the limit
+    EXPECT_EQ(error_code(mem.ref(2, 3), 3), 0);     // a window within the limit is fine
+
+    MappedPayload::Ref ref;
+    EXPECT_EQ(error_code(ref, 64), 400);            // neither shm nor pid/fd
+    ref.shm = "../etc/passwd";
+    EXPECT_EQ(error_code(ref, 64), 400);
+    ref.shm = "/a/b";
+    EXPECT_EQ(error_code(ref, 64), 400);
+    ref.shm = "/omniflow-does-not-exist";
+    EXPECT_EQ(error_code(ref, 64), 400);
+}
+
+TEST(ShmPayload, RejectsDescriptorsThatAreNotMemfds) {
+    char path[] = "/tmp/omniflow-test-XXXXXX";
+    int fd = ::mkstemp(path);
+    ASSERT_GE(fd, 0);
+    ::unlink(path);
+    ASSERT_EQ(::write(fd, "secret", 6), 6);
+    MappedPayload::Ref ref;
+    ref.pid = static_cast<long>(::getpid());
+    ref.fd = fd;
+    EXPECT_EQ(error_code(ref, 64), 400);
+    ::close(fd);
+
+    const std::string name = "/omniflow-test-fd-" + std::to_string(::getpid()); // tmpfs, but not a memfd
+    int shm = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    ASSERT_GE(shm, 0);
+    ::shm_unlink(name.c_str());
+    ASSERT_EQ(::write(shm, "secret", 6), 6);
+    ref.fd = shm;
+    EXPECT_EQ(error_code(ref, 64), 400);
+    ::close(shm);
+}
+
+TEST(ShmPayload, MemfdMustBelongToThePeer) {
+    MemFd mem("0123456789");
+    long self = static_cast<long>(::getpid());
+    EXPECT_EQ(error_code(mem.ref(), 64, self), 0);
+    EXPECT_EQ(error_code(mem.ref(), 64, self + 1), 400);
+    EXPECT_EQ(error_code(mem.ref(), 64, -1), 400); // peer unknown
+
+    const std::string name = "/omniflow-test-peer-" + std::to_string(::getpid());
+    int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(::write(fd, "hello", 5), 5);
+    ::close(fd);
+    MappedPayload::Ref ref;
+    ref.shm = name;
+    EXPECT_EQ(error_code(ref, 64), 0);
+    EXPECT_EQ(error_code(ref, 64, self), 400); // any client could name it
+    ::shm_unlink(name.c_str());
+}
@@ -0,0 +1,287 @@
+// plugins/cpp/tests/unit/test_unix_server.cpp
+//
+// Unit tests for the Unix socket server mode used by the C++ plugin
+// (plugins/cpp/unix_server.hpp). Written with Google Test and linked into the
+// same test binary as the other unit tests.
+//
+// The test suite checks:
+//  - frames from several clients reach the callback with their own
+//    connection, and each client only reads its own responses
+//  - a client's partial line is completed across reads; oversized lines are
+//    reported to the callback and framing resumes
+//  - returning false from the callback closes just that connection
+//  - connections beyond max_clients are closed and counted as rejected
+//  - a stale socket file is replaced; a live server's path is refused
+//  - stop() ends run() and the socket file is removed
+//  - each connection knows its peer's pid (SO_PEERCRED)
+//  - a client that stops reading does not hold up the others, and is
+//    disconnected once its output queue overflows
+//  - with a coalescing window, lines written from another thread are flushed
+//    by the loop's timer
+//
+// Keep tests small, deterministic and safe to run inside CI.
+//
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../../unix_server.hpp"
+
+using omniflow::UnixServer;
+using namespace std::chrono_literals;
+
+namespace {
+
+std::string temp_path(const char *tag) {
+    return "/tmp/omniflow-test-" + std::to_string(::getpid()) + "-" + tag + ".sock";
+}
+
+int connect_to(const std::string &path) {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (::connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    timeval tv{2, 0}; // a hung test fails instead of blocking CI
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+void send_all(int fd, std::string_view s) {
+    while (!s.empty()) {
+        ssize_t n = ::write(fd, s.data(), s.size());
+        ASSERT_GT(n, 0);
+        s.remove_prefix(static_cast<size_t>(n));
+    }
+}
+
+// Read until `lines` newlines arrived (or EOF / timeout)
+std::string read_lines(int fd, size_t lines) {
+    std::string out;
+    char buf[4096];
+    while (static_cast<size_t>(std::count(out.begin(), out.end(), '\n')) < lines) {
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        out.append(buf, static_cast<size_t>(n));
+    }
+    return out;
+}
+
+constexpr size_t FLOOD_BYTES = 256 * 1024;
+
+// Runs a server whose callback answers "<conn id>:<frame>\n" (or closes on
+// "bye", answers the peer's pid to "pid", a FLOOD_BYTES line to "flood", and
+// "late" from another thread to "async")
+struct EchoServer {
+    explicit EchoServer(const std::string &path, size_t max_clients = 8,
+                        std::chrono::microseconds window = std::chrono::microseconds(0), size_t max_queued = 0)
+        : server(path, 16, max_clients, window, 64 * 1024, 0600, max_queued) {
+        server.listen();
+        loop = std::thread([this] {
+            server.run(
+                [this](const UnixServer::ConnectionPtr &c, std::string_view frame, UnixServer::Clock::time_point) {
+                    if (frame == "bye") return false;
+                    if (frame == "pid") {
+                        c->out().write(std::to_string(c->peer_pid()) + "\n");
+                        return true;
+                    }
+                    if (frame == "flood") {
+                        c->out().write(std::string(FLOOD_BYTES - 1, 'f') + "\n");
+                        return true;
+                    }
+                    if (frame == "async") {
+                        helpers.emplace_back([c] {
+                            std::this_thread::sleep_for(5ms);
+                            c->out().write("late\n");
+                        });
+                        return true;
+                    }
+                    std::string line = std::to_string(c->id()) + ":" + std::string(frame) + "\n";
+                    c->out().write(line);
+                    return true;
+                },
+                [](const UnixServer::ConnectionPtr &c) { c->out().write("<oversized>\n"); });
+        });
+    }
+    ~EchoServer() {
+        server.stop();
+        loop.join();
+        for (auto &t : helpers) t.join();
+    }
+    UnixServer server;
+    std::thread loop;
+    std::vector<std::thread> helpers; // loop thread only until it is joined
+};
+
+} // namespace
+
+TEST(UnixServer, ClientsGetTheirOwnResponses) {
+    std::string path = temp_path("route");
+    EchoServer s(path);
+    int a = connect_to(path), b = connect_to(path);
+    ASSERT_GE(a, 0);
+    ASSERT_GE(b, 0);
+    send_all(a, "one\ntw");
+    send_all(b, "x\n");
+    std::string from_b = read_lines(b, 1);
+    send_all(a, "o\n");
+    std::string from_a = read_lines(a, 2);
+    std::string id_a = from_a.substr(0, from_a.find(':')), id_b = from_b.substr(0, from_b.find(':'));
+    EXPECT_NE(id_a, id_b);
+    EXPECT_EQ(from_a, id_a + ":one\n" + id_a + ":two\n");
+    EXPECT_EQ(from_b, id_b + ":x\n");
+    EXPECT_EQ(s.server.stats().accepted, 2u);
+    ::close(a);
+    ::close(b);
+}
+
+TEST(UnixServer, ConnectionsKnowTheirPeerPid) {
+    std::string path = temp_path("peer");
+    EchoServer s(path);
+    int fd = connect_to(path);
+    ASSERT_GE(fd, 0);
+    send_all(fd, "pid\n");
+    EXPECT_EQ(read_lines(fd, 1), std::to_string(::getpid()) + "\n");
+    ::close(fd);
+}
+
+TEST(UnixServer, OversizedLinesAreReportedAndFramingResumes) {
+    std::string path = temp_path("oversized");
+    EchoServer s(path);
+    int a = connect_to(path);
+    ASSERT_GE(a, 0);
+    send_all(a, std::string(100, 'z') + "\nok\n");
+    std::string got = read_lines(a, 2);
+    EXPECT_EQ(got.substr(0, 12), "<oversized>\n");
+    EXPECT_NE(got.find(":ok\n"), std::string::npos);
+    ::close(a);
+}
+
+TEST(UnixServer, CallbackFalseClosesOnlyThatConnection) {
+    std::string path = temp_path("close");
+    EchoServer s(path);
+    int a = connect_to(path), b = connect_to(path);
+    send_all(a, "bye\n");
+    char c;
+    EXPECT_EQ(::read(a, &c, 1), 0); // EOF: the server dropped it
+    send_all(b, "still\n");
+    EXPECT_NE(read_lines(b, 1).find(":still\n"), std::string::npos);
+    ::close(a);
+    ::close(b);
+}
+
+TEST(UnixServer, ClientsBeyondTheLimitAreRejected) {
+    std::string path = temp_path("limit");
+    EchoServer s(path, 1);
+    int a = connect_to(path);
+    send_all(a, "first\n");
+    read_lines(a, 1); // the first client is registered
+    int b = connect_to(path);
+    ASSERT_GE(b, 0);
+    char c;
+    EXPECT_EQ(::read(b, &c, 1), 0);
+    EXPECT_EQ(s.server.stats().rejected, 1u);
+    EXPECT_EQ(s.server.stats().clients, 1u);
+    ::close(a);
+    ::close(b);
+}
+
+TEST(UnixServer, StaleSocketIsReplacedLiveOneRefused) {
+    std::string path = temp_path("stale");
+    {
+        // a socket file nobody listens on
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        ASSERT_EQ(::bind(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)), 0);
+        ::close(fd);
+    }
+    {
+        EchoServer s(path);
+        struct stat st;
+        ASSERT_EQ(::stat(path.c_str(), &st), 0);
+        EXPECT_EQ(st.st_mode & 0777, 0600u);
+
+        UnixServer second(path, 16, 1, std::chrono::microseconds(0), 1024);
+        EXPECT_THROW(second.listen(), std::system_error);
+    }
+    struct stat st;
+    EXPECT_NE(::stat(path.c_str(), &st), 0); // unlinked by the destructor
+}
+
+TEST(UnixServer, SlowReaderDoesNotStallOthers) {
+    std::string path = temp_path("slow");
+    EchoServer s(path);
+    int slow = connect_to(path), b = connect_to(path);
+    ASSERT_GE(slow, 0);
+    ASSERT_GE(b, 0);
+    for (int i = 0; i < 8; ++i) send_all(slow, "flood\n"); // 2 MiB, never read
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 5; ++i) {
+        send_all(b, "ping\n");
+        ASSERT_NE(read_lines(b, 1).find(":ping\n"), std::string::npos);
+    }
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+
+    // the queued output is still delivered once the client reads
+    size_t got = 0;
+    char buf[65536];
+    while (got < 8 * FLOOD_BYTES) {
+        ssize_t n = ::read(slow, buf, sizeof(buf));
+        ASSERT_GT(n, 0);
+        got += static_cast<size_t>(n);
+    }
+    EXPECT_EQ(got, 8 * FLOOD_BYTES);
+    EXPECT_EQ(s.server.stats().overflowed, 0u);
+    ::close(slow);
+    ::close(b);
+}
+
+TEST(UnixServer, OverflowingClientIsDisconnected) {
+    std::string path = temp_path("overflow");
+    EchoServer s(path, 8, std::chrono::microseconds(0), 1024 * 1024);
+    int slow = connect_to(path), b = connect_to(path);
+    ASSERT_GE(slow, 0);
+    ASSERT_GE(b, 0);
+    for (int i = 0; i < 16; ++i) send_all(slow, "flood\n"); // 4 MiB against a 1 MiB queue
+    for (int i = 0; i < 200 && s.server.stats().overflowed == 0; ++i) std::this_thread::sleep_for(10ms);
+    EXPECT_EQ(s.server.stats().overflowed, 1u);
+    EXPECT_EQ(s.server.stats().clients, 1u);
+    send_all(b, "ping\n");
+    EXPECT_NE(read_lines(b, 1).find(":ping\n"), std::string::npos);
+
+    // what was sent before the cut ends in EOF, short of the full output
+    size_t got = 0;
+    char buf[65536];
+    ssize_t n;
+    while ((n = ::read(slow, buf, sizeof(buf))) > 0) got += static_cast<size_t>(n);
+    EXPECT_LT(got, 16 * FLOOD_BYTES);
+    ::close(slow);
+    ::close(b);
+}
+
+TEST(UnixServer, LoopFlushesCoalescedLinesFromOtherThreads) {
+    std::string path = temp_path("timer");
+    EchoServer s(path, 8, std::chrono::microseconds(2000));
+    int fd = connect_to(path);
+    ASSERT_GE(fd, 0);
+    send_all(fd, "async\n");
+    EXPECT_EQ(read_lines(fd, 1), "late\n");
+    ::close(fd);
+}
@@ -0,0 +1,392 @@
+// plugins/cpp/tests/unit/test_vendored_json.cpp
+//
+// Unit tests for the vendored nlohmann-like header used by the C++ plugin
+// (plugins/cpp/third_party/nlohmann/json.hpp). Written with Google Test and
+// linked into the plugin's test binary (omni_plugin_cpp_tests).
+//
+// The test suite checks:
+//  - brace initialization, integer queries and range-for over arrays
+//  - json::parse_view(): zero-copy string views, escape decoding, numbers,
+//    lookups, materialization via to_json() and rejection of malformed input
+//  - json::parse_lazy(): validation up front, on-demand member lookups that
+//    resume where the last one stopped, array walks, scalar conversion and
+//    to_json() of subtrees; input nested beyond json_max_depth is rejected
+//    by parse_lazy() and everything read from an accepted value stays in bounds
+//  - nlohmann::pmr::json: parsed and built trees allocate from the arena
+//    installed with arena_scope, copies follow the current arena
+//  - ordered_json: insertion order, first-key-wins parsing, lookups before
+//    and after the hash index kicks in, arena-backed pmr::ordered_json
+//  - integers are kept exact over the full int64 range (parse, dump, CBOR)
+//  - dump_to(): appends into a reused buffer, %.15g number formatting (-0
+//    keeps its sign) and string escaping identical to dump()
+//  - CBOR: RFC 8949 byte layout for the encoder, round trips, decoding of the
+//    forms we never emit (float16, indefinite lengths, tags) and rejection of
+//    truncated or hostile input
+//
+// Keep tests small, deterministic and safe to run inside CI.
+//
+
+#include <gtest/gtest.h>
+#include <limits>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+#include "../../third_party/nlohmann/json.hpp"
+
+using nlohmann::json;
+using nlohmann::json_view;
+
+TEST(VendoredJson, BraceInitializationAndIteration) {
+    json r = { {"id", "x"}, {"code", 400}, {"numbers", json::parse("[1,2,3]")}, {"list", {1, "two", nullptr}} };
+    ASSERT_TRUE(r.is_object());
+    EXPECT_EQ(r.dump(), R"({"code":400,"id":"x","list":[1,"two",null],"numbers":[1,2,3]})");
+
+    long long sum = 0;
+    for (const auto& v : r["numbers"]) {
+        ASSERT_TRUE(v.is_number_integer());
+        sum += v.get<long long>();
+    }
+    EXPECT_EQ(sum, 6);
+    EXPECT_FALSE(json(1.5).is_number_integer());
+    EXPECT_THROW(r["id"].begin(), json::type_error);
+}
+
+// Helper: true if `inner` points into the memory of `outer`
+static bool points_into(std::string_view inner, const std::string& outer) {
+    return inner.data() >= outer.data() && inner.data() + inner.size() <= outer.data() + outer.size();
+}
+
+TEST(JsonView, UnescapedStringsAreViewsIntoInput) {
+    const std::string txt = R"({"id":"req-1","type":"exec","payload":{"action":"echo","message":"hi"}})";
+    json_view v = json::parse_view(txt);
+    ASSERT_TRUE(v.is_object());
+    EXPECT_EQ(v["id"].get<std::string_view>(), "req-1");
+    EXPECT_TRUE(points_into(v["id"].get_string(), txt));
+    EXPECT_TRUE(points_into(v["payload"]["message"].get_string(), txt));
+    // keys are views too
+    EXPECT_TRUE(points_into(v.as_object().front().first, txt));
+}
+
+TEST(JsonView, EscapedStringsAreDecoded) {
+    const std::string txt = R"({"s":"Line1\nQuote\"П","k\tey":1})";
+    json_view v = json::parse_view(txt);
+    EXPECT_EQ(v["s"].get<std::string>(), std::string("Line1\nQuote\"") + u8"П");
+    EXPECT_FALSE(points_into(v["s"].get_string(), txt));
+    EXPECT_TRUE(v.contains("k\tey"));
+}
+
+TEST(JsonView, NumbersAndLiterals) {
+    json_view v = json::parse_view(R"([123,-45.5,1e3,-2.5E-1,true,false,null])");
+    ASSERT_EQ(v.size(), 7u);
+    EXPECT_DOUBLE_EQ(v[0].get_number(), 123.0);
+    EXPECT_DOUBLE_EQ(v[1].get_number(), -45.5);
+    EXPECT_DOUBLE_EQ(v[2].get_number(), 1000.0);
+    EXPECT_DOUBLE_EQ(v[3].get_number(), -0.25);
+    EXPECT_TRUE(v[4].get_boolean());
+    EXPECT_FALSE(v[5].get_boolean());
+    EXPECT_TRUE(v[6].is_null());
+}
+
+TEST(JsonView, LookupSemantics) {
+    json_view v = json::parse_view(R"({"a":1,"a":2,"b":[]})");
+    EXPECT_DOUBLE_EQ(v["a"].get_number(), 1.0); // first occurrence, like json::parse
+    EXPECT_EQ(v.find("missing"), nullptr);
+    EXPECT_THROW(v["missing"], json::type_error);
+    EXPECT_THROW(v["b"][0], json::type_error);
+}
+
+TEST(JsonView, ToJsonMatchesParse) {
+    const std::string txt = R"({"b":[1,2,{"c":"x\\y"}],"a":null,"d":true})";
+    json a = json::parse(txt);
+    json b = json::parse_view(txt).to_json();
+    EXPECT_EQ(a.dump(), b.dump());
+}
+
+TEST(JsonView, RejectsMalformedInput) {
+    EXPECT_THROW(json::parse_view(R"({"id":"x")"), json::parse_error);
+    EXPECT_THROW(json::parse_view(R"({"s":"bad\qescape"})"), json::parse_error);
+    EXPECT_THROW(json::parse_view(R"({"s":"unterminated})"), json::parse_error);
+    EXPECT_THROW(json::parse_view("[1,2] trailing"), json::parse_error);
+    EXPECT_THROW(json::parse_view("-"), json::parse_error);
+    EXPECT_THROW(json::parse_view("1e999"), json::parse_error);
+}
+
+// memory_resource that counts allocations and forwards to an upstream resource
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : upstream_(upstream) {}
+    size_t allocations = 0;
+
+private:
+    void* do_allocate(size_t bytes, size_t align) override { ++allocations; return upstream_->allocate(bytes, align); }
+    void do_deallocate(void* p, size_t bytes, size_t align) override { upstream_->deallocate(p, bytes, align); }
+    bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override { return this == &o; }
+    std::pmr::memory_resource* upstream_;
+};
+
+TEST(PmrJson, ParsedTreeAllocatesFromCurrentArena) {
+    const std::string txt = R"({"id":"req-1","type":"exec","payload":{"action":"echo","message":"a string too long for SSO"}})";
+    CountingResource arena;
+    CountingResource outside;
+    std::pmr::memory_resource* prev = std::pmr::set_default_resource(&outside);
+    {
+        nlohmann::pmr::arena_scope scope(&arena);
+        nlohmann::pmr::json msg = nlohmann::pmr::json::parse(txt);
+        EXPECT_EQ(msg["payload"]["message"].get<std::string>(), "a string too long for SSO");
+        EXPECT_EQ(msg.dump(), json::parse(txt).dump());
+    }
+    std::pmr::set_default_resource(prev);
+    EXPECT_GT(arena.allocations, 0u);
+    EXPECT_EQ(outside.allocations, 0u);
+}
+
+TEST(PmrJson, MonotonicArenaCanBeReleasedPerMessage) {
+    alignas(std::max_align_t) static char buf[4096];
+    std::pmr::monotonic_buffer_resource arena(buf, sizeof(buf), std::pmr::null_memory_resource());
+    for (int i = 0; i < 100; ++i) {
+        {
+            nlohmann::pmr::arena_scope scope(&arena);
+            nlohmann::pmr::json r = { {"id", std::to_string(i)}, {"status", "ok"}, {"body", { {"n", i} }} };
+            EXPECT_EQ(r["body"]["n"].get<int>(), i);
+        }
+        arena.release(); // would exhaust the 4 KiB buffer (and throw) without the reset
+    }
+}
+
+TEST(PmrJson, CopiesFollowTheCurrentArena) {
+    CountingResource a;
+    CountingResource b;
+    std::unique_ptr<nlohmann::pmr::json> copy;
+    {
+        nlohmann::pmr::arena_scope scope(&a);
+        nlohmann::pmr::json src = nlohmann::pmr::json::parse(R"({"numbers":[1,2,3],"message":"copied across arenas"})");
+        size_t before = b.allocations;
+        {
+            nlohmann::pmr::arena_scope inner(&b);
+            copy = std::make_unique<nlohmann::pmr::json>(src);
+        }
+        EXPECT_GT(b.allocations, before);
+    }
+    // the source and `a`'s scope are gone; the copy only depends on `b`
+    EXPECT_EQ(copy->dump(), R"({"message":"copied across arenas","numbers":[1,2,3]})");
+}
+
+TEST(OrderedJson, KeepsInsertionOrder) {
+    nlohmann::ordered_json j = nlohmann::ordered_json::parse(R"({"z":1,"a":{"y":2,"b":3},"m":[],"z":4})");
+    EXPECT_EQ(j.dump(), R"({"z":1,"a":{"y":2,"b":3},"m":[]})"); // duplicate key: first one wins, as for json
+    j["c"] = "new";
+    j["a"]["y"] = 5;
+    EXPECT_EQ(j.dump(), R"({"z":1,"a":{"y":5,"b":3},"m":[],"c":"new"})");
+    EXPECT_EQ(nlohmann::ordered_json::from_cbor(j.to_cbor()).dump(), j.dump());
+    nlohmann::ordered_json r = { {"id", "x"}, {"status", "ok"}, {"code", 0} };
+    EXPECT_EQ(r.dump(), R"({"id":"x","status":"ok","code":0})");
+}
+
+TEST(OrderedJson, LookupsAcrossIndexThreshold) {
+    nlohmann::ordered_json j;
+    for (int i = 0; i < 300; ++i) {
+        j["key" + std::to_string(i)] = i;
+        // every key stays reachable while the object switches from scans to the index and grows it
+        for (int k = 0; k <= i; k += 7) ASSERT_EQ(j["key" + std::to_string(k)].get<int>(), k);
+        EXPECT_FALSE(j.contains("key" + std::to_string(i + 1)));
+    }
+    EXPECT_EQ(j.size(), 300u);
+    EXPECT_TRUE(j.as_object().indexed());
+    EXPECT_EQ(j.as_object().begin()->first, "key0");
+    nlohmann::ordered_json copy = j;
+    EXPECT_EQ(copy["key299"].get<int>(), 299);
+    EXPECT_EQ(copy.dump(), j.dump());
+    EXPECT_FALSE(nlohmann::ordered_json::parse(R"({"a":1})").as_object().indexed());
+}
+
+TEST(OrderedJson, ArenaBackedFlavour) {
+    CountingResource arena;
+    CountingResource outside;
+    std::pmr::memory_resource* prev = std::pmr::set_default_resource(&outside);
+    {
+        nlohmann::pmr::arena_scope scope(&arena);
+        std::string txt = "{";
+        for (int i = 0; i < 20; ++i) txt += (i ? ",\"k" : "\"k") + std::to_string(i) + "\":" + std::to_string(i);
+        txt += "}";
+        nlohmann::pmr::ordered_json msg = nlohmann::pmr::ordered_json::parse(txt);
+        EXPECT_EQ(msg.dump(), txt);
+        EXPECT_EQ(msg["k13"].get<int>(), 13);
+    }
+    std::pmr::set_default_resource(prev);
+    EXPECT_GT(arena.allocations, 0u);
+    EXPECT_EQ(outside.allocations, 0u);
+}
+
+TEST(VendoredJson, IntegersAreExact) {
+    json j = json::parse("[9007199254740993,-9223372036854775808,9223372036854775807,9223372036854775808,1.0]");
+    EXPECT_EQ(j.dump(), "[9007199254740993,-9223372036854775808,9223372036854775807,9.22337203685478e+18,1]");
+    EXPECT_EQ(j[0].get<long long>(), 9007199254740993LL);
+    EXPECT_TRUE(j[2].is_number_integer());
+    EXPECT_FALSE(j[3].is_number_integer()); // 2^63 does not fit: stored as double
+    EXPECT_TRUE(j[4].is_number_integer());  // integral double
+    EXPECT_EQ(json(std::numeric_limits<uint64_t>::max()).dump(), "1.84467440737096e+19");
+    EXPECT_EQ(json::from_cbor(j.to_cbor()).dump(), j.dump());
+}
+
+TEST(VendoredJson, DumpToAppendsIntoReusedBuffer) {
+    json a = { {"id", "1"}, {"status", "ok"} };
+    std::string buf = "prefix:";
+    a.dump_to(buf);
+    EXPECT_EQ(buf, R"(prefix:{"id":"1","status":"ok"})");
+
+    buf.clear();
+    const size_t cap = (a.dump_to(buf), buf.capacity());
+    for (int i = 0; i < 10; ++i) { buf.clear(); a.dump_to(buf); }
+    EXPECT_EQ(buf.capacity(), cap); // no regrowth once the buffer is warm
+    EXPECT_EQ(buf, a.dump());
+}
+
+TEST(VendoredJson, NumberFormatting) {
+    EXPECT_EQ(json(123).dump(), "123");
+    EXPECT_EQ(json(-7).dump(), "-7");
+    EXPECT_EQ(json(1791988368L).dump(), "1791988368");
+    EXPECT_EQ(json(1.5).dump(), "1.5");
+    EXPECT_EQ(json(0.1).dump(), "0.1");
+    EXPECT_EQ(json(3.14159265358979).dump(), "3.14159265358979");
+    EXPECT_EQ(json(1e15).dump(), "1e+15");
+    EXPECT_EQ(json(-2.5e-7).dump(), "-2.5e-07");
+    EXPECT_EQ(json(0.0).dump(), "0");
+    EXPECT_EQ(json(-0.0).dump(), "-0");
+    EXPECT_EQ(json(std::numeric_limits<double>::infinity()).dump(), "null");
+}
+
+TEST(VendoredJson, StringEscaping) {
+    json s = std::string("plain \"quoted\" back\\slash\n\t\x01 end");
+    EXPECT_EQ(s.dump(), R"("plain \"quoted\" back\\slash\n\t\u0001 end")");
+    json k = { {"k\"ey", "v"} };
+    EXPECT_EQ(k.dump(), R"({"k\"ey":"v"})");
+    EXPECT_EQ(json::parse(s.dump()).get<std::string>(), s.get<std::string>());
+}
+
+TEST(VendoredJson, PrettyDump) {
+    json j = json::parse(R"({"a":[1,{}],"b":"x"})");
+    EXPECT_EQ(j.dump(2), "{\n  \"a\": [\n    1,\n    {}\n  ],\n  \"b\": \"x\"\n}");
+    EXPECT_EQ(j.dump(0), j.dump());
+}
+
+TEST(LazyJson, ReadsOnlyWhatIsAccessed) {
+    const std::string txt = R"({"action":"compute","big":{"deep":[1,[2,[3]],"\u0041"]},"numbers":[1,-2,30000000000],)"
+                            R"("k\"ey":true,"action":"second","f":2.5,"s":"a\nb"})";
+    nlohmann::lazy_json v = json::parse_lazy(txt);
+    ASSERT_TRUE(v.is_object());
+    EXPECT_EQ(v["action"].get<std::string>(), "compute"); // first key wins, as for json
+    EXPECT_EQ(v["action"].get<std::string_view>(), "compute");
+    EXPECT_TRUE(points_into(v["action"].raw(), txt));
+    EXPECT_TRUE(v.contains("k\"ey"));
+    EXPECT_TRUE(v["k\"ey"].get<bool>());
+    EXPECT_FALSE(v.contains("missing"));
+    EXPECT_THROW(v["missing"], json::type_error);
+    EXPECT_EQ(v["s"].get<std::string>(), "a\nb");
+    EXPECT_THROW(v["s"].get<std::string_view>(), json::type_error); // escaped: needs decoding
+    EXPECT_EQ(v["f"].get<double>(), 2.5);
+    EXPECT_FALSE(v["f"].is_number_integer());
+    EXPECT_EQ(v.size(), 7u);
+
+    const nlohmann::lazy_json nums = v["numbers"];
+    ASSERT_TRUE(nums.is_array());
+    EXPECT_EQ(nums.size(), 3u);
+    long long sum = 0;
+    for (const auto& n : nums) {
+        ASSERT_TRUE(n.is_number_integer());
+        sum += n.get<long long>();
+    }
+    EXPECT_EQ(sum, 29999999999LL);
+    EXPECT_EQ(nums[2].get<int64_t>(), 30000000000LL);
+    EXPECT_THROW(nums[3], json::type_error);
+    EXPECT_EQ(v["big"].to_json().dump(), R"({"deep":[1,[2,[3]],"A"]})");
+    EXPECT_THROW(v["action"].begin(), json::type_error);
+
+    nlohmann::lazy_json empty = json::parse_lazy(" [ ] ");
+    EXPECT_EQ(empty.size(), 0u);
+    EXPECT_TRUE(empty.begin() == empty.end());
+    EXPECT_EQ(json::parse_lazy("{}").size(), 0u);
+}
+
+TEST(LazyJson, ValidatesUpFront) {
+    EXPECT_THROW(json::parse_lazy(R"({"a":1,"b":[1,2})"), json::parse_error);
+    EXPECT_THROW(json::parse_lazy(R"({"a":"\x"})"), json::parse_error);
+    EXPECT_THROW(json::parse_lazy(R"({"a":1} 2)"), json::parse_error);
+    EXPECT_THROW(json::parse_lazy(""), json::parse_error);
+    EXPECT_NO_THROW(json::parse_lazy(R"( {"a":[{"b":null}],"c":-0.5e-3} )"));
+}
+
+TEST(LazyJson, RejectsExcessiveNesting) {
+    const size_t max = nlohmann::detail::json_max_depth;
+    auto nested = [](size_t depth) { return std::string(depth, '[') + std::string(depth, ']'); };
+    EXPECT_THROW(json::parse_lazy(nested(60000)), json::parse_error);
+    EXPECT_THROW(json::parse_lazy(R"({"action":"echo","x":)" + nested(max) + "}"), json::parse_error);
+
+    // at the limit: member skips, array walks and to_json() all complete
+    std::string deepest = R"({"x":)" + nested(max - 1) + R"(,"action":"echo"})";
+    nlohmann::lazy_json v = json::parse_lazy(deepest);
+    EXPECT_EQ(v["action"].get<std::string>(), "echo");
+    EXPECT_EQ(v["x"].size(), 1u);
+    EXPECT_EQ(v.to_json().dump().size(), deepest.size());
+}
+
+// Helper: bytes from a list of octets
+static std::string bytes(std::initializer_list<int> octets) {
+    std::string out;
+    for (int o : octets) out.push_back(static_cast<char>(o));
+    return out;
+}
+
+TEST(Cbor, EncodesRfc8949Examples) {
+    EXPECT_EQ(json(0).to_cbor(), bytes({0x00}));
+    EXPECT_EQ(json(23).to_cbor(), bytes({0x17}));
+    EXPECT_EQ(json(24).to_cbor(), bytes({0x18, 0x18}));
+    EXPECT_EQ(json(1000).to_cbor(), bytes({0x19, 0x03, 0xe8}));
+    EXPECT_EQ(json(-1000).to_cbor(), bytes({0x39, 0x03, 0xe7}));
+    EXPECT_EQ(json(1000000).to_cbor(), bytes({0x1a, 0x00, 0x0f, 0x42, 0x40}));
+    EXPECT_EQ(json(1.5).to_cbor(), bytes({0xfa, 0x3f, 0xc0, 0x00, 0x00}));
+    EXPECT_EQ(json(1.1).to_cbor(), bytes({0xfb, 0x3f, 0xf1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a}));
+    EXPECT_EQ(json(nullptr).to_cbor(), bytes({0xf6}));
+    EXPECT_EQ(json(true).to_cbor(), bytes({0xf5}));
+    EXPECT_EQ(json("a").to_cbor(), bytes({0x61, 0x61}));
+    EXPECT_EQ(json({1, 2}).to_cbor(), bytes({0x82, 0x01, 0x02}));
+    EXPECT_EQ(json({ {"a", 1} }).to_cbor(), bytes({0xa1, 0x61, 0x61, 0x01}));
+}
+
+TEST(Cbor, RoundTripsEnvelopes) {
+    json j = json::parse(R"({"id":"r1","type":"exec","payload":{"action":"compute",)"
+                         R"("numbers":[1,-2,3000000000,-9007199254740993,0.25,1.1e300],"s":"\u00e9\n","ok":true,"n":null}})");
+    std::string buf = "prefix";
+    j.dump_cbor_to(buf);
+    ASSERT_EQ(buf.compare(0, 6, "prefix"), 0);
+    json back = json::from_cbor(std::string_view(buf).substr(6));
+    EXPECT_EQ(back.dump(), j.dump());
+
+    nlohmann::pmr::json pj = nlohmann::pmr::json::from_cbor(j.to_cbor());
+    EXPECT_EQ(pj.dump(), j.dump());
+}
+
+TEST(Cbor, DecodesFormsTheEncoderNeverEmits) {
+    EXPECT_EQ(json::from_cbor(bytes({0xf9, 0x3c, 0x00})).get_number(), 1.0);   // float16
+    EXPECT_EQ(json::from_cbor(bytes({0xf9, 0xc4, 0x00})).get_number(), -4.0);
+    EXPECT_EQ(json::from_cbor(bytes({0xf7})).is_null(), true);                 // undefined
+    EXPECT_EQ(json::from_cbor(bytes({0xc1, 0x1a, 0x51, 0x4b, 0x67, 0xb0})).get_number(), 1363896240.0); // tag 1
+    EXPECT_EQ(json::from_cbor(bytes({0x9f, 0x01, 0x82, 0x02, 0x03, 0xff})).dump(), "[1,[2,3]]");
+    EXPECT_EQ(json::from_cbor(bytes({0xbf, 0x61, 0x61, 0x01, 0xff})).dump(), R"({"a":1})");
+    EXPECT_EQ(json::from_cbor(bytes({0x7f, 0x62, 0x73, 0x74, 0x61, 0x72, 0xff})).get<std::string>(), "str");
+}
+
+TEST(Cbor, RejectsMalformedInput) {
+    EXPECT_THROW(json::from_cbor(""), json::parse_error);
+    EXPECT_THROW(json::from_cbor(bytes({0x19, 0x03})), json::parse_error);             // truncated uint16
+    EXPECT_THROW(json::from_cbor(bytes({0x63, 0x61, 0x62})), json::parse_error);       // short string
+    EXPECT_THROW(json::from_cbor(bytes({0x9b, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff})),
+                 json::parse_error);                                                  // huge array count
+    EXPECT_THROW(json::from_cbor(bytes({0xa1, 0x01, 0x02})), json::parse_error);       // non-text key
+    EXPECT_THROW(json::from_cbor(bytes({0x41, 0x00})), json::parse_error);             // byte string
+    EXPECT_THROW(json::from_cbor(bytes({0x9f, 0x01})), json::parse_error);             // missing break
+    EXPECT_THROW(json::from_cbor(bytes({0x01, 0x02})), json::parse_error);             // trailing bytes
+    EXPECT_THROW(json::from_cbor(std::string(1000, static_cast<char>(0x81)) + bytes({0x00})),
+                 json::parse_error);                                                  // nesting depth
+}
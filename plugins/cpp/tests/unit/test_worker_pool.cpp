@@ -0,0 +1,221 @@
+// plugins/cpp/tests/unit/test_worker_pool.cpp
+//
+// Unit tests for the exec worker pool used by the C++ plugin
+// (plugins/cpp/worker_pool.hpp). Written with Google Test and linked into the
+// same test binary as the other unit tests.
+//
+// The test suite checks:
+//  - every submitted task runs exactly once, so each request id is answered once
+//  - a throwing task does not take its worker down
+//  - drain() (shutdown) and the destructor (EOF) wait for queued and running tasks
+//  - try_submit() refuses tasks beyond the in-flight and byte limits, always
+//    admits into an idle pool, and releases capacity as tasks finish
+//  - the mean task time is tracked
+//  - Control tasks run while Bulk tasks occupy every worker they may use, and
+//    each lane is admitted against the limits on its own
+//  - tasks queued in a busy worker's shard are taken by idle workers
+//  - a lazy pool starts its threads with the first task, and drains and
+//    destroys cleanly when it never got one
+//
+// Keep tests small, deterministic and safe to run inside CI.
+//
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "../../worker_pool.hpp"
+
+using omniflow::WorkerPool;
+
+namespace {
+
+// Holds tasks until released, so the pool's occupancy is known
+class Gate {
+public:
+    void wait() {
+        std::unique_lock<std::mutex> lock(mu_);
+        cv_.wait(lock, [this] { return open_; });
+    }
+    void open() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            open_ = true;
+        }
+        cv_.notify_all();
+    }
+
+private:
+    std::mutex mu_;
+    std::condition_variable cv_;
+    bool open_ = false;
+};
+
+// Polls `done` for up to a few seconds (the pool has no completion hook)
+template <typename Pred>
+bool eventually(Pred done) {
+    auto until = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!done()) {
+        if (std::chrono::steady_clock::now() > until) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(WorkerPool, OneResponsePerId) {
+    std::mutex mu;
+    std::map<std::string, int> responses;
+    {
+        WorkerPool pool(4);
+        for (int i = 0; i < 200; ++i) {
+            std::string id = "req-" + std::to_string(i);
+            pool.submit([&mu, &responses, id] {
+                std::lock_guard<std::mutex> lock(mu);
+                ++responses[id];
+            });
+        }
+        pool.drain();
+        EXPECT_EQ(pool.pending(), 0u);
+    }
+    ASSERT_EQ(responses.size(), 200u);
+    for (const auto &kv : responses) EXPECT_EQ(kv.second, 1) << kv.first;
+}
+
+TEST(WorkerPool, ThrowingTaskKeepsWorkerAlive) {
+    std::atomic<int> ran{0};
+    WorkerPool pool(1);
+    pool.submit([] { throw std::runtime_error("handler bug"); });
+    pool.submit([&] { ran.fetch_add(1); });
+    pool.drain();
+    EXPECT_EQ(ran.load(), 1);
+}
+
+TEST(WorkerPool, DrainWaitsForQueuedAndRunning) {
+    std::atomic<int> done{0};
+    WorkerPool pool(2);
+    for (int i = 0; i < 8; ++i) {
+        pool.submit([&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            done.fetch_add(1);
+        });
+    }
+    // shutdown path: drain before acknowledging
+    pool.drain();
+    EXPECT_EQ(done.load(), 8);
+}
+
+TEST(WorkerPool, DestructorDrainsOnEof) {
+    std::atomic<int> done{0};
+    {
+        WorkerPool pool(2);
+        for (int i = 0; i < 8; ++i) {
+            pool.submit([&] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                done.fetch_add(1);
+            });
+        }
+        // EOF path: the plugin resets the pool without an explicit drain()
+    }
+    EXPECT_EQ(done.load(), 8);
+}
+
+TEST(WorkerPool, AdmissionLimits) {
+    Gate gate;
+    WorkerPool::Limits limits;
+    limits.max_inflight = 3;
+    limits.max_bytes = 100;
+    WorkerPool pool(1, limits);
+
+    EXPECT_TRUE(pool.try_submit([&] { gate.wait(); }, 500)); // idle pool: admitted despite the budget
+    EXPECT_FALSE(pool.try_submit([] {}, 1));                  // byte budget exhausted
+    gate.open();
+    pool.drain();
+    EXPECT_EQ(pool.pending_bytes(), 0u);
+
+    Gate second;
+    std::atomic<int> ran{0};
+    for (int i = 0; i < 3; ++i) EXPECT_TRUE(pool.try_submit([&] { second.wait(); ran.fetch_add(1); }, 10));
+    EXPECT_EQ(pool.pending(), 3u);
+    EXPECT_EQ(pool.pending_bytes(), 30u);
+    EXPECT_FALSE(pool.try_submit([&] { ran.fetch_add(1); }, 10)); // depth limit
+    second.open();
+    pool.drain();
+    EXPECT_EQ(ran.load(), 3);
+    EXPECT_TRUE(pool.try_submit([&] { ran.fetch_add(1); }, 10)); // room again
+    pool.drain();
+    EXPECT_EQ(ran.load(), 4);
+}
+
+TEST(WorkerPool, TracksMeanTaskTime) {
+    WorkerPool pool(2);
+    EXPECT_EQ(pool.mean_task_time().count(), 0);
+    for (int i = 0; i < 4; ++i) pool.submit([] { std::this_thread::sleep_for(std::chrono::milliseconds(2)); });
+    pool.drain();
+    EXPECT_GE(pool.mean_task_time(), std::chrono::microseconds(500));
+}
+
+TEST(WorkerPool, ControlLaneRunsBehindABulkBacklog) {
+    Gate gate;
+    std::atomic<int> control{0};
+    WorkerPool pool(2);
+    EXPECT_EQ(pool.bulk_slots(), 1u);
+    for (int i = 0; i < 8; ++i) pool.submit([&] { gate.wait(); }, WorkerPool::Lane::Bulk);
+    for (int i = 0; i < 5; ++i) pool.submit([&] { control.fetch_add(1); }, WorkerPool::Lane::Control);
+    EXPECT_TRUE(eventually([&] { return control.load() == 5; }));
+    EXPECT_EQ(pool.pending(WorkerPool::Lane::Bulk), 8u); // none finished, at most one started
+    gate.open();
+    pool.drain();
+    EXPECT_EQ(pool.pending(), 0u);
+}
+
+TEST(WorkerPool, LimitsApplyPerLane) {
+    Gate gate;
+    WorkerPool::Limits limits;
+    limits.max_inflight = 1;
+    WorkerPool pool(2, limits);
+    EXPECT_TRUE(pool.try_submit([&] { gate.wait(); }, 0, WorkerPool::Lane::Bulk));
+    EXPECT_FALSE(pool.try_submit([] {}, 0, WorkerPool::Lane::Bulk));
+    EXPECT_TRUE(pool.try_submit([&] { gate.wait(); }, 0, WorkerPool::Lane::Control)); // its own budget
+    EXPECT_FALSE(pool.try_submit([] {}, 0, WorkerPool::Lane::Control));
+    gate.open();
+    pool.drain();
+    EXPECT_TRUE(pool.try_submit([] {}, 0, WorkerPool::Lane::Bulk));
+}
+
+TEST(WorkerPool, IdleWorkersTakeFromABusyOnesShard) {
+    Gate gate;
+    std::atomic<int> ran{0};
+    WorkerPool pool(3);
+    pool.submit([&] { gate.wait(); }, WorkerPool::Lane::Control);
+    // round-robin puts a third of these in the blocked worker's shard
+    for (int i = 0; i < 30; ++i) pool.submit([&] { ran.fetch_add(1); }, WorkerPool::Lane::Control);
+    EXPECT_TRUE(eventually([&] { return ran.load() == 30; }));
+    gate.open();
+    pool.drain();
+}
+
+TEST(WorkerPool, LazyPoolStartsWithItsFirstTask) {
+    {
+        WorkerPool idle(4, WorkerPool::Limits(), true);
+        EXPECT_FALSE(idle.started());
+        EXPECT_EQ(idle.size(), 4u);
+        idle.drain(); // nothing queued: returns at once
+    }
+
+    std::atomic<int> ran{0};
+    WorkerPool pool(2, WorkerPool::Limits(), true);
+    EXPECT_FALSE(pool.started());
+    EXPECT_TRUE(pool.try_submit([&] { ran.fetch_add(1); }, 0));
+    EXPECT_TRUE(pool.started());
+    for (int i = 0; i < 99; ++i) pool.submit([&] { ran.fetch_add(1); });
+    pool.drain();
+    EXPECT_EQ(ran.load(), 100);
+}
@@ -5,10 +5,22 @@
  *   Lightweight vendor header that provides a small `nlohmann::json`-like API
  *   sufficient for the OmniFlow C++ plugins' unit/integration tests and simple
  *   runtime needs.  It supports:
- *     - objects (string->value), arrays, strings, numbers (double), booleans, null
- *     - parsing from std::string: json::parse(...)
- *     - serializing to string: json::dump()
- *     - operator[] for objects and arrays
+ *     - objects (string->value), arrays, strings, numbers (exact int64 or
+ *       double), booleans, null
+ *     - parsing from std::string / std::string_view: json::parse(...); every
+ *       text parser rejects nesting deeper than detail::json_max_depth (512)
+ *     - allocation-light, read-only parsing: json::parse_view(...) -> json_view
+ *     - on-demand reading: json::parse_lazy(...) -> lazy_json (validate once,
+ *       parse members only when they are accessed)
+ *     - arena-backed trees: nlohmann::pmr::json (basic_json<pmr::arena_allocator>)
+ *     - object storage chosen at compile time: sorted std::map (json) or
+ *       insertion-ordered flat storage with a hash index (ordered_json)
+ *     - serializing to string: json::dump(), or appending into a reusable
+ *       buffer without temporaries: json::dump_to(std::string&)
+ *     - CBOR (RFC 8949) encoding and decoding: json::dump_cbor_to(std::string&),
+ *       json::from_cbor(...) - the plugins' binary transport
+ *     - brace initialization: json j = { {"id", id}, {"status", "ok"} }
+ *     - operator[] for objects and arrays, range-for over arrays
  *     - basic type queries: is_object(), is_array(), is_string(), is_number(), is_boolean(), is_null()
  *     - getters: get<T>()
  *
@@ -43,6 +55,19 @@
  *   std::string id = j["id"].get<std::string>();
  *   std::string s = j.dump();
  *
+ *   // zero-copy: strings without escapes point into `line` (keep it alive)
+ *   nlohmann::json_view v = json::parse_view(line);
+ *   std::string_view type = v["type"].get<std::string_view>();
+ *
+ *   // per-message arena: every node of `msg` comes from `arena`
+ *   std::pmr::monotonic_buffer_resource arena;
+ *   {
+ *       nlohmann::pmr::arena_scope scope(&arena);
+ *       nlohmann::pmr::json msg = nlohmann::pmr::json::parse(line);
+ *       ...
+ *   }                  // msg destroyed first,
+ *   arena.release();   // then all of its memory at once
+ *
  * Note: This header targets C++17 and above.
  */
 
@@ -50,121 +75,756 @@
 #define OMNIFLOW_THIRD_PARTY_NLOHMANN_JSON_HPP
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <deque>
+#include <functional>
 #include <map>
+#include <memory_resource>
+#include <initializer_list>
+#include <iterator>
 #include <variant>
 #include <memory>
 #include <stdexcept>
-#include <sstream>
 #include <cctype>
+#include <cerrno>
+#include <charconv>
 #include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <limits>
 #include <type_traits>
+#include <utility>
 
 namespace nlohmann {
 
-class json {
+class json_view;
+class lazy_json;
+
+namespace detail {
+
+// Exceptions (shared by every basic_json instantiation and json_view)
+struct parse_error : public std::runtime_error { parse_error(const std::string& s):std::runtime_error(s){} };
+struct type_error  : public std::runtime_error { type_error(const std::string& s):std::runtime_error(s){} };
+
+inline size_t skip_ws(std::string_view s, size_t idx) {
+    while (idx < s.size() && std::isspace(static_cast<unsigned char>(s[idx]))) ++idx;
+    return idx;
+}
+
+// Decode the string literal at s[idx] (s[idx] == '"') into `out`; advances idx
+// past the closing quote. Templated so each json flavour decodes straight into
+// its own string type.
+template<typename String>
+void decode_string(std::string_view s, size_t& idx, String& out) {
+    // assumes s[idx] == '"'
+    ++idx;
+    while (idx < s.size()) {
+        char c = s[idx++];
+        if (c == '"') return;
+        if (c == '\\') {
+            if (idx >= s.size()) throw parse_error("Invalid escape sequence");
+            char esc = s[idx++];
+            switch (esc) {
+                case '"': out.push_back('"'); break;
+                case '\\': out.push_back('\\'); break;
+                case '/': out.push_back('/'); break;
+                case 'b': out.push_back('\b'); break;
+                case 'f': out.push_back('\f'); break;
+                case 'n': out.push_back('\n'); break;
+                case 'r': out.push_back('\r'); break;
+                case 't': out.push_back('\t'); break;
+                case 'u': {
+                    // parse \uXXXX (basic BMP only)
+                    if (idx + 4 > s.size()) throw parse_error("Invalid unicode escape");
+                    unsigned int code = 0;
+                    for (int i = 0; i < 4; ++i) {
+                        char h = s[idx++];
+                        code <<= 4;
+                        if (h >= '0' && h <= '9') code |= (h - '0');
+                        else if (h >= 'A' && h <= 'F') code |= (10 + h - 'A');
+                        else if (h >= 'a' && h <= 'f') code |= (10 + h - 'a');
+                        else throw parse_error("Invalid hex in unicode escape");
+                    }
+                    // encode UTF-8 for BMP
+                    if (code <= 0x7F) out.push_back(static_cast<char>(code));
+                    else if (code <= 0x7FF) {
+                        out.push_back(static_cast<char>(0xC0 | ((code >> 6) & 0x1F)));
+                        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+                    } else {
+                        out.push_back(static_cast<char>(0xE0 | ((code >> 12) & 0x0F)));
+                        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+                        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+                    }
+                } break;
+                default:
+                    throw parse_error("Invalid escape character");
+            }
+        } else {
+            out.push_back(c);
+        }
+    }
+    throw parse_error("Unterminated string");
+}
+
+// Validate the JSON number grammar at s[idx]; advances idx past the number.
+// Returns true for an integer literal (no fraction, no exponent).
+inline bool scan_number_token(std::string_view s, size_t& idx) {
+    bool integral = true;
+    if (s[idx] == '-') ++idx;
+    bool has_digits = false;
+    while (idx < s.size() && s[idx] >= '0' && s[idx] <= '9') { ++idx; has_digits=true; }
+    if (!has_digits) throw parse_error("Invalid number");
+    if (idx < s.size() && s[idx] == '.') {
+        integral = false;
+        ++idx;
+        if (idx >= s.size() || !(s[idx] >= '0' && s[idx] <= '9')) throw parse_error("Invalid number fraction");
+        while (idx < s.size() && s[idx] >= '0' && s[idx] <= '9') ++idx;
+    }
+    if (idx < s.size() && (s[idx] == 'e' || s[idx] == 'E')) {
+        integral = false;
+        ++idx;
+        if (idx < s.size() && (s[idx] == '+' || s[idx] == '-')) ++idx;
+        if (idx >= s.size() || !(s[idx] >= '0' && s[idx] <= '9')) throw parse_error("Invalid number exponent");
+        while (idx < s.size() && s[idx] >= '0' && s[idx] <= '9') ++idx;
+    }
+    return integral;
+}
+
+// Convert a validated number token in place (no temporary token string).
+inline double token_to_double(const char* first, const char* last) {
+    double val = 0.0;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    auto res = std::from_chars(first, last, val);
+    if (res.ec != std::errc() || res.ptr != last) throw parse_error("Number conversion error");
+#else
+    // strtod needs a terminator; digits of a JSON number almost always fit on the stack
+    char buf[64];
+    std::string big;
+    const char* token = buf;
+    size_t len = static_cast<size_t>(last - first);
+    if (len < sizeof(buf)) { std::memcpy(buf, first, len); buf[len] = '\0'; }
+    else { big.assign(first, len); token = big.c_str(); }
+    char* endptr = nullptr;
+    errno = 0;
+    val = std::strtod(token, &endptr);
+    if (endptr != token + len || errno == ERANGE) throw parse_error("Number conversion error");
+#endif
+    return val;
+}
+
+// Validate and convert the JSON number at s[idx]; advances idx past it.
+inline double scan_number(std::string_view s, size_t& idx) {
+    size_t start = idx;
+    scan_number_token(s, idx);
+    return token_to_double(s.data() + start, s.data() + idx);
+}
+
+// As scan_number, but an integer literal that fits int64_t is converted
+// exactly into `exact` (returns true); anything else goes to `d`.
+inline bool scan_number_exact(std::string_view s, size_t& idx, int64_t& exact, double& d) {
+    size_t start = idx;
+    const char* first = s.data() + start;
+    if (scan_number_token(s, idx)) {
+        auto res = std::from_chars(first, s.data() + idx, exact);
+        if (res.ec == std::errc() && res.ptr == s.data() + idx) return true;
+    }
+    d = token_to_double(first, s.data() + idx);
+    return false;
+}
+
+// Validate the string literal at s[idx] (s[idx] == '"') without decoding it;
+// advances idx past the closing quote. Returns true if it contains escapes.
+inline bool skip_string(std::string_view s, size_t& idx) {
+    bool escaped = false;
+    ++idx;
+    while (idx < s.size()) {
+        char c = s[idx++];
+        if (c == '"') return escaped;
+        if (c != '\\') continue;
+        escaped = true;
+        if (idx >= s.size()) throw parse_error("Invalid escape sequence");
+        switch (s[idx++]) {
+            case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't': break;
+            case 'u':
+                if (idx + 4 > s.size()) throw parse_error("Invalid unicode escape");
+                for (int i = 0; i < 4; ++i, ++idx)
+                    if (!std::isxdigit(static_cast<unsigned char>(s[idx]))) throw parse_error("Invalid hex in unicode escape");
+                break;
+            default: throw parse_error("Invalid escape character");
+        }
+    }
+    throw parse_error("Unterminated string");
+}
+
+// Deepest nesting of arrays and objects the text parsers accept. They
+// recurse once per level, so without a limit a short line of '[' overflows
+// the stack; 512 is far beyond any protocol message.
+constexpr size_t json_max_depth = 512;
+
+inline void check_depth(size_t depth) {
+    if (depth >= json_max_depth) throw parse_error("JSON nesting too deep");
+}
+
+// Validate the JSON value at s[idx] without building anything (same grammar
+// and error messages as basic_json::parse); advances idx past the value.
+// Used to step over members a caller does not need. `depth` is the number of
+// arrays and objects the value is nested in. Iterative, with the open
+// containers in a fixed array, so its stack use does not grow with the
+// nesting: it also runs on host threads (plugin ABI) with small stacks.
+inline void skip_value(std::string_view s, size_t& idx, size_t depth = 0) {
+    char open[json_max_depth]; // '{' or '[' of each container entered
+    size_t n = 0;
+    auto member_key = [&] {
+        idx = skip_ws(s, idx);
+        if (idx >= s.size() || s[idx] != '"') throw parse_error("Expected string for object key");
+        skip_string(s, idx);
+        idx = skip_ws(s, idx);
+        if (idx >= s.size() || s[idx] != ':') throw parse_error("Expected ':' after object key");
+        ++idx;
+    };
+    for (;;) {
+        idx = skip_ws(s, idx);
+        if (idx >= s.size()) throw parse_error("Unexpected end of input");
+        char c = s[idx];
+        if (c == '{' || c == '[') {
+            check_depth(depth + n);
+            idx = skip_ws(s, idx + 1);
+            if (idx < s.size() && s[idx] == (c == '{' ? '}' : ']')) {
+                ++idx; // empty: complete
+            } else {
+                open[n++] = c;
+                if (c == '{') member_key();
+                continue; // its first value
+            }
+        } else if (c == '"') {
+            skip_string(s, idx);
+        } else if (c == 'n') {
+            if (s.compare(idx, 4, "null") != 0) throw parse_error("Invalid token (expected null)");
+            idx += 4;
+        } else if (c == 't') {
+            if (s.compare(idx, 4, "true") != 0) throw parse_error("Invalid token (expected true)");
+            idx += 4;
+        } else if (c == 'f') {
+            if (s.compare(idx, 5, "false") != 0) throw parse_error("Invalid token (expected false)");
+            idx += 5;
+        } else if (c == '-' || (c >= '0' && c <= '9')) {
+            scan_number_token(s, idx);
+        } else {
+            throw parse_error(std::string("Unexpected character '") + c + "'");
+        }
+
+        // A value is complete: close the containers it ends, or move on to
+        // the next member or element of the innermost one.
+        bool more = false;
+        while (n > 0 && !more) {
+            idx = skip_ws(s, idx);
+            bool object = open[n - 1] == '{';
+            if (idx >= s.size()) throw parse_error(object ? "Unterminated object" : "Unterminated array");
+            if (s[idx] == ',') {
+                ++idx;
+                if (object) member_key();
+                more = true;
+            } else if (s[idx] == (object ? '}' : ']')) {
+                ++idx;
+                --n;
+            } else {
+                throw parse_error(object ? "Expected ',' or '}' in object" : "Expected ',' or ']' in array");
+            }
+        }
+        if (!more) return;
+    }
+}
+
+// Append `s` as a quoted JSON string. Runs of characters that need no escaping
+// are copied with a single append.
+inline void append_escaped(std::string& out, std::string_view s) {
+    static const char hex[] = "0123456789abcdef";
+    out.push_back('"');
+    size_t run = 0;
+    for (size_t i = 0; i < s.size(); ++i) {
+        unsigned char ch = static_cast<unsigned char>(s[i]);
+        if (ch >= 0x20 && ch != '"' && ch != '\\') continue;
+        out.append(s.data() + run, i - run);
+        run = i + 1;
+        switch (ch) {
+            case '"': out.append("\\\"", 2); break;
+            case '\\': out.append("\\\\", 2); break;
+            case '\b': out.append("\\b", 2); break;
+            case '\f': out.append("\\f", 2); break;
+            case '\n': out.append("\\n", 2); break;
+            case '\r': out.append("\\r", 2); break;
+            case '\t': out.append("\\t", 2); break;
+            default: {
+                // control -> \u00XX
+                const char esc[6] = { '\\', 'u', '0', '0', hex[ch >> 4], hex[ch & 0xF] };
+                out.append(esc, sizeof(esc));
+            }
+        }
+    }
+    out.append(s.data() + run, s.size() - run);
+    out.push_back('"');
+}
+
+inline void append_integer(std::string& out, int64_t v) {
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, static_cast<size_t>(res.ptr - buf));
+}
+
+// Append a number formatted like printf("%.15g"); non-finite numbers -> null.
+inline void append_number(std::string& out, double v) {
+    if (!std::isfinite(v)) { out.append("null", 4); return; }
+    char buf[32];
+    // integral values below 1e15 print identically through the integer path,
+    // except -0.0, which would lose its sign there
+    if (std::trunc(v) == v && std::fabs(v) < 1e15 && !(v == 0 && std::signbit(v))) {
+        auto res = std::to_chars(buf, buf + sizeof(buf), static_cast<long long>(v));
+        out.append(buf, static_cast<size_t>(res.ptr - buf));
+        return;
+    }
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    auto res = std::to_chars(buf, buf + sizeof(buf), v, std::chars_format::general,
+                             std::numeric_limits<double>::digits10);
+    out.append(buf, static_cast<size_t>(res.ptr - buf));
+#else
+    int n = std::snprintf(buf, sizeof(buf), "%.*g", std::numeric_limits<double>::digits10, v);
+    out.append(buf, static_cast<size_t>(n));
+#endif
+}
+
+// ---------- CBOR (RFC 8949) ----------
+//
+// Only the subset that maps onto the JSON data model is produced: unsigned and
+// negative integers, text strings, definite-length arrays and maps with text
+// keys, float32/float64, false/true/null. The decoder additionally accepts
+// float16, indefinite lengths, `undefined` (as null) and skips tags.
+
+constexpr size_t cbor_max_depth = 512;
+
+// Append an initial byte of major type `major` with argument `v`, using the
+// shortest encoding.
+inline void append_cbor_head(std::string& out, uint8_t major, uint64_t v) {
+    const char m = static_cast<char>(major << 5);
+    if (v < 24) { out.push_back(static_cast<char>(m | static_cast<char>(v))); return; }
+    int bytes;
+    if (v <= 0xFF) { out.push_back(static_cast<char>(m | 24)); bytes = 1; }
+    else if (v <= 0xFFFF) { out.push_back(static_cast<char>(m | 25)); bytes = 2; }
+    else if (v <= 0xFFFFFFFFu) { out.push_back(static_cast<char>(m | 26)); bytes = 4; }
+    else { out.push_back(static_cast<char>(m | 27)); bytes = 8; }
+    for (int i = bytes - 1; i >= 0; --i) out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+}
+
+inline void append_cbor_integer(std::string& out, int64_t i) {
+    if (i >= 0) append_cbor_head(out, 0, static_cast<uint64_t>(i));
+    else append_cbor_head(out, 1, static_cast<uint64_t>(-(i + 1)));
+}
+
+inline void append_cbor_number(std::string& out, double v) {
+    constexpr double lo = static_cast<double>(std::numeric_limits<long long>::min());
+    if (std::trunc(v) == v && v >= lo && v < -lo) {
+        append_cbor_integer(out, static_cast<int64_t>(v));
+        return;
+    }
+    uint64_t bits;
+    const bool fits_float = !std::isfinite(v) ||
+        (std::fabs(v) <= std::numeric_limits<float>::max() &&
+         static_cast<double>(static_cast<float>(v)) == v);
+    if (fits_float && !std::isnan(v)) {
+        float f = static_cast<float>(v);
+        uint32_t b;
+        std::memcpy(&b, &f, sizeof(b));
+        out.push_back(static_cast<char>(0xFA));
+        bits = b;
+        for (int i = 3; i >= 0; --i) out.push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+        return;
+    }
+    std::memcpy(&bits, &v, sizeof(bits));
+    out.push_back(static_cast<char>(0xFB));
+    for (int i = 7; i >= 0; --i) out.push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+}
+
+inline uint64_t read_cbor_be(std::string_view s, size_t& idx, int bytes) {
+    if (s.size() - idx < static_cast<size_t>(bytes)) throw parse_error("Truncated CBOR item");
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; ++i) v = (v << 8) | static_cast<unsigned char>(s[idx++]);
+    return v;
+}
+
+// Argument of an initial byte with additional info `info`; sets `indefinite`
+// for info 31 (break-terminated item).
+inline uint64_t read_cbor_arg(std::string_view s, size_t& idx, uint8_t info, bool& indefinite) {
+    indefinite = false;
+    if (info < 24) return info;
+    switch (info) {
+        case 24: return read_cbor_be(s, idx, 1);
+        case 25: return read_cbor_be(s, idx, 2);
+        case 26: return read_cbor_be(s, idx, 4);
+        case 27: return read_cbor_be(s, idx, 8);
+        case 31: indefinite = true; return 0;
+        default: throw parse_error("Invalid CBOR additional information");
+    }
+}
+
+inline double cbor_half_to_double(uint16_t h) {
+    int exp = (h >> 10) & 0x1F;
+    int mant = h & 0x3FF;
+    double v;
+    if (exp == 0) v = std::ldexp(mant, -24);
+    else if (exp != 31) v = std::ldexp(mant + 1024, exp - 25);
+    else v = mant == 0 ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+    return (h & 0x8000) ? -v : v;
+}
+
+// Decode a text string (major type 3) whose initial byte has been consumed,
+// appending it to `out`.
+template<typename String>
+void read_cbor_text(std::string_view s, size_t& idx, uint8_t info, String& out) {
+    bool indefinite;
+    uint64_t len = read_cbor_arg(s, idx, info, indefinite);
+    if (!indefinite) {
+        if (len > s.size() - idx) throw parse_error("Truncated CBOR string");
+        out.append(s.data() + idx, static_cast<size_t>(len));
+        idx += static_cast<size_t>(len);
+        return;
+    }
+    for (;;) { // chunks of definite-length text strings, then a break
+        if (idx >= s.size()) throw parse_error("Truncated CBOR string");
+        uint8_t ib = static_cast<uint8_t>(s[idx++]);
+        if (ib == 0xFF) return;
+        if ((ib >> 5) != 3 || (ib & 0x1F) == 31) throw parse_error("Invalid CBOR string chunk");
+        read_cbor_text(s, idx, ib & 0x1F, out);
+    }
+}
+
+// Insertion-ordered object storage: members live in one contiguous vector in
+// document order. Small objects are searched with a linear scan (length check
+// first, then memcmp); once an object grows past `linear_max` members an
+// open-addressing index (linear probing, power-of-two table at most half
+// full) is built and kept up to date on insert. Each slot packs the member
+// position (+1, 0 = empty) with the upper hash bits, so probes rarely touch a
+// key that does not match. Members cannot be removed.
+template<typename Key, typename T, typename Alloc>
+class ordered_object {
+public:
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<Key, T>;
+    using allocator_type = typename std::allocator_traits<Alloc>::template rebind_alloc<value_type>;
+    using iterator = typename std::vector<value_type, allocator_type>::iterator;
+    using const_iterator = typename std::vector<value_type, allocator_type>::const_iterator;
+
+    static constexpr size_t linear_max = 8;
+
+    iterator begin() noexcept { return m_items.begin(); }
+    iterator end() noexcept { return m_items.end(); }
+    const_iterator begin() const noexcept { return m_items.begin(); }
+    const_iterator end() const noexcept { return m_items.end(); }
+    size_t size() const noexcept { return m_items.size(); }
+    bool empty() const noexcept { return m_items.empty(); }
+    bool indexed() const noexcept { return !m_slots.empty(); }
+    void reserve(size_t n) { m_items.reserve(n); }
+
+    iterator find(std::string_view key) { return begin() + static_cast<std::ptrdiff_t>(locate(key)); }
+    const_iterator find(std::string_view key) const { return begin() + static_cast<std::ptrdiff_t>(locate(key)); }
+
+    // keeps the existing value when `key` is present (std::map semantics)
+    std::pair<iterator, bool> emplace(Key key, T value) {
+        size_t pos = locate(key);
+        if (pos != m_items.size()) return { begin() + static_cast<std::ptrdiff_t>(pos), false };
+        append(std::move(key), std::move(value));
+        return { end() - 1, true };
+    }
+
+    std::pair<iterator, bool> insert_or_assign(Key key, T value) {
+        size_t pos = locate(key);
+        if (pos != m_items.size()) {
+            m_items[pos].second = std::move(value);
+            return { begin() + static_cast<std::ptrdiff_t>(pos), false };
+        }
+        append(std::move(key), std::move(value));
+        return { end() - 1, true };
+    }
+
+private:
+    using slot_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<uint64_t>;
+
+    static uint64_t hash(std::string_view key) noexcept {
+        uint64_t h = std::hash<std::string_view>{}(key);
+        return h ^ (h >> 29); // the table uses the low bits, the tag the high ones
+    }
+
+    static bool same_key(const Key& a, std::string_view b) noexcept {
+        return a.size() == b.size() && std::memcmp(a.data(), b.data(), b.size()) == 0;
+    }
+
+    // position of `key`, or size() if absent
+    size_t locate(std::string_view key) const noexcept {
+        if (m_slots.empty()) {
+            for (size_t i = 0; i < m_items.size(); ++i)
+                if (same_key(m_items[i].first, key)) return i;
+            return m_items.size();
+        }
+        uint64_t h = hash(key);
+        uint64_t tag = h & 0xFFFFFFFF00000000ull;
+        size_t mask = m_slots.size() - 1;
+        for (size_t i = static_cast<size_t>(h) & mask;; i = (i + 1) & mask) {
+            uint64_t slot = m_slots[i];
+            if (slot == 0) return m_items.size();
+            size_t pos = static_cast<size_t>(slot & 0xFFFFFFFFu) - 1;
+            if ((slot & 0xFFFFFFFF00000000ull) == tag && same_key(m_items[pos].first, key)) return pos;
+        }
+    }
+
+    void append(Key&& key, T&& value) {
+        m_items.emplace_back(std::move(key), std::move(value));
+        if (m_slots.empty()) {
+            if (m_items.size() > linear_max) rebuild(4 * m_items.size());
+        } else if (2 * m_items.size() > m_slots.size()) {
+            rebuild(2 * m_slots.size());
+        } else {
+            insert_slot(m_items.size() - 1);
+        }
+    }
+
+    void rebuild(size_t min_slots) {
+        size_t n = 16;
+        while (n < min_slots) n <<= 1;
+        m_slots.assign(n, 0);
+        for (size_t i = 0; i < m_items.size(); ++i) insert_slot(i);
+    }
+
+    void insert_slot(size_t pos) noexcept {
+        uint64_t h = hash(m_items[pos].first);
+        size_t mask = m_slots.size() - 1;
+        size_t i = static_cast<size_t>(h) & mask;
+        while (m_slots[i] != 0) i = (i + 1) & mask;
+        m_slots[i] = (h & 0xFFFFFFFF00000000ull) | (static_cast<uint64_t>(pos) + 1);
+    }
+
+    std::vector<value_type, allocator_type> m_items;
+    std::vector<uint64_t, slot_allocator> m_slots; // empty while linear
+};
+
+} // namespace detail
+
+// Object storage policies (second template parameter of basic_json).
+// `Alloc` is the tree's allocator for std::pair<const Key, T>.
+//   sorted_objects  - std::map: keys serialized in sorted order (the default,
+//                     matching upstream nlohmann::json)
+//   ordered_objects - detail::ordered_object: keys kept in insertion order,
+//                     contiguous storage, linear scan for small objects and a
+//                     hash index for large ones (upstream's ordered_json order)
+struct sorted_objects {
+    template<typename Key, typename T, typename Alloc>
+    using container = std::map<Key, T, std::less<>, Alloc>;
+};
+
+struct ordered_objects {
+    template<typename Key, typename T, typename Alloc>
+    using container = detail::ordered_object<Key, T, Alloc>;
+};
+
+// ---------------------------------------------------------------------------
+// basic_json - owning, mutable JSON value
+//
+//   `Allocator` supplies every string and container of the tree. The default
+//   (std::allocator) is `nlohmann::json`; `nlohmann::pmr::json` (below) draws
+//   from a per-message arena instead. `ObjectPolicy` selects how objects are
+//   stored (see sorted_objects / ordered_objects above).
+// ---------------------------------------------------------------------------
+template<template<typename> class Allocator = std::allocator, typename ObjectPolicy = sorted_objects>
+class basic_json {
 public:
     // underlying variant type
-    using object_t = std::map<std::string, json>;
-    using array_t  = std::vector<json>;
-    using string_t = std::string;
+    using string_t = std::basic_string<char, std::char_traits<char>, Allocator<char>>;
+    using object_t = typename ObjectPolicy::template container<string_t, basic_json,
+                                                               Allocator<std::pair<const string_t, basic_json>>>;
+    using array_t  = std::vector<basic_json, Allocator<basic_json>>;
     using number_t = double;
+    using number_integer_t = int64_t; // integers are kept exact, as in upstream nlohmann
     using boolean_t = bool;
     using null_t = std::nullptr_t;
-    using value_t = std::variant<null_t, boolean_t, number_t, string_t, array_t, object_t>;
+    using value_t = std::variant<null_t, boolean_t, number_t, string_t, array_t, object_t, number_integer_t>;
 
 private:
     value_t m_value;
 
 public:
     // Exceptions
-    struct parse_error : public std::runtime_error { parse_error(const std::string& s):std::runtime_error(s){} };
-    struct type_error  : public std::runtime_error { type_error(const std::string& s):std::runtime_error(s){} };
+    using parse_error = detail::parse_error;
+    using type_error  = detail::type_error;
 
     // Constructors
-    json() noexcept : m_value(nullptr) {}
-    json(std::nullptr_t) noexcept : m_value(nullptr) {}
-    json(boolean_t b) noexcept : m_value(b) {}
-    json(int v) noexcept : m_value(static_cast<number_t>(v)) {}
-    json(long v) noexcept : m_value(static_cast<number_t>(v)) {}
-    json(number_t d) noexcept : m_value(d) {}
-    json(const char* s) : m_value(string_t(s ? s : "")) {}
-    json(const string_t& s) : m_value(s) {}
-    json(string_t&& s) : m_value(std::move(s)) {}
-    json(const array_t& a) : m_value(a) {}
-    json(array_t&& a) : m_value(std::move(a)) {}
-    json(const object_t& o) : m_value(o) {}
-    json(object_t&& o) : m_value(std::move(o)) {}
+    basic_json() noexcept : m_value(nullptr) {}
+    basic_json(std::nullptr_t) noexcept : m_value(nullptr) {}
+    basic_json(boolean_t b) noexcept : m_value(b) {}
+    template<typename T, typename std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+    basic_json(T v) noexcept {
+        // unsigned values above INT64_MAX are the only ones stored as double
+        if constexpr (std::is_unsigned_v<T> && sizeof(T) >= sizeof(number_integer_t)) {
+            if (v > static_cast<T>(std::numeric_limits<number_integer_t>::max())) { m_value = static_cast<number_t>(v); return; }
+        }
+        m_value = static_cast<number_integer_t>(v);
+    }
+    basic_json(number_t d) noexcept : m_value(d) {}
+    basic_json(const char* s) : m_value(string_t(s ? s : "")) {}
+    basic_json(const string_t& s) : m_value(s) {}
+    basic_json(string_t&& s) : m_value(std::move(s)) {}
+    // any other string-like value (std::string_view, std::string for pmr::json, ...)
+    template<typename S, typename std::enable_if_t<std::is_convertible_v<const S&, std::string_view>
+                                                   && !std::is_convertible_v<const S&, const char*>
+                                                   && !std::is_same_v<S, basic_json>, int> = 0>
+    basic_json(const S& s) : m_value(string_t(std::string_view(s))) {}
+    basic_json(const array_t& a) : m_value(a) {}
+    basic_json(array_t&& a) : m_value(std::move(a)) {}
+    basic_json(const object_t& o) : m_value(o) {}
+    basic_json(object_t&& o) : m_value(std::move(o)) {}
+
+    // Brace initialization, as in nlohmann: a list whose elements are all
+    // two-element arrays starting with a string builds an object, anything
+    // else an array.  json j = { {"id", id}, {"status", "ok"} };
+    basic_json(std::initializer_list<basic_json> init) {
+        bool is_obj = true;
+        for (const auto& e : init) {
+            if (!e.is_array() || e.size() != 2 || !e[0].is_string()) { is_obj = false; break; }
+        }
+        if (is_obj) {
+            object_t obj;
+            for (const auto& e : init) obj.emplace(e[0].get_string(), e[1]);
+            m_value = std::move(obj);
+        } else {
+            m_value = array_t(init.begin(), init.end());
+        }
+    }
 
     // Factory helpers
-    static json object() { return json(object_t{}); }
-    static json array()  { return json(array_t{}); }
+    static basic_json object() { return basic_json(object_t{}); }
+    static basic_json array()  { return basic_json(array_t{}); }
 
-    // parse from string (static)
-    static json parse(const std::string& s) {
+    // parse from string (static); accepts std::string, literals and string views
+    static basic_json parse(std::string_view s) {
         size_t idx = 0;
-        json result = parse_internal(s, idx);
-        idx = skip_ws(s, idx);
+        basic_json result = parse_internal(s, idx);
+        idx = detail::skip_ws(s, idx);
         if (idx != s.size()) throw parse_error("Extra characters after JSON value");
         return result;
     }
 
+    // parse into a read-only json_view: unescaped strings are views into `s`,
+    // so `s` must outlive the result (see json_view below)
+    static json_view parse_view(std::string_view s);
+
+    // validate `s` without building a tree and return an on-demand view of it
+    // (see lazy_json below); `s` must outlive the result
+    static lazy_json parse_lazy(std::string_view s);
+
     // dump to string (compact)
     std::string dump() const {
-        std::ostringstream oss;
-        dump_internal(oss);
-        return oss.str();
+        std::string out;
+        dump_to(out);
+        return out;
     }
 
     // pretty print (indent)
     std::string dump(int indent) const {
-        if (indent <= 0) return dump();
-        std::ostringstream oss;
-        dump_internal(oss, indent, 0);
-        return oss.str();
+        std::string out;
+        dump_to(out, indent);
+        return out;
+    }
+
+    // append the serialization to a caller-owned buffer (not cleared first), so
+    // one buffer can be reused across messages without reallocating
+    void dump_to(std::string& out) const { serialize(out); }
+
+    void dump_to(std::string& out, int indent) const {
+        if (indent <= 0) serialize(out);
+        else serialize(out, indent, 0);
+    }
+
+    // CBOR: append the encoding to a caller-owned buffer (not cleared first).
+    // Integral numbers are encoded as CBOR integers, others as float32 when
+    // that is lossless and as float64 otherwise.
+    void dump_cbor_to(std::string& out) const { serialize_cbor(out); }
+
+    std::string to_cbor() const {
+        std::string out;
+        serialize_cbor(out);
+        return out;
+    }
+
+    // decode exactly one CBOR data item spanning all of `s`
+    static basic_json from_cbor(std::string_view s) {
+        size_t idx = 0;
+        basic_json result = parse_cbor(s, idx, 0);
+        if (idx != s.size()) throw parse_error("Extra bytes after CBOR item");
+        return result;
     }
 
     // type queries
     bool is_null() const noexcept { return std::holds_alternative<null_t>(m_value); }
     bool is_boolean() const noexcept { return std::holds_alternative<boolean_t>(m_value); }
-    bool is_number() const noexcept { return std::holds_alternative<number_t>(m_value); }
+    bool is_number() const noexcept {
+        return std::holds_alternative<number_integer_t>(m_value) || std::holds_alternative<number_t>(m_value);
+    }
     bool is_string() const noexcept { return std::holds_alternative<string_t>(m_value); }
     bool is_array() const noexcept { return std::holds_alternative<array_t>(m_value); }
     bool is_object() const noexcept { return std::holds_alternative<object_t>(m_value); }
 
+    // exact integer, or a double with no fractional part that fits a long long
+    bool is_number_integer() const noexcept {
+        if (std::holds_alternative<number_integer_t>(m_value)) return true;
+        if (!std::holds_alternative<number_t>(m_value)) return false;
+        double v = std::get<number_t>(m_value);
+        constexpr double lo = static_cast<double>(std::numeric_limits<long long>::min());
+        return std::trunc(v) == v && v >= lo && v < -lo;
+    }
+
     // accessors (const)
     const object_t&   get_object() const { if (!is_object()) throw type_error("not an object"); return std::get<object_t>(m_value); }
     const array_t&    get_array()  const { if (!is_array())  throw type_error("not an array");  return std::get<array_t>(m_value); }
     const string_t&   get_string() const { if (!is_string()) throw type_error("not a string");  return std::get<string_t>(m_value); }
-    number_t          get_number() const { if (!is_number()) throw type_error("not a number");  return std::get<number_t>(m_value); }
+    number_t          get_number() const {
+        if (auto i = std::get_if<number_integer_t>(&m_value)) return static_cast<number_t>(*i);
+        if (!std::holds_alternative<number_t>(m_value)) throw type_error("not a number");
+        return std::get<number_t>(m_value);
+    }
     boolean_t         get_boolean() const { if (!is_boolean()) throw type_error("not a boolean"); return std::get<boolean_t>(m_value); }
 
     // templated get<T>
     template<typename T>
     T get() const {
-        if constexpr (std::is_same_v<T, std::string>) return get_string();
+        if constexpr (std::is_same_v<T, std::string>) { const auto& s = get_string(); return std::string(s.data(), s.size()); }
+        else if constexpr (std::is_same_v<T, std::string_view>) return std::string_view(get_string());
+        else if constexpr (std::is_same_v<T, string_t>) return get_string();
         else if constexpr (std::is_same_v<T, const char*>) return get_string().c_str();
         else if constexpr (std::is_same_v<T, number_t>) return get_number();
-        else if constexpr (std::is_same_v<T, int>) return static_cast<int>(get_number());
         else if constexpr (std::is_same_v<T, bool>) return get_boolean();
+        else if constexpr (std::is_integral_v<T>) {
+            if (auto i = std::get_if<number_integer_t>(&m_value)) return static_cast<T>(*i);
+            return static_cast<T>(get_number());
+        }
         else if constexpr (std::is_same_v<T, array_t>) return get_array();
         else if constexpr (std::is_same_v<T, object_t>) return get_object();
         else static_assert(sizeof(T)==0, "unsupported get<T>() type");
     }
 
     // operator[] for object - creates key if not exists (like nlohmann)
-    json& operator[](const std::string& key) {
+    basic_json& operator[](std::string_view key) {
         if (!is_object()) {
             // convert to object if null
             if (is_null()) m_value = object_t{};
             else throw type_error("not an object (operator[])");
         }
         auto& obj = std::get<object_t>(m_value);
-        return obj[key]; // default constructs json (null) if key absent
+        auto it = obj.find(key);
+        if (it == obj.end()) it = obj.emplace(string_t(key), basic_json()).first; // null if key absent
+        return it->second;
     }
 
-    const json& operator[](const std::string& key) const {
+    const basic_json& operator[](std::string_view key) const {
         const auto& obj = get_object();
         auto it = obj.find(key);
         if (it == obj.end()) throw type_error("key not found in object");
@@ -172,14 +832,14 @@ public:
     }
 
     // operator[] for arrays
-    json& operator[](size_t idx) {
+    basic_json& operator[](size_t idx) {
         if (!is_array()) throw type_error("not an array (operator[])");
         auto& arr = std::get<array_t>(m_value);
         if (idx >= arr.size()) throw type_error("array index out of range");
         return arr[idx];
     }
 
-    const json& operator[](size_t idx) const {
+    const basic_json& operator[](size_t idx) const {
         const auto& arr = get_array();
         if (idx >= arr.size()) throw type_error("array index out of range");
         return arr[idx];
@@ -192,14 +852,14 @@ public:
     }
 
     // convenience: contains
-    bool contains(const std::string& key) const noexcept {
+    bool contains(std::string_view key) const noexcept {
         if (!is_object()) return false;
         const auto& obj = std::get<object_t>(m_value);
         return obj.find(key) != obj.end();
     }
 
     // push_back for arrays
-    void push_back(const json& v) {
+    void push_back(const basic_json& v) {
         if (!is_array()) {
             if (is_null()) m_value = array_t{};
             else throw type_error("not an array (push_back)");
@@ -207,305 +867,800 @@ public:
         std::get<array_t>(m_value).push_back(v);
     }
 
+    void push_back(basic_json&& v) {
+        if (!is_array()) {
+            if (is_null()) m_value = array_t{};
+            else throw type_error("not an array (push_back)");
+        }
+        std::get<array_t>(m_value).push_back(std::move(v));
+    }
+
     // iterators for objects/arrays (simple)
     // For brevity we expose const accessors for underlying types
     const object_t& as_object() const { return get_object(); }
     const array_t& as_array() const { return get_array(); }
 
+    // range-for over array elements (arrays only)
+    typename array_t::const_iterator begin() const { return get_array().begin(); }
+    typename array_t::const_iterator end() const { return get_array().end(); }
+
 private:
     // ---------- Parsing implementation (compact recursive descent) ----------
-    static size_t skip_ws(const std::string& s, size_t idx) {
-        while (idx < s.size() && std::isspace(static_cast<unsigned char>(s[idx]))) ++idx;
-        return idx;
-    }
-
-    static json parse_internal(const std::string& s, size_t& idx) {
-        idx = skip_ws(s, idx);
+    static basic_json parse_internal(std::string_view s, size_t& idx, size_t depth = 0) {
+        idx = detail::skip_ws(s, idx);
         if (idx >= s.size()) throw parse_error("Unexpected end of input");
         char c = s[idx];
         if (c == '{') {
-            return parse_object(s, idx);
+            detail::check_depth(depth);
+            return parse_object(s, idx, depth);
         } else if (c == '[') {
-            return parse_array(s, idx);
+            detail::check_depth(depth);
+            return parse_array(s, idx, depth);
         } else if (c == '"') {
-            return json(parse_string(s, idx));
+            return basic_json(parse_string(s, idx));
         } else if (c == 'n') {
-            if (s.compare(idx, 4, "null") == 0) { idx += 4; return json(nullptr); }
+            if (s.compare(idx, 4, "null") == 0) { idx += 4; return basic_json(nullptr); }
             throw parse_error("Invalid token (expected null)");
         } else if (c == 't') {
-            if (s.compare(idx, 4, "true") == 0) { idx += 4; return json(true); }
+            if (s.compare(idx, 4, "true") == 0) { idx += 4; return basic_json(true); }
             throw parse_error("Invalid token (expected true)");
         } else if (c == 'f') {
-            if (s.compare(idx, 5, "false") == 0) { idx += 5; return json(false); }
+            if (s.compare(idx, 5, "false") == 0) { idx += 5; return basic_json(false); }
             throw parse_error("Invalid token (expected false)");
         } else if ( (c == '-') || (c >= '0' && c <= '9') ) {
-            return parse_number(s, idx);
+            int64_t exact;
+            double d;
+            if (detail::scan_number_exact(s, idx, exact, d)) return basic_json(exact);
+            return basic_json(d);
         } else {
             throw parse_error(std::string("Unexpected character '") + c + "'");
         }
     }
 
-    static json parse_object(const std::string& s, size_t& idx) {
+    static basic_json parse_object(std::string_view s, size_t& idx, size_t depth) {
         // assumes s[idx] == '{'
         ++idx; // skip '{'
-        idx = skip_ws(s, idx);
+        idx = detail::skip_ws(s, idx);
         object_t obj;
-        if (idx < s.size() && s[idx] == '}') { ++idx; return json(std::move(obj)); }
+        if (idx < s.size() && s[idx] == '}') { ++idx; return basic_json(std::move(obj)); }
         while (true) {
-            idx = skip_ws(s, idx);
+            idx = detail::skip_ws(s, idx);
             if (idx >= s.size() || s[idx] != '"') throw parse_error("Expected string for object key");
-            std::string key = parse_string(s, idx);
-            idx = skip_ws(s, idx);
+            string_t key = parse_string(s, idx);
+            idx = detail::skip_ws(s, idx);
             if (idx >= s.size() || s[idx] != ':') throw parse_error("Expected ':' after object key");
             ++idx;
-            json val = parse_internal(s, idx);
+            basic_json val = parse_internal(s, idx, depth + 1);
             obj.emplace(std::move(key), std::move(val));
-            idx = skip_ws(s, idx);
+            idx = detail::skip_ws(s, idx);
             if (idx >= s.size()) throw parse_error("Unterminated object");
             if (s[idx] == ',') { ++idx; continue; }
             else if (s[idx] == '}') { ++idx; break; }
             else throw parse_error("Expected ',' or '}' in object");
         }
-        return json(std::move(obj));
+        return basic_json(std::move(obj));
     }
 
-    static json parse_array(const std::string& s, size_t& idx) {
+    static basic_json parse_array(std::string_view s, size_t& idx, size_t depth) {
         // assumes s[idx] == '['
         ++idx; // skip '['
-        idx = skip_ws(s, idx);
+        idx = detail::skip_ws(s, idx);
         array_t arr;
-        if (idx < s.size() && s[idx] == ']') { ++idx; return json(std::move(arr)); }
+        if (idx < s.size() && s[idx] == ']') { ++idx; return basic_json(std::move(arr)); }
         while (true) {
-            json v = parse_internal(s, idx);
+            basic_json v = parse_internal(s, idx, depth + 1);
             arr.push_back(std::move(v));
-            idx = skip_ws(s, idx);
+            idx = detail::skip_ws(s, idx);
             if (idx >= s.size()) throw parse_error("Unterminated array");
             if (s[idx] == ',') { ++idx; continue; }
             else if (s[idx] == ']') { ++idx; break; }
             else throw parse_error("Expected ',' or ']' in array");
         }
-        return json(std::move(arr));
+        return basic_json(std::move(arr));
     }
 
-    static std::string parse_string(const std::string& s, size_t& idx) {
-        // assumes s[idx] == '"'
-        ++idx;
-        std::string out;
-        while (idx < s.size()) {
-            char c = s[idx++];
-            if (c == '"') return out;
-            if (c == '\\') {
-                if (idx >= s.size()) throw parse_error("Invalid escape sequence");
-                char esc = s[idx++];
-                switch (esc) {
-                    case '"': out.push_back('"'); break;
-                    case '\\': out.push_back('\\'); break;
-                    case '/': out.push_back('/'); break;
-                    case 'b': out.push_back('\b'); break;
-                    case 'f': out.push_back('\f'); break;
-                    case 'n': out.push_back('\n'); break;
-                    case 'r': out.push_back('\r'); break;
-                    case 't': out.push_back('\t'); break;
-                    case 'u': {
-                        // parse \uXXXX (basic BMP only)
-                        if (idx + 4 > s.size()) throw parse_error("Invalid unicode escape");
-                        unsigned int code = 0;
-                        for (int i = 0; i < 4; ++i) {
-                            char h = s[idx++];
-                            code <<= 4;
-                            if (h >= '0' && h <= '9') code |= (h - '0');
-                            else if (h >= 'A' && h <= 'F') code |= (10 + h - 'A');
-                            else if (h >= 'a' && h <= 'f') code |= (10 + h - 'a');
-                            else throw parse_error("Invalid hex in unicode escape");
-                        }
-                        // encode UTF-8 for BMP
-                        if (code <= 0x7F) out.push_back(static_cast<char>(code));
-                        else if (code <= 0x7FF) {
-                            out.push_back(static_cast<char>(0xC0 | ((code >> 6) & 0x1F)));
-                            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
-                        } else {
-                            out.push_back(static_cast<char>(0xE0 | ((code >> 12) & 0x0F)));
-                            out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
-                            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
-                        }
-                    } break;
-                    default:
-                        throw parse_error("Invalid escape character");
-                }
-            } else {
-                out.push_back(c);
-            }
-        }
-        throw parse_error("Unterminated string");
+    static string_t parse_string(std::string_view s, size_t& idx) {
+        string_t out;
+        detail::decode_string(s, idx, out);
+        return out;
     }
 
-    static json parse_number(const std::string& s, size_t& idx) {
-        size_t start = idx;
-        if (s[idx] == '-') ++idx;
-        bool has_digits = false;
-        while (idx < s.size() && s[idx] >= '0' && s[idx] <= '9') { ++idx; has_digits=true; }
-        if (!has_digits) throw parse_error("Invalid number");
-        if (idx < s.size() && s[idx] == '.') {
-            ++idx;
-            if (idx >= s.size() || !(s[idx] >= '0' && s[idx] <= '9')) throw parse_error("Invalid number fraction");
-            while (idx < s.size() && s[idx] >= '0' && s[idx] <= '9') ++idx;
-        }
-        if (idx < s.size() && (s[idx] == 'e' || s[idx] == 'E')) {
-            ++idx;
-            if (idx < s.size() && (s[idx] == '+' || s[idx] == '-')) ++idx;
-            if (idx >= s.size() || !(s[idx] >= '0' && s[idx] <= '9')) throw parse_error("Invalid number exponent");
-            while (idx < s.size() && s[idx] >= '0' && s[idx] <= '9') ++idx;
+    // ---------- CBOR decoding ----------
+    static basic_json parse_cbor(std::string_view s, size_t& idx, size_t depth) {
+        if (depth > detail::cbor_max_depth) throw parse_error("CBOR nesting too deep");
+        if (idx >= s.size()) throw parse_error("Unexpected end of CBOR input");
+        uint8_t ib = static_cast<uint8_t>(s[idx++]);
+        uint8_t major = ib >> 5, info = ib & 0x1F;
+        bool indefinite;
+        switch (major) {
+            case 0: // values above INT64_MAX become doubles
+                return basic_json(detail::read_cbor_arg(s, idx, info, indefinite));
+            case 1: {
+                uint64_t n = detail::read_cbor_arg(s, idx, info, indefinite);
+                if (n <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))
+                    return basic_json(-1 - static_cast<number_integer_t>(n));
+                return basic_json(-1.0 - static_cast<number_t>(n));
+            }
+            case 2:
+                throw parse_error("CBOR byte strings are not supported");
+            case 3: {
+                string_t str;
+                detail::read_cbor_text(s, idx, info, str);
+                return basic_json(std::move(str));
+            }
+            case 4: {
+                uint64_t n = detail::read_cbor_arg(s, idx, info, indefinite);
+                array_t arr;
+                if (indefinite) {
+                    while (idx < s.size() && static_cast<uint8_t>(s[idx]) != 0xFF)
+                        arr.push_back(parse_cbor(s, idx, depth + 1));
+                    if (idx++ >= s.size()) throw parse_error("Unterminated CBOR array");
+                } else {
+                    // every element takes at least one byte: bounds a hostile count
+                    if (n > s.size() - idx) throw parse_error("Truncated CBOR array");
+                    arr.reserve(static_cast<size_t>(n));
+                    for (uint64_t i = 0; i < n; ++i) arr.push_back(parse_cbor(s, idx, depth + 1));
+                }
+                return basic_json(std::move(arr));
+            }
+            case 5: {
+                uint64_t n = detail::read_cbor_arg(s, idx, info, indefinite);
+                if (!indefinite && n > (s.size() - idx) / 2) throw parse_error("Truncated CBOR map");
+                object_t obj;
+                for (uint64_t i = 0; indefinite || i < n; ++i) {
+                    if (idx >= s.size()) throw parse_error("Unterminated CBOR map");
+                    uint8_t kb = static_cast<uint8_t>(s[idx++]);
+                    if (indefinite && kb == 0xFF) break;
+                    if ((kb >> 5) != 3) throw parse_error("CBOR map keys must be text strings");
+                    string_t key;
+                    detail::read_cbor_text(s, idx, kb & 0x1F, key);
+                    basic_json val = parse_cbor(s, idx, depth + 1);
+                    obj.insert_or_assign(std::move(key), std::move(val));
+                }
+                return basic_json(std::move(obj));
+            }
+            case 6: // tag: the tagged item is decoded as-is
+                detail::read_cbor_arg(s, idx, info, indefinite);
+                if (indefinite) throw parse_error("Invalid CBOR tag");
+                return parse_cbor(s, idx, depth + 1);
+            default: // 7: simple values and floats
+                switch (info) {
+                    case 20: return basic_json(false);
+                    case 21: return basic_json(true);
+                    case 22: case 23: return basic_json(nullptr);
+                    case 25: return basic_json(detail::cbor_half_to_double(
+                                 static_cast<uint16_t>(detail::read_cbor_be(s, idx, 2))));
+                    case 26: {
+                        uint32_t b = static_cast<uint32_t>(detail::read_cbor_be(s, idx, 4));
+                        float f;
+                        std::memcpy(&f, &b, sizeof(f));
+                        return basic_json(static_cast<number_t>(f));
+                    }
+                    case 27: {
+                        uint64_t b = detail::read_cbor_be(s, idx, 8);
+                        double d;
+                        std::memcpy(&d, &b, sizeof(d));
+                        return basic_json(d);
+                    }
+                    default: throw parse_error("Unsupported CBOR simple value");
+                }
         }
-        std::string token = s.substr(start, idx - start);
-        // Convert to double safely
-        char* endptr = nullptr;
-        errno = 0;
-        double val = std::strtod(token.c_str(), &endptr);
-        if (endptr != token.c_str() + token.size() || errno == ERANGE) throw parse_error("Number conversion error");
-        return json(val);
     }
 
     // ---------- Serialization ----------
-    void dump_internal(std::ostream& os) const {
-        if (is_null()) { os << "null"; return; }
-        if (is_boolean()) { os << (get_boolean() ? "true" : "false"); return; }
-        if (is_number()) {
-            double v = get_number();
-            if (std::isfinite(v)) {
-                // choose formatting similar to common JSON libs
-                std::ostringstream tmp;
-                tmp.precision(std::numeric_limits<double>::digits10);
-                tmp << v;
-                os << tmp.str();
-            } else {
-                os << "null"; // non-finite numbers -> null
-            }
-            return;
-        }
+    void serialize_cbor(std::string& out) const {
+        if (is_null()) { out.push_back(static_cast<char>(0xF6)); return; }
+        if (is_boolean()) { out.push_back(static_cast<char>(get_boolean() ? 0xF5 : 0xF4)); return; }
+        if (auto i = std::get_if<number_integer_t>(&m_value)) { detail::append_cbor_integer(out, *i); return; }
+        if (is_number()) { detail::append_cbor_number(out, get_number()); return; }
         if (is_string()) {
-            os << '"';
             const auto& str = get_string();
-            for (unsigned char ch : str) {
-                switch (ch) {
-                    case '"': os << "\\\""; break;
-                    case '\\': os << "\\\\"; break;
-                    case '\b': os << "\\b"; break;
-                    case '\f': os << "\\f"; break;
-                    case '\n': os << "\\n"; break;
-                    case '\r': os << "\\r"; break;
-                    case '\t': os << "\\t"; break;
-                    default:
-                        if (ch < 0x20) {
-                            // control -> \u00XX
-                            char buf[7];
-                            std::snprintf(buf, sizeof(buf), "\\u%04x", ch);
-                            os << buf;
-                        } else os << ch;
-                }
-            }
-            os << '"';
+            detail::append_cbor_head(out, 3, str.size());
+            out.append(str.data(), str.size());
             return;
         }
         if (is_array()) {
-            os << '[';
+            const auto& arr = get_array();
+            detail::append_cbor_head(out, 4, arr.size());
+            for (const auto& v : arr) v.serialize_cbor(out);
+            return;
+        }
+        const auto& obj = get_object();
+        detail::append_cbor_head(out, 5, obj.size());
+        for (const auto& kv : obj) {
+            detail::append_cbor_head(out, 3, kv.first.size());
+            out.append(kv.first.data(), kv.first.size());
+            kv.second.serialize_cbor(out);
+        }
+    }
+
+    void serialize(std::string& out) const {
+        if (is_null()) { out.append("null", 4); return; }
+        if (is_boolean()) { if (get_boolean()) out.append("true", 4); else out.append("false", 5); return; }
+        if (auto i = std::get_if<number_integer_t>(&m_value)) { detail::append_integer(out, *i); return; }
+        if (is_number()) { detail::append_number(out, get_number()); return; }
+        if (is_string()) { detail::append_escaped(out, get_string()); return; }
+        if (is_array()) {
+            out.push_back('[');
             const auto& arr = get_array();
             for (size_t i = 0; i < arr.size(); ++i) {
-                if (i) os << ',';
-                arr[i].dump_internal(os);
+                if (i) out.push_back(',');
+                arr[i].serialize(out);
             }
-            os << ']';
+            out.push_back(']');
             return;
         }
         if (is_object()) {
-            os << '{';
-            const auto& obj = get_object();
+            out.push_back('{');
             bool first = true;
-            for (const auto& kv : obj) {
-                if (!first) os << ',';
+            for (const auto& kv : get_object()) {
+                if (!first) out.push_back(',');
                 first = false;
-                // key
-                os << '"';
-                for (unsigned char ch : kv.first) {
-                    switch (ch) {
-                        case '"': os << "\\\""; break;
-                        case '\\': os << "\\\\"; break;
-                        case '\b': os << "\\b"; break;
-                        case '\f': os << "\\f"; break;
-                        case '\n': os << "\\n"; break;
-                        case '\r': os << "\\r"; break;
-                        case '\t': os << "\\t"; break;
-                        default:
-                            if (ch < 0x20) {
-                                char buf[7];
-                                std::snprintf(buf, sizeof(buf), "\\u%04x", ch);
-                                os << buf;
-                            } else os << ch;
-                    }
-                }
-                os << "\":";
-                kv.second.dump_internal(os);
+                detail::append_escaped(out, kv.first);
+                out.push_back(':');
+                kv.second.serialize(out);
             }
-            os << '}';
+            out.push_back('}');
             return;
         }
     }
 
-    void dump_internal(std::ostream& os, int indent, int level) const {
+    void serialize(std::string& out, int indent, int level) const {
         // Pretty-print with indent spaces per level
         if (is_object()) {
             const auto& obj = get_object();
-            if (obj.empty()) { os << "{}"; return; }
-            os << "{\n";
+            if (obj.empty()) { out.append("{}", 2); return; }
+            out.append("{\n", 2);
             bool first = true;
             for (const auto& kv : obj) {
-                if (!first) os << ",\n";
+                if (!first) out.append(",\n", 2);
                 first = false;
-                os << std::string((level+1)*indent, ' ');
-                os << '"' << escape_string(kv.first) << "\": ";
-                kv.second.dump_internal(os, indent, level+1);
+                out.append(static_cast<size_t>((level+1)*indent), ' ');
+                detail::append_escaped(out, kv.first);
+                out.append(": ", 2);
+                kv.second.serialize(out, indent, level+1);
             }
-            os << '\n' << std::string(level*indent, ' ') << '}';
+            out.push_back('\n');
+            out.append(static_cast<size_t>(level*indent), ' ');
+            out.push_back('}');
             return;
         } else if (is_array()) {
             const auto& arr = get_array();
-            if (arr.empty()) { os << "[]"; return; }
-            os << "[\n";
+            if (arr.empty()) { out.append("[]", 2); return; }
+            out.append("[\n", 2);
             for (size_t i = 0; i < arr.size(); ++i) {
-                if (i) os << ",\n";
-                os << std::string((level+1)*indent, ' ');
-                arr[i].dump_internal(os, indent, level+1);
+                if (i) out.append(",\n", 2);
+                out.append(static_cast<size_t>((level+1)*indent), ' ');
+                arr[i].serialize(out, indent, level+1);
             }
-            os << '\n' << std::string(level*indent, ' ') << ']';
+            out.push_back('\n');
+            out.append(static_cast<size_t>(level*indent), ' ');
+            out.push_back(']');
             return;
         } else {
-            dump_internal(os);
+            serialize(out);
         }
     }
+};
 
-    static std::string escape_string(const std::string& s) {
-        std::string out;
-        out.reserve(s.size());
-        for (unsigned char ch : s) {
-            switch (ch) {
-                case '"': out += "\\\""; break;
-                case '\\': out += "\\\\"; break;
-                case '\b': out += "\\b"; break;
-                case '\f': out += "\\f"; break;
-                case '\n': out += "\\n"; break;
-                case '\r': out += "\\r"; break;
-                case '\t': out += "\\t"; break;
-                default:
-                    if (ch < 0x20) {
-                        char buf[7];
-                        std::snprintf(buf, sizeof(buf), "\\u%04x", ch);
-                        out += buf;
-                    } else out.push_back((char)ch);
-            }
+using json = basic_json<>;
+using ordered_json = basic_json<std::allocator, ordered_objects>;
+
+// ---------------------------------------------------------------------------
+// json_view - read-only document produced by json::parse_view()
+//
+//   Strings without escape sequences (keys and values) are std::string_view
+//   slices of the parsed buffer; only strings that contain escapes are decoded,
+//   into storage owned by the root view. Objects are flat (key, value) vectors
+//   in document order, so an envelope costs one allocation per container
+//   rather than a map node plus a std::string per key. Numbers are converted
+//   straight from the buffer.
+//
+//   Lifetime: the parsed buffer must outlive the view; child views must not
+//   outlive the root returned by parse_view() (it owns the decoded strings).
+//   Use to_json() to obtain an owning, mutable copy.
+// ---------------------------------------------------------------------------
+class json_view {
+public:
+    using string_t = std::string_view;
+    using number_t = json::number_t;
+    using boolean_t = bool;
+    using null_t = std::nullptr_t;
+    using array_t = std::vector<json_view>;
+    using member_t = std::pair<std::string_view, json_view>;
+    using object_t = std::vector<member_t>;
+    using value_t = std::variant<null_t, boolean_t, number_t, string_t, array_t, object_t>;
+
+    json_view() noexcept : m_value(nullptr) {}
+
+    // type queries
+    bool is_null() const noexcept { return std::holds_alternative<null_t>(m_value); }
+    bool is_boolean() const noexcept { return std::holds_alternative<boolean_t>(m_value); }
+    bool is_number() const noexcept { return std::holds_alternative<number_t>(m_value); }
+    bool is_string() const noexcept { return std::holds_alternative<string_t>(m_value); }
+    bool is_array() const noexcept { return std::holds_alternative<array_t>(m_value); }
+    bool is_object() const noexcept { return std::holds_alternative<object_t>(m_value); }
+
+    // accessors
+    const object_t&   get_object() const { if (!is_object()) throw detail::type_error("not an object"); return std::get<object_t>(m_value); }
+    const array_t&    get_array()  const { if (!is_array())  throw detail::type_error("not an array");  return std::get<array_t>(m_value); }
+    string_t          get_string() const { if (!is_string()) throw detail::type_error("not a string");  return std::get<string_t>(m_value); }
+    number_t          get_number() const { if (!is_number()) throw detail::type_error("not a number");  return std::get<number_t>(m_value); }
+    boolean_t         get_boolean() const { if (!is_boolean()) throw detail::type_error("not a boolean"); return std::get<boolean_t>(m_value); }
+
+    template<typename T>
+    T get() const {
+        if constexpr (std::is_same_v<T, std::string_view>) return get_string();
+        else if constexpr (std::is_same_v<T, std::string>) return std::string(get_string());
+        else if constexpr (std::is_same_v<T, number_t>) return get_number();
+        else if constexpr (std::is_same_v<T, int>) return static_cast<int>(get_number());
+        else if constexpr (std::is_same_v<T, bool>) return get_boolean();
+        else static_assert(sizeof(T)==0, "unsupported json_view::get<T>() type");
+    }
+
+    // member lookup (first occurrence wins, matching json::parse); nullptr if absent
+    const json_view* find(std::string_view key) const noexcept {
+        if (!is_object()) return nullptr;
+        for (const auto& kv : std::get<object_t>(m_value)) {
+            if (kv.first == key) return &kv.second;
         }
-        return out;
+        return nullptr;
+    }
+
+    bool contains(std::string_view key) const noexcept { return find(key) != nullptr; }
+
+    const json_view& operator[](std::string_view key) const {
+        if (!is_object()) throw detail::type_error("not an object");
+        const json_view* v = find(key);
+        if (!v) throw detail::type_error("key not found in object");
+        return *v;
     }
+
+    const json_view& operator[](size_t idx) const {
+        const auto& arr = get_array();
+        if (idx >= arr.size()) throw detail::type_error("array index out of range");
+        return arr[idx];
+    }
+
+    size_t size() const noexcept {
+        if (is_array()) return std::get<array_t>(m_value).size();
+        if (is_object()) return std::get<object_t>(m_value).size();
+        return 0;
+    }
+
+    const object_t& as_object() const { return get_object(); }
+    const array_t& as_array() const { return get_array(); }
+
+    // materialize an owning tree (allocates like BasicJson::parse; for
+    // pmr::json from the current arena)
+    template<typename BasicJson = json>
+    BasicJson to_json() const {
+        using string_type = typename BasicJson::string_t;
+        if (is_null()) return BasicJson(nullptr);
+        if (is_boolean()) return BasicJson(get_boolean());
+        if (is_number()) return BasicJson(get_number());
+        if (is_string()) return BasicJson(string_type(get_string()));
+        if (is_array()) {
+            typename BasicJson::array_t arr;
+            arr.reserve(size());
+            for (const auto& v : get_array()) arr.push_back(v.template to_json<BasicJson>());
+            return BasicJson(std::move(arr));
+        }
+        typename BasicJson::object_t obj;
+        for (const auto& kv : get_object()) obj.emplace(string_type(kv.first), kv.second.template to_json<BasicJson>());
+        return BasicJson(std::move(obj));
+    }
+
+    // same as json::parse_view(s)
+    static json_view parse(std::string_view s) {
+        auto storage = std::make_shared<std::deque<std::string>>();
+        size_t idx = 0;
+        json_view result = parse_value(s, idx, *storage);
+        idx = detail::skip_ws(s, idx);
+        if (idx != s.size()) throw detail::parse_error("Extra characters after JSON value");
+        if (!storage->empty()) result.m_storage = std::move(storage);
+        return result;
+    }
+
+private:
+    static json_view parse_value(std::string_view s, size_t& idx, std::deque<std::string>& storage, size_t depth = 0);
+    static std::string_view parse_string(std::string_view s, size_t& idx, std::deque<std::string>& storage);
+
+    value_t m_value;
+    std::shared_ptr<std::deque<std::string>> m_storage; // root only: decoded escaped strings
 };
 
+template<template<typename> class Allocator, typename ObjectPolicy>
+inline json_view basic_json<Allocator, ObjectPolicy>::parse_view(std::string_view s) {
+    return json_view::parse(s);
+}
+
+// Fast path: a string without escapes is returned as a slice of the input.
+// Otherwise it is decoded once into `storage` (deque: element addresses are stable).
+inline std::string_view json_view::parse_string(std::string_view s, size_t& idx, std::deque<std::string>& storage) {
+    // assumes s[idx] == '"'
+    size_t start = idx + 1;
+    for (size_t i = start; i < s.size(); ++i) {
+        char c = s[i];
+        if (c == '"') { idx = i + 1; return s.substr(start, i - start); }
+        if (c == '\\') {
+            storage.emplace_back();
+            detail::decode_string(s, idx, storage.back());
+            return storage.back();
+        }
+    }
+    throw detail::parse_error("Unterminated string");
+}
+
+inline json_view json_view::parse_value(std::string_view s, size_t& idx, std::deque<std::string>& storage,
+                                        size_t depth) {
+    idx = detail::skip_ws(s, idx);
+    if (idx >= s.size()) throw detail::parse_error("Unexpected end of input");
+    json_view out;
+    char c = s[idx];
+    if (c == '{' || c == '[') detail::check_depth(depth);
+    if (c == '{') {
+        ++idx; // skip '{'
+        json_view::object_t obj;
+        idx = detail::skip_ws(s, idx);
+        if (idx < s.size() && s[idx] == '}') { ++idx; out.m_value = std::move(obj); return out; }
+        while (true) {
+            idx = detail::skip_ws(s, idx);
+            if (idx >= s.size() || s[idx] != '"') throw detail::parse_error("Expected string for object key");
+            std::string_view key = parse_string(s, idx, storage);
+            idx = detail::skip_ws(s, idx);
+            if (idx >= s.size() || s[idx] != ':') throw detail::parse_error("Expected ':' after object key");
+            ++idx;
+            json_view val = parse_value(s, idx, storage, depth + 1);
+            obj.emplace_back(key, std::move(val));
+            idx = detail::skip_ws(s, idx);
+            if (idx >= s.size()) throw detail::parse_error("Unterminated object");
+            if (s[idx] == ',') { ++idx; continue; }
+            else if (s[idx] == '}') { ++idx; break; }
+            else throw detail::parse_error("Expected ',' or '}' in object");
+        }
+        out.m_value = std::move(obj);
+    } else if (c == '[') {
+        ++idx; // skip '['
+        json_view::array_t arr;
+        idx = detail::skip_ws(s, idx);
+        if (idx < s.size() && s[idx] == ']') { ++idx; out.m_value = std::move(arr); return out; }
+        while (true) {
+            arr.push_back(parse_value(s, idx, storage, depth + 1));
+            idx = detail::skip_ws(s, idx);
+            if (idx >= s.size()) throw detail::parse_error("Unterminated array");
+            if (s[idx] == ',') { ++idx; continue; }
+            else if (s[idx] == ']') { ++idx; break; }
+            else throw detail::parse_error("Expected ',' or ']' in array");
+        }
+        out.m_value = std::move(arr);
+    } else if (c == '"') {
+        out.m_value = parse_string(s, idx, storage);
+    } else if (c == 'n') {
+        if (s.compare(idx, 4, "null") != 0) throw detail::parse_error("Invalid token (expected null)");
+        idx += 4;
+    } else if (c == 't') {
+        if (s.compare(idx, 4, "true") != 0) throw detail::parse_error("Invalid token (expected true)");
+        idx += 4; out.m_value = true;
+    } else if (c == 'f') {
+        if (s.compare(idx, 5, "false") != 0) throw detail::parse_error("Invalid token (expected false)");
+        idx += 5; out.m_value = false;
+    } else if ( (c == '-') || (c >= '0' && c <= '9') ) {
+        out.m_value = detail::scan_number(s, idx);
+    } else {
+        throw detail::parse_error(std::string("Unexpected character '") + c + "'");
+    }
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// pmr::json - basic_json whose strings and containers live in an arena
+//
+//   arena_allocator<T> allocates from the memory resource that is current on
+//   the constructing thread (std::pmr::get_default_resource() unless an
+//   arena_scope is active). Installing a std::pmr::monotonic_buffer_resource
+//   per message puts every node of the tree - parsed or built - in one arena,
+//   so teardown is a pointer reset (release()) instead of one free per node.
+//
+//   Copies are allocated from the resource current at the point of the copy:
+//   copying a value under another arena's scope moves it into that arena.
+//   Every value must be destroyed before its arena is released.
+// ---------------------------------------------------------------------------
+namespace detail {
+inline std::pmr::memory_resource*& current_arena() noexcept {
+    thread_local std::pmr::memory_resource* r = nullptr;
+    return r;
+}
+} // namespace detail
+
+namespace pmr {
+
+inline std::pmr::memory_resource* current_resource() noexcept {
+    std::pmr::memory_resource* r = detail::current_arena();
+    return r ? r : std::pmr::get_default_resource();
+}
+
+// Makes `r` the current resource of this thread until the scope ends (nests).
+class arena_scope {
+public:
+    explicit arena_scope(std::pmr::memory_resource* r) noexcept : m_prev(detail::current_arena()) {
+        detail::current_arena() = r;
+    }
+    ~arena_scope() { detail::current_arena() = m_prev; }
+
+    arena_scope(const arena_scope&) = delete;
+    arena_scope& operator=(const arena_scope&) = delete;
+
+private:
+    std::pmr::memory_resource* m_prev;
+};
+
+template<typename T>
+class arena_allocator {
+public:
+    using value_type = T;
+
+    arena_allocator() noexcept : m_resource(current_resource()) {}
+    arena_allocator(std::pmr::memory_resource* r) noexcept : m_resource(r) {}
+    template<typename U>
+    arena_allocator(const arena_allocator<U>& other) noexcept : m_resource(other.resource()) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(m_resource->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* p, size_t n) noexcept {
+        m_resource->deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    // container copies draw from the arena current at the copy, not the source's
+    arena_allocator select_on_container_copy_construction() const noexcept { return arena_allocator(); }
+
+    std::pmr::memory_resource* resource() const noexcept { return m_resource; }
+
+private:
+    std::pmr::memory_resource* m_resource;
+};
+
+template<typename T, typename U>
+bool operator==(const arena_allocator<T>& a, const arena_allocator<U>& b) noexcept {
+    return a.resource() == b.resource() || a.resource()->is_equal(*b.resource());
+}
+
+template<typename T, typename U>
+bool operator!=(const arena_allocator<T>& a, const arena_allocator<U>& b) noexcept { return !(a == b); }
+
+using json = basic_json<arena_allocator>;
+using ordered_json = basic_json<arena_allocator, ordered_objects>;
+
+} // namespace pmr
+
+// ---------------------------------------------------------------------------
+// lazy_json - on-demand view produced by json::parse_lazy()
+//
+//   The input is validated once (detail::skip_value: nothing is built, and
+//   nesting beyond detail::json_max_depth is rejected) and then read on
+//   access, as with simdjson's on-demand API. An object records the key and
+//   byte range of each member as a lookup scans past it, so
+//   payload["action"] stops at "action" and a later lookup resumes where the
+//   last one stopped; member values are stepped over, not parsed. Arrays are
+//   walked element by element and scalars are converted when read. The
+//   member records come from the current pmr arena (pmr::current_resource()).
+//
+//   The read API mirrors basic_json (is_*(), contains(), operator[], size(),
+//   range-for over arrays, get<T>()), so code templated on the json type
+//   works with either. get<std::string_view>() needs a string without
+//   escapes; use get<std::string>() otherwise. to_json<BasicJson>() builds
+//   an owning tree of a subtree.
+//
+//   Lifetime: the buffer must outlive every view derived from it. Views are
+//   not thread-safe (lookups update the member records).
+// ---------------------------------------------------------------------------
+class lazy_json {
+public:
+    using number_t = double;
+    using number_integer_t = int64_t;
+
+    lazy_json() noexcept : m_text("null") {}
+
+    // `text` must already hold exactly one valid JSON value (for example a
+    // span recorded after detail::skip_value()); use parse() otherwise. The
+    // member skips and to_json() then recurse no deeper than that validation.
+    explicit lazy_json(std::string_view text) noexcept : m_text(text) {}
+
+    static lazy_json parse(std::string_view s) {
+        size_t start = detail::skip_ws(s, 0);
+        size_t idx = start;
+        detail::skip_value(s, idx);
+        if (detail::skip_ws(s, idx) != s.size()) throw detail::parse_error("Extra characters after JSON value");
+        return lazy_json(s.substr(start, idx - start));
+    }
+
+    // type queries (from the first byte)
+    bool is_null() const noexcept { return m_text[0] == 'n'; }
+    bool is_boolean() const noexcept { return m_text[0] == 't' || m_text[0] == 'f'; }
+    bool is_number() const noexcept { return m_text[0] == '-' || (m_text[0] >= '0' && m_text[0] <= '9'); }
+    bool is_string() const noexcept { return m_text[0] == '"'; }
+    bool is_array() const noexcept { return m_text[0] == '['; }
+    bool is_object() const noexcept { return m_text[0] == '{'; }
+
+    // same rule as basic_json: exact int64, or an integral double that fits
+    bool is_number_integer() const noexcept {
+        if (!is_number()) return false;
+        int64_t i;
+        double d;
+        try {
+            if (number(i, d)) return true;
+        } catch (const detail::parse_error&) {
+            return false; // out of double range
+        }
+        constexpr double lo = static_cast<double>(std::numeric_limits<long long>::min());
+        return std::trunc(d) == d && d >= lo && d < -lo;
+    }
+
+    bool contains(std::string_view key) const {
+        return is_object() && find(key) != nullptr;
+    }
+
+    lazy_json operator[](std::string_view key) const {
+        if (!is_object()) throw detail::type_error("not an object");
+        const member* m = find(key);
+        if (!m) throw detail::type_error("key not found in object");
+        return lazy_json(m->value);
+    }
+
+    lazy_json operator[](size_t idx) const {
+        for (const_iterator it = begin(); it != end(); ++it, --idx)
+            if (idx == 0) return *it;
+        throw detail::type_error("array index out of range");
+    }
+
+    // arrays: elements (a walk); objects: members as written; scalars: 0
+    size_t size() const {
+        if (is_object()) {
+            find(std::string_view(), true);
+            return m_members.size();
+        }
+        size_t n = 0;
+        if (is_array()) for (const_iterator it = begin(); it != end(); ++it) ++n;
+        return n;
+    }
+
+    // forward iteration over array elements
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = lazy_json;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = lazy_json;
+
+        const_iterator() noexcept = default;
+        const_iterator(std::string_view text, size_t pos) : m_text(text), m_pos(pos) { measure(); }
+
+        lazy_json operator*() const noexcept { return lazy_json(m_text.substr(m_pos, m_end - m_pos)); }
+        const_iterator& operator++() {
+            size_t idx = detail::skip_ws(m_text, m_end);
+            m_pos = m_text[idx] == ',' ? detail::skip_ws(m_text, idx + 1) : npos;
+            measure();
+            return *this;
+        }
+        const_iterator operator++(int) { const_iterator old = *this; ++*this; return old; }
+        bool operator==(const const_iterator& o) const noexcept { return m_pos == o.m_pos; }
+        bool operator!=(const const_iterator& o) const noexcept { return m_pos != o.m_pos; }
+
+    private:
+        static constexpr size_t npos = std::string_view::npos;
+        void measure() {
+            if (m_pos == npos) return;
+            m_end = m_pos;
+            detail::skip_value(m_text, m_end);
+        }
+        std::string_view m_text;
+        size_t m_pos = npos;
+        size_t m_end = npos;
+    };
+
+    const_iterator begin() const {
+        if (!is_array()) throw detail::type_error("not an array");
+        size_t first = detail::skip_ws(m_text, 1);
+        return m_text[first] == ']' ? end() : const_iterator(m_text, first);
+    }
+    const_iterator end() const noexcept { return const_iterator(); }
+
+    template<typename T>
+    T get() const {
+        if constexpr (std::is_same_v<T, std::string>) {
+            if (!is_string()) throw detail::type_error("not a string");
+            std::string out;
+            size_t at = 0;
+            detail::decode_string(m_text, at, out);
+            return out;
+        } else if constexpr (std::is_same_v<T, std::string_view>) {
+            if (!is_string()) throw detail::type_error("not a string");
+            std::string_view body = m_text.substr(1, m_text.size() - 2);
+            if (body.find('\\') != std::string_view::npos)
+                throw detail::type_error("string has escapes (use get<std::string>())");
+            return body;
+        } else if constexpr (std::is_same_v<T, bool>) {
+            if (!is_boolean()) throw detail::type_error("not a boolean");
+            return m_text[0] == 't';
+        } else if constexpr (std::is_same_v<T, number_t>) {
+            if (!is_number()) throw detail::type_error("not a number");
+            int64_t i;
+            double d;
+            return number(i, d) ? static_cast<number_t>(i) : d;
+        } else if constexpr (std::is_integral_v<T>) {
+            if (!is_number()) throw detail::type_error("not a number");
+            int64_t i;
+            double d;
+            return number(i, d) ? static_cast<T>(i) : static_cast<T>(d);
+        } else {
+            static_assert(sizeof(T) == 0, "unsupported get<T>() type (use to_json())");
+        }
+    }
+
+    // owning tree of this (sub)value
+    template<typename BasicJson = basic_json<>>
+    BasicJson to_json() const { return BasicJson::parse(m_text); }
+
+    // the JSON text of this value, as in the input
+    std::string_view raw() const noexcept { return m_text; }
+
+private:
+    struct member {
+        std::string_view key;   // between the quotes, still escaped if `escaped`
+        std::string_view value; // the member's JSON text
+        bool escaped;
+    };
+
+    bool number(int64_t& exact, double& d) const {
+        size_t idx = 0;
+        return detail::scan_number_exact(m_text, idx, exact, d);
+    }
+
+    static bool key_matches(const member& m, std::string_view key) {
+        if (!m.escaped) return m.key == key;
+        std::string decoded;
+        size_t at = 0;
+        detail::decode_string(std::string_view(m.key.data() - 1, m.key.size() + 2), at, decoded);
+        return decoded == key;
+    }
+
+    // Members already recorded first, then resume the scan of this object
+    // where the previous lookup stopped (the text is known to be valid).
+    // With `all`, records every member and returns nullptr.
+    const member* find(std::string_view key, bool all = false) const {
+        if (!all)
+            for (const member& m : m_members)
+                if (key_matches(m, key)) return &m;
+        if (m_resume == 0) m_resume = 1; // just past '{'
+        while (m_resume != std::string_view::npos) {
+            size_t idx = detail::skip_ws(m_text, m_resume);
+            if (m_text[idx] == '}') { m_resume = std::string_view::npos; break; }
+            size_t key_at = idx;
+            bool escaped = detail::skip_string(m_text, idx);
+            std::string_view name = m_text.substr(key_at + 1, idx - key_at - 2);
+            idx = detail::skip_ws(m_text, detail::skip_ws(m_text, idx) + 1); // past ':'
+            size_t value_at = idx;
+            detail::skip_value(m_text, idx);
+            m_members.push_back(member{name, m_text.substr(value_at, idx - value_at), escaped});
+            idx = detail::skip_ws(m_text, idx);
+            m_resume = m_text[idx] == ',' ? idx + 1 : std::string_view::npos;
+            if (!all && key_matches(m_members.back(), key)) return &m_members.back();
+        }
+        return nullptr;
+    }
+
+    std::string_view m_text;
+    mutable std::vector<member, pmr::arena_allocator<member>> m_members;
+    mutable size_t m_resume = 0; // offset to continue the member scan; npos when done
+};
+
+template<template<typename> class Allocator, typename ObjectPolicy>
+inline lazy_json basic_json<Allocator, ObjectPolicy>::parse_lazy(std::string_view s) {
+    return lazy_json::parse(s);
+}
+
 } // namespace nlohmann
 
 #endif // OMNIFLOW_THIRD_PARTY_NLOHMANN_JSON_HPP
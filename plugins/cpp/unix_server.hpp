@@ -0,0 +1,492 @@
+/*
+ * unix_server.hpp
+ *
+ * Unix domain socket server mode for the OmniFlow C++ plugin (plugins/cpp)
+ * License: Apache-2.0
+ *
+ * Purpose:
+ *   - Lets one resident plugin process serve many hosts: it listens on a
+ *     SOCK_STREAM Unix socket (OMNIFLOW_PLUGIN_SOCKET) and multiplexes every
+ *     accepted connection through one epoll(7) event loop, so the worker pool,
+ *     caches and metrics are shared instead of duplicated per host.
+ *   - Each connection speaks the stdio protocol unchanged: NDJSON requests are
+ *     split by its own LineFramer (same max_line handling) and its responses go
+ *     through its own CoalescingWriter, so they never interleave with another
+ *     client's.
+ *
+ * Event loop:
+ *   - Level-triggered; sockets are non-blocking. A readable connection is
+ *     served up to FRAMES_PER_WAKEUP frames at a time, then put on a backlog
+ *     so one busy client cannot starve the others. Its output is flushed once
+ *     its input is drained.
+ *   - Nothing on the loop blocks on a slow reader. Each connection's writer is
+ *     a queued CoalescingWriter without a thread: output the socket does not
+ *     take stays in that connection's queue until EPOLLOUT, and a client that
+ *     falls more than max_queued bytes behind is disconnected (counted in
+ *     Stats::overflowed). Writers on other threads (workers, timeouts) post
+ *     their connection to the loop through the eventfd; the loop also runs the
+ *     coalescing window's flush timers.
+ *   - stop() wakes the loop through an eventfd; it only stores a flag and
+ *     writes 8 bytes, so it may be called from a signal handler.
+ *   - Connections beyond max_clients are accepted and closed at once
+ *     (counted in Stats::rejected).
+ *   - Each connection records its peer's pid (SO_PEERCRED) at accept, so
+ *     requests can be checked against the process that sent them.
+ *
+ * Contract:
+ *   - listen() throws std::system_error (bad path, another live server on the
+ *     path, ...). A stale socket file left by a dead server is replaced; the
+ *     socket file is chmod'ed to `mode` and unlinked by the destructor.
+ *   - run() calls `on_frame(conn, frame, read_at)` for every non-empty frame
+ *     and `on_oversized(conn)` for every line over max_line, on the loop
+ *     thread. The frame view is valid only during the call. on_frame returns
+ *     false to close that connection.
+ *   - A Connection is shared: whoever still holds a ConnectionPtr (a queued
+ *     job, a pending timeout) can keep writing to it after the loop dropped
+ *     it. Its fd is closed when the last reference goes, so an fd is never reused
+ *     while a response may still target it. A dropped connection with queued
+ *     output stays watched for EPOLLOUT until the queue is sent.
+ *   - run() and close handling are loop-thread only; stats() and stop() are
+ *     thread-safe.
+ */
+
+#ifndef OMNIFLOW_PLUGIN_UNIX_SERVER_HPP
+#define OMNIFLOW_PLUGIN_UNIX_SERVER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "coalescing_writer.hpp"
+#include "line_framer.hpp"
+
+namespace omniflow {
+
+class UnixServer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t FRAMES_PER_WAKEUP = 64;
+    static constexpr size_t DEFAULT_MAX_CLIENTS = 64;
+    static constexpr size_t DEFAULT_MAX_QUEUED = 4 * 1024 * 1024; // unsent bytes per client
+
+    class Connection;
+    using ConnectionPtr = std::shared_ptr<Connection>;
+
+    // Connections the loop must look at (queued output, a flush timer). Shared
+    // with the connections so a late writer never touches a destroyed server.
+    struct Mailbox {
+        std::mutex mu;
+        std::vector<ConnectionPtr> posted;
+        int wake_fd = -1; // -1 once the server is gone
+
+        void post(ConnectionPtr c) {
+            std::lock_guard<std::mutex> lock(mu);
+            if (wake_fd < 0) return;
+            posted.push_back(std::move(c));
+            if (posted.size() == 1) {
+                uint64_t one = 1;
+                ssize_t r = ::write(wake_fd, &one, sizeof(one));
+                (void)r;
+            }
+        }
+    };
+
+    class Connection : public std::enable_shared_from_this<Connection> {
+    public:
+        Connection(int fd, uint64_t id, size_t max_line, std::chrono::microseconds flush_window,
+                   size_t flush_bytes, size_t max_queued, std::shared_ptr<Mailbox> mailbox, long peer_pid = -1)
+            : fd_{fd}, id_(id), peer_pid_(peer_pid), framer_(fd, max_line),
+              out_(fd, flush_window, flush_bytes, max_queued, [this, mailbox = std::move(mailbox)] {
+                  if (ConnectionPtr self = weak_from_this().lock()) mailbox->post(std::move(self));
+              }) {}
+
+        Connection(const Connection &) = delete;
+        Connection &operator=(const Connection &) = delete;
+
+        uint64_t id() const noexcept { return id_; }
+        // The connecting process (SO_PEERCRED at accept); -1 if unknown
+        long peer_pid() const noexcept { return peer_pid_; }
+        CoalescingWriter &out() noexcept { return out_; }
+
+    private:
+        friend class UnixServer;
+        struct Fd {
+            int fd;
+            ~Fd() { ::close(fd); }
+        };
+        Fd fd_; // first member: closed after out_ has flushed on destruction
+        const uint64_t id_;
+        const long peer_pid_;
+        LineFramer framer_;
+        CoalescingWriter out_;
+        uint32_t events_ = 0; // registered epoll events (loop thread)
+    };
+
+    struct Stats {
+        size_t clients = 0;      // connected now
+        uint64_t accepted = 0;   // since startup
+        uint64_t rejected = 0;   // closed at once: max_clients reached
+        uint64_t overflowed = 0; // disconnected: output queue over max_queued
+    };
+
+    UnixServer(std::string path, size_t max_line, size_t max_clients, std::chrono::microseconds flush_window,
+               size_t flush_bytes, mode_t mode = 0600, size_t max_queued = DEFAULT_MAX_QUEUED)
+        : path_(std::move(path)), max_line_(max_line), max_clients_(max_clients ? max_clients : DEFAULT_MAX_CLIENTS),
+          flush_window_(flush_window), flush_bytes_(flush_bytes), mode_(mode),
+          max_queued_(max_queued ? max_queued : DEFAULT_MAX_QUEUED) {}
+
+    ~UnixServer() {
+        {
+            std::lock_guard<std::mutex> lock(mailbox_->mu);
+            mailbox_->wake_fd = -1;
+            mailbox_->posted.clear();
+        }
+        conns_.clear();
+        draining_.clear();
+        timers_.clear();
+        if (listen_fd_ >= 0) {
+            ::close(listen_fd_);
+            ::unlink(path_.c_str());
+        }
+        if (wake_fd_ >= 0) ::close(wake_fd_);
+        if (epoll_fd_ >= 0) ::close(epoll_fd_);
+    }
+
+    UnixServer(const UnixServer &) = delete;
+    UnixServer &operator=(const UnixServer &) = delete;
+
+    void listen() {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (path_.empty() || path_.size() >= sizeof(addr.sun_path))
+            throw std::system_error(ENAMETOOLONG, std::generic_category(), "socket path '" + path_ + "'");
+        std::memcpy(addr.sun_path, path_.c_str(), path_.size() + 1);
+
+        remove_stale(addr);
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) fail("socket");
+        if (::bind(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0) {
+            int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "bind '" + path_ + "'");
+        }
+        listen_fd_ = fd; // from here on the destructor unlinks the path
+        if (::chmod(path_.c_str(), mode_) != 0) fail("chmod '" + path_ + "'");
+        if (::listen(fd, SOMAXCONN) != 0) fail("listen '" + path_ + "'");
+
+        epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) fail("epoll_create1");
+        wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd_ < 0) fail("eventfd");
+        watch(listen_fd_, LISTEN_TAG);
+        watch(wake_fd_, WAKE_TAG);
+        std::lock_guard<std::mutex> lock(mailbox_->mu);
+        mailbox_->wake_fd = wake_fd_;
+    }
+
+    // Serve until stop(); see the contract above for the callbacks.
+    template <typename OnFrame, typename OnOversized>
+    void run(OnFrame &&on_frame, OnOversized &&on_oversized) {
+        std::vector<epoll_event> events(64);
+        std::vector<ConnectionPtr> ready, backlog;
+        while (!stopping_.load(std::memory_order_acquire)) {
+            int n = ::epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()),
+                                 backlog.empty() ? wait_ms() : 0);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                fail("epoll_wait");
+            }
+            ready.swap(backlog);
+            for (int i = 0; i < n; ++i) {
+                const epoll_event &ev = events[static_cast<size_t>(i)];
+                uint64_t tag = ev.data.u64;
+                if (tag == LISTEN_TAG) {
+                    accept_all();
+                } else if (tag == WAKE_TAG) {
+                    drain_wake();
+                } else if (ConnectionPtr c = find(tag)) {
+                    if (ev.events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+                        c->out_.flush();
+                        tend(c);
+                    }
+                    if ((ev.events & ~uint32_t(EPOLLOUT)) && conns_.count(tag)) ready.push_back(std::move(c));
+                }
+            }
+            take_posted();
+            fire_timers();
+            for (const ConnectionPtr &c : ready) {
+                if (stopping_.load(std::memory_order_acquire)) break;
+                if (conns_.count(c->id_)) serve(c, backlog, on_frame, on_oversized);
+            }
+            ready.clear();
+        }
+        finish();
+    }
+
+    // Make run() return after the frame it is handling. Async-signal-safe.
+    void stop() noexcept {
+        stopping_.store(true, std::memory_order_release);
+        if (wake_fd_ >= 0) {
+            uint64_t one = 1;
+            ssize_t r = ::write(wake_fd_, &one, sizeof(one));
+            (void)r;
+        }
+    }
+
+    Stats stats() const noexcept {
+        return Stats{clients_.load(std::memory_order_relaxed), accepted_.load(std::memory_order_relaxed),
+                     rejected_.load(std::memory_order_relaxed), overflowed_.load(std::memory_order_relaxed)};
+    }
+
+    const std::string &path() const noexcept { return path_; }
+    size_t max_clients() const noexcept { return max_clients_; }
+    size_t max_queued() const noexcept { return max_queued_; }
+
+private:
+    static constexpr uint64_t LISTEN_TAG = ~uint64_t(0);
+    static constexpr uint64_t WAKE_TAG = ~uint64_t(0) - 1;
+    static constexpr std::chrono::seconds FINAL_DRAIN{5}; // run() returning: time left to slow readers
+
+    [[noreturn]] static void fail(const std::string &what) {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    // A socket file nobody accepts on is left over from a dead server: remove
+    // it. One that still accepts belongs to a live server: refuse to steal it.
+    void remove_stale(const sockaddr_un &addr) {
+        struct stat st;
+        if (::lstat(path_.c_str(), &st) != 0 || !S_ISSOCK(st.st_mode)) return;
+        int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (probe < 0) fail("socket");
+        bool live = ::connect(probe, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) == 0;
+        ::close(probe);
+        if (live) throw std::system_error(EADDRINUSE, std::generic_category(), "another server listens on '" + path_ + "'");
+        ::unlink(path_.c_str());
+    }
+
+    void watch(int fd, uint64_t tag) {
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = tag;
+        if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) != 0) fail("epoll_ctl");
+    }
+
+    void drain_wake() {
+        uint64_t v;
+        while (::read(wake_fd_, &v, sizeof(v)) > 0) {}
+    }
+
+    void accept_all() {
+        for (;;) {
+            int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR) continue;
+                return; // EAGAIN, or out of fds: retried on the next wakeup
+            }
+            if (conns_.size() >= max_clients_) {
+                rejected_.fetch_add(1, std::memory_order_relaxed);
+                ::close(fd);
+                continue;
+            }
+            uint64_t id = ++next_id_;
+            auto c = std::make_shared<Connection>(fd, id, max_line_, flush_window_, flush_bytes_, max_queued_,
+                                                  mailbox_, peer_pid_of(fd));
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLRDHUP;
+            ev.data.u64 = id;
+            if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) != 0) continue; // c closes fd
+            c->events_ = ev.events;
+            conns_.emplace(id, std::move(c));
+            clients_.store(conns_.size(), std::memory_order_relaxed);
+            accepted_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    static long peer_pid_of(int fd) noexcept {
+        ucred cred{};
+        socklen_t len = sizeof(cred);
+        if (::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0 || cred.pid <= 0) return -1;
+        return static_cast<long>(cred.pid);
+    }
+
+    ConnectionPtr find(uint64_t id) const {
+        if (auto it = conns_.find(id); it != conns_.end()) return it->second;
+        if (auto it = draining_.find(id); it != draining_.end()) return it->second;
+        return nullptr;
+    }
+
+    // Stop reading from a connection. Its fd stays open (and writable) until
+    // the last ConnectionPtr is released.
+    void drop(const ConnectionPtr &c) {
+        ::shutdown(c->fd_.fd, SHUT_RD);
+        conns_.erase(c->id_);
+        clients_.store(conns_.size(), std::memory_order_relaxed);
+        c->out_.flush();
+        tend(c);
+    }
+
+    // Bring a connection's epoll registration in line with its state: read
+    // while it is connected, EPOLLOUT while its writer has a backlog. A client
+    // whose writer overflowed is cut off.
+    void tend(const ConnectionPtr &c) {
+        bool reading = conns_.count(c->id_) != 0;
+        if (c->out_.overflowed()) {
+            if (reading) {
+                overflowed_.fetch_add(1, std::memory_order_relaxed);
+                conns_.erase(c->id_);
+                clients_.store(conns_.size(), std::memory_order_relaxed);
+            }
+            ::shutdown(c->fd_.fd, SHUT_RDWR);
+            reading = false;
+        }
+        uint32_t want = (reading ? uint32_t(EPOLLIN | EPOLLRDHUP) : 0) | (c->out_.backlog() ? uint32_t(EPOLLOUT) : 0);
+        if (want != c->events_) {
+            epoll_event ev{};
+            ev.events = want;
+            ev.data.u64 = c->id_;
+            int op = c->events_ == 0 ? EPOLL_CTL_ADD : want == 0 ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+            if (::epoll_ctl(epoll_fd_, op, c->fd_.fd, want ? &ev : nullptr) == 0) c->events_ = want;
+        }
+        if (!reading && c->events_ != 0) draining_.emplace(c->id_, c);
+        else draining_.erase(c->id_);
+    }
+
+    // Connections posted by their writers: a backlog to watch, or lines for
+    // the coalescing timer.
+    void take_posted() {
+        std::vector<ConnectionPtr> posted;
+        {
+            std::lock_guard<std::mutex> lock(mailbox_->mu);
+            posted.swap(mailbox_->posted);
+        }
+        for (ConnectionPtr &c : posted) {
+            tend(c);
+            if (c->out_.flush_deadline() != Clock::time_point::max()) timers_.push_back(std::move(c));
+        }
+    }
+
+    void fire_timers() {
+        Clock::time_point now = Clock::now();
+        for (size_t i = 0; i < timers_.size();) {
+            ConnectionPtr &c = timers_[i];
+            Clock::time_point due = c->out_.flush_deadline();
+            if (due <= now) {
+                c->out_.flush();
+                tend(c);
+            }
+            if (due <= now || due == Clock::time_point::max()) {
+                timers_[i] = std::move(timers_.back());
+                timers_.pop_back();
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    // epoll_wait timeout: until the earliest flush timer, or forever
+    int wait_ms() const {
+        Clock::time_point next = Clock::time_point::max();
+        for (const ConnectionPtr &c : timers_) next = std::min(next, c->out_.flush_deadline());
+        if (next == Clock::time_point::max()) return -1;
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(next - Clock::now()).count();
+        return left <= 0 ? 0 : static_cast<int>(left) + 1;
+    }
+
+    // run() is returning: flush every connection, then give the ones with a
+    // backlog up to FINAL_DRAIN to take it.
+    void finish() {
+        take_posted();
+        for (auto &entry : conns_) entry.second->out_.flush();
+        std::vector<ConnectionPtr> all;
+        for (auto &entry : conns_) all.push_back(entry.second);
+        for (auto &entry : draining_) all.push_back(entry.second);
+        Clock::time_point deadline = Clock::now() + FINAL_DRAIN;
+        std::vector<pollfd> fds;
+        for (;;) {
+            fds.clear();
+            for (const ConnectionPtr &c : all)
+                if (c->out_.backlog()) fds.push_back(pollfd{c->fd_.fd, POLLOUT, 0});
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            if (fds.empty() || left <= 0) return;
+            int r = ::poll(fds.data(), fds.size(), static_cast<int>(left));
+            if (r == 0 || (r < 0 && errno != EINTR)) return;
+            for (const ConnectionPtr &c : all) c->out_.flush();
+        }
+    }
+
+    template <typename OnFrame, typename OnOversized>
+    void serve(const ConnectionPtr &c, std::vector<ConnectionPtr> &backlog, OnFrame &on_frame,
+               OnOversized &on_oversized) {
+        std::string_view frame;
+        for (size_t budget = FRAMES_PER_WAKEUP;; --budget) {
+            if (budget == 0) {
+                backlog.push_back(c);
+                break;
+            }
+            LineFramer::Status st = c->framer_.next(frame);
+            if (st == LineFramer::Status::Again) break;
+            if (st == LineFramer::Status::Eof) {
+                drop(c);
+                return;
+            }
+            if (st == LineFramer::Status::Oversized) {
+                on_oversized(c);
+                continue;
+            }
+            if (frame.empty()) continue;
+            if (!on_frame(c, frame, Clock::now())) {
+                drop(c);
+                return;
+            }
+            if (stopping_.load(std::memory_order_acquire)) break;
+        }
+        c->out_.flush();
+    }
+
+    const std::string path_;
+    const size_t max_line_;
+    const size_t max_clients_;
+    const std::chrono::microseconds flush_window_;
+    const size_t flush_bytes_;
+    const mode_t mode_;
+    const size_t max_queued_;
+
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+    uint64_t next_id_ = 0;
+    std::unordered_map<uint64_t, ConnectionPtr> conns_;
+    std::unordered_map<uint64_t, ConnectionPtr> draining_; // dropped, output still queued
+    std::vector<ConnectionPtr> timers_;                    // buffered lines waiting for the window
+    std::shared_ptr<Mailbox> mailbox_ = std::make_shared<Mailbox>();
+    std::atomic<bool> stopping_{false};
+    std::atomic<size_t> clients_{0};
+    std::atomic<uint64_t> accepted_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> overflowed_{0};
+};
+
+} // namespace omniflow
+
+#endif // OMNIFLOW_PLUGIN_UNIX_SERVER_HPP
@@ -0,0 +1,302 @@
+/*
+ * worker_pool.hpp
+ *
+ * Sharded FIFO worker pool with priority lanes for the OmniFlow C++ plugin
+ * (plugins/cpp)
+ * License: Apache-2.0
+ *
+ * Purpose:
+ *   - Runs `exec` work off the stdin reader thread so one slow request does not
+ *     block every request queued behind it (see "Request processing model" in
+ *     plugins/common/protocol.md).
+ *   - The pool has a fixed number of threads chosen at startup (started with
+ *     the pool, or with its first task when constructed lazy, so a process
+ *     that never queues work never pays for them). Each worker
+ *     owns one FIFO shard per lane; submissions are spread over the shards
+ *     round-robin, and a worker takes the oldest task of its own shard or,
+ *     when that is empty, of the next non-empty one. There is no single queue
+ *     lock for every task to go through. This is not work stealing in the
+ *     Chase-Lev sense: tasks come from the reader, not from workers, and
+ *     every shard is consumed oldest first to keep submission order.
+ *   - Two lanes: Control for short requests that must stay responsive, Bulk
+ *     for everything else. A worker always looks at Control first, and Bulk
+ *     tasks may occupy at most size() - 1 workers (all of them with one
+ *     worker), so a Control task never waits for a Bulk backlog to drain.
+ *   - Admission control: try_submit() refuses a task once the tasks in flight
+ *     (queued or running) in its lane or the bytes they hold reach the pool's
+ *     Limits, so a burst is answered `busy` instead of growing the queue
+ *     without bound. Each lane is admitted on its own: a Bulk flood never
+ *     refuses Control work. The mean task time it tracks lets callers
+ *     estimate when to retry.
+ *
+ * Contract:
+ *   - Tasks must not throw. The plugin wraps every handler so that exactly one
+ *     response is emitted per request id, even on failure; the pool only guards
+ *     against escaping exceptions to keep the worker alive.
+ *   - submit() ignores the limits; a task refused by try_submit() is not run
+ *     and the caller answers its request itself. Limits are exact for one
+ *     submitting thread (the plugin's reader) and approximate for several.
+ *   - Tasks of one lane start roughly in submission order; there is no
+ *     ordering between lanes.
+ *   - drain() blocks until every lane is empty and no task is running. It is
+ *     used before acknowledging `shutdown` and on EOF so in-flight ids get
+ *     answered.
+ *   - The destructor drains, stops and joins all workers.
+ */
+
+#ifndef OMNIFLOW_PLUGIN_WORKER_POOL_HPP
+#define OMNIFLOW_PLUGIN_WORKER_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace omniflow {
+
+class WorkerPool {
+public:
+    using Task = std::function<void()>;
+
+    enum class Lane : size_t { Control = 0, Bulk = 1 };
+    static constexpr size_t LANES = 2;
+
+    // Per lane; 0 = unbounded
+    struct Limits {
+        size_t max_inflight = 0;
+        size_t max_bytes = 0;
+    };
+
+    explicit WorkerPool(size_t threads) : WorkerPool(threads, Limits()) {}
+
+    // lazy: the threads start with the first submitted task, not here
+    WorkerPool(size_t threads, Limits limits, bool lazy = false) : limits_(limits) {
+        if (threads == 0) threads = 1;
+        bulk_slots_ = threads > 1 ? threads - 1 : 1;
+        workers_.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) workers_.push_back(std::make_unique<Worker>());
+        if (!lazy) start();
+    }
+
+    ~WorkerPool() {
+        drain();
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stopping_ = true;
+        }
+        work_cv_.notify_all();
+        for (auto &t : threads_) {
+            if (t.joinable()) t.join();
+        }
+    }
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    // Queue a task; returns immediately.
+    void submit(Task task, Lane lane = Lane::Bulk) {
+        LaneState &ls = lane_state(lane);
+        ls.inflight.fetch_add(1);
+        enqueue(std::move(task), 0, lane);
+    }
+
+    // Queue a task holding `bytes` (released when it finishes) unless that would
+    // exceed its lane's limits; false means it was refused. With nothing in
+    // flight in the lane a task is always admitted, so one oversized request
+    // still runs.
+    bool try_submit(Task task, size_t bytes, Lane lane = Lane::Bulk) {
+        LaneState &ls = lane_state(lane);
+        size_t inflight = ls.inflight.load();
+        if (inflight > 0) {
+            if (limits_.max_inflight && inflight >= limits_.max_inflight) return false;
+            if (limits_.max_bytes && ls.bytes.load() + bytes > limits_.max_bytes) return false;
+        }
+        ls.inflight.fetch_add(1);
+        ls.bytes.fetch_add(bytes);
+        enqueue(std::move(task), bytes, lane);
+        return true;
+    }
+
+    // Block until every queued and running task has finished.
+    void drain() {
+        std::unique_lock<std::mutex> lock(mu_);
+        idle_cv_.wait(lock, [this] { return pending() == 0; });
+    }
+
+    size_t size() const noexcept { return workers_.size(); }
+
+    // False until the threads are running (a lazy pool before its first task).
+    bool started() const noexcept { return started_.load(std::memory_order_acquire); }
+
+    // Workers that may run Bulk tasks at once; the rest stay free for Control.
+    size_t bulk_slots() const noexcept { return bulk_slots_; }
+
+    // Tasks queued or running (approximate; for diagnostics only).
+    size_t pending() const noexcept { return pending(Lane::Control) + pending(Lane::Bulk); }
+    size_t pending(Lane lane) const noexcept { return lane_state(lane).inflight.load(std::memory_order_relaxed); }
+
+    // Bytes held by tasks admitted through try_submit() and not yet finished.
+    size_t pending_bytes() const noexcept {
+        return lanes_[0].bytes.load(std::memory_order_relaxed) + lanes_[1].bytes.load(std::memory_order_relaxed);
+    }
+
+    const Limits &limits() const noexcept { return limits_; }
+
+    // Moving average of task run time (zero before the first task finishes).
+    std::chrono::microseconds mean_task_time() const noexcept {
+        return std::chrono::microseconds(mean_task_us_.load(std::memory_order_relaxed));
+    }
+
+private:
+    struct Queued {
+        Task task;
+        size_t bytes = 0; // released when the task finishes
+    };
+
+    // One worker's shards, one FIFO per lane
+    struct Worker {
+        std::mutex mu;
+        std::deque<Queued> lanes[LANES];
+    };
+
+    struct LaneState {
+        std::atomic<size_t> inflight{0}; // queued or running
+        std::atomic<size_t> queued{0};   // in some worker's shard
+        std::atomic<size_t> bytes{0};
+    };
+
+    LaneState &lane_state(Lane lane) noexcept { return lanes_[static_cast<size_t>(lane)]; }
+    const LaneState &lane_state(Lane lane) const noexcept { return lanes_[static_cast<size_t>(lane)]; }
+
+    void start() {
+        threads_.reserve(workers_.size());
+        for (size_t i = 0; i < workers_.size(); ++i) threads_.emplace_back([this, i] { run(i); });
+        started_.store(true, std::memory_order_release);
+    }
+
+    void enqueue(Task task, size_t bytes, Lane lane) {
+        if (!started()) std::call_once(start_once_, [this] { start(); });
+        Worker &w = *workers_[next_.fetch_add(1, std::memory_order_relaxed) % workers_.size()];
+        // counted before it is visible, so `queued` never underflows; a
+        // worker seeing the count first just looks again
+        lane_state(lane).queued.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lock(w.mu);
+            w.lanes[static_cast<size_t>(lane)].push_back({std::move(task), bytes});
+        }
+        wake();
+    }
+
+    // Pairs with the sleepers_ increment in run(): either the sleeper sees the
+    // new work or this sees the sleeper (both are seq_cst)
+    void wake() {
+        if (sleepers_.load() == 0) return;
+        { std::lock_guard<std::mutex> lock(mu_); }
+        work_cv_.notify_one();
+    }
+
+    bool runnable() const noexcept {
+        return lanes_[0].queued.load() > 0 || (lanes_[1].queued.load() > 0 && bulk_running_.load() < bulk_slots_);
+    }
+
+    // The oldest task of `lane`, from worker `self`'s shard first, then from the others'
+    bool take(size_t self, Lane lane, Queued &out) {
+        size_t l = static_cast<size_t>(lane);
+        for (size_t k = 0; k < workers_.size(); ++k) {
+            Worker &w = *workers_[(self + k) % workers_.size()];
+            std::lock_guard<std::mutex> lock(w.mu);
+            if (w.lanes[l].empty()) continue;
+            out = std::move(w.lanes[l].front());
+            w.lanes[l].pop_front();
+            lanes_[l].queued.fetch_sub(1);
+            return true;
+        }
+        return false;
+    }
+
+    // Control first; Bulk only while a bulk slot is free
+    bool next_task(size_t self, Queued &out, Lane &lane) {
+        if (lanes_[0].queued.load() > 0 && take(self, Lane::Control, out)) {
+            lane = Lane::Control;
+            return true;
+        }
+        if (lanes_[1].queued.load() == 0) return false;
+        size_t running = bulk_running_.load();
+        do {
+            if (running >= bulk_slots_) return false;
+        } while (!bulk_running_.compare_exchange_weak(running, running + 1));
+        if (take(self, Lane::Bulk, out)) {
+            lane = Lane::Bulk;
+            return true;
+        }
+        bulk_running_.fetch_sub(1);
+        return false;
+    }
+
+    void run(size_t self) {
+        for (;;) {
+            Queued job;
+            Lane lane = Lane::Bulk;
+            if (!next_task(self, job, lane)) {
+                std::unique_lock<std::mutex> lock(mu_);
+                sleepers_.fetch_add(1);
+                work_cv_.wait(lock, [this] { return stopping_ || runnable(); });
+                sleepers_.fetch_sub(1);
+                if (stopping_ && !runnable()) return; // stopping and nothing left
+                continue;
+            }
+            auto started = std::chrono::steady_clock::now();
+            try {
+                job.task();
+            } catch (...) {
+                // Handlers report their own failures; never let one kill a worker.
+            }
+            record_task_time(std::chrono::steady_clock::now() - started);
+            job.task = nullptr; // release captures before the task counts as done
+            LaneState &ls = lane_state(lane);
+            ls.bytes.fetch_sub(job.bytes);
+            if (lane == Lane::Bulk && bulk_running_.fetch_sub(1) == bulk_slots_ && ls.queued.load() > 0)
+                wake(); // a slot opened: a parked worker may take the next one
+            if (ls.inflight.fetch_sub(1) == 1 && pending() == 0) {
+                std::lock_guard<std::mutex> lock(mu_);
+                idle_cv_.notify_all();
+            }
+        }
+    }
+
+    // EWMA with weight 1/8; racing updates may lose a sample, which is fine here
+    void record_task_time(std::chrono::steady_clock::duration d) noexcept {
+        auto us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+        uint64_t mean = mean_task_us_.load(std::memory_order_relaxed);
+        mean_task_us_.store(mean ? mean - mean / 8 + us / 8 : std::max<uint64_t>(us, 1), std::memory_order_relaxed);
+    }
+
+    const Limits limits_;
+    size_t bulk_slots_ = 1;
+    std::atomic<uint64_t> mean_task_us_{0};
+    LaneState lanes_[LANES];
+    std::atomic<size_t> bulk_running_{0};
+    std::atomic<size_t> next_{0};     // round-robin target of the next submission
+    std::atomic<size_t> sleepers_{0}; // workers parked on work_cv_
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex mu_; // parking only
+    std::condition_variable work_cv_;
+    std::condition_variable idle_cv_;
+    bool stopping_ = false;
+    std::once_flag start_once_;
+    std::atomic<bool> started_{false};
+    std::vector<std::thread> threads_;
+};
+
+} // namespace omniflow
+
+#endif // OMNIFLOW_PLUGIN_WORKER_POOL_HPP